@@ -0,0 +1,329 @@
+// bench-harness.hh - a minimal harness for micro-benchmarks
+//
+// The interface follows Google Benchmark (which is not available here), so
+// benchmarks can be moved to it easily:
+//
+//   void BM_op(bench::State& state)
+//   {
+//     Nfa aut = generate(state.range(0));      // setup (not measured)
+//     for (auto _ : state) { op(aut); }       // the measured loop
+//   }
+//   BENCHMARK(BM_op)->Args({100, 2})->Args({1000, 2});
+//   BENCHMARK_MAIN();
+//
+// Every benchmark is run with an increasing number of iterations until it runs
+// for at least --min-time seconds.  Results are printed as a table and, with
+// --json=<file>, written in the JSON format of Google Benchmark (so that its
+// tools/compare.py can compare two runs).  --filter=<regex> selects
+// benchmarks by their names (e.g., "BM_op/100/2").
+
+#ifndef _VATA2_BENCH_HARNESS_HH_
+#define _VATA2_BENCH_HARNESS_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+
+/// the state of a running benchmark
+class State
+{
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<int64_t> args;
+	size_t max_iterations;
+	size_t items_processed;
+
+	Clock::time_point start_real;
+	std::clock_t start_cpu;
+	double real_time;
+	double cpu_time;
+
+	/// the iterator of the measured loop
+	class Iterator
+	{
+	private:
+		State* state;
+		size_t left;
+
+	public:
+		Iterator(State* state, size_t left) : state(state), left(left) { }
+
+		/// the value of the loop variable (which is not used)
+		struct __attribute__((unused)) Value { };
+
+		Value operator*() const { return Value(); }
+		Iterator& operator++() { --this->left; return *this; }
+		bool operator!=(const Iterator& rhs)
+		{
+			if (this->left != rhs.left) { return true; }
+			this->state->stop_timer();
+			return false;
+		}
+	};
+
+public:
+
+	State(const std::vector<int64_t>& args, size_t max_iterations) :
+		args(args),
+		max_iterations(max_iterations),
+		items_processed(0),
+		start_real(),
+		start_cpu(),
+		real_time(0),
+		cpu_time(0)
+	{ }
+
+	/// the @p i-th argument of the benchmark
+	int64_t range(size_t i) const { return this->args.at(i); }
+
+	size_t iterations() const { return this->max_iterations; }
+
+	/// stops measuring (e.g., for a setup inside of the loop)
+	void PauseTiming() { this->stop_timer(); }
+	/// continues measuring
+	void ResumeTiming() { this->start_timer(); }
+
+	/// the number of processed items (e.g., transitions) to report their rate
+	void SetItemsProcessed(size_t items) { this->items_processed = items; }
+
+	double get_real_time() const { return this->real_time; }
+	double get_cpu_time() const { return this->cpu_time; }
+	size_t get_items_processed() const { return this->items_processed; }
+
+	void start_timer()
+	{
+		this->start_real = Clock::now();
+		this->start_cpu = std::clock();
+	}
+
+	void stop_timer()
+	{
+		std::chrono::duration<double> elapsed = Clock::now() - this->start_real;
+		this->real_time += elapsed.count();
+		this->cpu_time += static_cast<double>(std::clock() - this->start_cpu) /
+			CLOCKS_PER_SEC;
+	}
+
+	Iterator begin()
+	{
+		this->start_timer();
+		return Iterator(this, this->max_iterations);
+	}
+
+	Iterator end() { return Iterator(this, 0); }
+};
+
+using Function = void (*)(State&);
+
+/// a registered benchmark with lists of arguments
+class Benchmark
+{
+private:
+
+	std::string name;
+	Function func;
+	std::vector<std::vector<int64_t>> args_list;
+
+public:
+
+	Benchmark(const std::string& name, Function func) :
+		name(name), func(func), args_list()
+	{ }
+
+	/// adds a run with the arguments @p args
+	Benchmark* Args(const std::vector<int64_t>& args)
+	{
+		this->args_list.push_back(args);
+		return this;
+	}
+
+	/// adds a run with the argument @p arg
+	Benchmark* Arg(int64_t arg) { return this->Args({arg}); }
+
+	const std::string& get_name() const { return this->name; }
+	Function get_function() const { return this->func; }
+
+	/// lists of arguments of runs (a single empty one if none was added)
+	std::vector<std::vector<int64_t>> get_args_list() const
+	{
+		if (this->args_list.empty()) { return {{}}; }
+		return this->args_list;
+	}
+};
+
+/// all registered benchmarks
+inline std::vector<Benchmark*>& get_benchmarks()
+{
+	static std::vector<Benchmark*> benchmarks;
+	return benchmarks;
+}
+
+inline Benchmark* register_benchmark(const std::string& name, Function func)
+{
+	get_benchmarks().push_back(new Benchmark(name, func));
+	return get_benchmarks().back();
+}
+
+/// prevents the compiler from optimizing away the computation of @p value
+template <class T>
+inline void DoNotOptimize(const T& value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// the result of a run of a benchmark
+struct Result
+{
+	std::string name;
+	size_t iterations;
+	/// times per iteration in nanoseconds
+	double real_time;
+	double cpu_time;
+	/// processed items per second (0 if not set)
+	double items_per_second;
+};
+
+/// runs @p bench with @p args for at least @p min_time seconds
+inline Result run(const Benchmark& bench, const std::vector<int64_t>& args,
+	double min_time)
+{
+	std::string name = bench.get_name();
+	for (int64_t arg : args) { name += "/" + std::to_string(arg); }
+
+	size_t iterations = 1;
+	while (true) {
+		State state(args, iterations);
+		bench.get_function()(state);
+
+		const size_t MAX_ITERATIONS = 1000000000;
+		if (state.get_real_time() >= min_time || iterations >= MAX_ITERATIONS) {
+			double items = static_cast<double>(state.get_items_processed());
+			return Result{name, iterations,
+				1e9 * state.get_real_time() / iterations,
+				1e9 * state.get_cpu_time() / iterations,
+				(state.get_real_time() > 0)? items / state.get_real_time() : 0};
+		}
+
+		// the next number of iterations is estimated from the time (and it is
+		// at most 10 times larger)
+		double factor = (state.get_real_time() > 0)?
+			1.4 * min_time / state.get_real_time() : 10;
+		if (factor > 10) { factor = 10; }
+		size_t next = static_cast<size_t>(iterations * factor);
+		iterations = (next > iterations)? next : iterations + 1;
+	}
+}
+
+/// writes @p results to @p os in the JSON format of Google Benchmark
+inline void write_json(std::ostream& os, const std::string& executable,
+	const std::vector<Result>& results)
+{
+	std::time_t now = std::time(nullptr);
+	char date[64];
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	os << "{\n  \"context\": {\n";
+	os << "    \"date\": \"" << date << "\",\n";
+	os << "    \"executable\": \"" << executable << "\",\n";
+	os << "    \"library_build_type\": \"release\"\n";
+	os << "  },\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& res = results[i];
+		os << "    {\n";
+		os << "      \"name\": \"" << res.name << "\",\n";
+		os << "      \"run_name\": \"" << res.name << "\",\n";
+		os << "      \"run_type\": \"iteration\",\n";
+		os << "      \"iterations\": " << res.iterations << ",\n";
+		os << "      \"real_time\": " << std::setprecision(10) << res.real_time << ",\n";
+		os << "      \"cpu_time\": " << res.cpu_time << ",\n";
+		if (res.items_per_second > 0) {
+			os << "      \"items_per_second\": " << res.items_per_second << ",\n";
+		}
+		os << "      \"time_unit\": \"ns\"\n";
+		os << "    }" << ((i + 1 < results.size())? "," : "") << "\n";
+	}
+	os << "  ]\n}\n";
+}
+
+/// runs registered benchmarks according to the command line
+inline int run_main(int argc, char* argv[])
+{
+	double min_time = 0.5;
+	std::string filter = ".*";
+	std::string json_file;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (0 == arg.find("--min-time=")) {
+			min_time = std::stod(arg.substr(11));
+		} else if (0 == arg.find("--filter=")) {
+			filter = arg.substr(9);
+		} else if (0 == arg.find("--json=")) {
+			json_file = arg.substr(7);
+		} else {
+			std::cerr << "usage: " << argv[0] <<
+				" [--min-time=<seconds>] [--filter=<regex>] [--json=<file>]\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::regex filter_regex(filter);
+	std::vector<Result> results;
+	std::cout << std::left << std::setw(40) << "Benchmark" << std::right <<
+		std::setw(15) << "Time (ns)" << std::setw(15) << "CPU (ns)" <<
+		std::setw(12) << "Iterations" << std::setw(16) << "Items/s" << "\n";
+	for (const Benchmark* bench : get_benchmarks()) {
+		for (const auto& args : bench->get_args_list()) {
+			std::string name = bench->get_name();
+			for (int64_t arg : args) { name += "/" + std::to_string(arg); }
+			if (!std::regex_search(name, filter_regex)) { continue; }
+
+			results.push_back(run(*bench, args, min_time));
+			const Result& res = results.back();
+			std::cout << std::left << std::setw(40) << res.name << std::right <<
+				std::fixed << std::setprecision(0) <<
+				std::setw(15) << res.real_time << std::setw(15) << res.cpu_time <<
+				std::setw(12) << res.iterations << std::setw(16) <<
+				res.items_per_second << "\n" << std::defaultfloat << std::flush;
+		}
+	}
+
+	if (!json_file.empty()) {
+		std::ofstream os(json_file);
+		if (!os) {
+			std::cerr << "Could not open file \'" << json_file << "'\n";
+			return EXIT_FAILURE;
+		}
+		write_json(os, argv[0], results);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+} // bench
+
+#define BENCH_CONCAT_(a, b) a ## b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+/// registers the benchmark @p func
+#define BENCHMARK(func) \
+	static bench::Benchmark* BENCH_CONCAT(bench_registered_, __LINE__) = \
+		bench::register_benchmark(#func, func)
+
+/// defines main() running the registered benchmarks
+#define BENCHMARK_MAIN() \
+	int main(int argc, char* argv[]) { return bench::run_main(argc, argv); }
+
+#endif /* _VATA2_BENCH_HARNESS_HH_ */
@@ -0,0 +1,244 @@
+// bench-nfa.cc - micro-benchmarks of operations on NFAs
+//
+// Automata are random (see nfa-generator.hh) with the number of states and the
+// number of transitions per state (the density) given by arguments of
+// benchmarks, over the alphabet of NUM_SYMBOLS symbols.  Run with --json=<file> to store the
+// results for a comparison with another run.
+
+#include <random>
+#include <sstream>
+
+#include <vata2/nfa.hh>
+#include <vata2/nfa-generator.hh>
+#include <vata2/parser.hh>
+
+#include "bench-harness.hh"
+
+using namespace Vata2::Nfa;
+
+namespace
+{
+
+/// the number of symbols of random automata
+const Symbol NUM_SYMBOLS = 2;
+
+/**
+ * a random automaton (of Tabakov and Vardi) with @p states and @p density
+ * transitions per state (over all symbols) and a tenth of its states final
+ */
+Nfa random_nfa(size_t states, size_t density, unsigned seed = 42)
+{
+	return random_tabakov_vardi(states, NUM_SYMBOLS,
+		static_cast<double>(density) / NUM_SYMBOLS, 0.1, seed);
+}
+
+Nfa random_nfa(const bench::State& state, unsigned seed = 42)
+{
+	return random_nfa(state.range(0), state.range(1), seed);
+}
+
+/// the alphabet of random automata
+class RandomAlphabet : public EnumAlphabet
+{
+private:
+
+	static const std::vector<std::string>& get_names()
+	{
+		static std::vector<std::string> names;
+		for (Symbol symb = names.size(); symb < NUM_SYMBOLS; ++symb)
+		{
+			names.push_back(std::to_string(symb));
+		}
+
+		return names;
+	}
+
+public:
+
+	RandomAlphabet() : EnumAlphabet(get_names().begin(), get_names().end()) { }
+};
+
+/// random words of the length @p length
+std::vector<Word> random_words(size_t num, size_t length)
+{
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<Symbol> rand_symbol(0, NUM_SYMBOLS - 1);
+	std::vector<Word> result(num);
+	for (Word& word : result)
+	{
+		for (size_t i = 0; i < length; ++i) { word.push_back(rand_symbol(gen)); }
+	}
+
+	return result;
+}
+
+void BM_add_trans(bench::State& state)
+{
+	Nfa generated = random_nfa(state);
+	std::vector<Trans> trans;
+	for (const Trans& tr : generated) { trans.push_back(tr); }
+	for (auto _ : state)
+	{
+		Nfa aut;
+		for (const Trans& tr : trans) { aut.add_trans(tr); }
+		bench::DoNotOptimize(aut);
+	}
+	state.SetItemsProcessed(state.iterations() * trans.size());
+}
+
+void BM_post(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	StateSet macrostate;
+	for (State st = 0; st < static_cast<State>(state.range(0)); st += 2)
+	{
+		macrostate.insert(st);
+	}
+
+	for (auto _ : state)
+	{
+		for (Symbol symb = 0; symb < NUM_SYMBOLS; ++symb)
+		{
+			bench::DoNotOptimize(aut.post(macrostate, symb));
+		}
+	}
+}
+
+void BM_determinize(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	for (auto _ : state) { bench::DoNotOptimize(determinize(aut)); }
+}
+
+/// the worst case of determinization (with 2^n states of the result)
+void BM_determinize_nth_from_end(bench::State& state)
+{
+	Nfa aut = nth_symbol_from_end(state.range(0));
+	for (auto _ : state) { bench::DoNotOptimize(determinize(aut)); }
+}
+
+void BM_intersection(bench::State& state)
+{
+	Nfa lhs = random_nfa(state, 1);
+	Nfa rhs = random_nfa(state, 2);
+	for (auto _ : state) { bench::DoNotOptimize(intersection(lhs, rhs)); }
+}
+
+void BM_complement(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	RandomAlphabet alphabet;
+	for (auto _ : state) { bench::DoNotOptimize(complement(aut, alphabet)); }
+}
+
+void BM_minimize(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	for (auto _ : state) { bench::DoNotOptimize(minimize(aut)); }
+}
+
+/// inclusion that holds (so the whole state space is explored)
+void bench_is_incl(bench::State& state, const std::string& algo)
+{
+	Nfa smaller = random_nfa(state, 1);
+	Nfa bigger = union_rename(smaller, random_nfa(state, 2));
+	RandomAlphabet alphabet;
+	StringDict params = {{"algo", algo}};
+	for (auto _ : state)
+	{
+		bench::DoNotOptimize(is_incl(smaller, bigger, alphabet, params));
+	}
+}
+
+void BM_is_incl_naive(bench::State& state) { bench_is_incl(state, "naive"); }
+void BM_is_incl_antichains(bench::State& state) { bench_is_incl(state, "antichains"); }
+
+void bench_is_universal(bench::State& state, const std::string& algo)
+{
+	Nfa aut = random_nfa(state);
+	RandomAlphabet alphabet;
+	StringDict params = {{"algo", algo}};
+	for (auto _ : state)
+	{
+		bench::DoNotOptimize(is_universal(aut, alphabet, params));
+	}
+}
+
+void BM_is_universal_naive(bench::State& state) { bench_is_universal(state, "naive"); }
+void BM_is_universal_antichains(bench::State& state) { bench_is_universal(state, "antichains"); }
+
+/// removal of the symbol 0 as epsilon
+void BM_remove_epsilon(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	for (auto _ : state) { bench::DoNotOptimize(remove_epsilon(aut, 0)); }
+}
+
+/// membership of 10 words of the length 100
+void BM_is_in_lang(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	std::vector<Word> words = random_words(10, 100);
+	for (auto _ : state)
+	{
+		for (const Word& word : words)
+		{
+			bench::DoNotOptimize(is_in_lang(aut, word));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * words.size());
+}
+
+void BM_parse_vtf(bench::State& state)
+{
+	std::string text = std::to_string(serialize(random_nfa(state)));
+	for (auto _ : state) { bench::DoNotOptimize(Vata2::Parser::parse_vtf_section(text)); }
+	state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+void BM_construct(bench::State& state)
+{
+	Vata2::Parser::ParsedSection parsec = serialize(random_nfa(state));
+	for (auto _ : state)
+	{
+		StringToSymbolMap symbol_map;
+		OnTheFlyAlphabet alphabet(&symbol_map);
+		Nfa aut;
+		construct(&aut, parsec, &alphabet);
+		bench::DoNotOptimize(aut);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+void BM_serialize(bench::State& state)
+{
+	Nfa aut = random_nfa(state);
+	for (auto _ : state) { bench::DoNotOptimize(serialize(aut)); }
+	state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+}
+
+// operations (nearly) linear in the size of automata: {states, density}
+BENCHMARK(BM_add_trans)->Args({1000, 2})->Args({1000, 10})->Args({100000, 2})->Args({100000, 10});
+BENCHMARK(BM_post)->Args({1000, 2})->Args({1000, 10})->Args({100000, 2})->Args({100000, 10});
+BENCHMARK(BM_is_in_lang)->Args({1000, 2})->Args({1000, 10})->Args({100000, 2});
+BENCHMARK(BM_parse_vtf)->Args({1000, 2})->Args({1000, 10})->Args({100000, 2})->Args({100000, 10});
+BENCHMARK(BM_construct)->Args({1000, 2})->Args({1000, 10})->Args({100000, 2})->Args({100000, 10});
+BENCHMARK(BM_serialize)->Args({1000, 2})->Args({1000, 10})->Args({100000, 2})->Args({100000, 10});
+
+// operations on pairs of states and on closures: {states, density}
+BENCHMARK(BM_intersection)->Args({20, 2})->Args({20, 10})->Args({100, 2})->Args({100, 4});
+BENCHMARK(BM_remove_epsilon)->Args({100, 2})->Args({100, 10})->Args({1000, 2});
+
+// operations exploring subsets of states: {states, density}
+BENCHMARK(BM_determinize)->Args({10, 2})->Args({20, 2})->Args({20, 4})->Args({100, 10});
+BENCHMARK(BM_determinize_nth_from_end)->Arg(4)->Arg(8)->Arg(12);
+BENCHMARK(BM_complement)->Args({10, 2})->Args({20, 2})->Args({20, 4})->Args({100, 10});
+BENCHMARK(BM_minimize)->Args({10, 2})->Args({20, 2})->Args({20, 4})->Args({100, 10});
+BENCHMARK(BM_is_incl_naive)->Args({10, 2})->Args({20, 2})->Args({20, 4});
+BENCHMARK(BM_is_incl_antichains)->Args({10, 2})->Args({20, 2})->Args({20, 4});
+BENCHMARK(BM_is_universal_naive)->Args({10, 2})->Args({20, 2})->Args({20, 4})->Args({100, 10});
+BENCHMARK(BM_is_universal_antichains)->Args({10, 2})->Args({20, 2})->Args({20, 4})->Args({100, 10});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,77 @@
+// bench-write-vtf.cc - comparing serialize() + operator<<() with write_vtf()
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+
+namespace
+{
+
+/// runs @p func and returns the time it took in seconds
+template <class Func>
+double measure(Func func)
+{
+	auto start = std::chrono::steady_clock::now();
+	func();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 5)
+	{
+		std::cerr << "usage: " << argv[0] <<
+			" [states [transitions-per-state [threads [output]]]]\n";
+		return EXIT_FAILURE;
+	}
+
+	size_t num_states = (argc > 1)? std::stoul(argv[1]) : 200000;
+	size_t trans_per_state = (argc > 2)? std::stoul(argv[2]) : 10;
+	size_t threads = (argc > 3)? std::stoul(argv[3]) : 4;
+	std::string output = (argc > 4)? argv[4] : "/dev/null";
+
+	// a random automaton over 26 symbols
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<State> rand_state(0, num_states - 1);
+	std::uniform_int_distribution<Symbol> rand_symbol(0, 25);
+	Nfa aut;
+	aut.add_initial(0);
+	for (State st = 0; st < num_states; ++st)
+	{
+		if (0 == st % 100) { aut.add_final(st); }
+		for (size_t i = 0; i < trans_per_state; ++i)
+		{
+			aut.add_trans(st, rand_symbol(gen), rand_state(gen));
+		}
+	}
+
+	std::cout << "states: " << num_states << ", transitions: " <<
+		aut.trans_size() << "\n";
+
+	std::ofstream os(output);
+	if (!os)
+	{
+		std::cerr << "Could not open file \'" << output << "'\n";
+		return EXIT_FAILURE;
+	}
+
+	double time_serialize = measure([&]() { os << serialize(aut); });
+	double time_write = measure([&]() { write_vtf(os, aut); });
+	double time_write_par = measure([&]() { write_vtf(os, aut, nullptr, nullptr, threads); });
+
+	std::cout << "serialize() + operator<<():     " << time_serialize << " s\n";
+	std::cout << "write_vtf():                    " << time_write << " s\n";
+	std::cout << "write_vtf() with " << threads << " threads:     " <<
+		time_write_par << " s\n";
+
+	return EXIT_SUCCESS;
+}
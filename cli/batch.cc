@@ -0,0 +1,462 @@
+// TODO: add header
+
+/*
+ * The batch mode runs jobs from a manifest, one job per line:
+ *
+ *   <op> <file> [<file>]
+ *
+ * where <op> is one of load, isect, union, empty, univ, incl, eq (as in the
+ * cli/vata wrapper), files are .vtf or binary NFAs, and lines starting with
+ * '#' are comments.  Every distinct file is loaded once (symbols of all
+ * automata are interned into a single pool, so equal names are equal symbols;
+ * the alphabet of a job consists of the symbols of its own inputs only) and
+ * jobs are run in forked worker processes (at most `jobs` at a time), so
+ * that a job can be killed when it exceeds the timeout and its peak memory can
+ * be measured.  The results are printed in the order of the manifest as CSV
+ * or JSON (one object per job).  The result of a test is true or false, the
+ * result of an operation constructing an automaton is its number of
+ * transitions.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vata2/binary.hh>
+#include <vata2/nfa-binary.hh>
+#include <vata2/parser.hh>
+
+using namespace Vata2::Nfa;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// arities of operations
+const std::map<std::string, size_t> OPERATIONS = {
+	{"load", 1}, {"isect", 2}, {"union", 2}, {"empty", 1},
+	{"univ", 1}, {"incl", 2}, {"eq", 2}
+};
+
+/// a job of the manifest
+struct Job
+{
+	std::string op;
+	std::vector<std::string> inputs;
+	/// indices of inputs in the vector of loaded automata
+	std::vector<size_t> auts;
+
+	/// "ok", "error", or "timeout"
+	std::string status;
+	/// the result or the error message
+	std::string result;
+	/// wall time in seconds
+	double time;
+	/// peak resident set size of the worker in kB
+	long peak_mem;
+
+	Job() : op(), inputs(), auts(), status(), result(), time(0), peak_mem(0) { }
+};
+
+/// a loaded automaton
+struct Input
+{
+	std::string filename;
+	Nfa aut;
+	/// the symbols of the automaton (the pool is shared by all inputs)
+	PooledAlphabet alphabet;
+	/// the error message if the automaton could not be loaded
+	std::string error;
+
+	explicit Input(const std::shared_ptr<Vata2::util::StringPool>& pool) :
+		filename(), aut(), alphabet(pool), error() { }
+};
+
+/// a job being run by a worker process
+struct Worker
+{
+	pid_t pid;
+	int fd;
+	size_t job;
+	Clock::time_point start;
+	std::string output;
+};
+
+/// loads the automaton from the file of @p input (with its alphabet)
+void load_input(Input* input)
+{
+	std::ifstream is(input->filename, std::ios::in | std::ios::binary);
+	if (!is) {
+		input->error = "could not open file '" + input->filename + "'";
+		return;
+	}
+
+	try {
+		// a .vtf file cannot start with the first character of the magic number
+		if (Vata2::Binary::MAGIC[0] == is.peek()) {
+			Nfa loaded;
+			SymbolToStringMap symbol_names;
+			load_binary(&loaded, is, nullptr, &symbol_names);
+
+			auto get_symbol = [&](Symbol symb) -> Symbol {
+				auto it = symbol_names.find(symb);
+				return input->alphabet.translate_symb((symbol_names.end() != it)?
+					it->second : get_unnamed_symbol_name(symb));
+			};
+
+			input->aut.initialstates = loaded.initialstates;
+			input->aut.finalstates = loaded.finalstates;
+			for (const auto& trans : loaded) {
+				input->aut.add_trans(trans.src, get_symbol(trans.symb), trans.tgt);
+			}
+		} else {
+			Vata2::Parser::VtfScanner scanner(is);
+			Vata2::util::StringPool state_pool;
+			construct(&input->aut, &scanner, &input->alphabet, &state_pool);
+		}
+	}
+	catch (const std::exception& ex) {
+		input->error = ex.what();
+	}
+}
+
+/// loads @p inputs using @p threads threads
+void load_inputs(std::vector<Input>* inputs, size_t threads)
+{
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for (size_t i = next++; i < inputs->size(); i = next++) {
+			load_input(&(*inputs)[i]);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < threads && i < inputs->size(); ++i) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : workers) { thread.join(); }
+}
+
+/// the alphabet of @p job: the symbols of all of its inputs
+PooledAlphabet get_job_alphabet(const Job& job, const std::vector<Input>& inputs)
+{
+	PooledAlphabet result(inputs[job.auts[0]].alphabet.get_pool());
+	for (size_t aut : job.auts) {
+		const PooledAlphabet& alphabet = inputs[aut].alphabet;
+		for (Symbol symb : alphabet.get_symbols()) {
+			result.translate_symb(alphabet.get_symb_name(symb));
+		}
+	}
+
+	return result;
+}
+
+/// computes the result of @p job
+std::string run_job(const Job& job, const std::vector<Input>& inputs)
+{
+	PooledAlphabet alphabet = get_job_alphabet(job, inputs);
+	const Nfa& lhs = inputs[job.auts[0]].aut;
+	const Nfa& rhs = inputs[job.auts[job.auts.size() - 1]].aut;
+	auto to_str = [](bool val) { return std::string(val? "true" : "false"); };
+
+	if ("load" == job.op) {
+		return std::to_string(lhs.trans_size());
+	} else if ("isect" == job.op) {
+		return std::to_string(intersection(lhs, rhs).trans_size());
+	} else if ("union" == job.op) {
+		return std::to_string(union_rename(lhs, rhs).trans_size());
+	} else if ("empty" == job.op) {
+		return to_str(is_lang_empty(lhs));
+	} else if ("univ" == job.op) {
+		return to_str(is_universal(lhs, alphabet));
+	} else if ("incl" == job.op) {
+		return to_str(is_incl(lhs, rhs, alphabet));
+	} else {
+		assert("eq" == job.op);
+		return to_str(is_incl(lhs, rhs, alphabet) && is_incl(rhs, lhs, alphabet));
+	}
+}
+
+/// starts a worker process running @p job (with index @p idx)
+Worker start_job(size_t idx, const Job& job, const std::vector<Input>& inputs)
+{
+	int fds[2];
+	if (0 != pipe(fds)) {
+		throw std::runtime_error(std::string("pipe: ") + std::strerror(errno));
+	}
+
+	std::cout.flush();
+	std::cerr.flush();
+	Clock::time_point start = Clock::now();
+	pid_t pid = fork();
+	if (pid < 0) {
+		throw std::runtime_error(std::string("fork: ") + std::strerror(errno));
+	}
+
+	if (0 == pid) { // the worker
+		close(fds[0]);
+		std::string output;
+		try {
+			output = "R" + run_job(job, inputs);
+		}
+		catch (const std::exception& ex) {
+			output = std::string("E") + ex.what();
+		}
+
+		const char* data = output.data();
+		size_t len = output.size();
+		while (len > 0) {
+			ssize_t written = write(fds[1], data, len);
+			if (written <= 0) { break; }
+			data += written;
+			len -= written;
+		}
+
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(fds[1]);
+	return Worker{pid, fds[0], idx, start, std::string()};
+}
+
+/// waits for the end of @p worker and stores its results into @p job
+void finish_job(Worker* worker, Job* job, bool timeout)
+{
+	if (timeout) { kill(worker->pid, SIGKILL); }
+	close(worker->fd);
+
+	int status;
+	struct rusage usage;
+	while (wait4(worker->pid, &status, 0, &usage) < 0 && EINTR == errno) { }
+	std::chrono::duration<double> elapsed = Clock::now() - worker->start;
+	job->time = elapsed.count();
+#ifdef __APPLE__
+	job->peak_mem = usage.ru_maxrss / 1024;   // in bytes
+#else
+	job->peak_mem = usage.ru_maxrss;          // in kB
+#endif
+
+	if (timeout) {
+		job->status = "timeout";
+	} else if (!WIFEXITED(status) || worker->output.empty()) {
+		job->status = "error";
+		job->result = "the worker terminated abnormally";
+	} else {
+		job->status = ('R' == worker->output[0])? "ok" : "error";
+		job->result = worker->output.substr(1);
+	}
+}
+
+/// runs @p jobs in at most @p threads workers at a time
+void run_jobs(std::vector<Job>* jobs, const std::vector<Input>& inputs,
+	size_t threads, double timeout)
+{
+	std::vector<Worker> workers;
+	size_t next = 0;
+	while (true) {
+		for (; next < jobs->size() && workers.size() < threads; ++next) {
+			if ((*jobs)[next].status.empty()) {
+				workers.push_back(start_job(next, (*jobs)[next], inputs));
+			}
+		}
+
+		if (workers.empty()) { break; }
+
+		// waits for an output or the first deadline
+		int wait_ms = -1;
+		Clock::time_point now = Clock::now();
+		if (timeout > 0) {
+			for (const Worker& worker : workers) {
+				std::chrono::duration<double> left =
+					worker.start + std::chrono::duration<double>(timeout) - now;
+				int ms = std::max(0, static_cast<int>(std::ceil(left.count() * 1000)));
+				wait_ms = (wait_ms < 0)? ms : std::min(wait_ms, ms);
+			}
+		}
+
+		std::vector<struct pollfd> fds;
+		for (const Worker& worker : workers) {
+			fds.push_back({worker.fd, POLLIN, 0});
+		}
+		if (poll(fds.data(), fds.size(), wait_ms) < 0 && EINTR != errno) {
+			throw std::runtime_error(std::string("poll: ") + std::strerror(errno));
+		}
+
+		now = Clock::now();
+		for (size_t i = workers.size(); i-- > 0; ) {
+			Worker& worker = workers[i];
+			bool done = false;
+			if (0 != fds[i].revents) {
+				char buf[4096];
+				ssize_t len = read(worker.fd, buf, sizeof(buf));
+				if (len > 0) {
+					worker.output.append(buf, len);
+				} else {
+					done = true;
+				}
+			}
+
+			std::chrono::duration<double> elapsed = now - worker.start;
+			bool expired = !done && timeout > 0 && elapsed.count() >= timeout;
+			if (done || expired) {
+				finish_job(&worker, &(*jobs)[worker.job], expired);
+				workers.erase(workers.begin() + i);
+			}
+		}
+	}
+}
+
+/// quotes @p str for CSV if needed
+std::string csv_quote(const std::string& str)
+{
+	if (std::string::npos == str.find_first_of(",\"\n")) { return str; }
+
+	std::string result = "\"";
+	for (char c : str) {
+		if ('"' == c) { result += '"'; }
+		result += c;
+	}
+
+	return result + "\"";
+}
+
+/// a JSON string with @p str
+std::string json_quote(const std::string& str)
+{
+	std::ostringstream os;
+	os << '"';
+	for (char c : str) {
+		if ('"' == c || '\\' == c) {
+			os << '\\' << c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			os << "\\u" << std::hex << std::setw(4) << std::setfill('0') <<
+				static_cast<int>(c) << std::dec;
+		} else {
+			os << c;
+		}
+	}
+	os << '"';
+
+	return os.str();
+}
+
+/// prints results of @p jobs to @p os in @p format
+void print_results(std::ostream& os, const std::vector<Job>& jobs, bool json)
+{
+	if (json) { os << "[\n"; }
+	else { os << "job,op,inputs,status,result,time,peak_mem_kb\n"; }
+
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		const Job& job = jobs[i];
+		std::string inputs;
+		for (const std::string& input : job.inputs) {
+			inputs += (inputs.empty()? "" : " ") + input;
+		}
+
+		if (json) {
+			os << "  {\"job\": " << i << ", \"op\": " << json_quote(job.op) <<
+				", \"inputs\": [";
+			for (size_t j = 0; j < job.inputs.size(); ++j) {
+				os << ((0 == j)? "" : ", ") << json_quote(job.inputs[j]);
+			}
+			os << "], \"status\": " << json_quote(job.status) <<
+				", \"result\": " << json_quote(job.result) <<
+				", \"time\": " << job.time << ", \"peak_mem_kb\": " << job.peak_mem <<
+				"}" << ((i + 1 < jobs.size())? "," : "") << "\n";
+		} else {
+			os << i << "," << csv_quote(job.op) << "," << csv_quote(inputs) << "," <<
+				job.status << "," << csv_quote(job.result) << "," << job.time << "," <<
+				job.peak_mem << "\n";
+		}
+	}
+
+	if (json) { os << "]\n"; }
+}
+
+} // anonymous namespace
+
+/**
+ * Runs jobs from the manifest @p is in @p threads workers with the time limit
+ * @p timeout (in seconds, 0 means no limit) and prints the results to
+ * std::cout (in JSON if @p json is set and in CSV otherwise).
+ */
+int run_batch(std::istream& is, size_t threads, double timeout, bool json)
+{
+	try {
+		if (0 == threads) { threads = 1; }
+
+		std::vector<Job> jobs;
+		std::vector<Input> inputs;
+		auto symbol_pool = std::make_shared<Vata2::util::StringPool>();
+		std::map<std::string, size_t> input_ids;
+
+		std::string line;
+		while (std::getline(is, line)) {
+			std::istringstream line_stream(line);
+			Job job;
+			if (!(line_stream >> job.op) || '#' == job.op[0]) { continue; }
+
+			std::string input;
+			while (line_stream >> input) { job.inputs.push_back(input); }
+
+			auto it = OPERATIONS.find(job.op);
+			if (OPERATIONS.end() == it) {
+				job.status = "error";
+				job.result = "unknown operation '" + job.op + "'";
+			} else if (it->second != job.inputs.size()) {
+				job.status = "error";
+				job.result = "operation '" + job.op + "' expects " +
+					std::to_string(it->second) + " inputs";
+			} else {
+				for (const std::string& filename : job.inputs) {
+					auto id_inserted = input_ids.insert({filename, inputs.size()});
+					if (id_inserted.second) {
+						inputs.push_back(Input(symbol_pool));
+						inputs.back().filename = filename;
+					}
+					job.auts.push_back(id_inserted.first->second);
+				}
+			}
+
+			jobs.push_back(std::move(job));
+		}
+
+		load_inputs(&inputs, threads);
+		for (Job& job : jobs) {
+			for (size_t aut : job.auts) {
+				if (!inputs[aut].error.empty() && job.status.empty()) {
+					job.status = "error";
+					job.result = inputs[aut].filename + ": " + inputs[aut].error;
+				}
+			}
+		}
+
+		run_jobs(&jobs, inputs, threads, timeout);
+		print_results(std::cout, jobs, json);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "libVATA2 error: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+// TODO: add header
+
+#include <fstream>
+#include <iostream>
+
+#include <vata2/nfa-binary.hh>
+#include <vata2/parser.hh>
+
+using namespace Vata2::Nfa;
+
+/**
+ * Converts an NFA from @p is (either a .vtf section or a binary file) into
+ * the file @p out_file, in the binary format if @p to_binary is set and in the
+ * .vtf format otherwise.  Names of states and symbols are preserved.
+ */
+int convert_nfa(std::istream& is, const std::string& out_file, bool to_binary)
+{
+	try {
+		Nfa aut;
+		StateToStringMap state_names;
+		SymbolToStringMap symbol_names;
+
+		// a .vtf file cannot start with the first character of the magic number
+		if (Vata2::Binary::MAGIC[0] == is.peek()) {
+			load_binary(&aut, is, &state_names, &symbol_names);
+		} else {
+			Vata2::Parser::VtfScanner scanner(is);
+			StringToSymbolMap symbol_dict;
+			StringToStateMap state_dict;
+			OnTheFlyAlphabet alphabet(&symbol_dict);
+			construct(&aut, &scanner, &alphabet, &state_dict);
+
+			for (const auto& name_state : state_dict) {
+				state_names[name_state.second] = name_state.first;
+			}
+			for (const auto& name_symbol : symbol_dict) {
+				symbol_names[name_symbol.second] = name_symbol.first;
+			}
+		}
+
+		std::ios::openmode mode = std::ios::out;
+		if (to_binary) { mode |= std::ios::binary; }
+		std::ofstream os(out_file, mode);
+		if (!os) {
+			std::cerr << "Could not open file \'" << out_file << "'\n";
+			return EXIT_FAILURE;
+		}
+
+		if (to_binary) {
+			save_binary(aut, os, &state_names, &symbol_names);
+		} else {
+			// automata saved without names get the default ones
+			os << std::to_string(serialize(aut,
+				symbol_names.empty()? nullptr : &symbol_names,
+				state_names.empty()? nullptr : &state_names));
+		}
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "libVATA2 error: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -5,13 +5,20 @@
 #include <vata2/parser.hh>
 #include <vata2/vm.hh>
 
-int interpret_input(std::istream& is)
+int interpret_input(std::istream& is, size_t dataflow_threads)
 {
 	try {
-		Vata2::Parser::Parsed parsed = Vata2::Parser::parse_vtf(is, true);
-
 		Vata2::VM::VirtualMachine mach;
-		mach.run(parsed);
+		mach.set_dataflow(dataflow_threads);
+
+		// sections are read and run one by one so that only one of them is kept
+		// in memory at a time
+		Vata2::Parser::VtfScanner scanner(is);
+		Vata2::Parser::ParsedSection parsec;
+		while (scanner.read_section(&parsec, true))
+		{
+			mach.run(parsec);
+		}
 	}
 	catch (const std::exception& ex) {
 		std::cerr << "libVATA2 error: " << ex.what() << "\n";
@@ -4,7 +4,10 @@
 #include <cstring>
 #include <fstream>
 #include <iomanip>
+#include <thread>
 
+#include <vata2/nfa-cache.hh>
+#include <vata2/trace.hh>
 #include <vata2/util.hh>
 #include <vata2/vm-dispatch.hh>
 
@@ -15,7 +18,9 @@ extern const char* VATA_VERSION;
 extern const char* VATA_GIT_SHA;
 extern const char* VATA_GIT_DESCRIBE;
 
-int interpret_input(std::istream& is);
+int interpret_input(std::istream& is, size_t dataflow_threads);
+int convert_nfa(std::istream& is, const std::string& out_file, bool to_binary);
+int run_batch(std::istream& is, size_t threads, double timeout, bool json);
 
 /// maximum level of verbosity
 const unsigned MAX_VERBOSITY = 5;
@@ -31,6 +36,28 @@ int main(int argc, const char* argv[])
 	args::Flag flag_types(arg_parser, "types", "Print out info about types", {'t', "types"});
 	args::ValueFlag<unsigned> flag_debug(arg_parser, "level", "Debug level (from 0 to " +
 		std::to_string(MAX_VERBOSITY) + ")", {'d', "debug"}, DEFAULT_VERBOSITY);
+	args::ValueFlag<size_t> flag_cache(arg_parser, "size", "Cache results of up to "
+		"<size> operations (0 disables the cache)", {'c', "cache"}, 0);
+	args::ValueFlag<std::string> flag_to_binary(arg_parser, "file", "Convert the input "
+		"NFA (.vtf or binary) into <file> in the binary format", {"to-binary"});
+	args::ValueFlag<std::string> flag_to_text(arg_parser, "file", "Convert the input "
+		"NFA (.vtf or binary) into <file> in the .vtf format", {"to-text"});
+	args::Flag flag_batch(arg_parser, "batch", "Run jobs from the input manifest "
+		"(lines \"<op> <file> [<file>]\" with <op> one of load, isect, union, empty, "
+		"univ, incl, eq)", {'b', "batch"});
+	args::ValueFlag<size_t> flag_jobs(arg_parser, "n", "Run up to <n> jobs of the "
+		"batch mode at a time", {'j', "jobs"},
+		std::max(1u, std::thread::hardware_concurrency()));
+	args::ValueFlag<double> flag_timeout(arg_parser, "seconds", "Kill jobs of the "
+		"batch mode running longer than <seconds> (0 means no limit)", {"timeout"}, 0);
+	args::Flag flag_json(arg_parser, "json", "Print results of the batch mode in "
+		"JSON (instead of CSV)", {"json"});
+	args::ValueFlag<size_t> flag_dataflow(arg_parser, "n", "Run @CODE sections as "
+		"dataflow graphs: compute only values needed by calls with side effects "
+		"(e.g., print) and run independent calls on up to <n> threads", {'p', "dataflow"});
+	args::ValueFlag<std::string> flag_trace(arg_parser, "file", "Write the times of "
+		"calls of the program into <file> in the Chrome trace format (view it in "
+		"chrome://tracing or Perfetto)", {"trace"});
 	args::Positional<std::string> pos_inputfile(arg_parser,
 		"input", "An input .vtf @CODE file; if not supplied, read from STDIN");
 	arg_parser.helpParams.showTerminator = false;
@@ -92,21 +119,46 @@ int main(int argc, const char* argv[])
 	}
 	Vata2::LOG_VERBOSITY = verbosity;
 	DEBUG_PRINT("verbosity set to " + std::to_string(Vata2::LOG_VERBOSITY));
+	if (verbosity > VATA_MAX_LOG_LEVEL) {
+		std::cerr << "debug outputs above the level " << VATA_MAX_LOG_LEVEL <<
+			" are not compiled in (see VATA_MAX_LOG_LEVEL)\n";
+	}
+
+	Vata2::Nfa::OpCache::global().set_capacity(flag_cache.Get());
 
+	std::istream* input = &std::cin;   // the input goes from stdin by default
+	std::fstream fs;
 	if (pos_inputfile) {
 		std::string filename = args::get(pos_inputfile);
-		std::fstream fs(filename, std::ios::in);
+		fs.open(filename, std::ios::in | std::ios::binary);
 		if (!fs) {
 			std::cerr << "Could not open file \'" << filename << "'\n";
 			return EXIT_FAILURE;
 		}
 
-		ret_val = interpret_input(fs);
+		input = &fs;
+	}
+
+	if (flag_trace) {
+		try {
+			Vata2::Trace::start(args::get(flag_trace));
+		}
+		catch (const std::exception& ex) {
+			std::cerr << "libVATA2 error: " << ex.what() << "\n";
+			return EXIT_FAILURE;
+		}
+	}
 
-		fs.close();
-	} else { // the input goes from stdin
-		ret_val = interpret_input(std::cin);
+	if (flag_to_binary) {
+		ret_val = convert_nfa(*input, args::get(flag_to_binary), true);
+	} else if (flag_to_text) {
+		ret_val = convert_nfa(*input, args::get(flag_to_text), false);
+	} else if (flag_batch) {
+		ret_val = run_batch(*input, flag_jobs.Get(), flag_timeout.Get(), flag_json);
+	} else {
+		ret_val = interpret_input(*input, flag_dataflow? args::get(flag_dataflow) : 0);
 	}
 
+	Vata2::Trace::stop();
 	return ret_val;
 }
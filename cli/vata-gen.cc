@@ -0,0 +1,162 @@
+// TODO: add header
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <vata2/nfa-binary.hh>
+#include <vata2/nfa-generator.hh>
+
+#include "../3rdparty/args.hxx"
+
+using namespace Vata2::Nfa;
+
+/// families of generated automata
+const char* FAMILIES = "tv (random NFAs of Tabakov and Vardi), dfa (random "
+	"complete DFAs), nth (the n-th symbol from the end is 'a'), regex (the "
+	"automaton of --regex)";
+
+/// parameters of generated automata
+struct GenParams
+{
+	std::string family;
+	size_t states;
+	size_t symbols;
+	double trans_density;
+	double final_density;
+	std::string regex;
+};
+
+/**
+ * Generates an automaton of @p params with @p seed into @p aut, with names of
+ * its symbols in @p symbol_names (if they are not the default ones)
+ */
+void generate(
+	const GenParams&    params,
+	uint64_t            seed,
+	Nfa*                aut,
+	SymbolToStringMap*  symbol_names)
+{
+	if ("tv" == params.family) {
+		*aut = random_tabakov_vardi(params.states, params.symbols,
+			params.trans_density, params.final_density, seed);
+	} else if ("dfa" == params.family) {
+		*aut = random_dfa(params.states, params.symbols, params.final_density, seed);
+	} else if ("nth" == params.family) {
+		*aut = nth_symbol_from_end(params.states);
+		*symbol_names = {{0, "a"}, {1, "b"}};
+	} else if ("regex" == params.family) {
+		StringToSymbolMap symbol_map;
+		OnTheFlyAlphabet alphabet(&symbol_map);
+		*aut = regex_to_nfa(params.regex, &alphabet);
+		for (const auto& name_symbol : symbol_map) {
+			(*symbol_names)[name_symbol.second] = name_symbol.first;
+		}
+	} else {
+		throw std::runtime_error("unknown family \'" + params.family + "'");
+	}
+}
+
+/// writes @p aut to @p os (in the binary format if @p binary is set)
+void write(
+	std::ostream&             os,
+	const Nfa&                aut,
+	const SymbolToStringMap&  symbol_names,
+	bool                      binary)
+{
+	const SymbolToStringMap* names = symbol_names.empty()? nullptr : &symbol_names;
+	if (binary) {
+		save_binary(aut, os, nullptr, names);
+	} else {
+		write_vtf(os, aut, names);
+	}
+}
+
+/// The entry point
+int main(int argc, const char* argv[])
+{
+	args::ArgumentParser arg_parser("Generates automata for experiments and "
+		"benchmarks.  With --output, automata with the seeds <seed>, ..., <seed> + "
+		"<count> - 1 are written into the files <prefix>-<seed>.vtf (or .vtfb) and "
+		"their names are printed one per line (e.g., as the input of pycobench); "
+		"otherwise, the automaton is printed to STDOUT.");
+	args::HelpFlag flag_help(arg_parser, "help", "Display this help menu", {'h', "help"});
+	args::ValueFlag<size_t> flag_states(arg_parser, "n", "The number of states "
+		"(for tv and dfa) or n (for nth)", {'n', "states"}, 10);
+	args::ValueFlag<size_t> flag_symbols(arg_parser, "k", "The number of symbols "
+		"(for tv and dfa)", {'k', "symbols"}, 2);
+	args::ValueFlag<double> flag_trans_density(arg_parser, "r", "The number of "
+		"transitions over every symbol divided by the number of states (for tv)",
+		{'r', "trans-density"}, 1.25);
+	args::ValueFlag<double> flag_final_density(arg_parser, "f", "The ratio of final "
+		"states (for tv and dfa)", {'f', "final-density"}, 0.5);
+	args::ValueFlag<std::string> flag_regex(arg_parser, "regex", "The regular "
+		"expression (for regex)", {'e', "regex"});
+	args::ValueFlag<uint64_t> flag_seed(arg_parser, "seed", "The seed of random "
+		"automata", {'s', "seed"}, 0);
+	args::ValueFlag<size_t> flag_count(arg_parser, "count", "The number of generated "
+		"automata (with --output)", {'c', "count"}, 1);
+	args::ValueFlag<std::string> flag_output(arg_parser, "prefix", "The prefix of "
+		"names of output files", {'o', "output"});
+	args::Flag flag_binary(arg_parser, "binary", "Write automata in the binary format",
+		{'b', "binary"});
+	args::Positional<std::string> pos_family(arg_parser, "family",
+		std::string("One of ") + FAMILIES);
+	arg_parser.helpParams.showTerminator = false;
+
+	try {
+		arg_parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help&) {
+		std::cout << arg_parser;
+		return EXIT_SUCCESS;
+	}
+	catch (const args::Error& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!pos_family) {
+		std::cerr << "Missing the family of automata; use one of " << FAMILIES << "\n";
+		return EXIT_FAILURE;
+	}
+
+	GenParams params = {args::get(pos_family), flag_states.Get(), flag_symbols.Get(),
+		flag_trans_density.Get(), flag_final_density.Get(), args::get(flag_regex)};
+
+	try {
+		if (!flag_output) {
+			Nfa aut;
+			SymbolToStringMap symbol_names;
+			generate(params, flag_seed.Get(), &aut, &symbol_names);
+			write(std::cout, aut, symbol_names, flag_binary);
+			return EXIT_SUCCESS;
+		}
+
+		for (size_t i = 0; i < flag_count.Get(); ++i) {
+			uint64_t seed = flag_seed.Get() + i;
+			Nfa aut;
+			SymbolToStringMap symbol_names;
+			generate(params, seed, &aut, &symbol_names);
+
+			std::string filename = args::get(flag_output) + "-" + std::to_string(seed) +
+				(flag_binary? ".vtfb" : ".vtf");
+			std::ios::openmode mode = std::ios::out;
+			if (flag_binary) { mode |= std::ios::binary; }
+			std::ofstream os(filename, mode);
+			if (!os) {
+				std::cerr << "Could not open file \'" << filename << "'\n";
+				return EXIT_FAILURE;
+			}
+
+			write(os, aut, symbol_names, flag_binary);
+			std::cout << filename << "\n";
+		}
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "libVATA2 error: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
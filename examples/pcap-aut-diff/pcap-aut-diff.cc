@@ -4,10 +4,13 @@
 
 #include <vata2/util.hh>
 #include <vata2/nfa.hh>
+#include <vata2/nfa-matcher.hh>
 
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <sstream>
 
 // PCAP-related headers
 #include <pcap.h>
@@ -42,11 +45,19 @@ using namespace Vata2::Parser;
 
 using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
+/// a view of a part of a packet
+struct ByteSpan
+{
+	const uint8_t* data;
+	size_t len;
+};
+
 // FUNCTION DECLARATIONS
 void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
 
 // GLOBAL VARIABLES
 size_t total_packets = 0;
+size_t total_bytes = 0;
 size_t payloaded_packets = 0;
 size_t vlan_packets = 0;
 size_t ipv4_packets = 0;
@@ -68,66 +79,80 @@ size_t accepted_aut1 = 0;
 size_t accepted_aut2 = 0;
 size_t accepted_aut1_not_aut2 = 0;
 size_t accepted_aut2_not_aut1 = 0;
+size_t accepted_both = 0;
+size_t accepted_none = 0;
 bool prefix_acceptance = false;
 Nfa aut1;
 Nfa aut2;
+/// the bound on the number of states of the product
+size_t max_states = DiffMatcher::DEFAULT_MAX_STATES;
+/// the product of aut1 and aut2 used to match both of them in a single pass
+/// (nullptr if the product has more than max_states states)
+std::unique_ptr<const DiffMatcher> matcher;
+/// lazy DFAs of aut1 and aut2 matched one after the other without the product
+std::unique_ptr<LazyDfaMatcher> lazy_matcher1;
+std::unique_ptr<LazyDfaMatcher> lazy_matcher2;
 
 
 
 void print_usage(const char* prog_name)
 {
-	std::cout << "usage: " << prog_name << " [-p] aut1.vtf aut2.vtf packets.pcap\n";
+	std::cout << "usage: " << prog_name << " [-p] [-s states] aut1.vtf aut2.vtf packets.pcap\n";
 	std::cout << "\n";
 	std::cout << "Options:\n";
-	std::cout << "  -p    prefix acceptance\n";
+	std::cout << "  -p           prefix acceptance\n";
+	std::cout << "  -s states    the maximum number of states of the product of the\n";
+	std::cout << "               automata (default " << DiffMatcher::DEFAULT_MAX_STATES <<
+		"); larger\n";
+	std::cout << "               products are not built and the automata are matched\n";
+	std::cout << "               one after the other\n";
 }
 
 Nfa load_aut(const std::string& file_name)
 {
+	// the file is scanned directly in memory (in parallel)
+	MappedFile file(file_name);
+	VtfScanner scanner(file.data(), file.size());
+
 	Nfa result;
-	std::ifstream input(file_name);
-	if (input.is_open())
-	{
-		ParsedSection parsec = parse_vtf_section(input);
-		Vata2::Nfa::DirectAlphabet alphabet;
-		return construct(parsec, &alphabet);
-	}
-	else
-	{
-		throw std::runtime_error("Cannot open file " + file_name);
-	}
+	Vata2::Nfa::DirectAlphabet alphabet;
+	construct_parallel(&result, &scanner, &alphabet);
+	return result;
 }
 
 int main(int argc, char** argv)
 {
 	// PARSING COMMAND LINE ARGUMENTS
-	size_t param_start = 1;
-	if (argc != 4 && argc != 5)
+	int param_start = 1;
+	for (; param_start < argc && '-' == argv[param_start][0]; ++param_start)
 	{
-		print_usage(argv[0]);
-		return EXIT_FAILURE;
-	}
-
-	if (std::to_string(argv[1]) == "-p")
-	{
-		prefix_acceptance = true;
-		param_start = 2;
-
-		if (argc != 5)
+		std::string option = argv[param_start];
+		if ("-p" == option)
 		{
-			print_usage(argv[0]);
-			return EXIT_FAILURE;
+			prefix_acceptance = true;
 		}
-	}
-	else
-	{
-		if (argc != 4)
+		else if ("-s" == option && param_start + 1 < argc)
+		{
+			std::istringstream value(argv[++param_start]);
+			if (!(value >> max_states) || !value.eof())
+			{
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+		}
+		else
 		{
 			print_usage(argv[0]);
 			return EXIT_FAILURE;
 		}
 	}
 
+	if (argc - param_start != 3)
+	{
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
 	// LOADING INPUTS
 	std::string aut1_file = argv[param_start + 0];
 	std::string aut2_file = argv[param_start + 1];
@@ -155,6 +180,19 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	TimePoint compileTime = std::chrono::high_resolution_clock::now();
+
+	try
+	{
+		matcher.reset(new DiffMatcher(aut1, aut2, prefix_acceptance, max_states));
+	}
+	catch (const std::exception& ex)
+	{ // the product would be too big (subset construction may blow up)
+		std::clog << "Not using the product of automata: " << ex.what() << "\n";
+		lazy_matcher1.reset(new LazyDfaMatcher(aut1));
+		lazy_matcher2.reset(new LazyDfaMatcher(aut2));
+	}
+
 	TimePoint startTime = std::chrono::high_resolution_clock::now();
 
 	// start packet processing loop, just like live capture
@@ -166,6 +204,8 @@ int main(int argc, char** argv)
 
 	TimePoint finishTime = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> opTime = finishTime - startTime;
+	std::chrono::duration<double> prodTime = startTime - compileTime;
+	double seconds = opTime.count();
 
 	std::cout << "\n";
 	std::cout << "Total packets in " << packets_file << ": " << total_packets << "\n";
@@ -189,16 +229,30 @@ int main(int argc, char** argv)
 	std::cout << "Accepted in Aut2: " << accepted_aut2 << "\n";
 	std::cout << "Accepted in Aut1 but not in Aut2: " << accepted_aut1_not_aut2 << "\n";
 	std::cout << "Accepted in Aut2 but not in Aut1: " << accepted_aut2_not_aut1 << "\n";
+	std::cout << "Accepted in both: " << accepted_both << "\n";
+	std::cout << "Accepted in none: " << accepted_none << "\n";
 	std::cout << "Inconsistent packets: " << incons_packets << "\n";
-	std::cout << "Time: " <<
-		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
-		<< "\n";
+	if (nullptr != matcher)
+	{
+		std::cout << "Product states: " << matcher->num_states() << "\n";
+	}
+	else
+	{
+		std::cout << "Product states: not built (more than " << max_states << ")\n";
+	}
+	std::cout << "Product construction time: " << prodTime.count() << "\n";
+	std::cout << "Time: " << seconds << "\n";
+	if (seconds > 0)
+	{
+		std::cout << "Packets/s: " << total_packets / seconds << "\n";
+		std::cout << "Bytes/s: " << total_bytes / seconds << "\n";
+	}
 
 	return EXIT_SUCCESS;
 }
 
 
-Word get_payload(
+ByteSpan get_payload(
 	const pcap_pkthdr* pkthdr,
 	const u_char* packet)
 {
@@ -242,7 +296,7 @@ Word get_payload(
 	else
 	{
 		++other_l3_packets;
-		return Word();
+		return ByteSpan{nullptr, 0};
 	}
 
 	bool ip_in_ip = false;
@@ -292,7 +346,7 @@ Word get_payload(
 		{
 			++gre_packets;
 
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 		else if (IPPROTO_ICMPV6 == l4_proto)
 		{
@@ -322,7 +376,7 @@ Word get_payload(
 		{
 			++pim_packets;
 
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 		else
 		{
@@ -331,12 +385,36 @@ Word get_payload(
 			// std::cout << std::hex << static_cast<unsigned>(ip_hdr->ip_p) << std::dec << "\n";
 			// std::cout << static_cast<unsigned>(ip_hdr->ip_p) << "\n";
 
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 	}
 
-	return Word(packet + offset, packet + std::max(static_cast<size_t>(pkthdr->len), offset));
-	// return Word(packet + offset, packet + pkthdr->len);
+	// only the captured part of the packet is available
+	size_t caplen = pkthdr->caplen;
+	if (offset >= caplen) { return ByteSpan{nullptr, 0}; }
+
+	return ByteSpan{packet + offset, caplen - offset};
+}
+
+/// matches @p payload by the lazy DFAs of aut1 and aut2 one after the other
+DiffMatcher::Verdict match_separately(const ByteSpan& payload)
+{
+	bool in_aut1;
+	bool in_aut2;
+	if (prefix_acceptance)
+	{
+		in_aut1 = lazy_matcher1->is_prfx_in_lang(payload.data, payload.len);
+		in_aut2 = lazy_matcher2->is_prfx_in_lang(payload.data, payload.len);
+	}
+	else
+	{
+		in_aut1 = lazy_matcher1->is_in_lang(payload.data, payload.len);
+		in_aut2 = lazy_matcher2->is_in_lang(payload.data, payload.len);
+	}
+
+	return static_cast<DiffMatcher::Verdict>(
+		(in_aut1? DiffMatcher::IN_FIRST_ONLY : DiffMatcher::IN_NONE) |
+		(in_aut2? DiffMatcher::IN_SECOND_ONLY : DiffMatcher::IN_NONE));
 }
 
 void packetHandler(
@@ -348,51 +426,34 @@ void packetHandler(
 	assert(nullptr != packet);
 
 	++total_packets;
+	total_bytes += pkthdr->caplen;
 
-	Word payload = get_payload(pkthdr, packet);
-	if (payload.empty())
+	ByteSpan payload = get_payload(pkthdr, packet);
+	if (0 == payload.len)
 	{
 		return;
 	}
 
 	++payloaded_packets;
 
-	// std::cout << std::to_string(payload);
-
-	bool in_aut1;
-	bool in_aut2;
-
-	if (prefix_acceptance)
+	// both automata are matched in a single pass over the payload (if the
+	// product has been built)
+	DiffMatcher::Verdict verdict = (nullptr != matcher)?
+		matcher->match(payload.data, payload.len) : match_separately(payload);
+	switch (verdict)
 	{
-		in_aut1 = is_prfx_in_lang(aut1, payload);
-		in_aut2 = is_prfx_in_lang(aut2, payload);
-	}
-	else
-	{
-		in_aut1 = is_in_lang(aut1, payload);
-		in_aut2 = is_in_lang(aut2, payload);
+		case DiffMatcher::IN_BOTH: ++accepted_both; break;
+		case DiffMatcher::IN_NONE: ++accepted_none; break;
+		case DiffMatcher::IN_FIRST_ONLY: ++accepted_aut1_not_aut2; break;
+		case DiffMatcher::IN_SECOND_ONLY: ++accepted_aut2_not_aut1; break;
+		default: assert(false);
 	}
 
+	bool in_aut1 = (0 != (verdict & DiffMatcher::IN_FIRST_ONLY));
+	bool in_aut2 = (0 != (verdict & DiffMatcher::IN_SECOND_ONLY));
 	if (in_aut1) { ++accepted_aut1; }
 	if (in_aut2) { ++accepted_aut2; }
-
-	if (in_aut1 != in_aut2)
-	{
-		++incons_packets;
-
-		if (in_aut1 && !in_aut2)
-		{
-			++accepted_aut1_not_aut2;
-		}
-		else if (in_aut2 && !in_aut1)
-		{
-			++accepted_aut2_not_aut1;
-		}
-		else
-		{
-			assert(false);
-		}
-	}
+	if (in_aut1 != in_aut2) { ++incons_packets; }
 
 	if (total_packets % 10000 == 0)
 	{
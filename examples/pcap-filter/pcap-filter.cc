@@ -1,12 +1,21 @@
 // pcap-filter.cc - filters packets from a PCAP file that belong (or do not)
 // into the language of a provided NFA
+//
+// Packets are processed by a pipeline: the main thread reads packets into a
+// ring of slots, matcher threads (each with its own lazy DFA over the shared
+// automaton) match payloads directly in the slots, and a writer thread dumps
+// the kept packets in their original order.
 
 #include <vata2/util.hh>
 #include <vata2/nfa.hh>
+#include <vata2/nfa-matcher.hh>
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <thread>
 
 // PCAP-related headers
 #include <pcap.h>
@@ -35,81 +44,237 @@ using namespace Vata2::Parser;
 
 using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
+/// a view of a part of a packet
+struct ByteSpan
+{
+	const uint8_t* data;
+	size_t len;
+};
+
+/**
+ * A slot of the ring of packets.  The stamp of the slot used for the packet
+ * with the sequence number 'seq' goes through the following values:
+ *   seq      - the slot is free,
+ *   seq + 1  - the packet has been read,
+ *   seq + 2  - the packet has been matched, and
+ *   seq + RING_SIZE  - the packet has been written (the slot is free again).
+ */
+struct PacketSlot
+{
+	std::atomic<size_t> stamp;
+	pcap_pkthdr hdr;
+	std::vector<u_char> data;
+	bool has_payload;
+	bool keep;
+
+	PacketSlot() : stamp(0), hdr(), data(), has_payload(false), keep(false) { }
+};
+
 // FUNCTION DECLARATIONS
-void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
+ByteSpan get_payload(const pcap_pkthdr* pkthdr, const u_char* packet);
+
+// CONSTANTS
+const size_t RING_SIZE = 4096;
+const size_t DEFAULT_THREADS = 4;
 
 // GLOBAL VARIABLES
 size_t total_packets = 0;
 size_t payloaded_packets = 0;
 size_t filtered_packets = 0;
+size_t total_bytes = 0;
 bool prefix_acceptance = false;
 bool keep_in_language = true;
 Nfa aut;
 pcap_dumper_t* dumper = nullptr;
 
+std::unique_ptr<PacketSlot[]> ring;
+/// the next sequence number to be claimed by a matcher
+std::atomic<size_t> next_to_match(0);
+/// the number of read packets (valid once reading_done is set)
+std::atomic<size_t> read_packets(0);
+std::atomic<bool> reading_done(false);
+
 
 void print_usage(const char* prog_name)
 {
-	std::cout << "usage: " << prog_name << " [-p] <--in|--notin> <aut.vtf> <input.pcap> <output.pcap>\n";
+	std::cout << "usage: " << prog_name << " [-p] [-t <threads>] <--in|--notin> <aut.vtf> <input.pcap> <output.pcap>\n";
 	std::cout << "\n";
 	std::cout << "Options:\n";
 	std::cout << "  --in     keep packets IN the language of aut.vtf\n";
 	std::cout << "  --notin  keep packets NOT IN the language of aut.vtf\n";
 	std::cout << "  -p       prefix acceptance\n";
+	std::cout << "  -t       number of matcher threads (default: " << DEFAULT_THREADS << ")\n";
 }
 
 Nfa load_aut(const std::string& file_name)
 {
+	// the file is scanned directly in memory (in parallel)
+	MappedFile file(file_name);
+	VtfScanner scanner(file.data(), file.size());
+
 	Nfa result;
-	std::ifstream input(file_name);
-	if (input.is_open())
-	{
-		ParsedSection parsec = parse_vtf_section(input);
-		Vata2::Nfa::CharAlphabet alphabet;
-		return construct(parsec, &alphabet);
-	}
-	else
+	Vata2::Nfa::CharAlphabet alphabet;
+	construct_parallel(&result, &scanner, &alphabet);
+	return result;
+}
+
+/**
+ * Waits until the slot of the packet @p seq gets the stamp @p expected.
+ * Returns false if there is no such packet (the input has ended before it).
+ */
+bool wait_for_stamp(size_t seq, size_t expected)
+{
+	const PacketSlot& slot = ring[seq % RING_SIZE];
+	while (slot.stamp.load(std::memory_order_acquire) != expected)
 	{
-		throw std::runtime_error("Cannot open file " + file_name);
+		if (reading_done.load(std::memory_order_acquire) &&
+			seq >= read_packets.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		std::this_thread::yield();
 	}
+
+	return true;
 }
 
-int main(int argc, char** argv)
+/// matches payloads of packets until there are no more
+void match_packets()
 {
-	// PARSING COMMAND LINE ARGUMENTS
-	size_t param_start = 1;
-	if (argc != 5 && argc != 6)
+	LazyDfaMatcher matcher(aut);
+
+	while (true)
 	{
-		print_usage(argv[0]);
-		return EXIT_FAILURE;
+		size_t seq = next_to_match.fetch_add(1);
+		if (!wait_for_stamp(seq, seq + 1)) { return; }
+
+		PacketSlot& slot = ring[seq % RING_SIZE];
+		ByteSpan payload = get_payload(&slot.hdr, slot.data.data());
+		slot.has_payload = (0 != payload.len);
+		slot.keep = false;
+		if (slot.has_payload)
+		{
+			bool in_lang = false;
+			if (prefix_acceptance)
+			{
+				in_lang = matcher.is_prfx_in_lang(payload.data, payload.len);
+			}
+			else
+			{
+				in_lang = matcher.is_in_lang(payload.data, payload.len);
+			}
+
+			slot.keep = (in_lang == keep_in_language);
+		}
+
+		slot.stamp.store(seq + 2, std::memory_order_release);
 	}
+}
 
-	if (std::to_string(argv[1]) == "-p")
+/// writes matched packets in the order in which they were read
+void write_packets()
+{
+	for (size_t seq = 0; wait_for_stamp(seq, seq + 2); ++seq)
 	{
-		prefix_acceptance = true;
-		param_start = 2;
+		PacketSlot& slot = ring[seq % RING_SIZE];
 
-		if (argc != 6)
+		++total_packets;
+		total_bytes += slot.hdr.caplen;
+		if (slot.has_payload) { ++payloaded_packets; }
+		if (slot.keep)
 		{
-			print_usage(argv[0]);
-			return EXIT_FAILURE;
+			++filtered_packets;
+			pcap_dump(reinterpret_cast<u_char*>(dumper), &slot.hdr, slot.data.data());
+		}
+
+		if (total_packets % 10000 == 0)
+		{
+			std::clog << "#";
+			std::clog.flush();
 		}
+
+		slot.stamp.store(seq + RING_SIZE, std::memory_order_release);
 	}
-	else
+}
+
+/// reads packets into the ring; returns false on an error
+bool read_packets_into_ring(pcap_t* descr)
+{
+	size_t seq = 0;
+	pcap_pkthdr* pkthdr = nullptr;
+	const u_char* packet = nullptr;
+	int rv;
+	while (1 == (rv = pcap_next_ex(descr, &pkthdr, &packet)))
+	{
+		PacketSlot& slot = ring[seq % RING_SIZE];
+		while (slot.stamp.load(std::memory_order_acquire) != seq)
+		{ // waiting for the writer to free the slot
+			std::this_thread::yield();
+		}
+
+		slot.hdr = *pkthdr;
+		slot.data.assign(packet, packet + pkthdr->caplen);
+		slot.stamp.store(seq + 1, std::memory_order_release);
+		++seq;
+	}
+
+	read_packets.store(seq, std::memory_order_release);
+	reading_done.store(true, std::memory_order_release);
+
+	if (-1 == rv)
+	{
+		std::cout << "pcap_next_ex() failed: " << pcap_geterr(descr) << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	// PARSING COMMAND LINE ARGUMENTS
+	int param_start = 1;
+	size_t threads = DEFAULT_THREADS;
+	while (param_start < argc && argv[param_start][0] == '-' &&
+		std::string(argv[param_start]) != "--in" &&
+		std::string(argv[param_start]) != "--notin")
 	{
-		if (argc != 5)
+		std::string opt = argv[param_start];
+		if ("-p" == opt)
+		{
+			prefix_acceptance = true;
+			param_start += 1;
+		}
+		else if ("-t" == opt && param_start + 1 < argc)
+		{
+			threads = std::strtoul(argv[param_start + 1], nullptr, 10);
+			if (0 == threads)
+			{
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+
+			param_start += 2;
+		}
+		else
 		{
 			print_usage(argv[0]);
 			return EXIT_FAILURE;
 		}
 	}
 
-	if (std::to_string(argv[param_start + 0]) == "--in")
+	if (argc != param_start + 4)
 	{
-		keep_in_language = true;
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
 
+	if (std::string(argv[param_start + 0]) == "--in")
+	{
+		keep_in_language = true;
 	}
-	else if (std::to_string(argv[param_start + 0]) == "--notin")
+	else if (std::string(argv[param_start + 0]) == "--notin")
 	{
 		keep_in_language = false;
 	}
@@ -152,33 +317,46 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	ring.reset(new PacketSlot[RING_SIZE]);
+	for (size_t i = 0; i < RING_SIZE; ++i) { ring[i].stamp.store(i); }
+
 	TimePoint startTime = std::chrono::high_resolution_clock::now();
 
-	// start packet processing loop, just like live capture
-	if (pcap_loop(descr, 0, packetHandler, nullptr) < 0)
-	{
-		std::cout << "pcap_loop() failed: " << pcap_geterr(descr);
-		return EXIT_FAILURE;
-	}
+	std::vector<std::thread> matchers;
+	for (size_t i = 0; i < threads; ++i) { matchers.emplace_back(match_packets); }
+	std::thread writer(write_packets);
+
+	bool read_ok = read_packets_into_ring(descr);
+
+	for (std::thread& matcher : matchers) { matcher.join(); }
+	writer.join();
 
 	pcap_dump_close(dumper);
+	pcap_close(descr);
+
+	if (!read_ok) { return EXIT_FAILURE; }
 
 	TimePoint finishTime = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> opTime = finishTime - startTime;
+	std::chrono::duration<double> opTime = finishTime - startTime;
+	double seconds = opTime.count();
 
 	std::cout << "\n";
 	std::cout << "Total packets in " << packets_file << ": " << total_packets << "\n";
 	std::cout << "Packets with payload: " << payloaded_packets << "\n";
 	std::cout << "Filtered packets: " << filtered_packets << "\n";
-	std::cout << "Time: " <<
-		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
-		<< "\n";
+	std::cout << "Matcher threads: " << threads << "\n";
+	std::cout << "Time: " << seconds << "\n";
+	if (seconds > 0)
+	{
+		std::cout << "Packets/s: " << total_packets / seconds << "\n";
+		std::cout << "Bytes/s: " << total_bytes / seconds << "\n";
+	}
 
 	return EXIT_SUCCESS;
 }
 
 
-Word get_payload(
+ByteSpan get_payload(
 	const pcap_pkthdr* pkthdr,
 	const u_char* packet)
 {
@@ -211,7 +389,7 @@ Word get_payload(
 	}
 	else
 	{
-		return Word();
+		return ByteSpan{nullptr, 0};
 	}
 
 	bool ip_in_ip = false;
@@ -252,7 +430,7 @@ Word get_payload(
 		}
 		else if (IPPROTO_GRE == l4_proto)
 		{
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 		else if (IPPROTO_ICMPV6 == l4_proto)
 		{
@@ -274,55 +452,17 @@ Word get_payload(
 		}
 		else if (IPPROTO_PIM == l4_proto)
 		{
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 		else
 		{
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 	}
 
-	return Word(packet + offset, packet + std::max(static_cast<size_t>(pkthdr->len), offset));
-	// return Word(packet + offset, packet + pkthdr->len);
-}
-
-void packetHandler(
-	u_char* /* userData */,
-	const pcap_pkthdr* pkthdr,
-	const u_char* packet)
-{
-	assert(nullptr != pkthdr);
-	assert(nullptr != packet);
-
-	++total_packets;
-
-	Word payload = get_payload(pkthdr, packet);
-	if (payload.empty())
-	{
-		return;
-	}
-
-	++payloaded_packets;
+	// only the captured part of the packet is available
+	size_t caplen = pkthdr->caplen;
+	if (offset >= caplen) { return ByteSpan{nullptr, 0}; }
 
-	bool in_lang = false;
-	if (prefix_acceptance)
-	{
-		in_lang = is_prfx_in_lang(aut, payload);
-	}
-	else
-	{
-		in_lang = is_in_lang(aut, payload);
-	}
-
-	if ((in_lang && keep_in_language) || (!in_lang && !keep_in_language))
-	{
-		++filtered_packets;
-		pcap_dump((u_char*)dumper, pkthdr, packet);
-	}
-
-	if (total_packets % 10000 == 0)
-	{
-		std::clog << "#";
-		std::clog.flush();
-	}
+	return ByteSpan{packet + offset, caplen - offset};
 }
@@ -4,10 +4,14 @@
 
 #include <vata2/util.hh>
 #include <vata2/nfa.hh>
+#include <vata2/nfa-matcher.hh>
 
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
 
 // PCAP-related headers
 #include <pcap.h>
@@ -36,22 +40,40 @@ using namespace Vata2::Parser;
 
 using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
+/// a view of a part of a packet
+struct ByteSpan
+{
+	const uint8_t* data;
+	size_t len;
+};
+
+/// payloads of a batch of packets stored one after another
+struct Batch
+{
+	std::vector<uint8_t> bytes = {};
+	/// ends of payloads in bytes
+	std::vector<size_t> ends = {};
+
+	void clear() { this->bytes.clear(); this->ends.clear(); }
+};
+
+/// the size of a batch (in bytes) that is profiled at once
+const size_t BATCH_SIZE = 64 << 20;
+
 // FUNCTION DECLARATIONS
-void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
+ByteSpan get_payload(const pcap_pkthdr* pkthdr, const u_char* packet, u_int16_t tcp_port);
 
 // GLOBAL VARIABLES
 size_t total_packets = 0;
 size_t payloaded_packets = 0;
+size_t total_bytes = 0;
 u_int16_t tcp_port = 0;
+size_t num_threads = 4;
 Nfa aut;
 
-std::unordered_map<State, size_t> state_occur_cnt;
-std::unordered_map<Trans, size_t> trans_occur_cnt;
-std::unordered_map<State, size_t> state_accept_cnt;
-
 void print_usage(const char* prog_name)
 {
-	std::cout << "usage: " << prog_name << " (--tcp PORT) <aut.vtf> <input.pcap>\n";
+	std::cout << "usage: " << prog_name << " (--tcp PORT) (-t THREADS) <aut.vtf> <input.pcap>\n";
 	std::cout << "\n";
 	std::cout << "Accepts a deterministic FA in aut.vtf and a PCAP file in\n";
 	std::cout << "input.pcap and constructs a probabilistic automaton obtained\n";
@@ -60,66 +82,90 @@ void print_usage(const char* prog_name)
 	std::cout << "\n";
 	std::cout << "Options:\n";
 	std::cout << "  --tcp PORT  Consider *only* TCP packets *only* on PORT (any from src or dst)\n";
+	std::cout << "  -t THREADS  Number of profiling threads (default: 4)\n";
 	std::cout << "\n";
 	std::cout << "Parameters:\n";
-	std::cout << "  aut.vtf     Deterministic FA with the structure to be labelled\n";
+	std::cout << "  aut.vtf     FA with the structure to be labelled (determinized if\n";
+	std::cout << "              nondeterministic)\n";
 	std::cout << "  input.pcap  Input sample\n";
 }
 
 Nfa load_aut(const std::string& file_name)
 {
+	// the file is scanned directly in memory (in parallel)
+	MappedFile file(file_name);
+	VtfScanner scanner(file.data(), file.size());
+
 	Nfa result;
-	std::ifstream input(file_name);
-	if (input.is_open())
-	{
-		ParsedSection parsec = parse_vtf_section(input);
-		Vata2::Nfa::CharAlphabet alphabet;
-		return construct(parsec, &alphabet);
-	}
-	else
+	Vata2::Nfa::CharAlphabet alphabet;
+	construct_parallel(&result, &scanner, &alphabet);
+	return result;
+}
+
+/**
+ * @brief  Profiles payloads of a batch, split among threads
+ *
+ * Every thread profiles a contiguous part of the batch into its own counters.
+ */
+void profile_batch(
+	const ProfilingMatcher&                     matcher,
+	const Batch&                                batch,
+	std::vector<ProfilingMatcher::Counters>*    counters)
+{
+	assert(nullptr != counters);
+
+	size_t num_payloads = batch.ends.size();
+	size_t chunk = (num_payloads + counters->size() - 1) / counters->size();
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < counters->size(); ++i)
 	{
-		throw std::runtime_error("Cannot open file " + file_name);
+		size_t first = std::min(i * chunk, num_payloads);
+		size_t last = std::min(first + chunk, num_payloads);
+		ProfilingMatcher::Counters* cnt = &(*counters)[i];
+		workers.emplace_back([&matcher, &batch, first, last, cnt]() {
+			size_t start = (0 == first)? 0 : batch.ends[first - 1];
+			for (size_t j = first; j < last; ++j)
+			{
+				matcher.profile(batch.bytes.data() + start, batch.ends[j] - start, cnt);
+				start = batch.ends[j];
+			}
+		});
 	}
+
+	for (auto& worker : workers) { worker.join(); }
 }
 
 int main(int argc, char** argv)
 {
 	// PARSING COMMAND LINE ARGUMENTS
-	size_t param_start = 1;
-	if (argc != 3 && argc != 5)
+	int param_start = 1;
+	while (param_start < argc && argv[param_start][0] == '-')
 	{
-		print_usage(argv[0]);
-		return EXIT_FAILURE;
-	}
-
-	if (std::to_string(argv[1]) == "--tcp")
-	{
-		param_start = 3;
-
-		if (argc != 5)
+		std::string opt = argv[param_start];
+		if (param_start + 1 >= argc || (opt != "--tcp" && opt != "-t"))
 		{
 			print_usage(argv[0]);
 			return EXIT_FAILURE;
 		}
 
-		std::istringstream stream(argv[2]);
-		try
-		{
-			stream >> tcp_port;
-		}
-		catch (...)
+		std::istringstream stream(argv[param_start + 1]);
+		if (opt == "--tcp") { stream >> tcp_port; }
+		else { stream >> num_threads; }
+
+		if (stream.fail() || 0 == num_threads)
 		{
-			std::cerr << "Invalid number as PORT provided!\n";
+			std::cerr << "Invalid number provided for " << opt << "!\n";
 			return EXIT_FAILURE;
 		}
+
+		param_start += 2;
 	}
-	else
+
+	if (argc - param_start != 2)
 	{
-		if (argc != 3)
-		{
-			print_usage(argv[0]);
-			return EXIT_FAILURE;
-		}
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
 	}
 
 	// LOADING INPUTS
@@ -138,29 +184,26 @@ int main(int argc, char** argv)
 
 	if (!is_deterministic(aut))
 	{
-		std::cerr << "The provided automaton is nondeterministic!\n";
-		return EXIT_FAILURE;
+		std::clog << "The provided automaton is nondeterministic, determinizing\n";
+		aut = determinize(aut);
 	}
 
-	// size_t max_state = 0;
-	// for (const auto& st : aut.initialstates) { max_state = std::max({max_state, st}); }
-	// for (const auto& st : aut.finalstates) { max_state = std::max({max_state, st}); }
-	// for (const auto& trans : aut) { max_state = std::max({max_state, trans.src, trans.tgt}); }
-
 	Vata2::Nfa::CharAlphabet alphabet;
 	if (!is_complete(aut, alphabet))
 	{
-		// ++max_state;
 		make_complete(&aut, alphabet, -1);
 	}
 
-	// std::clog << "# States = " << max_state + 1 << "\n";
-
-	// state_occur_cnt = new size_t[max_state+1];
-	// for (size_t i = 0; i <= max_state; ++i)
-	// {
-	// 	state_occur_cnt[i] = 0;
-	// }
+	std::unique_ptr<ProfilingMatcher> matcher;
+	try
+	{
+		matcher.reset(new ProfilingMatcher(aut));
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error compiling the automaton: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
 
 	pcap_t *descr = nullptr;
 	char errbuf[PCAP_ERRBUF_SIZE];
@@ -175,45 +218,75 @@ int main(int argc, char** argv)
 
 	TimePoint startTime = std::chrono::high_resolution_clock::now();
 
-	// start packet processing loop, just like live capture
-	if (pcap_loop(descr, 0, packetHandler, nullptr) < 0)
+	// one batch is being read while the other one is being profiled
+	std::vector<ProfilingMatcher::Counters> counters(num_threads,
+		matcher->new_counters());
+	Batch batches[2];
+	size_t reading = 0;
+	std::thread profiler;
+
+	auto flush_batch = [&]() {
+		if (profiler.joinable()) { profiler.join(); }
+		batches[1 - reading].clear();
+		profiler = std::thread(profile_batch, std::cref(*matcher),
+			std::cref(batches[reading]), &counters);
+		reading = 1 - reading;
+		std::clog << "#";
+		std::clog.flush();
+	};
+
+	int res;
+	pcap_pkthdr* pkthdr;
+	const u_char* packet;
+	while ((res = pcap_next_ex(descr, &pkthdr, &packet)) >= 0)
 	{
-		std::cout << "pcap_loop() failed: " << pcap_geterr(descr);
-		return EXIT_FAILURE;
-	}
+		if (0 == res) { continue; }   // timeout (only for live captures)
 
-	TimePoint finishTime = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> opTime = finishTime - startTime;
+		++total_packets;
+		ByteSpan payload = get_payload(pkthdr, packet, tcp_port);
+		if (0 == payload.len) { continue; }
 
-	// set precision of output
-	std::cout.precision(std::numeric_limits<double>::max_digits10);
+		++payloaded_packets;
+		total_bytes += payload.len;
 
-	std::cout << "@DPA\n";
-	std::cout << "%Initial " << *aut.initialstates.begin() << ":1.0\n";
-	std::cout << "%Final ";
-	for (const auto& st_acc : state_accept_cnt)
+		Batch& batch = batches[reading];
+		batch.bytes.insert(batch.bytes.end(), payload.data, payload.data + payload.len);
+		batch.ends.push_back(batch.bytes.size());
+		if (batch.bytes.size() >= BATCH_SIZE) { flush_batch(); }
+	}
+
+	if (-1 == res)
 	{
-		double prod = (static_cast<double>(st_acc.second) / state_occur_cnt[st_acc.first]);
-		std::cout << st_acc.first << ":" << prod << " ";
+		std::cout << "pcap_next_ex() failed: " << pcap_geterr(descr);
+		// a running std::thread must not be destroyed
+		if (profiler.joinable()) { profiler.join(); }
+		pcap_close(descr);
+		return EXIT_FAILURE;
 	}
-	std::cout << "\n";
 
-	for (const auto& trans_acc : trans_occur_cnt)
+	flush_batch();
+	profiler.join();
+	pcap_close(descr);
+
+	for (size_t i = 1; i < counters.size(); ++i)
 	{
-		double prob = (static_cast<double>(trans_acc.second) /
-			state_occur_cnt[trans_acc.first.src]);
-		const Trans& trans = trans_acc.first;
-		std::cout << trans.src << " ";
-		std::cout << trans.symb << ":" << prob << " ";
-		std::cout << trans.tgt << "\n";
+		counters[0].merge(counters[i]);
 	}
 
+	TimePoint finishTime = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> opTime = finishTime - startTime;
+
+	std::cout << std::to_string(matcher->serialize_prob(counters[0]));
+
 	std::clog << "\n";
 	std::clog << "Total packets in " << packets_file << ": " << total_packets << "\n";
 	std::clog << "Packets with payload: " << payloaded_packets << "\n";
-	std::clog << "Time: " <<
-		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
-		<< "\n";
+	std::clog << "Packets with a blocked run: " << counters[0].blocked << "\n";
+	std::clog << "Time: " << opTime.count() << "\n";
+	if (opTime.count() > 0)
+	{
+		std::clog << "Bytes/s: " << total_bytes / opTime.count() << "\n";
+	}
 
 	return EXIT_SUCCESS;
 }
@@ -225,7 +298,7 @@ int main(int argc, char** argv)
  * @param[in]  tcp_port  If non-0, specifies a TCP port that will only be
  *                       considered (src or dst)
  */
-Word get_payload(
+ByteSpan get_payload(
 	const pcap_pkthdr*   pkthdr,
 	const u_char*        packet,
 	u_int16_t            tcp_port)
@@ -259,7 +332,7 @@ Word get_payload(
 	}
 	else
 	{
-		return Word();
+		return ByteSpan{nullptr, 0};
 	}
 
 	if (IPPROTO_TCP == l4_proto)
@@ -269,7 +342,7 @@ Word get_payload(
 			(ntohs(tcp_hdr->th_sport) != tcp_port) &&
 			(ntohs(tcp_hdr->th_dport) != tcp_port))
 		{
-			return Word();
+			return ByteSpan{nullptr, 0};
 		}
 
 		size_t tcp_hdr_size = tcp_hdr->th_off * 4;
@@ -277,62 +350,12 @@ Word get_payload(
 	}
 	else
 	{
-		return Word();
+		return ByteSpan{nullptr, 0};
 	}
 
-	return Word(packet + offset, packet + std::max(static_cast<size_t>(pkthdr->len), offset));
-	// return Word(packet + offset, packet + pkthdr->len);
-}
-
-void packetHandler(
-	u_char* /* userData */,
-	const pcap_pkthdr* pkthdr,
-	const u_char* packet)
-{
-	assert(nullptr != pkthdr);
-	assert(nullptr != packet);
-
-	++total_packets;
-
-	Word payload = get_payload(pkthdr, packet, tcp_port);
-	if (payload.empty()) { return; }
-
-	++payloaded_packets;
-
-	// std::clog << std::to_string(payload) << "\n";
-	// for (auto i: payload)
-	// {
-	// 	std::clog << static_cast<char>(i);
-	// }
-  //
-	// std::clog << "\n";
-
-	StateSet cur = aut.initialstates;
-	for (Symbol sym : payload)
-	{
-		if (cur.size() != 1) { std::abort(); }
+	// only the captured part of the packet is available
+	size_t caplen = pkthdr->caplen;
+	if (offset >= caplen) { return ByteSpan{nullptr, 0}; }
 
-		State src = *cur.begin();
-
-		// SAFELY NEGLECTED
-		// assert(state_occur_cnt[st] < SIZE_MAX);
-
-		++state_occur_cnt[src];
-
-		cur = aut.get_post_of_set(cur, sym);
-		if (cur.size() != 1) { std::abort(); }
-		State tgt = *cur.begin();
-
-		Trans trans(src, sym, tgt);
-		++trans_occur_cnt[trans];
-	}
-
-	State st = *cur.begin();
-	++state_accept_cnt[st];
-
-	if (total_packets % 10000 == 0)
-	{
-		std::clog << "#";
-		std::clog.flush();
-	}
+	return ByteSpan{packet + offset, caplen - offset};
 }
@@ -0,0 +1,119 @@
+/* binary.hh -- common header of binary automata files
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_BINARY_HH_
+#define _VATA2_BINARY_HH_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// VATA2 headers
+#include <vata2/util.hh>
+
+namespace Vata2
+{
+namespace Binary
+{
+
+/// the magic number at the beginning of every binary file
+const char MAGIC[4] = {'V', 'T', 'F', 'B'};
+/// the current version of the format
+const uint32_t VERSION = 1;
+/// written in the native byte order; used to detect files from other machines
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+/// the maximum length of the type of the automaton
+const size_t MAX_TYPE_LEN = 16;
+
+/**
+ * The header of a binary file.  It is followed by data specific to the type of
+ * the automaton (e.g., "NFA", the same as the @TYPE of a VTF section); all
+ * data are in the native byte order and aligned to 8 bytes from the beginning
+ * of the file.
+ */
+struct Header
+{ // {{{
+	char magic[4];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t reserved;
+	char type[MAX_TYPE_LEN];
+}; // Header }}}
+
+static_assert(sizeof(Header) == 32, "unexpected padding in Binary::Header");
+
+
+/// does @p data of size @p size start with the magic number?
+inline bool has_magic(const char* data, size_t size)
+{ // {{{
+	return size >= sizeof(MAGIC) && 0 == std::memcmp(data, MAGIC, sizeof(MAGIC));
+} // has_magic }}}
+
+
+/// creates a header for an automaton of the type @p type
+inline Header make_header(const std::string& type)
+{ // {{{
+	if (type.size() > MAX_TYPE_LEN)
+	{
+		throw std::runtime_error(std::to_string(__func__) + ": type too long: " + type);
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	std::memcpy(header.type, type.data(), type.size());
+	return header;
+} // make_header }}}
+
+
+/**
+ * Checks the header at the beginning of @p data of size @p size and returns
+ * the type of the automaton; throws std::runtime_error if the header is
+ * invalid
+ */
+inline std::string read_header(const char* data, size_t size)
+{ // {{{
+	if (size < sizeof(Header) || !has_magic(data, size))
+	{
+		throw std::runtime_error(std::to_string(__func__) + ": not a binary automaton");
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	if (BYTE_ORDER_MARK != header.byte_order)
+	{
+		throw std::runtime_error(std::to_string(__func__) +
+			": the file uses a different byte order");
+	}
+
+	if (VERSION != header.version)
+	{
+		throw std::runtime_error(std::to_string(__func__) +
+			": unsupported version " + std::to_string(header.version));
+	}
+
+	return std::string(header.type, strnlen(header.type, MAX_TYPE_LEN));
+} // read_header }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Binary */
+} /* Vata2 */
+
+#endif /* _VATA2_BINARY_HH_ */
@@ -1,16 +1,98 @@
-// TODO: add header
+/* code.hh -- compilation of VATA@CODE into instructions of the VM
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
 
 #ifndef _VATA2_CODE_HH_
 #define _VATA2_CODE_HH_
 
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// VATA headers
+#include <vata2/parser.hh>
+
 namespace Vata2
 {
 namespace Code
 {
 
+/// the operation codes of instructions
+enum class OpCode : uint8_t
+{
+	PUSH_STR,     ///< pushes a new string with the literal strings[arg]
+	PUSH_TOKEN,   ///< pushes a new token with the text strings[arg]
+	CALL,         ///< calls calls[arg] and replaces its arguments by the result
+	STORE,        ///< pops a value and stores it into the variable vars[arg]
+	DISCARD,      ///< pops a value and deletes it (with a warning if not void)
+	ERROR,        ///< deletes the stack and throws an error with strings[arg]
+};
+
+/// an instruction
+struct Instr
+{ // {{{
+	OpCode op;
+	uint32_t arg;
+}; // Instr }}}
+
+/// a function call
+struct Call
+{ // {{{
+	/// the argument is taken from the stack (and not from a variable)
+	static const uint32_t FROM_STACK = std::numeric_limits<uint32_t>::max();
+
+	/// the ID of the name of the function (in Program::funcs)
+	uint32_t func = 0;
+	/// IDs of variables passed as arguments (in Program::vars) or FROM_STACK
+	std::vector<uint32_t> args = {};
+	/// the number of arguments taken from the stack
+	uint32_t num_stack = 0;
+}; // Call }}}
 
+/**
+ * @brief  A compiled CODE section
+ *
+ * Every line of the section is compiled into instructions of a stack machine.
+ * Names of functions and variables are interned, so no tokens are allocated
+ * when the program is executed, and variables (and dispatchers of calls) are
+ * looked up only at their first use.  Errors in the structure of the code are
+ * compiled into ERROR instructions at the positions where the interpreter
+ * would report them, so the code before them is executed as before.
+ */
+struct Program
+{ // {{{
+	std::vector<Instr> instrs = {};
+	/// string literals, tokens, and error messages
+	std::vector<std::string> strings = {};
+	/// interned names of variables
+	std::vector<std::string> vars = {};
+	/// interned names of functions
+	std::vector<std::string> funcs = {};
+	std::vector<Call> calls = {};
+	/// the maximum number of arguments of a call
+	size_t max_args = 0;
+}; // Program }}}
 
+/// compiles the CODE section @p parsec
+Program compile(const Vata2::Parser::ParsedSection& parsec);
 
+/// prints the instructions of @p prog (one per line)
+std::ostream& operator<<(std::ostream& os, const Program& prog);
 
 // CLOSING NAMESPACES AND GUARDS
 } /* Code */
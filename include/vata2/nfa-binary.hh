@@ -0,0 +1,174 @@
+/* nfa-binary.hh -- compact binary format of NFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_NFA_BINARY_HH_
+#define _VATA2_NFA_BINARY_HH_
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+
+// VATA2 headers
+#include <vata2/binary.hh>
+#include <vata2/nfa.hh>
+
+namespace Vata2
+{
+namespace Nfa
+{
+
+/**
+ * @brief  Saves @p aut in the binary format
+ *
+ * After the common Binary::Header (with the type "NFA"), the file contains
+ * the following arrays, each of them starting at an offset aligned to 8
+ * bytes:
+ *
+ *   - counts of items of the arrays below (eight 64-bit integers),
+ *   - the states (sorted); other arrays refer to states by their indices
+ *     into this array,
+ *   - indices of initial states and of final states,
+ *   - transitions in the compressed sparse row format: for every state, the
+ *     offset of its first transition (plus the final end offset), followed
+ *     by symbols and (indices of) targets of transitions; transitions of a
+ *     state are sorted by symbols and targets,
+ *   - optional names of states and of symbols as keys with offsets into a
+ *     shared array of characters.
+ *
+ * Names of states and symbols from @p state_map and @p symbol_map are saved
+ * only for states and symbols occurring in @p aut.
+ */
+void save_binary(
+	const Nfa&                aut,
+	std::ostream&             os,
+	const StateToStringMap*   state_map = nullptr,
+	const SymbolToStringMap*  symbol_map = nullptr);
+
+/**
+ * Loads an automaton in the binary format (see save_binary()) from @p is;
+ * throws std::runtime_error if the input is not a valid binary NFA
+ */
+void load_binary(
+	Nfa*                aut,
+	std::istream&       is,
+	StateToStringMap*   state_map = nullptr,
+	SymbolToStringMap*  symbol_map = nullptr);
+
+/**
+ * The name of the symbol @p symb that has no name in a binary NFA.  The name
+ * starts with a newline, which no name in a .vtf file contains, so symbols
+ * without names are never merged with named ones (of any automaton).
+ */
+inline std::string get_unnamed_symbol_name(Symbol symb)
+{ // {{{
+	return "\n" + std::to_string(symb);
+} // get_unnamed_symbol_name }}}
+
+inline Nfa load_binary(
+	std::istream&       is,
+	StateToStringMap*   state_map = nullptr,
+	SymbolToStringMap*  symbol_map = nullptr)
+{ // {{{
+	Nfa result;
+	load_binary(&result, is, state_map, symbol_map);
+	return result;
+} // load_binary }}}
+
+
+/**
+ * A read-only view of an automaton in the binary format.  The data are
+ * validated once in the constructor and queries are then answered directly
+ * from them (post() uses binary search), so opening a large automaton takes
+ * a single pass over the file, without building an Nfa.
+ */
+class BinaryNfa
+{ // {{{
+private:
+
+	/// the mapped file (if the view was opened from a file)
+	std::unique_ptr<Vata2::Parser::MappedFile> file;
+
+	/// counts of items
+	uint64_t cnt_states;
+	uint64_t cnt_initial;
+	uint64_t cnt_final;
+	uint64_t cnt_trans;
+	uint64_t cnt_state_names;
+	uint64_t cnt_symbol_names;
+
+	/// the arrays (see save_binary())
+	const uint64_t* states;
+	const uint32_t* initial_idx;
+	const uint32_t* final_idx;
+	const uint64_t* row_ptr;
+	const uint64_t* symbols;
+	const uint32_t* targets;
+	const uint32_t* state_name_keys;
+	const uint64_t* state_name_offs;
+	const uint64_t* symbol_name_keys;
+	const uint64_t* symbol_name_offs;
+	const char* names;
+
+	BinaryNfa(const BinaryNfa&) = delete;
+	BinaryNfa& operator=(const BinaryNfa&) = delete;
+
+	void init(const char* data, size_t size);
+
+	/// the index of @p state, or num_states() if it is not in the automaton
+	uint64_t index_of(State state) const;
+
+public:
+
+	/// maps @p filename and opens the automaton in it
+	explicit BinaryNfa(const std::string& filename);
+
+	/**
+	 * Opens the automaton at @p data (aligned to 8 bytes) of size @p size; the
+	 * data need to outlive the view
+	 */
+	BinaryNfa(const char* data, size_t size);
+
+	size_t num_states() const { return this->cnt_states; }
+	size_t num_trans() const { return this->cnt_trans; }
+
+	bool has_initial(State state) const;
+	bool has_final(State state) const;
+	StateSet get_initial() const;
+	StateSet get_final() const;
+
+	/// the post of @p state over @p symb
+	StateSet post(State state, Symbol symb) const;
+	/// the post of a set of states over @p symb
+	StateSet post(const StateSet& macrostate, Symbol symb) const;
+
+	/// names of states and symbols saved in the file
+	StateToStringMap get_state_names() const;
+	SymbolToStringMap get_symbol_names() const;
+
+	/// builds the automaton (and the names of its states and symbols)
+	void to_nfa(
+		Nfa*                aut,
+		StateToStringMap*   state_map = nullptr,
+		SymbolToStringMap*  symbol_map = nullptr) const;
+}; // BinaryNfa }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Nfa */
+} /* Vata2 */
+
+#endif /* _VATA2_NFA_BINARY_HH_ */
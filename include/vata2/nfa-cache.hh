@@ -0,0 +1,166 @@
+/* nfa-cache.hh -- cache of results of operations on NFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_NFA_CACHE_HH_
+#define _VATA2_NFA_CACHE_HH_
+
+#include <list>
+#include <mutex>
+
+// VATA2 headers
+#include <vata2/nfa.hh>
+
+namespace Vata2
+{
+namespace Nfa
+{
+
+/// A result of an operation stored in the cache
+struct CachedResult
+{
+	Nfa aut = {};         /// the resulting automaton (for constructions)
+	bool flag = false;    /// the resulting value (for decision procedures)
+	Word cex = {};        /// the counterexample (for decision procedures)
+};
+
+
+/**
+ * A size-bounded LRU cache of results of operations.  An entry is identified
+ * by the name of the operation, its argument automata, the symbols of the
+ * alphabet, and parameters.  Lookups are driven by structural hashes of the
+ * automata, which are then compared for equality, so a hash collision can
+ * never produce a wrong result.
+ *
+ * The cache is disabled (has capacity 0) until set_capacity() is called.  All
+ * methods may be called from several threads.
+ */
+class OpCache
+{ // {{{
+private:
+
+	struct Entry
+	{
+		std::string op;
+		std::vector<Nfa> args;
+		std::vector<Symbol> symbols;
+		StringDict params;
+		size_t key_hash;
+		CachedResult result;
+	};
+
+	using EntryList = std::list<Entry>;
+
+	/// entries, the most recently used one at the front
+	EntryList entries;
+	/// maps hashes of keys into entries
+	std::unordered_multimap<size_t, EntryList::iterator> index;
+	size_t max_size;
+	size_t hits;
+	size_t misses;
+	mutable std::mutex mtx;
+
+	OpCache(const OpCache&) = delete;
+	OpCache& operator=(const OpCache&) = delete;
+
+	EntryList::iterator find(
+		const std::string&              op,
+		const std::vector<const Nfa*>&  args,
+		const std::vector<Symbol>&      symbols,
+		const StringDict&               params,
+		size_t                          key_hash);
+
+	void evict();
+
+public:
+
+	OpCache() :
+		entries(), index(), max_size(0), hits(0), misses(0), mtx()
+	{ }
+
+	/// the cache used by cached operations
+	static OpCache& global();
+
+	/// sets the maximum number of entries (0 disables the cache)
+	void set_capacity(size_t capacity);
+	size_t capacity() const;
+	bool enabled() const { return 0 != this->capacity(); }
+
+	/// number of stored entries
+	size_t size() const;
+	/// number of successful and unsuccessful lookups
+	size_t get_hits() const;
+	size_t get_misses() const;
+
+	/// removes all entries (and resets statistics)
+	void clear();
+
+	/**
+	 * Looks up the result of @p op called on @p args.  @p symbols should be
+	 * the sorted symbols of the alphabet (or empty if the result does not
+	 * depend on it)
+	 *
+	 * @returns  @p true if the result was found and copied into @p result
+	 */
+	bool lookup(
+		const std::string&              op,
+		const std::vector<const Nfa*>&  args,
+		const std::vector<Symbol>&      symbols,
+		const StringDict&               params,
+		CachedResult*                   result);
+
+	/// stores the result of @p op called on @p args
+	void store(
+		const std::string&              op,
+		const std::vector<const Nfa*>&  args,
+		const std::vector<Symbol>&      symbols,
+		const StringDict&               params,
+		const CachedResult&             result);
+}; // OpCache }}}
+
+
+/// Determinization consulting the global cache
+Nfa determinize_cached(const Nfa& aut);
+
+/// Minimization consulting the global cache
+Nfa minimize_cached(const Nfa& aut, const StringDict& params = {});
+
+/// Complementation consulting the global cache
+Nfa complement_cached(
+	const Nfa&         aut,
+	const Alphabet&    alphabet,
+	const StringDict&  params = {{"algo", "classical"}});
+
+/// Universality checking consulting the global cache
+bool is_universal_cached(
+	const Nfa&         aut,
+	const Alphabet&    alphabet,
+	Word*              cex = nullptr,
+	const StringDict&  params = {{"algo", "antichains"}});
+
+/// Inclusion checking consulting the global cache
+bool is_incl_cached(
+	const Nfa&         smaller,
+	const Nfa&         bigger,
+	const Alphabet&    alphabet,
+	Word*              cex = nullptr,
+	const StringDict&  params = {{"algo", "antichains"}});
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Nfa */
+} /* Vata2 */
+
+#endif /* _VATA2_NFA_CACHE_HH_ */
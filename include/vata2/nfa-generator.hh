@@ -0,0 +1,89 @@
+/* nfa-generator.hh -- generators of NFAs for experiments and benchmarks
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_NFA_GENERATOR_HH_
+#define _VATA2_NFA_GENERATOR_HH_
+
+#include <cstdint>
+#include <string>
+
+// VATA2 headers
+#include <vata2/nfa.hh>
+
+namespace Vata2
+{
+namespace Nfa
+{
+
+/**
+ * @brief  A random automaton in the model of Tabakov and Vardi
+ *
+ * The automaton has the states 0, ..., @p num_states - 1 with the single
+ * initial state 0 and the symbols 0, ..., @p num_symbols - 1.  For every
+ * symbol, round(@p trans_density * @p num_states) transitions are chosen
+ * uniformly among all pairs of states, and round(@p final_density *
+ * @p num_states) states are chosen uniformly to be final.
+ *
+ * The same @p seed gives the same automaton on every platform (the random
+ * numbers do not depend on the implementation of the standard library).
+ */
+Nfa random_tabakov_vardi(
+	size_t    num_states,
+	size_t    num_symbols,
+	double    trans_density,
+	double    final_density,
+	uint64_t  seed);
+
+/**
+ * A random complete DFA with the states 0, ..., @p num_states - 1 (with the
+ * initial state 0) over the symbols 0, ..., @p num_symbols - 1, whose
+ * transitions lead to uniformly chosen states and whose round(@p final_density
+ * * @p num_states) final states are chosen uniformly
+ */
+Nfa random_dfa(
+	size_t    num_states,
+	size_t    num_symbols,
+	double    final_density,
+	uint64_t  seed);
+
+/**
+ * The automaton with @p n + 1 states accepting words over the symbols 0 and 1
+ * whose @p n-th symbol from the end is 0; its minimal DFA has 2^@p n states
+ */
+Nfa nth_symbol_from_end(size_t n);
+
+/**
+ * @brief  The automaton of the regular expression @p regex
+ *
+ * Characters of @p regex are symbols (translated by @p alphabet), except for
+ * the operators '|' (union), '*', '+', '?' (iteration, positive iteration,
+ * and option), and parentheses; a character preceded by '\' is always a
+ * symbol.  An empty expression (or an empty alternative) denotes the empty
+ * word.
+ *
+ * The automaton is constructed by the method of Glushkov, so it is free of
+ * epsilon transitions and has one state per occurrence of a symbol in
+ * @p regex plus the initial state 0.  Throws std::runtime_error if @p regex is
+ * malformed.
+ */
+Nfa regex_to_nfa(const std::string& regex, Alphabet* alphabet);
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Nfa */
+} /* Vata2 */
+
+#endif /* _VATA2_NFA_GENERATOR_HH_ */
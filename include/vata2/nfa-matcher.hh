@@ -0,0 +1,297 @@
+/* nfa-matcher.hh -- matching byte strings against NFAs via lazy DFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_NFA_MATCHER_HH_
+#define _VATA2_NFA_MATCHER_HH_
+
+#include <cstdint>
+#include <limits>
+
+// VATA2 headers
+#include <vata2/nfa.hh>
+
+namespace Vata2
+{
+namespace Nfa
+{
+
+/**
+ * Matches byte strings (with bytes being the symbols) against the language of
+ * an NFA.  The NFA is determinized lazily: macrostates are numbered when they
+ * are first reached and their successors are kept in a dense table with one
+ * row of 256 entries per macrostate, so matching a byte whose successor is
+ * already known is a single table lookup.
+ *
+ * When the number of macrostates exceeds a bound, the whole table is flushed
+ * and built again from scratch; states obtained before a flush are then no
+ * longer valid.
+ *
+ * A matcher only reads the automaton, which therefore needs to outlive it and
+ * must not be modified while matching.  A matcher itself is not thread-safe;
+ * threads matching against the same automaton should use one matcher each.
+ */
+class LazyDfaMatcher
+{ // {{{
+public:
+
+	/// a state of the lazily built DFA
+	using DfaState = uint32_t;
+
+	/// a successor that has not been computed yet
+	static const DfaState UNKNOWN = std::numeric_limits<DfaState>::max();
+
+	/// default bound on the number of states
+	static const size_t DEFAULT_MAX_STATES = 1 << 16;
+
+private:
+
+	enum : uint8_t { FLAG_ACCEPTING = 1, FLAG_SINK = 2 };
+
+	const Nfa& aut;
+	/// maps macrostates to states of the DFA
+	SubsetMap subset_map;
+	/// macrostates of states of the DFA (pointing to keys of subset_map)
+	std::vector<const StateSet*> macrostates;
+	/// successors; the successor of state s over byte b is at s * 256 + b
+	std::vector<DfaState> table;
+	/// FLAG_* of states
+	std::vector<uint8_t> flags;
+	size_t max_states;
+	size_t flushes;
+
+	LazyDfaMatcher(const LazyDfaMatcher&) = delete;
+	LazyDfaMatcher& operator=(const LazyDfaMatcher&) = delete;
+
+	DfaState get_state(const StateSet& macrostate);
+	DfaState compute_succ(DfaState state, uint8_t byte);
+	void flush();
+
+public:
+
+	explicit LazyDfaMatcher(
+		const Nfa&  aut,
+		size_t      max_states = DEFAULT_MAX_STATES);
+
+	/// the initial state (always 0)
+	DfaState initial() const { return 0; }
+
+	/// the successor of @p state over @p byte
+	DfaState step(DfaState state, uint8_t byte)
+	{ // {{{
+		DfaState succ = this->table[state * 256 + byte];
+		return (UNKNOWN != succ)? succ : this->compute_succ(state, byte);
+	} // step }}}
+
+	/// is @p state accepting?
+	bool is_accepting(DfaState state) const
+	{ // {{{
+		return 0 != (this->flags[state] & FLAG_ACCEPTING);
+	} // }}}
+
+	/// is @p state the (non-accepting) sink, i.e., the empty macrostate?
+	bool is_sink(DfaState state) const
+	{ // {{{
+		return 0 != (this->flags[state] & FLAG_SINK);
+	} // }}}
+
+	/// the macrostate of @p state
+	const StateSet& get_macrostate(DfaState state) const
+	{ // {{{
+		return *this->macrostates[state];
+	} // }}}
+
+	/// checks whether the string @p data of length @p len is in the language
+	bool is_in_lang(const uint8_t* data, size_t len);
+
+	/// checks whether a prefix of the string @p data of length @p len is in
+	/// the language
+	bool is_prfx_in_lang(const uint8_t* data, size_t len);
+
+	/// number of states built so far (since the last flush)
+	size_t num_states() const { return this->macrostates.size(); }
+	/// number of flushes of the table
+	size_t num_flushes() const { return this->flushes; }
+}; // LazyDfaMatcher }}}
+
+
+/**
+ * Compares the verdicts of two NFAs on byte strings in a single scan.  The
+ * synchronous product of (determinized) automata is built eagerly in the
+ * constructor; every product state is tagged with whether it accepts in the
+ * first and in the second automaton, and marked as settled if all states
+ * reachable from it carry the same tag, i.e., if the verdict cannot change by
+ * reading more bytes.  Matching stops when a settled state is reached (this
+ * includes the state where both automata have no run any more).
+ *
+ * With prefix acceptance, a string is accepted by an automaton if any of its
+ * prefixes is; accepting states of the components are then absorbing.
+ *
+ * Matching does not modify the matcher, so a single matcher can be shared by
+ * several threads.
+ */
+class DiffMatcher
+{ // {{{
+public:
+
+	/// a state of the product
+	using DfaState = uint32_t;
+
+	/// verdicts of the pair of automata (bit 0: first, bit 1: second)
+	enum Verdict : uint8_t
+	{
+		IN_NONE = 0,
+		IN_FIRST_ONLY = 1,
+		IN_SECOND_ONLY = 2,
+		IN_BOTH = 3
+	};
+
+	/// default bound on the number of states of the product (the table of
+	/// successors takes 1 KiB per state, i.e., up to 64 MiB)
+	static const size_t DEFAULT_MAX_STATES = 1 << 16;
+
+private:
+
+	enum : uint8_t { FLAG_SETTLED = 4 };
+
+	/// successors; the successor of state s over byte b is at s * 256 + b
+	std::vector<DfaState> table;
+	/// verdicts of states and FLAG_SETTLED
+	std::vector<uint8_t> flags;
+
+public:
+
+	/**
+	 * Builds the product of @p aut1 and @p aut2; throws std::runtime_error if
+	 * it has more than @p max_states states
+	 */
+	DiffMatcher(
+		const Nfa&  aut1,
+		const Nfa&  aut2,
+		bool        prefix_acceptance = false,
+		size_t      max_states = DEFAULT_MAX_STATES);
+
+	/// the initial state (always 0)
+	DfaState initial() const { return 0; }
+
+	/// the successor of @p state over @p byte
+	DfaState step(DfaState state, uint8_t byte) const
+	{ // {{{
+		return this->table[state * 256 + byte];
+	} // }}}
+
+	/// the verdict if the input ended in @p state
+	Verdict get_verdict(DfaState state) const
+	{ // {{{
+		return static_cast<Verdict>(this->flags[state] & IN_BOTH);
+	} // }}}
+
+	/// can the verdict of @p state not change by reading more bytes?
+	bool is_settled(DfaState state) const
+	{ // {{{
+		return 0 != (this->flags[state] & FLAG_SETTLED);
+	} // }}}
+
+	/// the verdicts of both automata on the string @p data of length @p len
+	Verdict match(const uint8_t* data, size_t len) const;
+
+	/// number of states of the product
+	size_t num_states() const { return this->flags.size(); }
+}; // DiffMatcher }}}
+
+
+/**
+ * Profiles how byte strings traverse a deterministic automaton.  The automaton
+ * is compiled into a dense table with one row of 256 entries per reachable
+ * state, each entry holding the ID of the transition taken (transitions are
+ * numbered consecutively).  Profiling a string increments the counter of every
+ * transition taken and the counter of the state where the string ended.
+ *
+ * Counters are kept outside of the matcher, so several threads can profile
+ * using one matcher, each with its own Counters, which are merged at the end.
+ */
+class ProfilingMatcher
+{ // {{{
+public:
+
+	/// a state of the compiled automaton (the initial state is 0)
+	using DfaState = uint32_t;
+	/// an ID of a transition
+	using TransId = uint32_t;
+
+	/// a missing transition
+	static const TransId NO_TRANS = std::numeric_limits<TransId>::max();
+
+	/// hit counters of a single thread
+	struct Counters
+	{ // {{{
+		/// numbers of times transitions were taken (indexed by TransId)
+		std::vector<uint64_t> trans_hits = {};
+		/// numbers of strings ending in states (indexed by DfaState)
+		std::vector<uint64_t> end_hits = {};
+		/// number of strings whose run was blocked by a missing transition (the
+		/// transitions taken before are counted)
+		uint64_t blocked = 0;
+
+		/// adds counters of @p rhs to the counters
+		void merge(const Counters& rhs);
+	}; // Counters }}}
+
+private:
+
+	/// original states of states of the compiled automaton
+	std::vector<State> states;
+	/// transitions taken; the one from state s over byte b is at s * 256 + b
+	std::vector<TransId> table;
+	/// sources, symbols, and targets of transitions
+	std::vector<DfaState> trans_src;
+	std::vector<uint8_t> trans_symb;
+	std::vector<DfaState> trans_tgt;
+
+public:
+
+	/**
+	 * Compiles @p aut; throws std::runtime_error if it is not deterministic or
+	 * a reachable transition is over a symbol that is not a byte
+	 */
+	explicit ProfilingMatcher(const Nfa& aut);
+
+	/// creates zeroed counters for the matcher
+	Counters new_counters() const;
+
+	/// profiles the string @p data of length @p len into @p counters
+	void profile(const uint8_t* data, size_t len, Counters* counters) const;
+
+	/**
+	 * Exports the automaton with counters turned into probabilities as a @DPA
+	 * section.  The probability of a transition from a state (written as
+	 * "symbol:probability") and of ending in the state (the %Final attribute)
+	 * are its hits divided by the number of all visits of the state.  Only
+	 * items with a non-zero probability are exported.
+	 */
+	Vata2::Parser::ParsedSection serialize_prob(const Counters& counters) const;
+
+	/// number of (reachable) states
+	size_t num_states() const { return this->states.size(); }
+	/// number of (reachable) transitions
+	size_t num_trans() const { return this->trans_tgt.size(); }
+}; // ProfilingMatcher }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Nfa */
+} /* Vata2 */
+
+#endif /* _VATA2_NFA_MATCHER_HH_ */
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -28,6 +29,7 @@
 
 // VATA2 headers
 #include <vata2/parser.hh>
+#include <vata2/string-pool.hh>
 #include <vata2/util.hh>
 
 namespace Vata2
@@ -97,6 +99,27 @@ public:
 		throw std::runtime_error("Unimplemented");
 	} // }}}
 
+	/**
+	 * The number of symbols of a dense alphabet, i.e., an alphabet with symbols
+	 * 0, ..., n - 1, and 0 for other alphabets.  Symbols of dense alphabets can
+	 * be enumerated by a loop and sets of them can be represented by bitsets.
+	 */
+	virtual size_t get_dense_size() const { return 0; }
+
+	/// calls @p func on every symbol of the alphabet (with no list allocated
+	/// for dense alphabets)
+	void for_each_symbol(const std::function<void(Symbol)>& func) const
+	{ // {{{
+		const size_t dense_size = this->get_dense_size();
+		if (0 != dense_size)
+		{
+			for (Symbol symb = 0; symb < dense_size; ++symb) { func(symb); }
+			return;
+		}
+
+		for (Symbol symb : this->get_symbols()) { func(symb); }
+	} // }}}
+
 	virtual ~Alphabet() { }
 };
 
@@ -124,6 +147,50 @@ public:
 		const std::set<Symbol>& syms) const override;
 };
 
+/**
+ * An alphabet whose symbols are IDs of their names in a string pool, which may
+ * be shared by several alphabets (e.g., of all automata in a program), so that
+ * equal names are equal symbols in all of them.  The symbols of the alphabet
+ * are only those it has translated (not all names in the pool, which may come
+ * from unrelated automata).
+ */
+class PooledAlphabet : public Alphabet
+{
+private:
+	std::shared_ptr<Vata2::util::StringPool> pool;
+	/// the symbols translated by this alphabet
+	std::set<Symbol> symbols;
+
+public:
+
+	explicit PooledAlphabet(std::shared_ptr<Vata2::util::StringPool> pool =
+		std::make_shared<Vata2::util::StringPool>()) :
+		pool(pool),
+		symbols()
+	{
+		assert(nullptr != this->pool);
+	}
+
+	virtual Symbol translate_symb(const std::string& str) override
+	{
+		Symbol symb = this->pool->intern(str);
+		this->symbols.insert(symb);
+		return symb;
+	}
+
+	/// the name of @p symb
+	std::string get_symb_name(Symbol symb) const { return this->pool->get(symb); }
+
+	const std::shared_ptr<Vata2::util::StringPool>& get_pool() const
+	{
+		return this->pool;
+	}
+
+	virtual std::list<Symbol> get_symbols() const override;
+	virtual std::list<Symbol> get_complement(
+		const std::set<Symbol>& syms) const override;
+};
+
 class DirectAlphabet : public Alphabet
 {
 	virtual Symbol translate_symb(const std::string& str) override
@@ -155,6 +222,7 @@ public:
 		return symb;
 	}
 
+	virtual size_t get_dense_size() const override { return 256; }
 	virtual std::list<Symbol> get_symbols() const override;
 	virtual std::list<Symbol> get_complement(
 		const std::set<Symbol>& syms) const override;
@@ -203,6 +271,8 @@ public:
 		return it->second;
 	}
 
+	/// symbols are numbered in the order of their names given to the constructor
+	virtual size_t get_dense_size() const override { return this->symbol_map.size(); }
 	virtual std::list<Symbol> get_symbols() const override;
 	virtual std::list<Symbol> get_complement(
 		const std::set<Symbol>& syms) const override;
@@ -218,6 +288,19 @@ Vata2::Parser::ParsedSection serialize(
 	const SymbolToStringMap*  symbol_map = nullptr,
 	const StateToStringMap*   state_map = nullptr);
 
+/**
+ * Writes @p aut to @p os in the .vtf format; the text is the same as the one
+ * of the result of serialize() but it is formatted directly into large
+ * buffers, without intermediate strings.  With @p threads > 1, blocks of
+ * states are formatted in parallel.
+ */
+void write_vtf(
+	std::ostream&             os,
+	const Nfa&                aut,
+	const SymbolToStringMap*  symbol_map = nullptr,
+	const StateToStringMap*   state_map = nullptr,
+	size_t                    threads = 1);
+
 
 ///  An NFA
 struct Nfa
@@ -229,6 +312,10 @@ private:
 	// states with outgoing edges in the NFA
 	StateToPostMap transitions = {};
 
+	// order-independent hash of transitions (XOR of hashes of all transitions),
+	// maintained by add_trans() and remove_trans()
+	size_t trans_hash = 0;
+
 public:
 
 	std::set<State> initialstates = {};
@@ -259,6 +346,12 @@ public:
 		this->add_trans({src, symb, tgt});
 	} // }}}
 
+	void remove_trans(const Trans& trans);
+	void remove_trans(State src, Symbol symb, State tgt)
+	{ // {{{
+		this->remove_trans({src, symb, tgt});
+	} // }}}
+
 	bool has_trans(const Trans& trans) const;
 	bool has_trans(State src, Symbol symb, State tgt) const
 	{ // {{{
@@ -266,6 +359,10 @@ public:
 	} // }}}
 
 	bool trans_empty() const { return this->transitions.empty();};// no transitions
+
+	/// structural hash of the automaton (initial states, final states, and
+	/// transitions); the part for transitions is kept up-to-date incrementally
+	size_t hash() const;
 	size_t trans_size() const;/// number of transitions; has linear time complexity
 
 	struct const_iterator
@@ -339,26 +436,50 @@ public:
 	// }
 }; // Nfa }}}
 
+/// structural equality of automata (no renaming of states is considered)
+bool operator==(const Nfa& lhs, const Nfa& rhs);
+inline bool operator!=(const Nfa& lhs, const Nfa& rhs) { return !(lhs == rhs); }
+
 
 /// a wrapper encapsulating @p Nfa for higher-level use
 struct NfaWrapper
 { // {{{
 	/// the NFA
-	Nfa nfa;
+	Nfa nfa = {};
 
 	/// the alphabet
-	Alphabet* alphabet;
+	std::unique_ptr<Alphabet> alphabet = nullptr;
 
-	/// mapping of state names (as strings) to their numerical values
-	StringToStateMap state_dict;
+	/// names of states (the value of a state is the ID of its name)
+	std::shared_ptr<Vata2::util::StringPool> state_dict =
+		std::make_shared<Vata2::util::StringPool>();
 }; // NfaWrapper }}}
 
 
 /// Do the automata have disjoint sets of states?
 bool are_state_disjoint(const Nfa& lhs, const Nfa& rhs);
-/// Is the language of the automaton empty?
-bool is_lang_empty(const Nfa& aut, Path* cex = nullptr);
-bool is_lang_empty_cex(const Nfa& aut, Word* cex);
+/**
+ * @brief  Is the language of the automaton empty?
+ *
+ * If the language is not empty and @p cex is not @p nullptr, a shortest path
+ * from an initial to a final state is stored into @p cex.  The search is
+ * chosen by the "algo" key of @p params: "bfs" (breadth-first search from
+ * initial states) or "bidirectional" (breadth-first search from initial and
+ * final states at the same time).
+ */
+bool is_lang_empty(
+	const Nfa&         aut,
+	Path*              cex = nullptr,
+	const StringDict&  params = {{"algo", "bfs"}});
+
+/// Is the language of the automaton empty?  Gives a shortest word as @p cex
+bool is_lang_empty_cex(
+	const Nfa&         aut,
+	Word*              cex,
+	const StringDict&  params = {{"algo", "bfs"}});
+
+/// Gets (at most) @p k shortest words of the language in the shortlex order
+std::vector<Word> get_shortest_words(const Nfa& aut, size_t k);
 
 /// Retrieves the states reachable from initial states
 std::unordered_set<State> get_fwd_reach_states(const Nfa& aut);
@@ -398,6 +519,39 @@ inline bool is_incl(
 	return is_incl(smaller, bigger, alphabet, nullptr, params);
 } // }}}
 
+/**
+ * Checks inclusion of the language of @p smaller in the languages of many
+ * automata at once.  With the "antichains" algorithm, the exploration of
+ * @p smaller is shared by all queries and every bigger automaton is dropped
+ * as soon as a counterexample for it is found.
+ *
+ * @param[in]   smaller  The automaton whose language is checked
+ * @param[in]   biggers  The automata whose languages should include it
+ * @param[in]   alphabet The alphabet
+ * @param[out]  results  @p results[i] is the result of the check for @p biggers[i]
+ * @param[out]  cexes    If not @p nullptr, @p cexes[i] is a counterexample to
+ *                       the inclusion in @p biggers[i] (if there is one)
+ * @param[in]   params   "algo" is either "antichains" or "naive"
+ */
+void is_incl_many(
+	const Nfa&                      smaller,
+	const std::vector<const Nfa*>&  biggers,
+	const Alphabet&                 alphabet,
+	std::vector<bool>*              results,
+	std::vector<Word>*              cexes = nullptr,
+	const StringDict&               params = {{"algo", "antichains"}});
+
+inline std::vector<bool> is_incl_many(
+	const Nfa&                      smaller,
+	const std::vector<const Nfa*>&  biggers,
+	const Alphabet&                 alphabet,
+	const StringDict&               params = {{"algo", "antichains"}})
+{ // {{{
+	std::vector<bool> results;
+	is_incl_many(smaller, biggers, alphabet, &results, nullptr, params);
+	return results;
+} // }}}
+
 /// Compute union of a pair of automata
 /// Assumes that sets of states of lhs, rhs, and result are disjoint
 void union_norename(
@@ -455,6 +609,63 @@ inline Nfa determinize(
 	return result;
 } // determinize }}}
 
+/// Determinization result kept for later incremental updates
+struct DetResult
+{ // {{{
+	/// the deterministic automaton
+	Nfa result = {};
+	/// mapping of macrostates of the input automaton to states of @p result
+	SubsetMap subset_map = {};
+	/// the highest number of a state used in @p result
+	State last_state_num = 0;
+}; // DetResult }}}
+
+/// Changes to a deterministic automaton made by an incremental update
+struct DetDelta
+{ // {{{
+	std::vector<Trans> added_trans = {};
+	std::vector<Trans> removed_trans = {};
+	/// newly created states (their finality is in @p added_final)
+	StateSet added_states = {};
+	StateSet added_final = {};
+	/// states that became unreachable and were removed with their transitions
+	StateSet removed_states = {};
+
+	bool empty() const
+	{ // {{{
+		return added_trans.empty() && removed_trans.empty() &&
+			added_states.empty() && removed_states.empty();
+	} // }}}
+}; // DetDelta }}}
+
+/// Determinizes @p aut and keeps what is needed for @p determinize_incr
+void determinize_incr_init(DetResult* det, const Nfa& aut);
+
+/**
+ * @brief  Updates a determinization after a change of transitions
+ *
+ * @p aut is the input automaton with transitions @p added already added and
+ * @p removed already removed.  Only macrostates containing a source state of
+ * a changed transition are re-explored; new states are numbered after @p
+ * det->last_state_num.  Initial and final states of @p aut are expected to
+ * be the same as in the previous call.
+ *
+ * @param[in,out]  det      Previous result (updated in place)
+ * @param[in]      aut      The updated input automaton
+ * @param[in]      added    Transitions added to @p aut since the last call
+ * @param[in]      removed  Transitions removed from @p aut since the last call
+ * @param[out]     delta    If not @p nullptr, the changes done to @p det->result
+ */
+void determinize_incr(
+	DetResult*                det,
+	const Nfa&                aut,
+	const std::vector<Trans>& added,
+	const std::vector<Trans>& removed,
+	DetDelta*                 delta = nullptr);
+
+/// Applies changes obtained from @p determinize_incr to a copy of the result
+void apply_delta(Nfa* dfa, const DetDelta& delta);
+
 /// makes the transition relation complete
 void make_complete(
 	Nfa*             aut,
@@ -564,6 +775,53 @@ inline Nfa construct(
 	return result;
 } // construct(Alphabet) }}}
 
+/**
+ * Loads an automaton from the next section of @p scanner.  Lines of the body
+ * are consumed one by one, so no ParsedSection is materialized.
+ */
+void construct(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	StringToStateMap*           state_map = nullptr);
+
+/**
+ * Loads an automaton from Parsed object, with states being IDs of their names
+ * interned in @p state_pool
+ */
+void construct(
+	Nfa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	Vata2::util::StringPool*             state_pool);
+
+/**
+ * Loads an automaton from the next section of @p scanner, with states being
+ * IDs of their names interned in @p state_pool
+ */
+void construct(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	Vata2::util::StringPool*    state_pool);
+
+/**
+ * Loads an automaton from the next section of @p scanner (over a buffer) using
+ * @p threads threads (0 means the number of hardware threads).  The body is
+ * split into chunks of lines, which are tokenized in parallel with names of
+ * states and symbols interned into per-chunk dictionaries.  The dictionaries
+ * are then merged in parallel, with names of states sharded among threads by
+ * their hashes.  States and symbols are numbered in the order of their first
+ * occurrence, so the result is the same as of construct() (@p state_map is
+ * expected to be empty).
+ */
+void construct_parallel(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	StringToStateMap*           state_map = nullptr,
+	size_t                      threads = 0);
+
 /**
  * @brief  Obtains a word corresponding to a path in an automaton (or sets a flag)
  *
@@ -585,6 +843,23 @@ std::pair<Word, bool> get_word_for_path(const Nfa& aut, const Path& path);
 /// Checks whether a string is in the language of an automaton
 bool is_in_lang(const Nfa& aut, const Word& word);
 
+/**
+ * Checks whether strings are in the language of an automaton.  Words are
+ * processed in lexicographic order so that macrostates reached by a common
+ * prefix of consecutive words are computed only once.
+ *
+ * @param[in]  aut     The automaton
+ * @param[in]  words   The words to check
+ * @param[in]  params  "threads" is the number of threads to use (default 1)
+ *
+ * @returns  A vector whose i-th element is @p true iff @p words[i] is in the
+ *           language of @p aut
+ */
+std::vector<bool> is_in_lang_many(
+	const Nfa&                aut,
+	const std::vector<Word>&  words,
+	const StringDict&         params = {{"threads", "1"}});
+
 /// Checks whether the prefix of a string is in the language of an automaton
 bool is_prfx_in_lang(const Nfa& aut, const Word& word);
 
@@ -624,6 +899,15 @@ struct hash<Vata2::Nfa::Trans>
 	}
 };
 
+template <>
+struct hash<Vata2::Nfa::Nfa>
+{
+	inline size_t operator()(const Vata2::Nfa::Nfa& aut) const
+	{
+		return aut.hash();
+	}
+};
+
 std::ostream& operator<<(std::ostream& os, const Vata2::Nfa::Trans& trans);
 std::ostream& operator<<(std::ostream& os, const Vata2::Nfa::NfaWrapper& nfa_wrap);
 } // std }}}
@@ -22,6 +22,7 @@
 #include <cassert>
 #include <list>
 #include <map>
+#include <istream>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -139,6 +140,141 @@ ParsedSection parse_vtf_section(
 	const std::string&  input,
 	bool                keepQuotes = false);
 
+
+
+/**
+ * A read-only memory mapping of a whole file.  The mapping is released when the
+ * object is destroyed.
+ */
+class MappedFile
+{ // {{{
+private:
+
+	const char* addr;
+	size_t length;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+
+	/// maps @p filename; throws std::runtime_error on failure
+	explicit MappedFile(const std::string& filename);
+	~MappedFile();
+
+	const char* data() const { return this->addr; }
+	size_t size() const { return this->length; }
+}; // MappedFile }}}
+
+
+/// A token pointing into a buffer scanned by VtfScanner
+struct TokenView
+{ // {{{
+	const char* data;
+	size_t len;
+	/// was the token enclosed in quotes?
+	bool quoted;
+	/// does the token contain escaped quotes (which need to be unescaped)?
+	bool escaped;
+
+	/// assigns the (unescaped) token into @p str (reusing its storage)
+	void assign_to(std::string* str) const;
+
+	std::string to_string() const
+	{ // {{{
+		std::string result;
+		this->assign_to(&result);
+		return result;
+	} // to_string }}}
+}; // TokenView }}}
+
+using TokenLine = std::vector<TokenView>;
+
+
+/**
+ * A scanner of .vtf sections accepting the same language as
+ * parse_vtf_section().  Sections are read one line at a time, so large
+ * automata can be constructed without materializing ParsedSection.
+ *
+ * The input is either a memory buffer (typically a MappedFile), in which case
+ * tokens point into the buffer, or a stream, in which case tokens point into an
+ * internal line buffer and are valid only until the next call of the scanner.
+ */
+class VtfScanner
+{ // {{{
+private:
+
+	/// the current position in the buffer (unused for streams)
+	const char* pos;
+	const char* end;
+	/// the input stream (or @p nullptr for buffers)
+	std::istream* input;
+	/// the buffer for the current line of a stream
+	std::string line_buf;
+	/// the current line (without leading whitespaces)
+	const char* line_begin;
+	const char* line_end;
+	/// has the current line not been processed yet?
+	bool has_line;
+	bool in_section;
+
+	// the current line points into the line buffer and the position into the
+	// buffer, so the scanner cannot be copied
+	VtfScanner(const VtfScanner&) = delete;
+	VtfScanner& operator=(const VtfScanner&) = delete;
+
+	/// reads the next non-blank line into the current line
+	bool fetch_line();
+
+public:
+
+	VtfScanner(const char* data, size_t size) :
+		pos(data), end(data + size), input(nullptr), line_buf(),
+		line_begin(nullptr), line_end(nullptr), has_line(false), in_section(false)
+	{ }
+
+	explicit VtfScanner(std::istream& input) :
+		pos(nullptr), end(nullptr), input(&input), line_buf(),
+		line_begin(nullptr), line_end(nullptr), has_line(false), in_section(false)
+	{ }
+
+	/**
+	 * Moves to the next section (skipping the rest of the current one) and reads
+	 * its type into @p type
+	 *
+	 * @returns  @p false if there are no more sections
+	 */
+	bool next_section(std::string* type);
+
+	/**
+	 * Reads the next non-empty line of the current section into @p line.  For
+	 * %KEY lines, @p is_key is set and the first token is the key without '%'.
+	 *
+	 * @returns  @p false at the end of the section
+	 */
+	bool next_line(TokenLine* line, bool* is_key);
+
+	/**
+	 * Reads the next section into @p parsec (the same as parse_vtf_section())
+	 *
+	 * @returns  @p false if there are no more sections
+	 */
+	bool read_section(ParsedSection* parsec, bool keepQuotes = false);
+
+	/**
+	 * Splits the rest of the current section into at most @p num_chunks chunks
+	 * of whole lines of roughly the same size and moves past the section.  The
+	 * chunks can be scanned independently (e.g., on several threads) by
+	 * scanners set up using start_body().  Only available for buffers.
+	 */
+	std::vector<std::pair<const char*, size_t>> split_section(size_t num_chunks);
+
+	/// scans the input as (a part of) the body of a section, i.e., without a
+	/// line with @TYPE
+	void start_body() { this->in_section = true; }
+}; // VtfScanner }}}
+
+
 /// registers dispatcher
 void init();
 
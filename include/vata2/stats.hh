@@ -0,0 +1,222 @@
+/* stats.hh -- statistics of operations
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_STATS_HH_
+#define _VATA2_STATS_HH_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Statistics are collected only if the library is compiled with VATA_STATS
+ * defined (the CMake option VATA_STATS); otherwise, the macros below expand to
+ * nothing and all statistics stay zero.
+ */
+#ifdef VATA_STATS
+	#define VATA_STATS_ADD(counter, num) \
+		Vata2::Stats::add(Vata2::Stats::Counter::counter, num)
+	#define VATA_STATS_MAX(counter, value) \
+		Vata2::Stats::update_max(Vata2::Stats::Counter::counter, value)
+	#define VATA_STATS_TIMER(phase) \
+		Vata2::Stats::Timer vata_stats_timer_(Vata2::Stats::Phase::phase)
+#else
+	#define VATA_STATS_ADD(counter, num) ((void)0)
+	#define VATA_STATS_MAX(counter, value) ((void)0)
+	#define VATA_STATS_TIMER(phase) ((void)0)
+#endif
+
+#define VATA_STATS_INC(counter) VATA_STATS_ADD(counter, 1)
+
+namespace Vata2
+{
+namespace Stats
+{
+
+/// counters of work done by operations
+enum class Counter : unsigned
+{
+	MACROSTATES,         ///< macrostates (or product states) created
+	SUBSUMPTION_CHECKS,  ///< checks of subsumption of elements of antichains
+	PRUNED,              ///< subsumed elements (pruned or not inserted)
+	POST_CALLS,          ///< calls of Nfa::post() on macrostates
+	PEAK_WORKLIST,       ///< the maximum size of a worklist
+	PEAK_MAP_SIZE,       ///< the maximum number of items of a hash map of macrostates
+	PEAK_MAP_LOAD,       ///< the maximum load factor of such a map (in thousandths)
+	NUM_COUNTERS
+};
+
+/// phases of operations whose time is measured (including nested phases)
+enum class Phase : unsigned
+{
+	DETERMINIZE,
+	COMPLEMENT,
+	MINIMIZE,
+	INTERSECTION,
+	INCLUSION,
+	UNIVERSALITY,
+	NUM_PHASES
+};
+
+const size_t NUM_COUNTERS = static_cast<size_t>(Counter::NUM_COUNTERS);
+const size_t NUM_PHASES = static_cast<size_t>(Phase::NUM_PHASES);
+
+/// whether the library collects statistics (was compiled with VATA_STATS)
+bool enabled();
+
+/// is @p counter a maximum (rather than a sum)?
+inline bool is_peak(Counter counter) { return counter >= Counter::PEAK_WORKLIST; }
+
+const char* to_string(Counter counter);
+const char* to_string(Phase phase);
+
+/// a snapshot of statistics
+struct Stats
+{ // {{{
+	std::array<uint64_t, NUM_COUNTERS> counters = {};
+	/// the numbers of runs of phases
+	std::array<uint64_t, NUM_PHASES> runs = {};
+	/// the total times of phases (in seconds)
+	std::array<double, NUM_PHASES> times = {};
+
+	uint64_t operator[](Counter counter) const
+	{ // {{{
+		return this->counters[static_cast<size_t>(counter)];
+	} // operator[] }}}
+
+	double get_time(Phase phase) const { return this->times[static_cast<size_t>(phase)]; }
+	uint64_t get_runs(Phase phase) const { return this->runs[static_cast<size_t>(phase)]; }
+
+	/// adds @p rhs (sums counters and times, takes maxima of peaks)
+	void merge(const Stats& rhs);
+}; // Stats }}}
+
+/// prints the nonzero statistics in @p stats, one per line
+std::ostream& operator<<(std::ostream& os, const Stats& stats);
+
+/// statistics of the calling thread
+Stats get_thread();
+
+/// statistics aggregated over all threads (including finished ones)
+Stats get_total();
+
+/// resets statistics of all threads (which should not run operations meanwhile)
+void reset();
+
+/**
+ * Collects statistics of operations run by the calling thread during the
+ * lifetime of the object into @p result (merged with its content).  Peaks are
+ * those reached within the lifetime.
+ */
+class Collector
+{ // {{{
+private:
+
+	Stats* result;
+	/// statistics of the thread when the collector was created
+	Stats start;
+
+	Collector(const Collector&) = delete;
+	Collector& operator=(const Collector&) = delete;
+
+public:
+
+	explicit Collector(Stats* result);
+	~Collector();
+}; // Collector }}}
+
+
+// THE HOT PATH (used via the macros above)
+
+/// statistics of a thread, written only by the thread itself
+struct ThreadStats
+{ // {{{
+	std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters;
+	std::array<std::atomic<uint64_t>, NUM_PHASES> runs;
+	/// the times in nanoseconds
+	std::array<std::atomic<uint64_t>, NUM_PHASES> nanos;
+
+	ThreadStats();
+	~ThreadStats();
+
+	ThreadStats(const ThreadStats&) = delete;
+	ThreadStats& operator=(const ThreadStats&) = delete;
+
+	Stats snapshot() const;
+	void clear();
+}; // ThreadStats }}}
+
+/// statistics of the calling thread
+ThreadStats& get_local();
+
+/**
+ * Increments @p cnt.  The counter has a single writer, so a relaxed load and
+ * store suffice (without the cost of an atomic read-modify-write); atomics make
+ * only reads by other threads safe.
+ */
+inline void add_relaxed(std::atomic<uint64_t>& cnt, uint64_t num)
+{ // {{{
+	cnt.store(cnt.load(std::memory_order_relaxed) + num, std::memory_order_relaxed);
+} // add_relaxed }}}
+
+inline void add(Counter counter, uint64_t num)
+{ // {{{
+	add_relaxed(get_local().counters[static_cast<size_t>(counter)], num);
+} // add }}}
+
+inline void update_max(Counter counter, uint64_t value)
+{ // {{{
+	std::atomic<uint64_t>& cnt = get_local().counters[static_cast<size_t>(counter)];
+	if (cnt.load(std::memory_order_relaxed) < value)
+	{
+		cnt.store(value, std::memory_order_relaxed);
+	}
+} // update_max }}}
+
+/// measures the time of a phase while it exists
+class Timer
+{ // {{{
+private:
+
+	Phase phase;
+	std::chrono::steady_clock::time_point start;
+
+	Timer(const Timer&) = delete;
+	Timer& operator=(const Timer&) = delete;
+
+public:
+
+	explicit Timer(Phase phase) : phase(phase), start(std::chrono::steady_clock::now()) { }
+
+	~Timer()
+	{ // {{{
+		auto elapsed = std::chrono::steady_clock::now() - this->start;
+		ThreadStats& local = get_local();
+		size_t idx = static_cast<size_t>(this->phase);
+		add_relaxed(local.runs[idx], 1);
+		add_relaxed(local.nanos[idx],
+			std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	} // ~Timer }}}
+}; // Timer }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Stats */
+} /* Vata2 */
+
+#endif /* _VATA2_STATS_HH_ */
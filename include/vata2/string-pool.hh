@@ -0,0 +1,105 @@
+/* string-pool.hh -- interning of names of states and symbols
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_STRING_POOL_HH_
+#define _VATA2_STRING_POOL_HH_
+
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Vata2
+{
+namespace util
+{
+
+/**
+ * @brief  A pool of interned strings
+ *
+ * Every distinct string gets an ID, starting from 0 in the order of interning.
+ * The strings are stored one after another in a single array of characters,
+ * and IDs are found by an open-addressing hash table (with linear probing)
+ * holding only 32-bit IDs, so a name costs its characters and about 20 bytes
+ * of overhead (compared to a node of a std::unordered_map with a
+ * std::string).  All operations are guarded by a mutex, so a pool can be
+ * shared by several automata (and threads).
+ */
+class StringPool
+{ // {{{
+public:
+
+	using Id = uint32_t;
+
+	/// the ID returned by find() for strings not in the pool
+	static const Id NOT_FOUND = std::numeric_limits<Id>::max();
+
+private:
+
+	mutable std::mutex mutex;
+
+	/// characters of all strings
+	std::vector<char> chars;
+	/// the string with the ID i is chars[offsets[i], offsets[i + 1])
+	std::vector<size_t> offsets;
+	/// hashes of strings (to avoid comparing strings and rehashing)
+	std::vector<uint32_t> hashes;
+	/// the hash table with IDs (NOT_FOUND in empty slots), its size is a power of 2
+	std::vector<Id> slots;
+
+	StringPool(const StringPool& rhs);
+	StringPool& operator=(const StringPool& rhs);
+
+	/// the slot with @p str or the empty slot where it should be inserted
+	size_t find_slot(const char* str, size_t len, uint32_t hash) const;
+	/// doubles the size of the hash table
+	void grow();
+
+public:
+
+	StringPool();
+
+	/// returns the ID of the string, inserting it if it is not in the pool
+	Id intern(const char* str, size_t len);
+	Id intern(const std::string& str) { return this->intern(str.data(), str.size()); }
+
+	/// returns the ID of the string, or NOT_FOUND if it is not in the pool
+	Id find(const char* str, size_t len) const;
+	Id find(const std::string& str) const { return this->find(str.data(), str.size()); }
+
+	/// returns the string with the ID @p id
+	std::string get(Id id) const;
+
+	/// the number of strings in the pool
+	size_t size() const;
+
+	/// the number of bytes allocated by the pool
+	size_t memory_usage() const;
+}; // StringPool }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* util */
+} /* Vata2 */
+
+namespace std
+{ // {{{
+/// prints the pool as a map from strings to their IDs
+std::string to_string(const Vata2::util::StringPool& pool);
+} // std }}}
+
+#endif /* _VATA2_STRING_POOL_HH_ */
@@ -0,0 +1,106 @@
+/* trace.hh -- traces of execution in the Chrome trace format
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_TRACE_HH_
+#define _VATA2_TRACE_HH_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * Traces the scope in which it is used as an event with the category
+ * @p category (a string literal) and the name @p name, which is evaluated only
+ * if tracing is on (e.g., VATA_TRACE_SCOPE("vm", "call " + func_name)).
+ */
+#define VATA_TRACE_SCOPE(category, name) \
+	Vata2::Trace::Scope vata_trace_scope_(category, [&]() -> std::string { return name; })
+
+namespace Vata2
+{
+namespace Trace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// is tracing on?  (not to be used directly, see enabled())
+extern std::atomic<bool> ENABLED;
+
+inline bool enabled() { return ENABLED.load(std::memory_order_relaxed); }
+
+/**
+ * Starts writing events into @p filename in the JSON format of Chrome traces
+ * (which can be viewed, e.g., in chrome://tracing or by Perfetto); throws
+ * std::runtime_error if the file cannot be opened.  Events of forked processes
+ * are not written.
+ */
+void start(const std::string& filename);
+
+/// finishes the trace started by start() (and closes its file)
+void stop();
+
+/// writes an event of @p category and @p name that lasted from @p begin to @p end
+void record(
+	const char*          category,
+	const std::string&   name,
+	Clock::time_point    begin,
+	Clock::time_point    end);
+
+/// an event lasting while the object exists
+class Scope
+{ // {{{
+private:
+
+	bool active;
+	const char* category;
+	std::string name;
+	Clock::time_point begin;
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+
+public:
+
+	/// @p make_name is called (to get the name) only if tracing is on
+	template <class MakeName>
+	Scope(const char* category, MakeName make_name) :
+		active(enabled()),
+		category(category),
+		name(),
+		begin()
+	{ // {{{
+		if (this->active)
+		{
+			this->name = make_name();
+			this->begin = Clock::now();
+		}
+	} // Scope() }}}
+
+	~Scope()
+	{ // {{{
+		if (this->active)
+		{
+			record(this->category, this->name, this->begin, Clock::now());
+		}
+	} // ~Scope() }}}
+}; // Scope }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Trace */
+} /* Vata2 */
+
+#endif /* _VATA2_TRACE_HH_ */
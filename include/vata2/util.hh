@@ -30,9 +30,23 @@
 #include <unordered_map>
 #include <vector>
 
-/// macro for debug outputs
+/**
+ * The maximum level of debug outputs compiled in (0 disables all of them, 1
+ * keeps warnings, 2 debug outputs, and 3 and more outputs of the VM).  Outputs
+ * of higher levels are removed by the compiler entirely, together with the
+ * construction of their messages, regardless of Vata2::LOG_VERBOSITY.
+ */
+#ifndef VATA_MAX_LOG_LEVEL
+	#define VATA_MAX_LOG_LEVEL 5
+#endif
+
+/// is the output of level @p lvl enabled?
+#define VATA_LOG_ENABLED(lvl) \
+	((lvl) <= VATA_MAX_LOG_LEVEL && __builtin_expect(Vata2::LOG_VERBOSITY >= (lvl), 0))
+
+/// macro for debug outputs; the message @p x is constructed only if it is printed
 #define PRINT_VERBOSE_LVL(lvl, title, x) {\
-	if (Vata2::LOG_VERBOSITY >= lvl) {\
+	if (VATA_LOG_ENABLED(lvl)) {\
 		std::cerr << title << ": " << x << "\n";\
 	}\
 }
@@ -46,6 +46,17 @@ void reg_dispatcher(
 	const std::string&       info);
 
 
+/**
+ * registers @p func_name as a function with side effects (e.g., printing), so
+ * that the dataflow execution (see VirtualMachine::run_dataflow()) evaluates
+ * its calls even if their results are not used; "print", "print_stats", and
+ * "reset_stats" are registered at startup
+ */
+void reg_side_effect(const VMFuncName& func_name);
+
+/// does the function @p func_name have side effects?
+bool has_side_effect(const VMFuncName& func_name);
+
 /// finds the dispatcher function for a given type
 const VMDispatcherFunc& find_dispatcher(const std::string& type_name);
 
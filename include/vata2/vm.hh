@@ -18,9 +18,10 @@
 #ifndef _VATA2_VM_HH_
 #define _VATA2_VM_HH_
 
-#include <stack>
+#include <memory>
 
 // VATA headers
+#include <vata2/code.hh>
 #include <vata2/parser.hh>
 
 namespace Vata2
@@ -42,8 +43,13 @@ extern const std::string TYPE_PARSEC;
 namespace VM
 {
 
-/// Data type representing a pointer to a memory holding a value
-using VMPointer = const void*;
+/**
+ * Data type representing a pointer to a memory holding a value.  The memory is
+ * shared by all copies of the value and freed together with the last of them
+ * (with the destructor of the type the pointer was created with, e.g., by
+ * std::make_shared()).
+ */
+using VMPointer = std::shared_ptr<const void>;
 
 /**
  * Data type representing a value, which is composed of a type and a pointer to
@@ -72,23 +78,26 @@ public:
 	/// default constructor
 	VMValue() : type(), ptr() { }
 	/// standard constructor
-	VMValue(const std::string& type, VMPointer ptr) : type(type), ptr(ptr) { }
-	/// copy constructor
-	VMValue(const VMValue& rhs) : type(rhs.type), ptr(rhs.ptr) { }
-	/// assignment operator
-	VMValue& operator=(const VMValue& rhs)
-	{ // {{{
-		if (this != &rhs) {
-			this->type = rhs.type;
-			this->ptr = rhs.ptr;
-		}
+	VMValue(const std::string& type, VMPointer ptr) : type(type), ptr(std::move(ptr)) { }
+
+	// copies share the object (which is never copied), moves take it over
+	VMValue(const VMValue& rhs) = default;
+	VMValue(VMValue&& rhs) = default;
+	VMValue& operator=(const VMValue& rhs) = default;
+	VMValue& operator=(VMValue&& rhs) = default;
 
-		// FIXME: expecting memory issues here
-		return *this;
-	} // operator=() }}}
+	/**
+	 * A value referring to the object at @p ptr without owning it; the object
+	 * needs to outlive all copies of the value
+	 */
+	static VMValue borrow(const std::string& type, const void* ptr)
+	{ // {{{
+		// the aliasing constructor, which shares no ownership
+		return VMValue(type, VMPointer(VMPointer(), ptr));
+	} // borrow() }}}
 
 	/// returns the included pointer
-	VMPointer get_ptr() const { return this->ptr; }
+	const void* get_ptr() const { return this->ptr.get(); }
 
 	/// conversion to string
 	friend std::ostream& operator<<(std::ostream& os, const VMValue& val)
@@ -165,6 +174,19 @@ public:
  * define its own function handlers.  The resolution of a function to call is
  * based on the type of the first argument of the function --- the function call
  * will be passed to its dispatcher function.
+ *
+ * ## Dataflow execution
+ * With set_dataflow(), CODE sections are executed as dataflow graphs of their
+ * calls (see run_dataflow()).  Only the calls needed by calls with side effects
+ * (such as `print`, see reg_side_effect()) or by the last values of variables
+ * are evaluated, and independent calls are evaluated in parallel, e.g., the two
+ * determinizations in
+ *
+ * @code{.vata}
+ *   d1 = (determinize aut1)
+ *   d2 = (determinize aut2)
+ *   (print (is_incl d1 d2))
+ * @endcode
  */
 class VirtualMachine
 {
@@ -172,29 +194,52 @@ private:
 
 	/// A dictionary mapping names to values
 	using VMStorage = std::unordered_map<std::string, VMValue>;
-	/// A stack for VMValues
-	using VMStack = std::stack<VMValue>;
 
 	/// The memory assigning values to names
 	VMStorage mem;
-	VMStack exec_stack;
 
-	/// Pushes a new value on top of the execution stack
-	void push_to_stack(VMValue val);
+	/// the number of threads of the dataflow execution (0 for the serial one)
+	size_t dataflow_threads;
+
+	/// The object stored at position @p name (objects are never removed from
+	/// the storage, so the reference stays valid)
+	const VMValue& get_stored(const std::string& name) const;
 
 public:
 
 	/// default constructor
-	VirtualMachine() : mem(), exec_stack() { }
+	VirtualMachine() : mem(), dataflow_threads(0) { }
 
 	void run(const Vata2::Parser::Parsed& parsed);
 	void run(const Vata2::Parser::ParsedSection& parsec);
+	/// Compiles a CODE section (see Code::compile()) and executes it
 	void run_code(const Vata2::Parser::ParsedSection& parsec);
+	/// Executes a compiled CODE section
+	void run_program(const Vata2::Code::Program& prog);
 
-	/// Executes one line of code
-	void execute_line(const Parser::BodyLine& line);
-	void process_token(const std::string& tok);
-	void exec_cmd(const std::vector<VMValue>& exec_vec);
+	/**
+	 * @brief  Executes a compiled CODE section as a dataflow graph
+	 *
+	 * Calls of the program are evaluated lazily: only the calls with side
+	 * effects (see has_side_effect()), the ERROR of the program, the last
+	 * values of variables, and the calls their arguments need are evaluated (so
+	 * values that are discarded or overwritten before their use are not
+	 * computed, nor are errors in them reported).  Calls with side effects are
+	 * evaluated in the order of the program, each of them after the previous
+	 * one; the others are evaluated in parallel on up to @p num_threads threads
+	 * as soon as their arguments are known.  Variables of the program get their
+	 * last values.
+	 *
+	 * @throws  VMException  The error of the first call with side effects (or
+	 *                       the ERROR) that fails, after the calls running at
+	 *                       the time finish; otherwise, the error of the first
+	 *                       failed value of a variable
+	 */
+	void run_dataflow(const Vata2::Code::Program& prog, size_t num_threads);
+
+	/// CODE sections are executed by run_dataflow() with @p num_threads threads
+	/// (or by run_program() if @p num_threads is 0)
+	void set_dataflow(size_t num_threads) { this->dataflow_threads = num_threads; }
 
 	/**
 	 * @brief  Storage get accessor
@@ -215,9 +260,6 @@ public:
 	 * @param[in]  val   The value to store in the storage
 	 */
 	void save_to_storage(const std::string& name, VMValue val);
-
-	/// Cleans the stack
-	void clean_stack();
 };
 
 /// The exception for virtual machine errors
@@ -1,15 +1,30 @@
 // TODO: add header
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 #include <vata2/nfa.hh>
+#include <vata2/nfa-binary.hh>
+#include <vata2/nfa-cache.hh>
+#include <vata2/stats.hh>
 
 using namespace Vata2::Nfa;
 
 // Type of ID of NFAs that are used for referencing from outside
 using NfaId = size_t;
 
+// All functions may be called concurrently from several threads (and, when
+// called through ctypes.CDLL, they do not hold Python's GIL).  IDs are never
+// reused, and calls with an invalid ID (e.g., of a freed NFA) do nothing and
+// return -1 (if they return a value).
+
 // bookkeeping functions
 //
 extern "C" void nfa_set_debug_level(unsigned lvl);
@@ -43,9 +58,24 @@ extern "C" int  nfa_get_transitions(NfaId id_nfa, char* buf, size_t buf_len);
 // some more getters
 extern "C" int  nfa_get_fwd_reach_states(NfaId id_nfa, char* buf, size_t buf_len);
 
+// bulk transfers using arrays of integers (transitions are triples src, symb,
+// tgt); getters return the number of items (states or transitions), which are
+// written into buf only if at most buf_len items fit in, and -1 on error
+extern "C" void    nfa_add_initial_array(NfaId id_nfa, const uint64_t* states, size_t len);
+extern "C" void    nfa_add_final_array(NfaId id_nfa, const uint64_t* states, size_t len);
+extern "C" void    nfa_add_trans_array(NfaId id_nfa, const uint64_t* trans, size_t len);
+extern "C" int64_t nfa_get_initial_array(NfaId id_nfa, uint64_t* buf, size_t buf_len);
+extern "C" int64_t nfa_get_final_array(NfaId id_nfa, uint64_t* buf, size_t buf_len);
+extern "C" int64_t nfa_get_trans_array(NfaId id_nfa, uint64_t* buf, size_t buf_len);
+extern "C" int64_t nfa_get_fwd_reach_states_array(NfaId id_nfa, uint64_t* buf, size_t buf_len);
+
 // auxiliary
 extern "C" void nfa_print(NfaId id_nfa);
 
+// binary files (return 0 on success and -1 on failure)
+extern "C" int  nfa_save_binary(NfaId id_nfa, const char* filename);
+extern "C" int  nfa_load_binary(NfaId id_nfa, const char* filename);
+
 // language operations
 extern "C" void nfa_union(NfaId id_dst, NfaId id_lhs, NfaId id_rhs);
 extern "C" void nfa_minimize(NfaId id_dst, NfaId id_nfa);
@@ -55,9 +85,155 @@ extern "C" void nfa_remove_epsilon(NfaId id_dst, NfaId id_nfa, Symbol epsilon);
 extern "C" int  nfa_is_incl(NfaId id_lhs, NfaId id_rhs);
 extern "C" int  nfa_accepts_epsilon(NfaId id_aut);
 
+// operations with alphabets and parameters; an alphabet is given by an array
+// of symbols (all symbols are accepted if it is NULL), params are pairs of a
+// key and a value (the defaults of the operation are used for missing keys);
+// operations return 0 (or the result of a test) on success and -1 on failure
+// (e.g., for unknown values of parameters)
+extern "C" int  nfa_intersection(NfaId id_dst, NfaId id_lhs, NfaId id_rhs);
+extern "C" int  nfa_determinize(NfaId id_dst, NfaId id_nfa);
+extern "C" int  nfa_revert(NfaId id_dst, NfaId id_nfa);
+extern "C" int  nfa_minimize_params(NfaId id_dst, NfaId id_nfa,
+	const char* const* params, size_t num_params);
+extern "C" int  nfa_complement(NfaId id_dst, NfaId id_nfa,
+	const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params);
+extern "C" int  nfa_make_complete(NfaId id_nfa, const uint64_t* alph, size_t alph_len,
+	State sink_state);
+extern "C" int  nfa_is_deterministic(NfaId id_nfa);
+extern "C" int  nfa_is_complete(NfaId id_nfa, const uint64_t* alph, size_t alph_len);
+extern "C" int  nfa_are_state_disjoint(NfaId id_lhs, NfaId id_rhs);
+
+// tests with counterexamples; a counterexample is stored as the only last word
+// of the calling thread (see nfa_last_word())
+extern "C" int  nfa_is_lang_empty(NfaId id_nfa,
+	const char* const* params, size_t num_params);
+extern "C" int  nfa_is_universal(NfaId id_nfa,
+	const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params);
+extern "C" int  nfa_is_incl_params(NfaId id_lhs, NfaId id_rhs,
+	const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params);
+// results[i] is set to the result of the test for biggers[i], counterexamples
+// are stored as last words (empty for tests that hold)
+extern "C" int  nfa_is_incl_many(NfaId id_smaller, const NfaId* id_biggers,
+	size_t num_biggers, const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params, int* results);
+
+// words; nfa_get_shortest_words() stores the words as last words of the
+// calling thread and returns their number, nfa_last_word() gets the i-th last
+// word (like the getters of arrays)
+extern "C" int64_t nfa_get_shortest_words(NfaId id_nfa, size_t k);
+extern "C" int64_t nfa_last_word(size_t i, uint64_t* buf, size_t buf_len);
+
+// cache of results of operations
+extern "C" void   nfa_cache_set_capacity(size_t capacity);
+extern "C" size_t nfa_cache_size();
+extern "C" void   nfa_cache_clear();
+
+// statistics of operations aggregated over all threads (see vata2/stats.hh);
+// nfa_stats_get() fills the arrays of nfa_stats_num_counters() counters and of
+// the runs and times (in seconds) of nfa_stats_num_phases() phases
+extern "C" int         nfa_stats_enabled();
+extern "C" void        nfa_stats_reset();
+extern "C" size_t      nfa_stats_num_counters();
+extern "C" size_t      nfa_stats_num_phases();
+extern "C" const char* nfa_stats_counter_name(size_t i);
+extern "C" const char* nfa_stats_phase_name(size_t i);
+extern "C" void        nfa_stats_get(uint64_t* counters, uint64_t* runs, double* times);
+
 /** Library of NFAs */
-std::unordered_map<NfaId, Nfa*> mem;
-NfaId cnt = 0;
+namespace {
+	/// an NFA in the library, readers share the lock, writers own it
+	struct Entry {
+		std::shared_timed_mutex mtx;
+		Nfa nfa;
+
+		Entry() : mtx(), nfa() { }
+	};
+
+	/// a part of the library with its own lock (so that threads working with
+	/// different NFAs seldom wait for each other)
+	struct Shard {
+		std::mutex mtx;
+		std::unordered_map<NfaId, std::shared_ptr<Entry>> nfas;
+
+		Shard() : mtx(), nfas() { }
+	};
+
+	const size_t NUM_SHARDS = 16;
+	Shard mem[NUM_SHARDS];
+	std::atomic<NfaId> cnt(0);
+
+	Shard& get_shard(NfaId id)
+	{
+		return mem[id % NUM_SHARDS];
+	}
+
+	std::shared_ptr<Entry> find_entry(NfaId id)
+	{
+		Shard& shard = get_shard(id);
+		std::lock_guard<std::mutex> lock(shard.mtx);
+		auto it = shard.nfas.find(id);
+		if (shard.nfas.end() == it) {
+			WARN_PRINT("invalid NFA ID " + std::to_string(id));
+			return nullptr;
+		}
+
+		return it->second;
+	}
+
+	/**
+	 * Access to an NFA of the library holding its lock of the type Lock.  The
+	 * NFA stays alive while it is accessed even if it is freed meanwhile.
+	 */
+	template <class Lock, class T>
+	class Access {
+	private:
+		NfaId id;
+		std::shared_ptr<Entry> entry;
+		Lock lock;
+
+	public:
+		Access(NfaId id, std::defer_lock_t) : id(id), entry(find_entry(id)), lock() {
+			if (entry) lock = Lock(entry->mtx, std::defer_lock);
+		}
+
+		explicit Access(NfaId id) : Access(id, std::defer_lock) {
+			if (entry) lock.lock();
+		}
+
+		explicit operator bool() const { return static_cast<bool>(entry); }
+		T& operator*() const { return entry->nfa; }
+		T* operator->() const { return &entry->nfa; }
+
+		/// locks deferred accesses in the order of IDs of NFAs (so that two
+		/// threads do not deadlock); returns false if an access is invalid
+		friend bool lock_both(Access* lhs, Access* rhs) {
+			if (!*lhs || !*rhs) return false;
+			if (lhs->entry == rhs->entry) {
+				lhs->lock.lock();
+				return true;
+			}
+
+			if (lhs->id > rhs->id) std::swap(lhs, rhs);
+			lhs->lock.lock();
+			rhs->lock.lock();
+			return true;
+		}
+	};
+
+	using ReadNfa = Access<std::shared_lock<std::shared_timed_mutex>, const Nfa>;
+	using WriteNfa = Access<std::unique_lock<std::shared_timed_mutex>, Nfa>;
+
+	/// replaces the NFA with @p id_dst by @p result
+	void store_result(NfaId id_dst, Nfa&& result)
+	{
+		WriteNfa dst(id_dst);
+		if (!dst) return;
+		*dst = std::move(result);
+	}
+}
 
 void nfa_set_debug_level(unsigned verbosity)
 {
@@ -67,82 +243,106 @@ void nfa_set_debug_level(unsigned verbosity)
 
 size_t nfa_library_size()
 {
-	return mem.size();
+	size_t size = 0;
+	for (Shard& shard : mem) {
+		std::lock_guard<std::mutex> lock(shard.mtx);
+		size += shard.nfas.size();
+	}
+
+	return size;
 }
 
 void nfa_clear_library()
 {
-	for (auto it = mem.begin(); it != mem.end(); ++it) {
-		delete it->second;
-		mem.erase(it);
+	for (Shard& shard : mem) {
+		std::lock_guard<std::mutex> lock(shard.mtx);
+		shard.nfas.clear();
 	}
 }
 
 
 NfaId nfa_init()
 {
-	assert(cnt < std::numeric_limits<int>::max());
-	mem[cnt] = new Nfa();
-	DEBUG_PRINT("Creating NFA " + std::to_string(cnt));
-	return cnt++;
+	NfaId id = cnt++;
+	assert(id < std::numeric_limits<int>::max());
+	Shard& shard = get_shard(id);
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	{
+		std::lock_guard<std::mutex> lock(shard.mtx);
+		shard.nfas[id] = std::move(entry);
+	}
+
+	DEBUG_PRINT("Creating NFA " + std::to_string(id));
+	return id;
 }
 
 void nfa_free(NfaId id_nfa)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
 	DEBUG_PRINT("Deleting NFA " + std::to_string(id_nfa));
-	delete aut;
-	mem.erase(id_nfa);
+	Shard& shard = get_shard(id_nfa);
+	std::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock(shard.mtx);
+		auto it = shard.nfas.find(id_nfa);
+		if (shard.nfas.end() == it) return;
+		entry = std::move(it->second);
+		shard.nfas.erase(it);
+	}
+	// the NFA is deleted here (outside of the lock of the shard) unless it is
+	// accessed by another thread
 }
 
 void nfa_copy(NfaId dst, NfaId src)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[src];
-	Nfa* cp = mem[dst];
+	Nfa cp;
+	{
+		ReadNfa aut(src);
+		if (!aut) return;
 
-	// TODO: inefficient
-	cp->initialstates = aut->initialstates;
-	cp->finalstates = aut->finalstates;
+		// TODO: inefficient
+		cp.initialstates = aut->initialstates;
+		cp.finalstates = aut->finalstates;
 
-	for (auto tr : *aut) {
-		cp->add_trans(tr);
+		for (auto tr : *aut) {
+			cp.add_trans(tr);
+		}
 	}
+
+	store_result(dst, std::move(cp));
 }
 
 void nfa_add_initial(NfaId id_nfa, State state)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
 	aut->initialstates.insert(state);
 }
 
 void nfa_remove_initial(NfaId id_nfa, State state)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
 	aut->initialstates.erase(state);
 }
 
 int nfa_is_initial(NfaId id_nfa, State state)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 	return aut->has_initial(state);
 }
 
 void nfa_add_final(NfaId id_nfa, State state)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
 	aut->finalstates.insert(state);
 }
 
 void nfa_remove_final(NfaId id_nfa, State state)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
 	aut->finalstates.erase(state);
 }
 
@@ -183,8 +383,8 @@ namespace {
 
 int nfa_get_initial(NfaId id_nfa, char* buf, size_t buf_len)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 
 	int rv = serialize_container(buf, buf_len, aut->initialstates,
 		[](State state){ return std::to_string(state);});
@@ -194,8 +394,8 @@ int nfa_get_initial(NfaId id_nfa, char* buf, size_t buf_len)
 
 int nfa_get_final(NfaId id_nfa, char* buf, size_t buf_len)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 
 	int rv = serialize_container(buf, buf_len, aut->finalstates,
 		[](State state){ return std::to_string(state);});
@@ -205,31 +405,31 @@ int nfa_get_final(NfaId id_nfa, char* buf, size_t buf_len)
 
 int nfa_is_final(NfaId id_nfa, State state)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 	return aut->has_final(state);
 }
 
 void nfa_add_trans(NfaId id_nfa, State src, Symbol symb, State tgt)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
 
 	aut->add_trans(src, symb, tgt);
 }
 
 int nfa_has_trans(NfaId id_nfa, State src, Symbol symb, State tgt)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 
 	return aut->has_trans(src, symb, tgt);
 }
 
 int nfa_get_transitions(NfaId id_nfa, char* buf, size_t buf_len)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 
 	int rv = serialize_container(buf, buf_len, aut->begin(), aut->end(),
 		[](const Trans& trans){ return std::to_string(trans.src) + " " +
@@ -240,8 +440,8 @@ int nfa_get_transitions(NfaId id_nfa, char* buf, size_t buf_len)
 
 int nfa_get_fwd_reach_states(NfaId id_nfa, char* buf, size_t buf_len)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
 
 	auto fwd_states = get_fwd_reach_states(*aut);
 
@@ -251,53 +451,497 @@ int nfa_get_fwd_reach_states(NfaId id_nfa, char* buf, size_t buf_len)
 	return rv;
 }
 
+namespace {
+	/// writes states from @p cont into @p buf if they fit in
+	template <class T>
+	int64_t copy_states(uint64_t* buf, size_t buf_len, const T& cont)
+	{
+		if (cont.size() > buf_len) return cont.size();
+		if (nullptr == buf) return -1;
+
+		std::copy(cont.begin(), cont.end(), buf);
+		return cont.size();
+	}
+}
+
+void nfa_add_initial_array(NfaId id_nfa, const uint64_t* states, size_t len)
+{
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
+	aut->initialstates.insert(states, states + len);
+}
+
+void nfa_add_final_array(NfaId id_nfa, const uint64_t* states, size_t len)
+{
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
+	aut->finalstates.insert(states, states + len);
+}
+
+void nfa_add_trans_array(NfaId id_nfa, const uint64_t* trans, size_t len)
+{
+	WriteNfa aut(id_nfa);
+	if (!aut) return;
+
+	for (size_t i = 0; i < len; ++i, trans += 3) {
+		aut->add_trans(trans[0], trans[1], trans[2]);
+	}
+}
+
+int64_t nfa_get_initial_array(NfaId id_nfa, uint64_t* buf, size_t buf_len)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+	return copy_states(buf, buf_len, aut->initialstates);
+}
+
+int64_t nfa_get_final_array(NfaId id_nfa, uint64_t* buf, size_t buf_len)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+	return copy_states(buf, buf_len, aut->finalstates);
+}
+
+int64_t nfa_get_trans_array(NfaId id_nfa, uint64_t* buf, size_t buf_len)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+
+	size_t num_trans = aut->trans_size();
+	if (num_trans > buf_len) return num_trans;
+	if (nullptr == buf) return -1;
+
+	for (const Trans& trans : *aut) {
+		*buf++ = trans.src;
+		*buf++ = trans.symb;
+		*buf++ = trans.tgt;
+	}
+
+	return num_trans;
+}
+
+int64_t nfa_get_fwd_reach_states_array(NfaId id_nfa, uint64_t* buf, size_t buf_len)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+	return copy_states(buf, buf_len, get_fwd_reach_states(*aut));
+}
+
 void nfa_print(NfaId id_nfa)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
+	ReadNfa aut(id_nfa);
+	if (!aut) return;
 	DEBUG_PRINT(std::to_string(*aut));
 }
 
+int nfa_save_binary(NfaId id_nfa, const char* filename)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+
+	try {
+		std::ofstream os(filename, std::ios::out | std::ios::binary);
+		if (!os) return -1;
+		save_binary(*aut, os);
+	}
+	catch (const std::exception& ex) {
+		DEBUG_PRINT(std::string("nfa_save_binary: ") + ex.what());
+		return -1;
+	}
+
+	return 0;
+}
+
+int nfa_load_binary(NfaId id_nfa, const char* filename)
+{
+	Nfa loaded;
+	try {
+		BinaryNfa bin(filename);
+		bin.to_nfa(&loaded);
+	}
+	catch (const std::exception& ex) {
+		DEBUG_PRINT(std::string("nfa_load_binary: ") + ex.what());
+		return -1;
+	}
+
+	WriteNfa aut(id_nfa);
+	if (!aut) return -1;
+	*aut = std::move(loaded);
+
+	return 0;
+}
+
 int nfa_is_incl(NfaId id_lhs, NfaId id_rhs)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* lhs = mem[id_lhs];
-	Nfa* rhs = mem[id_rhs];
+	ReadNfa lhs(id_lhs, std::defer_lock);
+	ReadNfa rhs(id_rhs, std::defer_lock);
+	if (!lock_both(&lhs, &rhs)) return -1;
 
 	DirectAlphabet alph;
-	bool rv = is_incl(*lhs, *rhs, alph);
+	bool rv = is_incl_cached(*lhs, *rhs, alph);
 	return rv;
 }
 
 int nfa_accepts_epsilon(NfaId id_aut)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_aut];
+	ReadNfa aut(id_aut);
+	if (!aut) return -1;
 
 	return accepts_epsilon(*aut);
 }
 
 void nfa_union(NfaId id_dst, NfaId id_lhs, NfaId id_rhs)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* lhs = mem[id_lhs];
-	Nfa* rhs = mem[id_rhs];
-	Nfa* dst = mem[id_dst];
-	*dst = union_rename(*lhs, *rhs); // using the safe version
+	Nfa result;
+	{
+		ReadNfa lhs(id_lhs, std::defer_lock);
+		ReadNfa rhs(id_rhs, std::defer_lock);
+		if (!lock_both(&lhs, &rhs)) return;
+		result = union_rename(*lhs, *rhs); // using the safe version
+	}
+
+	store_result(id_dst, std::move(result));
 }
 
 void nfa_minimize(NfaId id_dst, NfaId id_nfa)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
-	Nfa* dst = mem[id_dst];
-	minimize(dst, *aut);
+	Nfa result;
+	{
+		ReadNfa aut(id_nfa);
+		if (!aut) return;
+		result = minimize_cached(*aut);
+	}
+
+	store_result(id_dst, std::move(result));
 }
 
 void nfa_remove_epsilon(NfaId id_dst, NfaId id_nfa, Symbol epsilon)
 {
-	DEBUG_PRINT("Some bound checking here...");
-	Nfa* aut = mem[id_nfa];
-	Nfa* dst = mem[id_dst];
-	remove_epsilon(dst, *aut, epsilon);
+	Nfa result;
+	{
+		ReadNfa aut(id_nfa);
+		if (!aut) return;
+		remove_epsilon(&result, *aut, epsilon);
+	}
+
+	store_result(id_dst, std::move(result));
+}
+
+namespace {
+	/// an alphabet with symbols given by an array
+	class ArrayAlphabet : public Alphabet {
+	private:
+		std::set<Symbol> symbols;
+
+	public:
+		ArrayAlphabet(const uint64_t* symbs, size_t len) : symbols(symbs, symbs + len) { }
+
+		virtual Symbol translate_symb(const std::string& str) override {
+			Symbol symb;
+			std::istringstream stream(str);
+			stream >> symb;
+			return symb;
+		}
+
+		virtual std::list<Symbol> get_symbols() const override {
+			return std::list<Symbol>(this->symbols.begin(), this->symbols.end());
+		}
+
+		virtual std::list<Symbol> get_complement(
+			const std::set<Symbol>& syms) const override {
+			std::list<Symbol> result;
+			std::set_difference(this->symbols.begin(), this->symbols.end(),
+				syms.begin(), syms.end(), std::back_inserter(result));
+			return result;
+		}
+	};
+
+	/// the alphabet with symbols @p alph, or a DirectAlphabet if it is NULL
+	std::unique_ptr<Alphabet> get_alphabet(const uint64_t* alph, size_t alph_len)
+	{
+		if (nullptr == alph) return std::unique_ptr<Alphabet>(new DirectAlphabet());
+		return std::unique_ptr<Alphabet>(new ArrayAlphabet(alph, alph_len));
+	}
+
+	/// @p defaults overridden by pairs of keys and values in @p params
+	StringDict get_params(
+		StringDict          defaults,
+		const char* const*  params,
+		size_t              num_params)
+	{
+		for (size_t i = 0; i < num_params; ++i) {
+			defaults[params[2*i]] = params[2*i + 1];
+		}
+
+		return defaults;
+	}
+
+	/// words (e.g., counterexamples) computed by the last call in the thread
+	thread_local std::vector<Word> last_words;
+
+	/// runs @p func, returning -1 if it throws
+	template <class Func>
+	int guarded(const char* func_name, Func func)
+	{
+		try {
+			return func();
+		}
+		catch (const std::exception& ex) {
+			DEBUG_PRINT(std::string(func_name) + ": " + ex.what());
+			return -1;
+		}
+	}
+
+	/// stores the result of @p op called on the NFA with @p id_nfa into the NFA
+	/// with @p id_dst
+	template <class Op>
+	int unary_op(const char* func_name, NfaId id_dst, NfaId id_nfa, Op op)
+	{
+		Nfa result;
+		int rv = guarded(func_name, [&]() {
+			ReadNfa aut(id_nfa);
+			if (!aut) return -1;
+			result = op(*aut);
+			return 0;
+		});
+		if (0 != rv) return rv;
+
+		store_result(id_dst, std::move(result));
+		return 0;
+	}
+
+	/// returns the result of @p test on the NFAs with @p id_lhs and @p id_rhs
+	template <class Test>
+	int binary_test(const char* func_name, NfaId id_lhs, NfaId id_rhs, Test test)
+	{
+		return guarded(func_name, [&]() {
+			ReadNfa lhs(id_lhs, std::defer_lock);
+			ReadNfa rhs(id_rhs, std::defer_lock);
+			if (!lock_both(&lhs, &rhs)) return -1;
+			return test(*lhs, *rhs)? 1 : 0;
+		});
+	}
+}
+
+int nfa_intersection(NfaId id_dst, NfaId id_lhs, NfaId id_rhs)
+{
+	Nfa result;
+	int rv = binary_test(__func__, id_lhs, id_rhs,
+		[&](const Nfa& lhs, const Nfa& rhs) {
+			result = intersection(lhs, rhs);
+			return true;
+		});
+	if (rv < 0) return rv;
+
+	store_result(id_dst, std::move(result));
+	return 0;
+}
+
+int nfa_determinize(NfaId id_dst, NfaId id_nfa)
+{
+	return unary_op(__func__, id_dst, id_nfa,
+		[](const Nfa& aut) { return determinize_cached(aut); });
+}
+
+int nfa_revert(NfaId id_dst, NfaId id_nfa)
+{
+	return unary_op(__func__, id_dst, id_nfa,
+		[](const Nfa& aut) { return revert(aut); });
+}
+
+int nfa_minimize_params(NfaId id_dst, NfaId id_nfa,
+	const char* const* params, size_t num_params)
+{
+	StringDict dict = get_params({}, params, num_params);
+	return unary_op(__func__, id_dst, id_nfa,
+		[&](const Nfa& aut) { return minimize_cached(aut, dict); });
+}
+
+int nfa_complement(NfaId id_dst, NfaId id_nfa,
+	const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params)
+{
+	std::unique_ptr<Alphabet> alphabet = get_alphabet(alph, alph_len);
+	StringDict dict = get_params({{"algo", "classical"}}, params, num_params);
+	return unary_op(__func__, id_dst, id_nfa,
+		[&](const Nfa& aut) { return complement_cached(aut, *alphabet, dict); });
+}
+
+int nfa_make_complete(NfaId id_nfa, const uint64_t* alph, size_t alph_len,
+	State sink_state)
+{
+	std::unique_ptr<Alphabet> alphabet = get_alphabet(alph, alph_len);
+	return guarded(__func__, [&]() {
+		WriteNfa aut(id_nfa);
+		if (!aut) return -1;
+		make_complete(&*aut, *alphabet, sink_state);
+		return 0;
+	});
+}
+
+int nfa_is_deterministic(NfaId id_nfa)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+	return is_deterministic(*aut);
+}
+
+int nfa_is_complete(NfaId id_nfa, const uint64_t* alph, size_t alph_len)
+{
+	std::unique_ptr<Alphabet> alphabet = get_alphabet(alph, alph_len);
+	return guarded(__func__, [&]() {
+		ReadNfa aut(id_nfa);
+		if (!aut) return -1;
+		return is_complete(*aut, *alphabet)? 1 : 0;
+	});
+}
+
+int nfa_are_state_disjoint(NfaId id_lhs, NfaId id_rhs)
+{
+	return binary_test(__func__, id_lhs, id_rhs,
+		[](const Nfa& lhs, const Nfa& rhs) { return are_state_disjoint(lhs, rhs); });
+}
+
+int nfa_is_lang_empty(NfaId id_nfa,
+	const char* const* params, size_t num_params)
+{
+	StringDict dict = get_params({{"algo", "bfs"}}, params, num_params);
+	last_words.assign(1, Word());
+	return guarded(__func__, [&]() {
+		ReadNfa aut(id_nfa);
+		if (!aut) return -1;
+		return is_lang_empty_cex(*aut, &last_words[0], dict)? 1 : 0;
+	});
+}
+
+int nfa_is_universal(NfaId id_nfa,
+	const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params)
+{
+	std::unique_ptr<Alphabet> alphabet = get_alphabet(alph, alph_len);
+	StringDict dict = get_params({{"algo", "antichains"}}, params, num_params);
+	last_words.assign(1, Word());
+	return guarded(__func__, [&]() {
+		ReadNfa aut(id_nfa);
+		if (!aut) return -1;
+		return is_universal_cached(*aut, *alphabet, &last_words[0], dict)? 1 : 0;
+	});
+}
+
+int nfa_is_incl_params(NfaId id_lhs, NfaId id_rhs,
+	const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params)
+{
+	std::unique_ptr<Alphabet> alphabet = get_alphabet(alph, alph_len);
+	StringDict dict = get_params({{"algo", "antichains"}}, params, num_params);
+	last_words.assign(1, Word());
+	return binary_test(__func__, id_lhs, id_rhs,
+		[&](const Nfa& lhs, const Nfa& rhs) {
+			return is_incl_cached(lhs, rhs, *alphabet, &last_words[0], dict);
+		});
+}
+
+int nfa_is_incl_many(NfaId id_smaller, const NfaId* id_biggers,
+	size_t num_biggers, const uint64_t* alph, size_t alph_len,
+	const char* const* params, size_t num_params, int* results)
+{
+	assert(nullptr != results);
+
+	std::unique_ptr<Alphabet> alphabet = get_alphabet(alph, alph_len);
+	StringDict dict = get_params({{"algo", "antichains"}}, params, num_params);
+	last_words.clear();
+	return guarded(__func__, [&]() {
+		// locks are taken in the order of IDs (as in lock_both())
+		std::vector<NfaId> ids(id_biggers, id_biggers + num_biggers);
+		ids.push_back(id_smaller);
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+		std::unordered_map<NfaId, std::unique_ptr<ReadNfa>> auts;
+		for (NfaId id : ids) {
+			std::unique_ptr<ReadNfa> aut(new ReadNfa(id));
+			if (!*aut) return -1;
+			auts[id] = std::move(aut);
+		}
+
+		std::vector<const Nfa*> biggers;
+		for (size_t i = 0; i < num_biggers; ++i) {
+			biggers.push_back(&**auts[id_biggers[i]]);
+		}
+
+		std::vector<bool> res;
+		is_incl_many(**auts[id_smaller], biggers, *alphabet, &res, &last_words, dict);
+		std::copy(res.begin(), res.end(), results);
+		return 0;
+	});
+}
+
+int64_t nfa_get_shortest_words(NfaId id_nfa, size_t k)
+{
+	ReadNfa aut(id_nfa);
+	if (!aut) return -1;
+
+	last_words = get_shortest_words(*aut, k);
+	return last_words.size();
+}
+
+int64_t nfa_last_word(size_t i, uint64_t* buf, size_t buf_len)
+{
+	if (i >= last_words.size()) return -1;
+	return copy_states(buf, buf_len, last_words[i]);
+}
+
+void nfa_cache_set_capacity(size_t capacity)
+{
+	OpCache::global().set_capacity(capacity);
+}
+
+size_t nfa_cache_size()
+{
+	return OpCache::global().size();
+}
+
+void nfa_cache_clear()
+{
+	OpCache::global().clear();
+}
+
+int nfa_stats_enabled()
+{
+	return Vata2::Stats::enabled();
+}
+
+void nfa_stats_reset()
+{
+	Vata2::Stats::reset();
+}
+
+size_t nfa_stats_num_counters()
+{
+	return Vata2::Stats::NUM_COUNTERS;
+}
+
+size_t nfa_stats_num_phases()
+{
+	return Vata2::Stats::NUM_PHASES;
+}
+
+const char* nfa_stats_counter_name(size_t i)
+{
+	if (i >= Vata2::Stats::NUM_COUNTERS) { return nullptr; }
+	return Vata2::Stats::to_string(static_cast<Vata2::Stats::Counter>(i));
+}
+
+const char* nfa_stats_phase_name(size_t i)
+{
+	if (i >= Vata2::Stats::NUM_PHASES) { return nullptr; }
+	return Vata2::Stats::to_string(static_cast<Vata2::Stats::Phase>(i));
+}
+
+void nfa_stats_get(uint64_t* counters, uint64_t* runs, double* times)
+{
+	Vata2::Stats::Stats stats = Vata2::Stats::get_total();
+	std::copy(stats.counters.begin(), stats.counters.end(), counters);
+	std::copy(stats.runs.begin(), stats.runs.end(), runs);
+	std::copy(stats.times.begin(), stats.times.end(), times);
 }
@@ -1,6 +1,9 @@
 #!/usr/bin/env python3
+import array
+import concurrent.futures
 import ctypes
 import ctypes.util
+import threading
 
 import unittest
 
@@ -27,18 +30,20 @@ class NFA:
     __symbDict = dict()    # translates symbols to numbers
     __numDict = dict()     # translates numbers to symbols
     __symbToNumCnt = 0     # counter for assigning symbols to unique numbers
+    __symbLock = threading.Lock()   # guards the translation of symbols
 
     @classmethod
     def symbToNum(cls, symb):
         """Converts a symbol to a number to be used by VATA"""
-        if symb in cls.__symbDict:
-            return cls.__symbDict[symb]
-        else:
-            num = cls.__symbToNumCnt
-            cls.__symbToNumCnt += 1
-            cls.__symbDict[symb] = num
-            cls.__numDict[num] = symb
-            return num
+        with cls.__symbLock:
+            if symb in cls.__symbDict:
+                return cls.__symbDict[symb]
+            else:
+                num = cls.__symbToNumCnt
+                cls.__symbToNumCnt += 1
+                cls.__symbDict[symb] = num
+                cls.__numDict[num] = symb
+                return num
 
     @classmethod
     def numToSymb(cls, num):
@@ -59,6 +64,65 @@ class NFA:
         assert type(level) == int
         g_vatalib.nfa_set_debug_level(level)
 
+    @staticmethod
+    def setCacheCapacity(capacity):
+        """Sets the number of results of operations cached by VATA (0 disables the cache)"""
+        assert type(capacity) == int and capacity >= 0
+        g_vatalib.nfa_cache_set_capacity(ctypes.c_size_t(capacity))
+
+    @staticmethod
+    def getCacheSize():
+        """Gets the number of results of operations cached by VATA"""
+        g_vatalib.nfa_cache_size.restype = ctypes.c_size_t
+        return g_vatalib.nfa_cache_size()
+
+    @staticmethod
+    def clearCache():
+        """Clears the cache of results of operations"""
+        g_vatalib.nfa_cache_clear()
+
+    @staticmethod
+    def statsEnabled():
+        """Checks whether VATA was compiled with statistics of operations (VATA_STATS)"""
+        return bool(g_vatalib.nfa_stats_enabled())
+
+    @staticmethod
+    def resetStats():
+        """Resets statistics of operations"""
+        g_vatalib.nfa_stats_reset()
+
+    @staticmethod
+    def getStats():
+        """getStats() -> dict
+
+Gets statistics of operations aggregated over all threads: counters (e.g.,
+'macrostates' or 'post calls') and, for every phase (e.g., 'inclusion'), the
+number of its runs ('runs of <phase>') and its time in seconds ('time of
+<phase>').  All values are zero unless VATA was compiled with VATA_STATS.
+"""
+        g_vatalib.nfa_stats_num_counters.restype = ctypes.c_size_t
+        g_vatalib.nfa_stats_num_phases.restype = ctypes.c_size_t
+        g_vatalib.nfa_stats_counter_name.restype = ctypes.c_char_p
+        g_vatalib.nfa_stats_phase_name.restype = ctypes.c_char_p
+        num_counters = g_vatalib.nfa_stats_num_counters()
+        num_phases = g_vatalib.nfa_stats_num_phases()
+
+        counters = (ctypes.c_uint64 * num_counters)()
+        runs = (ctypes.c_uint64 * num_phases)()
+        times = (ctypes.c_double * num_phases)()
+        g_vatalib.nfa_stats_get(counters, runs, times)
+
+        result = dict()
+        for i in range(num_counters):
+            name = g_vatalib.nfa_stats_counter_name(ctypes.c_size_t(i)).decode()
+            # the load factor is kept in thousandths
+            result[name] = counters[i] / 1000 if name == 'peak map load' else counters[i]
+        for i in range(num_phases):
+            name = g_vatalib.nfa_stats_phase_name(ctypes.c_size_t(i)).decode()
+            result['runs of ' + name] = runs[i]
+            result['time of ' + name] = times[i]
+        return result
+
     ################ CONSTRUCTORS AND DESTRUCTORS #################
     def __init__(self):
         """The constructor"""
@@ -102,6 +166,77 @@ class NFA:
         out_list = out_str.split(',')
         return out_list
 
+    @staticmethod
+    def __getArrayFromVATAFunction(vataFuncName, arg, item_len=1):
+        """Calls vataFuncName on arg, which fills an array of 64-bit integers
+        (items of the length item_len), and returns the array and the number of
+        items"""
+        func = g_vatalib[vataFuncName]
+        func.restype = ctypes.c_int64
+        buf_len = 1024
+        while True:
+            buf = (ctypes.c_uint64 * (buf_len * item_len))()
+            rv = func(arg, buf, ctypes.c_size_t(buf_len))
+            if rv < 0:
+                raise Exception("error while communicating with VATA: " +
+                    "returned error value from {}: {}".format(vataFuncName, rv))
+            if rv <= buf_len:
+                return buf, rv
+            buf_len = rv    # memory too small, call again with larger memory
+
+    @staticmethod
+    def __toArray(values):
+        """Converts values to a ctypes array of 64-bit integers.  Writable
+        buffers of unsigned 64-bit integers (e.g., array.array('Q') or numpy
+        arrays of uint64) are passed to VATA without copying."""
+        try:
+            view = memoryview(values)
+        except TypeError:
+            values = list(values)
+            return (ctypes.c_uint64 * len(values))(*values)
+
+        if (view.itemsize != 8 or view.format.lstrip('@=<') not in ('Q', 'L') or
+                not view.c_contiguous):
+            values = view.tolist()
+            return (ctypes.c_uint64 * len(values))(*values)
+
+        arr_type = ctypes.c_uint64 * (view.nbytes // 8)
+        if view.readonly:
+            return arr_type.from_buffer_copy(view)
+        return arr_type.from_buffer(view)
+
+    @classmethod
+    def __alphabetArgs(cls, alphabet):
+        """Converts an iterable of symbols to the arguments of VATA giving an
+        alphabet; None stands for all symbols translated by symbToNum()"""
+        if alphabet is None:
+            with cls.__symbLock:
+                alphabet = list(cls.__numDict.values())
+        symbs = [cls.symbToNum(symb) for symb in alphabet]
+        return (ctypes.c_uint64 * len(symbs))(*symbs), ctypes.c_size_t(len(symbs))
+
+    @staticmethod
+    def __paramsArgs(params):
+        """Converts a dictionary of parameters to the arguments of VATA"""
+        if params is None:
+            params = dict()
+        flat = [str(x).encode('utf-8') for item in params.items() for x in item]
+        return (ctypes.c_char_p * len(flat))(*flat), ctypes.c_size_t(len(params))
+
+    @staticmethod
+    def __check(vataFuncName, rv):
+        """Raises an exception if rv is an error value returned by vataFuncName"""
+        if rv < 0:
+            raise Exception("error while communicating with VATA: " +
+                "returned error value from {}: {}".format(vataFuncName, rv))
+        return rv
+
+    @classmethod
+    def __getLastWord(cls, i):
+        """Gets the i-th word computed by the last call of VATA (in the thread)"""
+        buf, num = cls.__getArrayFromVATAFunction("nfa_last_word", ctypes.c_size_t(i))
+        return tuple(cls.numToSymb(x) for x in buf[:num])
+
 
     ######################## INITIAL STATES ############################
     def addInitial(self, state):
@@ -120,11 +255,15 @@ class NFA:
         rv = g_vatalib.nfa_is_initial(self.aut, state)
         return True if rv != 0 else False     # VATA returns int
 
+    def addInitialStates(self, states):
+        """Adds initial states from an iterable or a buffer of 64-bit integers"""
+        arr = NFA.__toArray(states)
+        g_vatalib.nfa_add_initial_array(self.aut, arr, ctypes.c_size_t(len(arr)))
+
     def getInitial(self):
         """Gets initial states"""
-        out_str_list = self.__getStringListFromVATAFunction("nfa_get_initial")
-        init_states = set([int(x) for x in out_str_list])
-        return init_states
+        buf, num = NFA.__getArrayFromVATAFunction("nfa_get_initial_array", self.aut)
+        return set(buf[:num])
 
 
     ######################### FINAL STATES #############################
@@ -144,11 +283,15 @@ class NFA:
         rv = g_vatalib.nfa_is_final(self.aut, state)
         return True if rv != 0 else False     # VATA returns int
 
+    def addFinalStates(self, states):
+        """Adds final states from an iterable or a buffer of 64-bit integers"""
+        arr = NFA.__toArray(states)
+        g_vatalib.nfa_add_final_array(self.aut, arr, ctypes.c_size_t(len(arr)))
+
     def getFinal(self):
         """Gets final states"""
-        out_str_list = self.__getStringListFromVATAFunction("nfa_get_final")
-        fin_states = set([int(x) for x in out_str_list])
-        return fin_states
+        buf, num = NFA.__getArrayFromVATAFunction("nfa_get_final_array", self.aut)
+        return set(buf[:num])
 
 
     ######################### TRANSITIONS #############################
@@ -164,16 +307,35 @@ class NFA:
         symb_num = NFA.symbToNum(symb)
         return True if g_vatalib.nfa_has_trans(self.aut, src, symb_num, tgt) else False
 
+    def addTransitions(self, transitions):
+        """Adds transitions given as an iterable of triples (src, symb, tgt)"""
+        flat = array.array('Q')
+        for (src, symb, tgt) in transitions:
+            assert type(src) == int and type(tgt) == int
+            flat.extend((src, NFA.symbToNum(symb), tgt))
+        self.addTransitionsArray(flat)
+
+    def addTransitionsArray(self, transitions):
+        """Adds transitions given as a flat iterable or buffer of 64-bit
+        integers src, symb, tgt, ... (symbols are numbers from symbToNum())"""
+        arr = NFA.__toArray(transitions)
+        assert len(arr) % 3 == 0
+        g_vatalib.nfa_add_trans_array(self.aut, arr, ctypes.c_size_t(len(arr) // 3))
+
+    def getTransitionsArray(self):
+        """Gets all transitions of the automaton as array.array('Q') with
+        integers src, symb, tgt, ... (symbols are numbers from symbToNum())"""
+        buf, num = NFA.__getArrayFromVATAFunction("nfa_get_trans_array", self.aut, 3)
+        arr = array.array('Q')
+        arr.frombytes(ctypes.string_at(buf, 3 * num * ctypes.sizeof(ctypes.c_uint64)))
+        return arr
+
     def getTransitions(self):
         """Gets all transitions of the automaton"""
-        out_str_list = self.__getStringListFromVATAFunction("nfa_get_transitions")
+        arr = self.getTransitionsArray()
         trans_set = set()
-        for trans_str in out_str_list:
-            trans_split = trans_str.split(' ')
-            assert len(trans_split) == 3
-            symb = NFA.numToSymb(int(trans_split[1]))
-            trans = (int(trans_split[0]), symb, int(trans_split[2]))
-            trans_set.add(trans)
+        for i in range(0, len(arr), 3):
+            trans_set.add((arr[i], NFA.numToSymb(arr[i + 1]), arr[i + 2]))
 
         return trans_set
 
@@ -190,18 +352,47 @@ class NFA:
     ############################## AUXILIARY OPERATIONS ########################
     def getFwdReachStates(self):
         """Gets states reachable from initial states"""
-        out_str_list = self.__getStringListFromVATAFunction("nfa_get_fwd_reach_states")
-        fwd_states = set([int(x) for x in out_str_list])
-        return fwd_states
+        buf, num = NFA.__getArrayFromVATAFunction("nfa_get_fwd_reach_states_array", self.aut)
+        return set(buf[:num])
+
+
+    ############################### BINARY FILES ###############################
+    def saveBinary(self, filename):
+        """Saves the automaton into a file in VATA's binary format"""
+        assert type(filename) == str
+        rv = g_vatalib.nfa_save_binary(self.aut, filename.encode('utf-8'))
+        if rv != 0:
+            raise Exception("unable to save the automaton into {}".format(filename))
+
+    @classmethod
+    def loadBinary(cls, filename):
+        """Loads an automaton from a file in VATA's binary format.  Symbols are
+        kept as numbers assigned by symbToNum(), so the file needs to be loaded
+        in the session that saved it (or one assigning numbers the same way)."""
+        assert type(filename) == str
+        tmp = NFA()
+        rv = g_vatalib.nfa_load_binary(tmp.aut, filename.encode('utf-8'))
+        if rv != 0:
+            raise Exception("unable to load an automaton from {}".format(filename))
+        return tmp
 
 
     ############################### AUTOMATA OPERATIONS ########################
-    def minimize(self):
+    def minimize(self, params=None):
         """Returns a minimized automaton"""
         tmp = NFA()
-        g_vatalib.nfa_minimize(tmp.aut, self.aut)
+        if params is None:
+            g_vatalib.nfa_minimize(tmp.aut, self.aut)
+        else:
+            NFA.__check("nfa_minimize_params", g_vatalib.nfa_minimize_params(
+                tmp.aut, self.aut, *NFA.__paramsArgs(params)))
         return tmp
 
+    def minimizeAsync(self, executor):
+        """Returns a future of minimize() running in executor (VATA does not
+        hold the GIL, so minimizations in a thread pool run in parallel)"""
+        return executor.submit(self.minimize)
+
     def removeEpsilon(self, epsilon):
         """Removes epsilon transitions from the automaton (preserving language)"""
         tmp = NFA()
@@ -210,11 +401,79 @@ class NFA:
         return tmp
 
 
+    def determinize(self):
+        """Returns a deterministic automaton with the same language"""
+        tmp = NFA()
+        NFA.__check("nfa_determinize", g_vatalib.nfa_determinize(tmp.aut, self.aut))
+        return tmp
+
+    def revert(self):
+        """Returns the automaton with reverted transitions"""
+        tmp = NFA()
+        NFA.__check("nfa_revert", g_vatalib.nfa_revert(tmp.aut, self.aut))
+        return tmp
+
+    def complement(self, alphabet=None, params=None):
+        """Returns an automaton accepting the complement of the language wrt
+        alphabet (by default, all symbols known to NFA)"""
+        tmp = NFA()
+        NFA.__check("nfa_complement", g_vatalib.nfa_complement(tmp.aut, self.aut,
+            *(NFA.__alphabetArgs(alphabet) + NFA.__paramsArgs(params))))
+        return tmp
+
+    def makeComplete(self, sinkState, alphabet=None):
+        """Makes the automaton complete wrt alphabet (in place), adding
+        missing transitions to sinkState"""
+        assert type(sinkState) == int
+        NFA.__check("nfa_make_complete", g_vatalib.nfa_make_complete(self.aut,
+            *(NFA.__alphabetArgs(alphabet) + (ctypes.c_uint64(sinkState),))))
+
+
     ################################## LANGUAGE TESTS ##########################
     def acceptsEpsilon(self):
         """Checkes whether the automaton accepts epsilon"""
         return True if g_vatalib.nfa_accepts_epsilon(self.aut) == 1 else False
 
+    def isDeterministic(self):
+        """Checks whether the automaton is deterministic"""
+        return NFA.__check("nfa_is_deterministic",
+            g_vatalib.nfa_is_deterministic(self.aut)) == 1
+
+    def isComplete(self, alphabet=None):
+        """Checks whether the automaton is complete wrt alphabet"""
+        return NFA.__check("nfa_is_complete",
+            g_vatalib.nfa_is_complete(self.aut, *NFA.__alphabetArgs(alphabet))) == 1
+
+    def isLangEmptyCex(self, params=None):
+        """Checks whether the language is empty; returns the result and a
+        word of the language (None if it is empty)"""
+        rv = NFA.__check("nfa_is_lang_empty",
+            g_vatalib.nfa_is_lang_empty(self.aut, *NFA.__paramsArgs(params)))
+        return (True, None) if rv == 1 else (False, NFA.__getLastWord(0))
+
+    def isLangEmpty(self, params=None):
+        """Checks whether the language is empty"""
+        return self.isLangEmptyCex(params)[0]
+
+    def isUniversalCex(self, alphabet=None, params=None):
+        """Checks whether the language is universal wrt alphabet; returns the
+        result and a word not in the language (None if it is universal)"""
+        rv = NFA.__check("nfa_is_universal", g_vatalib.nfa_is_universal(self.aut,
+            *(NFA.__alphabetArgs(alphabet) + NFA.__paramsArgs(params))))
+        return (True, None) if rv == 1 else (False, NFA.__getLastWord(0))
+
+    def isUniversal(self, alphabet=None, params=None):
+        """Checks whether the language is universal wrt alphabet"""
+        return self.isUniversalCex(alphabet, params)[0]
+
+    def getShortestWords(self, k):
+        """Gets (at most) k shortest words of the language in the shortlex order"""
+        assert type(k) == int
+        func = g_vatalib.nfa_get_shortest_words
+        func.restype = ctypes.c_int64
+        num = NFA.__check("nfa_get_shortest_words", func(self.aut, ctypes.c_size_t(k)))
+        return [NFA.__getLastWord(i) for i in range(num)]
+
 
     # TODO: trim (odstran zbytecne prechody/stavy)
 
@@ -229,11 +488,64 @@ class NFA:
         return tmp
 
     @classmethod
-    def isIncl(cls, lhs, rhs):
+    def intersection(cls, lhs, rhs):
+        """Creates a product automaton accepting the intersection of languages"""
+        assert type(lhs) == NFA and type(rhs) == NFA
+        tmp = NFA()
+        cls.__check("nfa_intersection", g_vatalib.nfa_intersection(tmp.aut, lhs.aut, rhs.aut))
+        return tmp
+
+    @classmethod
+    def areStateDisjoint(cls, lhs, rhs):
+        """Checks whether two NFAs have disjoint sets of states"""
+        assert type(lhs) == NFA and type(rhs) == NFA
+        return cls.__check("nfa_are_state_disjoint",
+            g_vatalib.nfa_are_state_disjoint(lhs.aut, rhs.aut)) == 1
+
+    @classmethod
+    def isIncl(cls, lhs, rhs, alphabet=None, params=None):
         """Tests inclusion of languages of two NFAs."""
+        if alphabet is None and params is None:
+            assert type(lhs) == NFA and type(rhs) == NFA
+            return cls.__check("nfa_is_incl", g_vatalib.nfa_is_incl(lhs.aut, rhs.aut))
+        return cls.isInclCex(lhs, rhs, alphabet, params)[0]
+
+    @classmethod
+    def isInclCex(cls, lhs, rhs, alphabet=None, params=None):
+        """Tests inclusion of languages of two NFAs wrt alphabet; returns the
+        result and a word of lhs not in rhs (None if the inclusion holds)"""
         assert type(lhs) == NFA and type(rhs) == NFA
-        rv = g_vatalib.nfa_is_incl(lhs.aut, rhs.aut)
-        return rv
+        rv = cls.__check("nfa_is_incl_params", g_vatalib.nfa_is_incl_params(
+            lhs.aut, rhs.aut,
+            *(cls.__alphabetArgs(alphabet) + cls.__paramsArgs(params))))
+        return (True, None) if rv == 1 else (False, cls.__getLastWord(0))
+
+    @classmethod
+    def isInclBiggers(cls, smaller, biggers, alphabet=None, params=None):
+        """Tests inclusion of the language of smaller in languages of biggers
+        (sharing the exploration of smaller); returns a list of pairs of the
+        result and a counterexample (None if the inclusion holds)"""
+        assert type(smaller) == NFA and all(type(x) == NFA for x in biggers)
+        ids = (ctypes.c_size_t * len(biggers))(*[x.aut for x in biggers])
+        results = (ctypes.c_int * len(biggers))()
+        cls.__check("nfa_is_incl_many", g_vatalib.nfa_is_incl_many(
+            smaller.aut, ids, ctypes.c_size_t(len(biggers)),
+            *(cls.__alphabetArgs(alphabet) + cls.__paramsArgs(params) + (results,))))
+        return [(True, None) if results[i] else (False, cls.__getLastWord(i))
+            for i in range(len(biggers))]
+
+    @classmethod
+    def isInclAsync(cls, lhs, rhs, executor):
+        """Returns a future of isIncl(lhs, rhs) running in executor (VATA does
+        not hold the GIL, so tests in a thread pool run in parallel)"""
+        return executor.submit(cls.isIncl, lhs, rhs)
+
+    @classmethod
+    def isInclMany(cls, pairs, max_workers=None):
+        """Tests inclusion of languages of pairs of NFAs in parallel"""
+        with concurrent.futures.ThreadPoolExecutor(max_workers) as executor:
+            futures = [cls.isInclAsync(lhs, rhs, executor) for (lhs, rhs) in pairs]
+            return [future.result() for future in futures]
 
 ################################## UNIT TESTS ##################################
 class NFATest(unittest.TestCase):
@@ -286,6 +598,30 @@ class NFATest(unittest.TestCase):
         self.assertTrue(aut.hasTransition(41, "hello", 42))
         self.assertEqual(aut.getTransitions(), {(41, "hello", 42)})
 
+    def test_bulk(self):
+        """Testing bulk transfers of states and transitions"""
+        aut = NFA()
+        aut.addInitialStates([1, 2])
+        aut.addFinalStates(array.array('Q', [3]))
+        aut.addTransitions([(1, "a", 2), (2, "b", 3)])
+        self.assertEqual(aut.getInitial(), {1, 2})
+        self.assertEqual(aut.getFinal(), {3})
+        self.assertEqual(aut.getTransitions(), {(1, "a", 2), (2, "b", 3)})
+
+        flat = aut.getTransitionsArray()
+        self.assertEqual(len(flat), 6)
+        aut2 = NFA()
+        aut2.addTransitionsArray(flat)
+        self.assertEqual(aut2.getTransitions(), aut.getTransitions())
+
+        # more items than fit into the initial buffer
+        aut3 = NFA()
+        aut3.addInitialStates(range(5000))
+        aut3.addTransitionsArray(array.array('Q', [0, NFA.symbToNum("a"), 1] * 2 +
+            [x for i in range(2000) for x in (i, NFA.symbToNum("b"), i + 1)]))
+        self.assertEqual(aut3.getInitial(), set(range(5000)))
+        self.assertEqual(len(aut3.getTransitionsArray()), 3 * 2001)
+
     def test_copy(self):
         """Testing copying"""
         aut1 = NFA()
@@ -394,6 +730,132 @@ class NFATest(unittest.TestCase):
         # TODO: write some tests
         assert True
 
+    def test_threads(self):
+        """Testing calls from several threads"""
+        def build(i):
+            aut = NFA()
+            aut.addInitial(1)
+            aut.addTransitions([(1, "a", 2), (2, "b", 1), (2, "t{}".format(i % 4), 2)])
+            aut.addFinal(2)
+            return aut
+
+        with concurrent.futures.ThreadPoolExecutor(4) as executor:
+            auts = list(executor.map(build, range(32)))
+            mins = [future.result() for future in
+                [aut.minimizeAsync(executor) for aut in auts]]
+
+        self.assertEqual(g_vatalib.nfa_library_size(), 64)
+        results = NFA.isInclMany(list(zip(auts, mins)) + [(auts[0], auts[1])], 4)
+        self.assertEqual(results, [True] * 32 + [False])
+
+        aut = build(0)
+        g_vatalib.nfa_free(aut.aut)
+        with self.assertRaises(Exception):
+            NFA.isIncl(aut, auts[0])
+
+    def test_algorithms(self):
+        """Testing operations and tests with alphabets and parameters"""
+        aut1 = NFA()                # words ending with "b"
+        aut1.addInitial(1)
+        aut1.addTransitions([(1, "a", 1), (1, "b", 1), (1, "b", 2)])
+        aut1.addFinal(2)
+        aut2 = NFA()                # words containing "b"
+        aut2.addInitial(1)
+        aut2.addTransitions([(1, "a", 1), (1, "b", 2), (2, "a", 2), (2, "b", 2)])
+        aut2.addFinal(2)
+        alph = ["a", "b"]
+
+        self.assertFalse(aut1.isDeterministic())
+        det = aut1.determinize()
+        self.assertTrue(det.isDeterministic())
+        self.assertTrue(NFA.isIncl(det, aut1) and NFA.isIncl(aut1, det))
+        self.assertTrue(NFA.isIncl(aut1.minimize({"algo": "brzozowski"}), aut1))
+        with self.assertRaises(Exception):
+            aut1.complement(alph, {"algo": "foo"})
+
+        self.assertEqual(NFA.isInclCex(aut1, aut2, alph), (True, None))
+        self.assertEqual(NFA.isInclCex(aut2, aut1, alph, {"algo": "naive"}),
+            (False, ("b", "a")))
+        self.assertEqual(NFA.isInclBiggers(aut2, [aut2, aut1], alph),
+            [(True, None), (False, ("b", "a"))])
+
+        self.assertEqual(aut1.isLangEmptyCex(), (False, ("b",)))
+        self.assertTrue(NFA.intersection(aut1, NFA()).isLangEmpty())
+        self.assertEqual(aut1.isUniversalCex(alph), (False, ()))
+        self.assertTrue(NFA.union(aut1, aut1.complement(alph)).isUniversal(alph))
+        self.assertEqual(aut1.revert().getShortestWords(1), [("b",)])
+
+        self.assertTrue(aut2.isComplete(alph))
+        self.assertFalse(aut1.isComplete(alph))
+        aut3 = aut1.copy()
+        aut3.makeComplete(3, alph)
+        self.assertTrue(aut3.isComplete(alph))
+        self.assertTrue(aut3.hasTransition(2, "a", 3))
+        self.assertFalse(NFA.areStateDisjoint(aut1, aut2))
+
+    def test_cache(self):
+        """Testing the cache of results of operations."""
+        NFA.setCacheCapacity(10)
+        aut = NFA()
+        aut.addInitial(1)
+        aut.addTransition(1, "a", 2)
+        aut.addFinal(2)
+
+        self.assertEqual(NFA.getCacheSize(), 0)
+        aut.minimize()
+        self.assertEqual(NFA.getCacheSize(), 1)
+        aut.minimize()
+        self.assertEqual(NFA.getCacheSize(), 1)
+
+        NFA.clearCache()
+        self.assertEqual(NFA.getCacheSize(), 0)
+        NFA.setCacheCapacity(0)
+
+    def test_stats(self):
+        """Testing statistics of operations."""
+        aut = NFA()
+        aut.addInitial(1)
+        aut.addTransition(1, "a", 1)
+        aut.addTransition(1, "a", 2)
+        aut.addFinal(2)
+
+        NFA.resetStats()
+        aut.determinize()
+        stats = NFA.getStats()
+        self.assertIn('macrostates', stats)
+        self.assertIn('time of determinize', stats)
+        if NFA.statsEnabled():
+            self.assertEqual(stats['runs of determinize'], 1)
+            self.assertEqual(stats['macrostates'], 2)
+        else:
+            self.assertTrue(all(value == 0 for value in stats.values()))
+
+    def test_binary(self):
+        """Testing saving and loading of binary files."""
+        import os
+        import tempfile
+
+        aut1 = NFA()
+        aut1.addInitial(1)
+        aut1.addTransition(1, "a", 2)
+        aut1.addTransition(2, "b", 2)
+        aut1.addFinal(2)
+
+        fd, filename = tempfile.mkstemp(suffix=".vtfb")
+        os.close(fd)
+        try:
+            aut1.saveBinary(filename)
+            aut2 = NFA.loadBinary(filename)
+        finally:
+            os.remove(filename)
+
+        self.assertEqual(aut2.getInitial(), {1})
+        self.assertEqual(aut2.getFinal(), {2})
+        self.assertEqual(aut2.getTransitions(), {(1, "a", 2), (2, "b", 2)})
+
+        with self.assertRaises(Exception):
+            NFA.loadBinary(filename)
+
 
 ###########################################
 if __name__ == '__main__':
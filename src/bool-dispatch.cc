@@ -16,16 +16,6 @@ namespace
 	{ // {{{
 		DEBUG_PRINT("calling function \"" + func_name + "\" for " + Vata2::TYPE_BOOL);
 
-		if ("delete" == func_name) {
-			assert(func_args.size() == 1);
-			const VMValue& arg1 = func_args[0];
-			assert(Vata2::TYPE_BOOL == arg1.type);
-			const bool* bl = static_cast<const bool*>(arg1.get_ptr());
-			assert(nullptr != bl);
-			delete bl;
-			return VMValue(Vata2::TYPE_VOID, nullptr);
-		}
-
 		// we use throw to return result from test_and_call
 		try {
 
@@ -0,0 +1,275 @@
+/* code.cc -- compilation of VATA@CODE into instructions of the VM
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <unordered_map>
+
+// VATA headers
+#include <vata2/code.hh>
+
+using namespace Vata2::Code;
+
+const uint32_t Call::FROM_STACK;
+
+
+namespace
+{
+
+/// an item on the stack of the interpreter at compile time
+struct Item
+{ // {{{
+	/// a token (a name of a function or a variable, '(', or '='); otherwise,
+	/// the item is a value computed at run time
+	bool is_token;
+	/// the text of the token or the code computing the value
+	std::string text;
+}; // Item }}}
+
+
+/// compiles lines of code, interning strings and names
+class Compiler
+{ // {{{
+private:
+
+	Program prog = {};
+
+	std::unordered_map<std::string, uint32_t> var_ids = {};
+	std::unordered_map<std::string, uint32_t> func_ids = {};
+
+	static uint32_t intern(
+		const std::string&                          name,
+		std::vector<std::string>*                   names,
+		std::unordered_map<std::string, uint32_t>*  ids)
+	{ // {{{
+		auto it_insert_pair = ids->insert({name, names->size()});
+		if (it_insert_pair.second) { names->push_back(name); }
+		return it_insert_pair.first->second;
+	} // intern }}}
+
+	void emit(OpCode op, uint32_t arg)
+	{ // {{{
+		this->prog.instrs.push_back({op, arg});
+	} // emit }}}
+
+	void emit_string(OpCode op, const std::string& str)
+	{ // {{{
+		this->emit(op, this->prog.strings.size());
+		this->prog.strings.push_back(str);
+	} // emit_string }}}
+
+	static std::string join(const std::vector<Item>& items, const std::string& sep)
+	{ // {{{
+		std::string result;
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			if (0 != i) { result += sep; }
+			result += items[i].text;
+		}
+
+		return result;
+	} // join }}}
+
+	/// compiles the call of @p exec[0] on @p exec[1..]; returns false on error
+	bool compile_call(const std::vector<Item>& exec)
+	{ // {{{
+		if (exec.empty())
+		{
+			this->emit_string(OpCode::ERROR, "\"()\" is not a valid function call");
+			return false;
+		}
+
+		if (!exec[0].is_token)
+		{
+			this->emit_string(OpCode::ERROR, "\"(" + join(exec, ", ") +
+				")\" is not a valid function call");
+			return false;
+		}
+
+		if (exec.size() <= 1)
+		{
+			this->emit_string(OpCode::ERROR, "\"(" + exec[0].text +
+				")\" is not a valid function call");
+			return false;
+		}
+
+		Call call;
+		call.func = intern(exec[0].text, &this->prog.funcs, &this->func_ids);
+		for (size_t i = 1; i < exec.size(); ++i)
+		{
+			if (exec[i].is_token)
+			{ // tokens in arguments are names of variables
+				call.args.push_back(intern(exec[i].text, &this->prog.vars, &this->var_ids));
+			}
+			else
+			{
+				call.args.push_back(Call::FROM_STACK);
+				++call.num_stack;
+			}
+		}
+
+		this->prog.max_args = std::max(this->prog.max_args, call.args.size());
+		this->emit(OpCode::CALL, this->prog.calls.size());
+		this->prog.calls.push_back(std::move(call));
+		return true;
+	} // compile_call }}}
+
+	/// compiles what is done with the stack @p stack at the end of a line
+	void compile_end_of_line(const std::vector<Item>& stack)
+	{ // {{{
+		if (stack.empty()) { return; }
+
+		if (1 == stack.size())
+		{ // dead return value
+			if (stack[0].is_token) { this->emit_string(OpCode::PUSH_TOKEN, stack[0].text); }
+			this->emit(OpCode::DISCARD, 0);
+			return;
+		}
+
+		if (3 == stack.size())
+		{ // assignment
+			const Item& var = stack[0];
+			const Item& asgn = stack[1];
+			const Item& val = stack[2];
+			if (!asgn.is_token || "=" != asgn.text)
+			{
+				this->emit_string(OpCode::ERROR, "dangling code or invalid token: " +
+					asgn.text + " (expecting '=')");
+				return;
+			}
+
+			if (!var.is_token)
+			{
+				this->emit_string(OpCode::ERROR, "dangling code or invalid token: " +
+					var.text + " (expecting a variable)");
+				return;
+			}
+
+			if (val.is_token) { this->emit_string(OpCode::PUSH_TOKEN, val.text); }
+			this->emit(OpCode::STORE, intern(var.text, &this->prog.vars, &this->var_ids));
+			return;
+		}
+
+		this->emit_string(OpCode::ERROR, "dangling code in a CODE section: [" +
+			join(stack, ", ") + "]");
+	} // compile_end_of_line }}}
+
+public:
+
+	Compiler() { }
+
+	/// compiles @p line, simulating the stack of the interpreter
+	void compile_line(const Vata2::Parser::BodyLine& line)
+	{ // {{{
+		std::vector<Item> stack;
+		for (const std::string& tok : line)
+		{
+			if (")" != tok)
+			{
+				if (('\"' == tok[0]) && ('\"' == tok[tok.length()-1]))
+				{ // for strings
+					this->emit_string(OpCode::PUSH_STR, std::string(tok, 1, tok.length()-2));
+					stack.push_back({false, tok});
+				}
+				else
+				{ // for tokens
+					stack.push_back({true, tok});
+				}
+
+				continue;
+			}
+
+			// closing parenthesis - collect the call
+			std::vector<Item> exec;
+			bool closed = false;
+			while (!stack.empty())
+			{
+				Item item = std::move(stack.back());
+				stack.pop_back();
+				if (item.is_token && "(" == item.text)
+				{
+					closed = true;
+					break;
+				}
+
+				exec.insert(exec.begin(), std::move(item));
+			}
+
+			if (!closed)
+			{
+				this->emit_string(OpCode::ERROR, "mismatched parenthesis");
+				return;
+			}
+
+			if (!this->compile_call(exec)) { return; }
+
+			stack.push_back({false, "(" + join(exec, " ") + ")"});
+		}
+
+		this->compile_end_of_line(stack);
+	} // compile_line }}}
+
+	Program get_program() { return std::move(this->prog); }
+}; // Compiler }}}
+
+} // anonymous namespace
+
+
+Program Vata2::Code::compile(const Vata2::Parser::ParsedSection& parsec)
+{ // {{{
+	Compiler compiler;
+	for (const auto& line : parsec.body)
+	{
+		compiler.compile_line(line);
+	}
+
+	return compiler.get_program();
+} // compile }}}
+
+
+std::ostream& Vata2::Code::operator<<(std::ostream& os, const Program& prog)
+{ // {{{
+	for (const Instr& instr : prog.instrs)
+	{
+		switch (instr.op)
+		{
+			case OpCode::PUSH_STR:
+				os << "PUSH_STR \"" << prog.strings[instr.arg] << "\"\n"; break;
+			case OpCode::PUSH_TOKEN:
+				os << "PUSH_TOKEN " << prog.strings[instr.arg] << "\n"; break;
+			case OpCode::CALL:
+			{
+				const Call& call = prog.calls[instr.arg];
+				os << "CALL " << prog.funcs[call.func];
+				for (uint32_t arg : call.args)
+				{
+					if (Call::FROM_STACK == arg) { os << " _"; }
+					else { os << " " << prog.vars[arg]; }
+				}
+				os << "\n";
+				break;
+			}
+			case OpCode::STORE:
+				os << "STORE " << prog.vars[instr.arg] << "\n"; break;
+			case OpCode::DISCARD:
+				os << "DISCARD\n"; break;
+			case OpCode::ERROR:
+				os << "ERROR " << prog.strings[instr.arg] << "\n"; break;
+		}
+	}
+
+	return os;
+} // operator<<(Program) }}}
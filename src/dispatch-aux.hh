@@ -44,18 +44,20 @@ const T& unpack_type(
 	return *static_cast<const T*>(val.get_ptr());
 } // unpack_type }}}
 
+// the arguments are references to the objects of the values (which are thus
+// not copied)
 template <class T>
-std::tuple<T> construct_args(
+std::tuple<const T&> construct_args(
 	const Vata2::metaprog::tuple_of<1, std::string>&         type_names,
 	const Vata2::metaprog::tuple_of<1, Vata2::VM::VMValue>&  vals)
 {
 	const T& v = unpack_type<T>(std::get<0>(type_names), std::get<0>(vals));
-	std::tuple<T> res = { v };
+	std::tuple<const T&> res(v);
 	return res;
 }
 
 template <class T, class... Ts>
-std::tuple<T, Ts...> construct_args(
+std::tuple<const T&, const Ts&...> construct_args(
 	const Vata2::metaprog::tuple_of<sizeof...(Ts) + 1, std::string>&         type_names,
 	const Vata2::metaprog::tuple_of<sizeof...(Ts) + 1, Vata2::VM::VMValue>&  vals)
 {
@@ -65,10 +67,10 @@ std::tuple<T, Ts...> construct_args(
 	tie(std::ignore, type_names_tail) = type_names;
 	tie(std::ignore, vals_tail) = vals;
 
-	std::tuple<T> res_head = construct_args<T>(
+	std::tuple<const T&> res_head = construct_args<T>(
 		std::make_tuple(std::get<0>(type_names)),
 		std::make_tuple(std::get<0>(vals)));
-	std::tuple<Ts...> res_tail = construct_args<Ts...>(type_names_tail, vals_tail);
+	std::tuple<const Ts&...> res_tail = construct_args<Ts...>(type_names_tail, vals_tail);
 
 	return std::tuple_cat(res_head, res_tail);
 }
@@ -118,7 +120,7 @@ void test_and_call(
 	// a local substitute for std::apply from C++17
 	Vata2::VM::VMPointer f_res = Vata2::metaprog::apply(f, f_args);
 
-	Vata2::VM::VMValue result{result_type_name, f_res};
+	Vata2::VM::VMValue result{result_type_name, std::move(f_res)};
 	throw result;
 }
 
@@ -0,0 +1,616 @@
+/* nfa-binary.cc -- compact binary format of NFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+// VATA headers
+#include <vata2/nfa-binary.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+using Vata2::Parser::MappedFile;
+
+
+namespace
+{
+
+/// indices of counts at the beginning of the NFA data
+enum CountIndex : size_t
+{
+	CNT_STATES = 0,
+	CNT_INITIAL,
+	CNT_FINAL,
+	CNT_TRANS,
+	CNT_STATE_NAMES,
+	CNT_SYMBOL_NAMES,
+	CNT_NAMES_SIZE,
+	CNT_RESERVED,
+	CNT_SIZE
+};
+
+/// the upper bound on counts; guards computations of offsets from overflows
+const uint64_t MAX_COUNT = static_cast<uint64_t>(1) << 48;
+
+
+/// rounds @p offset up to a multiple of 8
+size_t align8(size_t offset)
+{ // {{{
+	return (offset + 7) & ~static_cast<size_t>(7);
+} // align8 }}}
+
+
+/// offsets of the arrays in a file (see save_binary())
+struct Layout
+{ // {{{
+	size_t states;
+	size_t initial;
+	size_t final;
+	size_t row_ptr;
+	size_t symbols;
+	size_t targets;
+	size_t state_name_keys;
+	size_t state_name_offs;
+	size_t symbol_name_keys;
+	size_t symbol_name_offs;
+	size_t names;
+	size_t end;
+
+	explicit Layout(const uint64_t* counts) :
+		states(align8(sizeof(Vata2::Binary::Header) + CNT_SIZE * sizeof(uint64_t))),
+		initial(align8(states + counts[CNT_STATES] * sizeof(uint64_t))),
+		final(align8(initial + counts[CNT_INITIAL] * sizeof(uint32_t))),
+		row_ptr(align8(final + counts[CNT_FINAL] * sizeof(uint32_t))),
+		symbols(align8(row_ptr + (counts[CNT_STATES] + 1) * sizeof(uint64_t))),
+		targets(align8(symbols + counts[CNT_TRANS] * sizeof(uint64_t))),
+		state_name_keys(align8(targets + counts[CNT_TRANS] * sizeof(uint32_t))),
+		state_name_offs(align8(state_name_keys +
+			counts[CNT_STATE_NAMES] * sizeof(uint32_t))),
+		symbol_name_keys(align8(state_name_offs +
+			(counts[CNT_STATE_NAMES] + 1) * sizeof(uint64_t))),
+		symbol_name_offs(align8(symbol_name_keys +
+			counts[CNT_SYMBOL_NAMES] * sizeof(uint64_t))),
+		names(align8(symbol_name_offs +
+			(counts[CNT_SYMBOL_NAMES] + 1) * sizeof(uint64_t))),
+		end(align8(names + counts[CNT_NAMES_SIZE]))
+	{ }
+}; // Layout }}}
+
+
+/// checks the counts at @p counts; throws std::runtime_error if they are invalid
+void check_counts(const uint64_t* counts)
+{ // {{{
+	for (size_t i = 0; i < CNT_SIZE; ++i)
+	{
+		if (counts[i] > MAX_COUNT)
+		{
+			throw std::runtime_error(std::to_string(__func__) +
+				": corrupted binary NFA (count " + std::to_string(counts[i]) +
+				" out of range)");
+		}
+	}
+
+	if (counts[CNT_STATES] > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::runtime_error(std::to_string(__func__) +
+			": corrupted binary NFA (too many states)");
+	}
+} // check_counts }}}
+
+
+/// the size of the file up to (and including) the counts
+const size_t COUNTS_END = sizeof(Vata2::Binary::Header) + CNT_SIZE * sizeof(uint64_t);
+
+
+/// the number of bytes read from a stream at once when its length is unknown
+const size_t READ_CHUNK = 1 << 20;
+
+
+/**
+ * returns the number of bytes left in @p is, or the maximum of size_t if the
+ * stream cannot seek (e.g., a pipe)
+ */
+size_t remaining_size(std::istream& is)
+{ // {{{
+	std::streampos pos = is.tellg();
+	if (std::streampos(-1) == pos) { is.clear(); return SIZE_MAX; }
+
+	is.seekg(0, std::ios::end);
+	std::streampos end = is.tellg();
+	is.seekg(pos);
+	if (std::streampos(-1) == end || !is) { is.clear(); return SIZE_MAX; }
+
+	return static_cast<size_t>(end - pos);
+} // remaining_size }}}
+
+
+/// writes @p vec to @p os and pads it to a multiple of 8 bytes
+template <class T>
+void write_array(std::ostream& os, const std::vector<T>& vec)
+{ // {{{
+	static const char padding[8] = { };
+
+	size_t size = vec.size() * sizeof(T);
+	os.write(reinterpret_cast<const char*>(vec.data()), size);
+	os.write(padding, align8(size) - size);
+} // write_array }}}
+
+
+/// throws an exception about a corrupted file if @p cond does not hold
+void check(bool cond, const char* what)
+{ // {{{
+	if (!cond)
+	{
+		throw std::runtime_error(std::string("BinaryNfa: corrupted binary NFA (") +
+			what + ")");
+	}
+} // check }}}
+
+} // anonymous namespace
+
+
+void Vata2::Nfa::save_binary(
+	const Nfa&                aut,
+	std::ostream&             os,
+	const StateToStringMap*   state_map,
+	const SymbolToStringMap*  symbol_map)
+{ // {{{
+	std::set<State> state_set = aut.initialstates;
+	state_set.insert(aut.finalstates.begin(), aut.finalstates.end());
+	for (auto tr : aut)
+	{
+		state_set.insert(tr.src);
+		state_set.insert(tr.tgt);
+	}
+
+	if (state_set.size() > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::runtime_error(std::to_string(__func__) + ": too many states");
+	}
+
+	std::vector<uint64_t> states(state_set.begin(), state_set.end());
+	std::unordered_map<State, uint32_t> index;
+	for (size_t i = 0; i < states.size(); ++i) { index[states[i]] = i; }
+
+	std::vector<uint32_t> initial;
+	for (State st : aut.initialstates) { initial.push_back(index[st]); }
+	std::vector<uint32_t> final;
+	for (State st : aut.finalstates) { final.push_back(index[st]); }
+
+	std::vector<uint64_t> row_ptr = {0};
+	std::vector<uint64_t> symbols;
+	std::vector<uint32_t> targets;
+	std::set<Symbol> used_symbols;
+	std::vector<std::pair<Symbol, uint32_t>> row;
+	for (State st : states)
+	{
+		row.clear();
+		for (const auto& symb_tgts : aut[st])
+		{
+			used_symbols.insert(symb_tgts.first);
+			for (State tgt : symb_tgts.second)
+			{
+				row.push_back({symb_tgts.first, index[tgt]});
+			}
+		}
+
+		std::sort(row.begin(), row.end());
+		for (const auto& symb_tgt : row)
+		{
+			symbols.push_back(symb_tgt.first);
+			targets.push_back(symb_tgt.second);
+		}
+
+		row_ptr.push_back(symbols.size());
+	}
+
+	std::string names;
+	std::vector<uint32_t> state_name_keys;
+	std::vector<uint64_t> state_name_offs = {0};
+	if (nullptr != state_map)
+	{
+		for (size_t i = 0; i < states.size(); ++i)
+		{
+			auto it = state_map->find(states[i]);
+			if (state_map->end() != it)
+			{
+				state_name_keys.push_back(i);
+				names += it->second;
+				state_name_offs.push_back(names.size());
+			}
+		}
+	}
+
+	std::vector<uint64_t> symbol_name_keys;
+	std::vector<uint64_t> symbol_name_offs = {names.size()};
+	if (nullptr != symbol_map)
+	{
+		for (Symbol symb : used_symbols)
+		{
+			auto it = symbol_map->find(symb);
+			if (symbol_map->end() != it)
+			{
+				symbol_name_keys.push_back(symb);
+				names += it->second;
+				symbol_name_offs.push_back(names.size());
+			}
+		}
+	}
+
+	std::vector<uint64_t> counts(CNT_SIZE);
+	counts[CNT_STATES] = states.size();
+	counts[CNT_INITIAL] = initial.size();
+	counts[CNT_FINAL] = final.size();
+	counts[CNT_TRANS] = symbols.size();
+	counts[CNT_STATE_NAMES] = state_name_keys.size();
+	counts[CNT_SYMBOL_NAMES] = symbol_name_keys.size();
+	counts[CNT_NAMES_SIZE] = names.size();
+
+	Vata2::Binary::Header header = Vata2::Binary::make_header(TYPE_NFA);
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	write_array(os, counts);
+	write_array(os, states);
+	write_array(os, initial);
+	write_array(os, final);
+	write_array(os, row_ptr);
+	write_array(os, symbols);
+	write_array(os, targets);
+	write_array(os, state_name_keys);
+	write_array(os, state_name_offs);
+	write_array(os, symbol_name_keys);
+	write_array(os, symbol_name_offs);
+	write_array(os, std::vector<char>(names.begin(), names.end()));
+
+	if (!os)
+	{
+		throw std::runtime_error(std::to_string(__func__) + ": write failed");
+	}
+} // save_binary }}}
+
+
+void Vata2::Nfa::load_binary(
+	Nfa*                aut,
+	std::istream&       is,
+	StateToStringMap*   state_map,
+	SymbolToStringMap*  symbol_map)
+{ // {{{
+	assert(nullptr != aut);
+
+	// the buffer of 64-bit words keeps the arrays aligned
+	std::vector<uint64_t> buf(COUNTS_END / sizeof(uint64_t));
+	char* data = reinterpret_cast<char*>(buf.data());
+	is.read(data, COUNTS_END);
+	Vata2::Binary::read_header(data, is.gcount());
+	if (static_cast<size_t>(is.gcount()) != COUNTS_END)
+	{
+		throw std::runtime_error(std::to_string(__func__) + ": truncated binary NFA");
+	}
+
+	const uint64_t* counts = buf.data() + sizeof(Vata2::Binary::Header) / sizeof(uint64_t);
+	check_counts(counts);
+	size_t size = Layout(counts).end;
+
+	// the counts are not trusted with the allocation: the buffer grows only as
+	// data arrives, and a stream that is known to be short fails right away
+	if (size - COUNTS_END > remaining_size(is))
+	{
+		throw std::runtime_error(std::to_string(__func__) + ": truncated binary NFA");
+	}
+
+	size_t read = COUNTS_END;
+	while (read < size)
+	{
+		size_t chunk = std::min(size - read, READ_CHUNK);
+		buf.resize((read + chunk) / sizeof(uint64_t));
+		is.read(reinterpret_cast<char*>(buf.data()) + read, chunk);
+		if (static_cast<size_t>(is.gcount()) != chunk)
+		{
+			throw std::runtime_error(std::to_string(__func__) + ": truncated binary NFA");
+		}
+
+		read += chunk;
+	}
+	data = reinterpret_cast<char*>(buf.data());
+
+	BinaryNfa view(data, size);
+	view.to_nfa(aut, state_map, symbol_map);
+} // load_binary }}}
+
+
+BinaryNfa::BinaryNfa(const std::string& filename) :
+	file(new MappedFile(filename)),
+	cnt_states(),
+	cnt_initial(),
+	cnt_final(),
+	cnt_trans(),
+	cnt_state_names(),
+	cnt_symbol_names(),
+	states(),
+	initial_idx(),
+	final_idx(),
+	row_ptr(),
+	symbols(),
+	targets(),
+	state_name_keys(),
+	state_name_offs(),
+	symbol_name_keys(),
+	symbol_name_offs(),
+	names()
+{ // {{{
+	this->init(this->file->data(), this->file->size());
+} // BinaryNfa(std::string) }}}
+
+
+BinaryNfa::BinaryNfa(const char* data, size_t size) :
+	file(),
+	cnt_states(),
+	cnt_initial(),
+	cnt_final(),
+	cnt_trans(),
+	cnt_state_names(),
+	cnt_symbol_names(),
+	states(),
+	initial_idx(),
+	final_idx(),
+	row_ptr(),
+	symbols(),
+	targets(),
+	state_name_keys(),
+	state_name_offs(),
+	symbol_name_keys(),
+	symbol_name_offs(),
+	names()
+{ // {{{
+	this->init(data, size);
+} // BinaryNfa(const char*) }}}
+
+
+void BinaryNfa::init(const char* data, size_t size)
+{ // {{{
+	check(0 == reinterpret_cast<uintptr_t>(data) % sizeof(uint64_t),
+		"data not aligned");
+
+	std::string type = Vata2::Binary::read_header(data, size);
+	if (TYPE_NFA != type)
+	{
+		throw std::runtime_error("BinaryNfa: the file contains " + type +
+			" instead of " + TYPE_NFA);
+	}
+
+	check(size >= COUNTS_END, "truncated");
+	const uint64_t* counts =
+		reinterpret_cast<const uint64_t*>(data + sizeof(Vata2::Binary::Header));
+	check_counts(counts);
+	Layout layout(counts);
+	check(layout.end == size, "unexpected size");
+
+	this->cnt_states = counts[CNT_STATES];
+	this->cnt_initial = counts[CNT_INITIAL];
+	this->cnt_final = counts[CNT_FINAL];
+	this->cnt_trans = counts[CNT_TRANS];
+	this->cnt_state_names = counts[CNT_STATE_NAMES];
+	this->cnt_symbol_names = counts[CNT_SYMBOL_NAMES];
+	uint64_t names_size = counts[CNT_NAMES_SIZE];
+
+	this->states = reinterpret_cast<const uint64_t*>(data + layout.states);
+	this->initial_idx = reinterpret_cast<const uint32_t*>(data + layout.initial);
+	this->final_idx = reinterpret_cast<const uint32_t*>(data + layout.final);
+	this->row_ptr = reinterpret_cast<const uint64_t*>(data + layout.row_ptr);
+	this->symbols = reinterpret_cast<const uint64_t*>(data + layout.symbols);
+	this->targets = reinterpret_cast<const uint32_t*>(data + layout.targets);
+	this->state_name_keys =
+		reinterpret_cast<const uint32_t*>(data + layout.state_name_keys);
+	this->state_name_offs =
+		reinterpret_cast<const uint64_t*>(data + layout.state_name_offs);
+	this->symbol_name_keys =
+		reinterpret_cast<const uint64_t*>(data + layout.symbol_name_keys);
+	this->symbol_name_offs =
+		reinterpret_cast<const uint64_t*>(data + layout.symbol_name_offs);
+	this->names = data + layout.names;
+
+	// validate everything that queries rely on
+	for (size_t i = 1; i < this->cnt_states; ++i)
+	{
+		check(this->states[i - 1] < this->states[i], "states not sorted");
+	}
+
+	// has_initial() and has_final() search the indices by bisection
+	for (size_t i = 0; i < this->cnt_initial; ++i)
+	{
+		check(this->initial_idx[i] < this->cnt_states, "invalid initial state");
+		check(0 == i || this->initial_idx[i - 1] < this->initial_idx[i],
+			"initial states not sorted");
+	}
+
+	for (size_t i = 0; i < this->cnt_final; ++i)
+	{
+		check(this->final_idx[i] < this->cnt_states, "invalid final state");
+		check(0 == i || this->final_idx[i - 1] < this->final_idx[i],
+			"final states not sorted");
+	}
+
+	check(0 == this->row_ptr[0], "invalid transitions");
+	for (size_t i = 0; i < this->cnt_states; ++i)
+	{
+		check(this->row_ptr[i] <= this->row_ptr[i + 1], "invalid transitions");
+		for (uint64_t j = this->row_ptr[i] + 1; j < this->row_ptr[i + 1]; ++j)
+		{
+			check(this->symbols[j - 1] <= this->symbols[j], "transitions not sorted");
+		}
+	}
+	check(this->cnt_trans == this->row_ptr[this->cnt_states], "invalid transitions");
+
+	for (size_t i = 0; i < this->cnt_trans; ++i)
+	{
+		check(this->targets[i] < this->cnt_states, "invalid target state");
+	}
+
+	for (size_t i = 0; i < this->cnt_state_names; ++i)
+	{
+		check(this->state_name_keys[i] < this->cnt_states, "invalid state name");
+	}
+
+	for (const uint64_t* offs : {this->state_name_offs, this->symbol_name_offs})
+	{
+		size_t cnt = (offs == this->state_name_offs)?
+			this->cnt_state_names : this->cnt_symbol_names;
+		for (size_t i = 0; i < cnt; ++i)
+		{
+			check(offs[i] <= offs[i + 1], "invalid names");
+		}
+		check(offs[cnt] <= names_size, "invalid names");
+	}
+} // init }}}
+
+
+uint64_t BinaryNfa::index_of(State state) const
+{ // {{{
+	const uint64_t* end = this->states + this->cnt_states;
+	const uint64_t* it = std::lower_bound(this->states, end, state);
+	return (end != it && *it == state)? it - this->states : this->cnt_states;
+} // index_of }}}
+
+
+bool BinaryNfa::has_initial(State state) const
+{ // {{{
+	uint64_t idx = this->index_of(state);
+	const uint32_t* end = this->initial_idx + this->cnt_initial;
+	return std::binary_search(this->initial_idx, end, idx);
+} // has_initial }}}
+
+
+bool BinaryNfa::has_final(State state) const
+{ // {{{
+	uint64_t idx = this->index_of(state);
+	const uint32_t* end = this->final_idx + this->cnt_final;
+	return std::binary_search(this->final_idx, end, idx);
+} // has_final }}}
+
+
+StateSet BinaryNfa::get_initial() const
+{ // {{{
+	StateSet result;
+	for (size_t i = 0; i < this->cnt_initial; ++i)
+	{
+		result.insert(this->states[this->initial_idx[i]]);
+	}
+
+	return result;
+} // get_initial }}}
+
+
+StateSet BinaryNfa::get_final() const
+{ // {{{
+	StateSet result;
+	for (size_t i = 0; i < this->cnt_final; ++i)
+	{
+		result.insert(this->states[this->final_idx[i]]);
+	}
+
+	return result;
+} // get_final }}}
+
+
+StateSet BinaryNfa::post(State state, Symbol symb) const
+{ // {{{
+	StateSet result;
+	uint64_t idx = this->index_of(state);
+	if (idx == this->cnt_states) { return result; }
+
+	auto range = std::equal_range(this->symbols + this->row_ptr[idx],
+		this->symbols + this->row_ptr[idx + 1], symb);
+	for (const uint64_t* it = range.first; it != range.second; ++it)
+	{
+		result.insert(this->states[this->targets[it - this->symbols]]);
+	}
+
+	return result;
+} // post(State) }}}
+
+
+StateSet BinaryNfa::post(const StateSet& macrostate, Symbol symb) const
+{ // {{{
+	StateSet result;
+	for (State st : macrostate)
+	{
+		StateSet post_st = this->post(st, symb);
+		result.insert(post_st.begin(), post_st.end());
+	}
+
+	return result;
+} // post(StateSet) }}}
+
+
+StateToStringMap BinaryNfa::get_state_names() const
+{ // {{{
+	StateToStringMap result;
+	for (size_t i = 0; i < this->cnt_state_names; ++i)
+	{
+		result[this->states[this->state_name_keys[i]]] = std::string(
+			this->names + this->state_name_offs[i],
+			this->state_name_offs[i + 1] - this->state_name_offs[i]);
+	}
+
+	return result;
+} // get_state_names }}}
+
+
+SymbolToStringMap BinaryNfa::get_symbol_names() const
+{ // {{{
+	SymbolToStringMap result;
+	for (size_t i = 0; i < this->cnt_symbol_names; ++i)
+	{
+		result[this->symbol_name_keys[i]] = std::string(
+			this->names + this->symbol_name_offs[i],
+			this->symbol_name_offs[i + 1] - this->symbol_name_offs[i]);
+	}
+
+	return result;
+} // get_symbol_names }}}
+
+
+void BinaryNfa::to_nfa(
+	Nfa*                aut,
+	StateToStringMap*   state_map,
+	SymbolToStringMap*  symbol_map) const
+{ // {{{
+	assert(nullptr != aut);
+
+	for (size_t i = 0; i < this->cnt_initial; ++i)
+	{
+		aut->add_initial(this->states[this->initial_idx[i]]);
+	}
+
+	for (size_t i = 0; i < this->cnt_final; ++i)
+	{
+		aut->add_final(this->states[this->final_idx[i]]);
+	}
+
+	for (size_t i = 0; i < this->cnt_states; ++i)
+	{
+		for (uint64_t j = this->row_ptr[i]; j < this->row_ptr[i + 1]; ++j)
+		{
+			aut->add_trans(this->states[i], this->symbols[j],
+				this->states[this->targets[j]]);
+		}
+	}
+
+	if (nullptr != state_map) { *state_map = this->get_state_names(); }
+	if (nullptr != symbol_map) { *symbol_map = this->get_symbol_names(); }
+} // to_nfa }}}
@@ -0,0 +1,334 @@
+/* nfa-cache.cc -- cache of results of operations on NFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// VATA headers
+#include <vata2/nfa-cache.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+using LockGuard = std::lock_guard<std::mutex>;
+
+namespace { // anonymous namespace
+
+/// hashes the key of an entry
+size_t hash_key(
+	const std::string&              op,
+	const std::vector<const Nfa*>&  args,
+	const std::vector<Symbol>&      symbols,
+	const StringDict&               params)
+{ // {{{
+	size_t accum = std::hash<std::string>{}(op);
+	for (const Nfa* aut : args)
+	{
+		assert(nullptr != aut);
+		accum = hash_combine(accum, *aut);
+	}
+
+	accum = hash_combine(accum, hash_range(symbols.begin(), symbols.end()));
+
+	// the order of iteration over StringDict is unspecified
+	size_t params_hash = 0;
+	for (const auto& key_val_pair : params)
+	{
+		params_hash ^= hash_combine(
+			std::hash<std::string>{}(key_val_pair.first), key_val_pair.second);
+	}
+
+	return hash_combine(accum, params_hash);
+} // hash_key }}}
+
+
+/**
+ * Obtains sorted symbols of an alphabet.  Alphabets that cannot enumerate their
+ * symbols give an empty vector; no operation depending on the symbols can be
+ * run with them, so their results do not depend on the alphabet.
+ */
+std::vector<Symbol> get_alphabet_key(const Alphabet& alphabet)
+{ // {{{
+	std::vector<Symbol> result;
+	try
+	{
+		alphabet.for_each_symbol([&result](Symbol symb) { result.push_back(symb); });
+	}
+	catch (const std::runtime_error&)
+	{ // the alphabet cannot enumerate its symbols
+		return result;
+	}
+
+	std::sort(result.begin(), result.end());
+	return result;
+} // get_alphabet_key }}}
+
+
+/**
+ * Runs @p compute unless the result is in the global cache (when the cache is
+ * enabled); stores the computed result into the cache.  The symbols of
+ * @p alphabet (nullptr for operations without an alphabet) are a part of the
+ * key, which is built only when the cache is enabled.
+ */
+template <class Func>
+CachedResult cached_call(
+	const std::string&              op,
+	const std::vector<const Nfa*>&  args,
+	const Alphabet*                 alphabet,
+	const StringDict&               params,
+	Func                            compute)
+{ // {{{
+	OpCache& cache = OpCache::global();
+	CachedResult result;
+	if (!cache.enabled())
+	{
+		compute(&result);
+		return result;
+	}
+
+	std::vector<Symbol> symbols;
+	if (nullptr != alphabet) { symbols = get_alphabet_key(*alphabet); }
+
+	if (cache.lookup(op, args, symbols, params, &result)) { return result; }
+
+	compute(&result);
+	cache.store(op, args, symbols, params, result);
+	return result;
+} // cached_call }}}
+
+} // namespace
+
+
+OpCache& OpCache::global()
+{ // {{{
+	static OpCache cache;
+	return cache;
+} // global }}}
+
+
+void OpCache::set_capacity(size_t capacity)
+{ // {{{
+	LockGuard lock(this->mtx);
+	this->max_size = capacity;
+	this->evict();
+} // set_capacity }}}
+
+
+size_t OpCache::capacity() const
+{ // {{{
+	LockGuard lock(this->mtx);
+	return this->max_size;
+} // capacity }}}
+
+
+size_t OpCache::size() const
+{ // {{{
+	LockGuard lock(this->mtx);
+	return this->entries.size();
+} // size }}}
+
+
+size_t OpCache::get_hits() const
+{ // {{{
+	LockGuard lock(this->mtx);
+	return this->hits;
+} // get_hits }}}
+
+
+size_t OpCache::get_misses() const
+{ // {{{
+	LockGuard lock(this->mtx);
+	return this->misses;
+} // get_misses }}}
+
+
+void OpCache::clear()
+{ // {{{
+	LockGuard lock(this->mtx);
+	this->entries.clear();
+	this->index.clear();
+	this->hits = 0;
+	this->misses = 0;
+} // clear }}}
+
+
+void OpCache::evict()
+{ // {{{
+	while (this->entries.size() > this->max_size)
+	{
+		const Entry& entry = this->entries.back();
+		auto range = this->index.equal_range(entry.key_hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (&*it->second == &entry)
+			{
+				this->index.erase(it);
+				break;
+			}
+		}
+
+		this->entries.pop_back();
+	}
+} // evict }}}
+
+
+OpCache::EntryList::iterator OpCache::find(
+	const std::string&              op,
+	const std::vector<const Nfa*>&  args,
+	const std::vector<Symbol>&      symbols,
+	const StringDict&               params,
+	size_t                          key_hash)
+{ // {{{
+	auto range = this->index.equal_range(key_hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		const Entry& entry = *it->second;
+		if (entry.op != op || entry.symbols != symbols || entry.params != params ||
+			entry.args.size() != args.size())
+		{
+			continue;
+		}
+
+		bool args_equal = true;
+		for (size_t i = 0; i < args.size() && args_equal; ++i)
+		{
+			args_equal = (entry.args[i] == *args[i]);
+		}
+
+		if (args_equal) { return it->second; }
+	}
+
+	return this->entries.end();
+} // find }}}
+
+
+bool OpCache::lookup(
+	const std::string&              op,
+	const std::vector<const Nfa*>&  args,
+	const std::vector<Symbol>&      symbols,
+	const StringDict&               params,
+	CachedResult*                   result)
+{ // {{{
+	assert(nullptr != result);
+
+	size_t key_hash = hash_key(op, args, symbols, params);
+
+	LockGuard lock(this->mtx);
+	auto it = this->find(op, args, symbols, params, key_hash);
+	if (this->entries.end() == it)
+	{
+		++this->misses;
+		return false;
+	}
+
+	// move the entry to the front
+	this->entries.splice(this->entries.begin(), this->entries, it);
+	++this->hits;
+	*result = it->result;
+	return true;
+} // lookup }}}
+
+
+void OpCache::store(
+	const std::string&              op,
+	const std::vector<const Nfa*>&  args,
+	const std::vector<Symbol>&      symbols,
+	const StringDict&               params,
+	const CachedResult&             result)
+{ // {{{
+	size_t key_hash = hash_key(op, args, symbols, params);
+
+	LockGuard lock(this->mtx);
+	if (0 == this->max_size) { return; }
+
+	auto it = this->find(op, args, symbols, params, key_hash);
+	if (this->entries.end() != it)
+	{ // the result might have been computed concurrently
+		this->entries.splice(this->entries.begin(), this->entries, it);
+		it->result = result;
+		return;
+	}
+
+	std::vector<Nfa> arg_copies;
+	for (const Nfa* aut : args) { arg_copies.push_back(*aut); }
+
+	this->entries.push_front({op, std::move(arg_copies), symbols, params,
+		key_hash, result});
+	this->index.insert({key_hash, this->entries.begin()});
+	this->evict();
+} // store }}}
+
+
+Nfa Vata2::Nfa::determinize_cached(const Nfa& aut)
+{ // {{{
+	CachedResult result = cached_call("determinize", {&aut}, nullptr, {},
+		[&aut](CachedResult* res) { res->aut = determinize(aut); });
+	return std::move(result.aut);
+} // determinize_cached }}}
+
+
+Nfa Vata2::Nfa::minimize_cached(const Nfa& aut, const StringDict& params)
+{ // {{{
+	CachedResult result = cached_call("minimize", {&aut}, nullptr, params,
+		[&](CachedResult* res) { res->aut = minimize(aut, params); });
+	return std::move(result.aut);
+} // minimize_cached }}}
+
+
+Nfa Vata2::Nfa::complement_cached(
+	const Nfa&         aut,
+	const Alphabet&    alphabet,
+	const StringDict&  params)
+{ // {{{
+	CachedResult result = cached_call("complement", {&aut},
+		&alphabet, params,
+		[&](CachedResult* res) { res->aut = complement(aut, alphabet, params); });
+	return std::move(result.aut);
+} // complement_cached }}}
+
+
+bool Vata2::Nfa::is_universal_cached(
+	const Nfa&         aut,
+	const Alphabet&    alphabet,
+	Word*              cex,
+	const StringDict&  params)
+{ // {{{
+	// counterexamples are always computed so that the entry can serve any call
+	CachedResult result = cached_call("is_universal", {&aut},
+		&alphabet, params,
+		[&](CachedResult* res) {
+			res->flag = is_universal(aut, alphabet, &res->cex, params);
+		});
+
+	if (!result.flag && nullptr != cex) { *cex = std::move(result.cex); }
+	return result.flag;
+} // is_universal_cached }}}
+
+
+bool Vata2::Nfa::is_incl_cached(
+	const Nfa&         smaller,
+	const Nfa&         bigger,
+	const Alphabet&    alphabet,
+	Word*              cex,
+	const StringDict&  params)
+{ // {{{
+	CachedResult result = cached_call("is_incl", {&smaller, &bigger},
+		&alphabet, params,
+		[&](CachedResult* res) {
+			res->flag = is_incl(smaller, bigger, alphabet, &res->cex, params);
+		});
+
+	if (!result.flag && nullptr != cex) { *cex = std::move(result.cex); }
+	return result.flag;
+} // is_incl_cached }}}
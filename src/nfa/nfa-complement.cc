@@ -17,6 +17,7 @@
 
 // VATA headers
 #include <vata2/nfa.hh>
+#include <vata2/stats.hh>
 
 using namespace Vata2::Nfa;
 using namespace Vata2::util;
@@ -82,6 +83,8 @@ void Vata2::Nfa::complement(
 	const StringDict&  params,
 	SubsetMap*         subset_map)
 {
+	VATA_STATS_TIMER(COMPLEMENT);
+
 	// setting the default algorithm
 	decltype(complement_classical)* algo = complement_classical;
 	if (!haskey(params, "algo")) {
@@ -0,0 +1,232 @@
+/* nfa-determinize-incr.cc -- incremental determinization of NFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <list>
+#include <unordered_set>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using std::tie;
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace { // anonymous namespace
+
+/// computes the post of a macrostate over all symbols
+PostSymb get_post_symb(const Nfa& aut, const StateSet& macrostate)
+{ // {{{
+	PostSymb post_symb;
+	for (State s : macrostate)
+	{
+		for (const auto& symb_post_pair : aut[s])
+		{
+			const StateSet& post = symb_post_pair.second;
+			post_symb[symb_post_pair.first].insert(post.begin(), post.end());
+		}
+	}
+
+	return post_symb;
+} // get_post_symb }}}
+
+
+/// the bookkeeping of one run of incremental determinization
+struct IncrContext
+{ // {{{
+	DetResult* det;
+	const Nfa& aut;
+	std::list<std::pair<const StateSet*, State>> worklist;
+	std::unordered_set<Trans> added_trans;
+	std::unordered_set<Trans> removed_trans;
+	StateSet added_states;
+	StateSet added_final;
+
+	IncrContext(DetResult* det, const Nfa& aut) :
+		det(det), aut(aut), worklist(), added_trans(), removed_trans(),
+		added_states(), added_final()
+	{ }
+
+	IncrContext(const IncrContext&) = delete;
+	IncrContext& operator=(const IncrContext&) = delete;
+
+	/// translates a macrostate into a state of the result, creating it if needed
+	State get_det_state(const StateSet& macrostate)
+	{ // {{{
+		auto it_bool_pair = det->subset_map.insert(
+			{macrostate, det->last_state_num + 1});
+		if (!it_bool_pair.second) { return it_bool_pair.first->second; }
+
+		State new_state = ++det->last_state_num;
+		worklist.push_back({&it_bool_pair.first->first, new_state});
+		added_states.insert(new_state);
+		if (!are_disjoint(macrostate, aut.finalstates))
+		{
+			det->result.finalstates.insert(new_state);
+			added_final.insert(new_state);
+		}
+
+		return new_state;
+	} // get_det_state }}}
+
+	void add_trans(const Trans& trans)
+	{ // {{{
+		det->result.add_trans(trans);
+		if (0 == removed_trans.erase(trans)) { added_trans.insert(trans); }
+	} // add_trans }}}
+
+	void remove_trans(const Trans& trans)
+	{ // {{{
+		det->result.remove_trans(trans);
+		if (0 == added_trans.erase(trans)) { removed_trans.insert(trans); }
+	} // remove_trans }}}
+}; // IncrContext }}}
+
+} // namespace
+
+
+void Vata2::Nfa::determinize_incr_init(DetResult* det, const Nfa& aut)
+{ // {{{
+	assert(nullptr != det);
+
+	det->result = Nfa();
+	det->subset_map.clear();
+	determinize(&det->result, aut, &det->subset_map, &det->last_state_num);
+} // determinize_incr_init }}}
+
+
+void Vata2::Nfa::determinize_incr(
+	DetResult*                det,
+	const Nfa&                aut,
+	const std::vector<Trans>& added,
+	const std::vector<Trans>& removed,
+	DetDelta*                 delta)
+{ // {{{
+	assert(nullptr != det);
+
+	if (nullptr != delta) { *delta = DetDelta(); }
+
+	StateSet changed_src;
+	for (const Trans& trans : added) { changed_src.insert(trans.src); }
+	for (const Trans& trans : removed) { changed_src.insert(trans.src); }
+	if (changed_src.empty()) { return; }
+
+	IncrContext ctx(det, aut);
+
+	// only macrostates containing a source of a changed transition can have a
+	// different post; start the exploration from them
+	for (const auto& macro_state_pair : det->subset_map)
+	{
+		if (!are_disjoint(macro_state_pair.first, changed_src))
+		{
+			ctx.worklist.push_back({&macro_state_pair.first, macro_state_pair.second});
+		}
+	}
+
+	bool trans_dropped = false;
+	while (!ctx.worklist.empty())
+	{
+		const StateSet* state_set;
+		State det_state;
+		tie(state_set, det_state) = ctx.worklist.front();
+		ctx.worklist.pop_front();
+		assert(nullptr != state_set);
+
+		PostSymb old_post = det->result[det_state];
+		for (const auto& symb_post_pair : get_post_symb(aut, *state_set))
+		{
+			Symbol symb = symb_post_pair.first;
+			State tgt = ctx.get_det_state(symb_post_pair.second);
+
+			auto it = old_post.find(symb);
+			if (old_post.end() != it)
+			{
+				assert(it->second.size() == 1);
+				State old_tgt = *it->second.begin();
+				old_post.erase(it);
+				if (old_tgt == tgt) { continue; }
+
+				ctx.remove_trans({det_state, symb, old_tgt});
+				trans_dropped = true;
+			}
+
+			ctx.add_trans({det_state, symb, tgt});
+		}
+
+		// symbols with no post any more
+		for (const auto& symb_post_pair : old_post)
+		{
+			for (State old_tgt : symb_post_pair.second)
+			{
+				ctx.remove_trans({det_state, symb_post_pair.first, old_tgt});
+				trans_dropped = true;
+			}
+		}
+	}
+
+	StateSet removed_states;
+	if (trans_dropped)
+	{ // some states might have become unreachable
+		std::unordered_set<State> reachable = get_fwd_reach_states(det->result);
+
+		auto it = det->subset_map.begin();
+		while (det->subset_map.end() != it)
+		{
+			State state = it->second;
+			if (haskey(reachable, state))
+			{
+				++it;
+				continue;
+			}
+
+			PostSymb old_post = det->result[state];
+			for (const auto& symb_post_pair : old_post)
+			{
+				for (State old_tgt : symb_post_pair.second)
+				{
+					ctx.remove_trans({state, symb_post_pair.first, old_tgt});
+				}
+			}
+
+			det->result.finalstates.erase(state);
+			ctx.added_final.erase(state);
+			if (0 == ctx.added_states.erase(state)) { removed_states.insert(state); }
+
+			it = det->subset_map.erase(it);
+		}
+	}
+
+	if (nullptr != delta)
+	{
+		delta->added_trans.assign(ctx.added_trans.begin(), ctx.added_trans.end());
+		delta->removed_trans.assign(ctx.removed_trans.begin(), ctx.removed_trans.end());
+		delta->added_states = std::move(ctx.added_states);
+		delta->added_final = std::move(ctx.added_final);
+		delta->removed_states = std::move(removed_states);
+	}
+} // determinize_incr }}}
+
+
+void Vata2::Nfa::apply_delta(Nfa* dfa, const DetDelta& delta)
+{ // {{{
+	assert(nullptr != dfa);
+
+	for (const Trans& trans : delta.removed_trans) { dfa->remove_trans(trans); }
+	for (const Trans& trans : delta.added_trans) { dfa->add_trans(trans); }
+	for (State state : delta.removed_states) { dfa->finalstates.erase(state); }
+	dfa->finalstates.insert(delta.added_final.begin(), delta.added_final.end());
+} // apply_delta }}}
@@ -15,10 +15,15 @@
  * GNU General Public License for more details.
  */
 
+#include <algorithm>
+#include <functional>
 #include <tuple>
+#include <unordered_set>
 
 // VATA headers
 #include <vata2/nfa.hh>
+#include <vata2/nfa-binary.hh>
+#include <vata2/nfa-cache.hh>
 #include <vata2/vm-dispatch.hh>
 
 // local headers
@@ -33,6 +38,38 @@ using Vata2::dispatch::test_and_call;
 
 namespace
 {
+	/// names of symbols shared by all automata with the default alphabet
+	const std::shared_ptr<Vata2::util::StringPool>& get_symbol_pool()
+	{
+		static std::shared_ptr<Vata2::util::StringPool> pool =
+			std::make_shared<Vata2::util::StringPool>();
+		return pool;
+	}
+
+	/// the names in @p names_map
+	template <class Map>
+	std::unordered_set<std::string> get_names(const Map& names_map)
+	{
+		std::unordered_set<std::string> result;
+		for (const auto& id_name : names_map) { result.insert(id_name.second); }
+		return result;
+	}
+
+	/**
+	 * The name of an unnamed state @p id: @p prefix followed by @p id and as
+	 * many primes as needed for the name not to be in @p used (names of
+	 * different IDs differ in the digits, so they do not clash either)
+	 */
+	std::string fresh_name(
+		const std::string&                      prefix,
+		uint64_t                                id,
+		const std::unordered_set<std::string>&  used)
+	{
+		std::string result = prefix + std::to_string(id);
+		while (used.count(result)) { result += "'"; }
+		return result;
+	}
+
 	VMValue nfa_dispatch(
 		const VMFuncName&  func_name,
 		const VMFuncArgs&  func_args)
@@ -49,7 +86,7 @@ namespace
 		if (TYPE_NFA == arg0.type) {
 			const NfaWrapper& wrap = *static_cast<const NfaWrapper*>(arg0.get_ptr());
 			DEBUG_VM_LOW_PRINT("NFA: " + std::to_string(wrap.nfa));
-			DEBUG_VM_LOW_PRINT("alphabet: " + std::to_string(wrap.alphabet));
+			DEBUG_VM_LOW_PRINT("alphabet: " + std::to_string(wrap.alphabet.get()));
 		}
 
 		// we use throw to return result from test_and_call
@@ -58,7 +95,7 @@ namespace
 			test_and_call("construct", func_name, {Vata2::TYPE_PARSEC}, func_args,
 				Vata2::Nfa::TYPE_NFA,
 				*[](const ParsedSection& parsec) -> auto {
-					NfaWrapper* nfa_wrap = new NfaWrapper;
+					std::unique_ptr<NfaWrapper> nfa_wrap(new NfaWrapper);
 					DEBUG_PRINT("constructing NFA " + (parsec.haskey("Name")?
 							std::to_string(parsec["Name"]) :
 							"[unnamed]"));
@@ -66,26 +103,75 @@ namespace
 					// choosing the alphabet to use
 					if (parsec.haskey("CharAlphabet")) {
 						DEBUG_PRINT("using CharAlphabet");
-						nfa_wrap->alphabet = new CharAlphabet();
+						nfa_wrap->alphabet.reset(new CharAlphabet());
 					} else if (parsec.haskey("DirectAlphabet")) {
 						DEBUG_PRINT("using DirectAlphabet");
-						nfa_wrap->alphabet = new DirectAlphabet();
+						nfa_wrap->alphabet.reset(new DirectAlphabet());
 					} else if (parsec.haskey("EnumAlphabet")) {
 						DEBUG_PRINT("using EnumAlphabet");
-						// TODO: load the alphabet
-						assert(false);
-						nfa_wrap->alphabet = new EnumAlphabet();
+						// symbols are given as values of the key, e.g., "%EnumAlphabet a b c"
+						const auto& symbols = parsec["EnumAlphabet"];
+						nfa_wrap->alphabet.reset(new EnumAlphabet(symbols.begin(), symbols.end()));
 					} else { // default
-						DEBUG_PRINT("using OnTheFlyAlphabet");
+						DEBUG_PRINT("using PooledAlphabet");
+						nfa_wrap->alphabet.reset(new PooledAlphabet(get_symbol_pool()));
+					}
 
-						// TODO: fix resource leak
-						StringToSymbolMap* sym_map = new StringToSymbolMap();
-						nfa_wrap->alphabet = new OnTheFlyAlphabet(sym_map);
+					construct(&nfa_wrap->nfa, parsec, nfa_wrap->alphabet.get(), nfa_wrap->state_dict.get());
+					return static_cast<VMPointer>(std::move(nfa_wrap));
+				});
+
+			test_and_call("load_binary", func_name, {Vata2::TYPE_STR}, func_args,
+				Vata2::Nfa::TYPE_NFA,
+				*[](const std::string& filename) -> auto {
+					BinaryNfa bin(filename);
+					Nfa loaded;
+					StateToStringMap state_names;
+					SymbolToStringMap symbol_names;
+					bin.to_nfa(&loaded, &state_names, &symbol_names);
+
+					// named states are renumbered to IDs of their names (the others
+					// get fresh names, so that they are not merged with named ones)
+					std::unique_ptr<NfaWrapper> nfa_wrap(new NfaWrapper);
+					std::unordered_set<std::string> used_state_names = get_names(state_names);
+					std::function<State(State)> get_state;
+					if (state_names.empty()) {
+						get_state = [](State state) { return state; };
+					} else {
+						get_state = [&](State state) -> State {
+							auto it = state_names.find(state);
+							return nfa_wrap->state_dict->intern((state_names.end() != it)?
+								it->second : fresh_name("q", state, used_state_names));
+						};
+					}
+
+					std::function<Symbol(Symbol)> get_symbol;
+					if (symbol_names.empty()) {
+						DEBUG_PRINT("using DirectAlphabet");
+						nfa_wrap->alphabet.reset(new DirectAlphabet());
+						get_symbol = [](Symbol symb) { return symb; };
+					} else {
+						DEBUG_PRINT("using PooledAlphabet");
+						nfa_wrap->alphabet.reset(new PooledAlphabet(get_symbol_pool()));
+						get_symbol = [&](Symbol symb) -> Symbol {
+							auto it = symbol_names.find(symb);
+							return get_symbol_pool()->intern((symbol_names.end() != it)?
+								it->second : get_unnamed_symbol_name(symb));
+						};
+					}
+
+					for (State state : loaded.initialstates) {
+						nfa_wrap->nfa.add_initial(get_state(state));
+					}
+					for (State state : loaded.finalstates) {
+						nfa_wrap->nfa.add_final(get_state(state));
+					}
+					for (const auto& trans : loaded) {
+						nfa_wrap->nfa.add_trans(get_state(trans.src), get_symbol(trans.symb),
+							get_state(trans.tgt));
 					}
 
-					// TODO: do sth with state_dict!!!!
-					construct(&nfa_wrap->nfa, parsec, nfa_wrap->alphabet, &nfa_wrap->state_dict);
-					return static_cast<VMPointer>(nfa_wrap);
+					return static_cast<VMPointer>(std::move(nfa_wrap));
 				});
 
 			test_and_call("print", func_name, {TYPE_NFA}, func_args, Vata2::TYPE_VOID,
@@ -100,9 +186,8 @@ namespace
 					Word cex;
 					// TODO: FIX
 					StringDict params{{"algo", "naive"}};
-					bool* result = new bool;
-					*result = is_universal(nfa_wrap.nfa, *nfa_wrap.alphabet, &cex, params);
-					return static_cast<VMPointer>(result);
+					return static_cast<VMPointer>(std::make_shared<bool>(
+						is_universal_cached(nfa_wrap.nfa, *nfa_wrap.alphabet, &cex, params)));
 				});
 		}
 		catch (VMValue res) {
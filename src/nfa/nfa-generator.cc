@@ -0,0 +1,367 @@
+/* nfa-generator.cc -- generators of NFAs for experiments and benchmarks
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cmath>
+#include <random>
+#include <unordered_set>
+
+// VATA headers
+#include <vata2/nfa-generator.hh>
+
+using namespace Vata2::Nfa;
+
+
+namespace
+{
+
+/**
+ * Random numbers from [0, bound).  std::mt19937_64 produces the same sequence
+ * everywhere, unlike the distributions of the standard library, whose
+ * algorithms are left to the implementation.  The bias of the modulo is
+ * negligible for the bounds used here.
+ */
+class Random
+{ // {{{
+private:
+
+	std::mt19937_64 gen;
+
+public:
+
+	explicit Random(uint64_t seed) : gen(seed) { }
+
+	uint64_t operator()(uint64_t bound) { return this->gen() % bound; }
+}; // Random }}}
+
+
+/// chooses @p count distinct numbers from [0, @p bound) (Floyd's algorithm)
+std::vector<uint64_t> sample(Random& random, uint64_t bound, uint64_t count)
+{ // {{{
+	assert(count <= bound);
+
+	std::unordered_set<uint64_t> chosen;
+	std::vector<uint64_t> result;
+	result.reserve(count);
+	for (uint64_t j = bound - count; j < bound; ++j)
+	{
+		uint64_t num = random(j + 1);
+		if (!chosen.insert(num).second)
+		{ // num was already chosen, but j cannot have been
+			num = j;
+			chosen.insert(num);
+		}
+
+		result.push_back(num);
+	}
+
+	return result;
+} // sample }}}
+
+
+/// the number of items given by @p density of @p num items (at most @p max)
+uint64_t count_of(double density, size_t num, uint64_t max, const char* func)
+{ // {{{
+	if (density < 0 || std::isnan(density))
+	{
+		throw std::runtime_error(std::string(func) + ": invalid density " +
+			std::to_string(density));
+	}
+
+	double count = std::round(density * num);
+	if (count > max)
+	{
+		throw std::runtime_error(std::string(func) + ": density " +
+			std::to_string(density) + " is too high");
+	}
+
+	return static_cast<uint64_t>(count);
+} // count_of }}}
+
+
+/// chooses final states of @p aut with @p num_states states
+void add_random_final(
+	Nfa*         aut,
+	Random&      random,
+	size_t       num_states,
+	double       final_density,
+	const char*  func)
+{ // {{{
+	uint64_t num_final = count_of(final_density, num_states, num_states, func);
+	for (uint64_t st : sample(random, num_states, num_final))
+	{
+		aut->add_final(st);
+	}
+} // add_random_final }}}
+
+
+/// a subexpression of a regular expression in the construction of Glushkov
+struct Fragment
+{ // {{{
+	/// whether the subexpression accepts the empty word
+	bool nullable;
+	/// positions (states) that can be the first ones of a word
+	StateSet first;
+	/// positions (states) that can be the last ones of a word
+	StateSet last;
+}; // Fragment }}}
+
+
+/**
+ * A recursive descent parser of regular expressions computing the Glushkov
+ * automaton; positions of symbols in the expression are numbered from 1 and
+ * they are the states of the automaton
+ */
+class RegexParser
+{ // {{{
+private:
+
+	const std::string& regex;
+	size_t pos;
+	Alphabet* alphabet;
+	Nfa* aut;
+
+	/// symbols of positions (with the index 0 unused)
+	std::vector<Symbol> symbols;
+
+	RegexParser(const RegexParser&) = delete;
+	RegexParser& operator=(const RegexParser&) = delete;
+
+	bool at_end() const { return this->pos >= this->regex.size(); }
+	char peek() const { return this->regex[this->pos]; }
+
+	[[noreturn]] void error(const std::string& msg) const
+	{ // {{{
+		throw std::runtime_error("regex_to_nfa: " + msg + " at the position " +
+			std::to_string(this->pos) + " of \"" + this->regex + "\"");
+	} // error }}}
+
+	/// adds transitions from positions in @p from to positions in @p to
+	void add_follow(const StateSet& from, const StateSet& to)
+	{ // {{{
+		for (State src : from)
+		{
+			for (State tgt : to)
+			{
+				this->aut->add_trans(src, this->symbols[tgt], tgt);
+			}
+		}
+	} // add_follow }}}
+
+	Fragment parse_atom()
+	{ // {{{
+		if (this->at_end()) { this->error("missing operand"); }
+
+		char ch = this->peek();
+		if ('(' == ch)
+		{
+			++this->pos;
+			Fragment result = this->parse_alt();
+			if (this->at_end() || ')' != this->peek()) { this->error("missing ')'"); }
+			++this->pos;
+			return result;
+		}
+
+		if ('*' == ch || '+' == ch || '?' == ch || ')' == ch || '|' == ch)
+		{
+			this->error(std::string("unexpected '") + ch + "'");
+		}
+
+		if ('\\' == ch)
+		{
+			++this->pos;
+			if (this->at_end()) { this->error("missing the escaped character"); }
+			ch = this->peek();
+		}
+
+		++this->pos;
+		State state = this->symbols.size();
+		this->symbols.push_back(this->alphabet->translate_symb(std::string(1, ch)));
+		return Fragment{false, {state}, {state}};
+	} // parse_atom }}}
+
+	Fragment parse_repeat()
+	{ // {{{
+		Fragment result = this->parse_atom();
+		while (!this->at_end())
+		{
+			char ch = this->peek();
+			if ('*' == ch || '+' == ch)
+			{ // positions can be repeated
+				this->add_follow(result.last, result.first);
+			}
+			else if ('?' != ch) { break; }
+
+			if ('+' != ch) { result.nullable = true; }
+			++this->pos;
+		}
+
+		return result;
+	} // parse_repeat }}}
+
+	Fragment parse_concat()
+	{ // {{{
+		Fragment result{true, {}, {}};
+		while (!this->at_end() && '|' != this->peek() && ')' != this->peek())
+		{
+			Fragment rhs = this->parse_repeat();
+			this->add_follow(result.last, rhs.first);
+
+			if (result.nullable)
+			{
+				result.first.insert(rhs.first.begin(), rhs.first.end());
+			}
+
+			if (rhs.nullable)
+			{
+				result.last.insert(rhs.last.begin(), rhs.last.end());
+			}
+			else
+			{
+				result.last = std::move(rhs.last);
+			}
+
+			result.nullable = result.nullable && rhs.nullable;
+		}
+
+		return result;
+	} // parse_concat }}}
+
+	Fragment parse_alt()
+	{ // {{{
+		Fragment result = this->parse_concat();
+		while (!this->at_end() && '|' == this->peek())
+		{
+			++this->pos;
+			Fragment rhs = this->parse_concat();
+			result.nullable = result.nullable || rhs.nullable;
+			result.first.insert(rhs.first.begin(), rhs.first.end());
+			result.last.insert(rhs.last.begin(), rhs.last.end());
+		}
+
+		return result;
+	} // parse_alt }}}
+
+public:
+
+	RegexParser(const std::string& regex, Alphabet* alphabet, Nfa* aut) :
+		regex(regex), pos(0), alphabet(alphabet), aut(aut), symbols(1)
+	{ }
+
+	void parse()
+	{ // {{{
+		Fragment result = this->parse_alt();
+		if (!this->at_end()) { this->error("unmatched ')'"); }
+
+		this->aut->add_initial(0);
+		this->add_follow({0}, result.first);
+		for (State st : result.last) { this->aut->add_final(st); }
+		if (result.nullable) { this->aut->add_final(0); }
+	} // parse }}}
+}; // RegexParser }}}
+
+} // namespace
+
+
+Nfa Vata2::Nfa::random_tabakov_vardi(
+	size_t    num_states,
+	size_t    num_symbols,
+	double    trans_density,
+	double    final_density,
+	uint64_t  seed)
+{ // {{{
+	if (0 == num_states)
+	{
+		throw std::runtime_error(std::string(__func__) + ": no states");
+	}
+
+	const uint64_t num_pairs = static_cast<uint64_t>(num_states) * num_states;
+	uint64_t num_trans = count_of(trans_density, num_states, num_pairs, __func__);
+
+	Random random(seed);
+	Nfa result;
+	result.add_initial(0);
+	for (Symbol symb = 0; symb < num_symbols; ++symb)
+	{
+		for (uint64_t pair : sample(random, num_pairs, num_trans))
+		{
+			result.add_trans(pair / num_states, symb, pair % num_states);
+		}
+	}
+
+	add_random_final(&result, random, num_states, final_density, __func__);
+	return result;
+} // random_tabakov_vardi }}}
+
+
+Nfa Vata2::Nfa::random_dfa(
+	size_t    num_states,
+	size_t    num_symbols,
+	double    final_density,
+	uint64_t  seed)
+{ // {{{
+	if (0 == num_states)
+	{
+		throw std::runtime_error(std::string(__func__) + ": no states");
+	}
+
+	Random random(seed);
+	Nfa result;
+	result.add_initial(0);
+	for (State st = 0; st < num_states; ++st)
+	{
+		for (Symbol symb = 0; symb < num_symbols; ++symb)
+		{
+			result.add_trans(st, symb, random(num_states));
+		}
+	}
+
+	add_random_final(&result, random, num_states, final_density, __func__);
+	return result;
+} // random_dfa }}}
+
+
+Nfa Vata2::Nfa::nth_symbol_from_end(size_t n)
+{ // {{{
+	if (0 == n)
+	{
+		throw std::runtime_error(std::string(__func__) + ": n needs to be positive");
+	}
+
+	Nfa result;
+	result.add_initial(0);
+	result.add_trans(0, 0, 0);
+	result.add_trans(0, 1, 0);
+	result.add_trans(0, 0, 1);
+	for (State st = 1; st < n; ++st)
+	{
+		result.add_trans(st, 0, st + 1);
+		result.add_trans(st, 1, st + 1);
+	}
+
+	result.add_final(n);
+	return result;
+} // nth_symbol_from_end }}}
+
+
+Nfa Vata2::Nfa::regex_to_nfa(const std::string& regex, Alphabet* alphabet)
+{ // {{{
+	assert(nullptr != alphabet);
+
+	Nfa result;
+	RegexParser(regex, alphabet, &result).parse();
+	return result;
+} // regex_to_nfa }}}
@@ -17,6 +17,7 @@
 
 // VATA headers
 #include <vata2/nfa.hh>
+#include <vata2/stats.hh>
 
 using namespace Vata2::Nfa;
 using namespace Vata2::util;
@@ -61,6 +62,7 @@ bool is_incl_antichains(
 	using ProcessedType = std::list<ProdStateType>;
 
 	auto subsumes = [](const ProdStateType& lhs, const ProdStateType& rhs) {
+		VATA_STATS_INC(SUBSUMPTION_CHECKS);
 		if (lhs.first != rhs.first) {
 			return false;
 		}
@@ -124,6 +126,7 @@ bool is_incl_antichains(
 			for (const State& smaller_succ : post_symb.second) {
 				StateSet bigger_succ = bigger.post(bigger_set, symb);
 				ProdStateType succ = {smaller_succ, bigger_succ};
+				VATA_STATS_INC(MACROSTATES);
 
 				if (smaller.has_final(smaller_succ) &&
 					are_disjoint(bigger_succ, bigger.finalstates))
@@ -153,7 +156,10 @@ bool is_incl_antichains(
 					}
 				}
 
-				if (is_subsumed) { continue; }
+				if (is_subsumed) {
+					VATA_STATS_INC(PRUNED);
+					continue;
+				}
 
 				// prune data structures and insert succ inside
 				for (std::list<ProdStateType>* ds : {&processed, &worklist}) {
@@ -163,6 +169,7 @@ bool is_incl_antichains(
 							auto to_remove = it;
 							++it;
 							ds->erase(to_remove);
+							VATA_STATS_INC(PRUNED);
 						} else {
 							++it;
 						}
@@ -172,6 +179,8 @@ bool is_incl_antichains(
 					ds->push_back(succ);
 				}
 
+				VATA_STATS_MAX(PEAK_WORKLIST, worklist.size());
+
 				// also set that succ was accessed from state
 				paths[succ] = {prod_state, symb};
 			}
@@ -181,6 +190,197 @@ bool is_incl_antichains(
 	return true;
 } // }}}
 
+
+/// naive batch inclusion check (one inclusion check per bigger automaton)
+void is_incl_many_naive(
+	const Nfa&                      smaller,
+	const std::vector<const Nfa*>&  biggers,
+	const Alphabet&                 alphabet,
+	std::vector<bool>*              results,
+	std::vector<Word>*              cexes,
+	const StringDict&               params)
+{ // {{{
+	for (size_t i = 0; i < biggers.size(); ++i)
+	{
+		Word* cex = (nullptr == cexes)? nullptr : &(*cexes)[i];
+		(*results)[i] = is_incl(smaller, *biggers[i], alphabet, cex, params);
+	}
+} // is_incl_many_naive }}}
+
+
+/**
+ * Batch inclusion check using Antichains.  The product is built from states of
+ * @p smaller and tuples of macrostates (one for every bigger automaton that has
+ * not been refuted yet), so the exploration of @p smaller is shared by all
+ * queries.  A product state is subsumed by another one if they share the
+ * state of @p smaller and each of the macrostates of active automata is a
+ * superset of the corresponding one in the other product state.
+ */
+void is_incl_many_antichains(
+	const Nfa&                      smaller,
+	const std::vector<const Nfa*>&  biggers,
+	const Alphabet&                 alphabet,
+	std::vector<bool>*              results,
+	std::vector<Word>*              cexes,
+	const StringDict&               params)
+{ // {{{
+	(void)params;
+	(void)alphabet;
+	VATA_STATS_TIMER(INCLUSION);
+
+	// a product state; 'pred' is the index of the product state it was reached
+	// from (its own index for initial states), over the symbol 'symb'
+	struct ProdState
+	{
+		State state;
+		std::vector<StateSet> bigger_sets;
+		size_t pred;
+		Symbol symb;
+	};
+
+	std::vector<ProdState> prod_states;
+	std::list<size_t> worklist = { };
+	std::list<size_t> processed = { };
+
+	// indices of bigger automata without a counterexample found so far
+	std::vector<size_t> active;
+	for (size_t i = 0; i < biggers.size(); ++i)
+	{
+		assert(nullptr != biggers[i]);
+		(*results)[i] = true;
+		active.push_back(i);
+	}
+
+	auto subsumes = [&](const ProdState& lhs, const ProdState& rhs) {
+		VATA_STATS_INC(SUBSUMPTION_CHECKS);
+		if (lhs.state != rhs.state) { return false; }
+
+		for (size_t i : active)
+		{
+			const StateSet& lhs_bigger = lhs.bigger_sets[i];
+			const StateSet& rhs_bigger = rhs.bigger_sets[i];
+			if (lhs_bigger.size() > rhs_bigger.size() ||
+				!std::includes(rhs_bigger.begin(), rhs_bigger.end(),
+					lhs_bigger.begin(), lhs_bigger.end()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	// drops the automata for which 'bigger_sets' is a counterexample, the word
+	// is given by the product state at 'pred' followed by 'symb'
+	auto refute = [&](const std::vector<StateSet>& bigger_sets, size_t pred,
+		const Symbol* symb)
+	{
+		auto it = active.begin();
+		while (active.end() != it)
+		{
+			if (!are_disjoint(bigger_sets[*it], biggers[*it]->finalstates))
+			{
+				++it;
+				continue;
+			}
+
+			(*results)[*it] = false;
+			if (nullptr != cexes)
+			{
+				Word& cex = (*cexes)[*it];
+				cex.clear();
+				if (nullptr != symb)
+				{
+					cex.push_back(*symb);
+					for (size_t trav = pred; prod_states[trav].pred != trav;
+						trav = prod_states[trav].pred)
+					{ // go back until initial state
+						cex.push_back(prod_states[trav].symb);
+					}
+
+					std::reverse(cex.begin(), cex.end());
+				}
+			}
+
+			it = active.erase(it);
+		}
+	};
+
+	std::vector<StateSet> init_sets(biggers.size());
+	for (size_t i : active) { init_sets[i] = biggers[i]->initialstates; }
+
+	// check initial states first
+	for (const auto& state : smaller.initialstates) {
+		if (smaller.has_final(state)) { refute(init_sets, 0, nullptr); }
+
+		prod_states.push_back({state, init_sets, prod_states.size(), 0});
+		worklist.push_back(prod_states.size() - 1);
+		processed.push_back(prod_states.size() - 1);
+	}
+
+	while (!worklist.empty() && !active.empty()) {
+		// get a next product state (DFS)
+		size_t prod_idx = worklist.back();
+		worklist.pop_back();
+
+		// process transitions leaving the state of smaller
+		for (const auto& post_symb : smaller[prod_states[prod_idx].state]) {
+			const Symbol& symb = post_symb.first;
+
+			// the post of macrostates is independent of the successor in smaller
+			std::vector<StateSet> bigger_succ(biggers.size());
+			for (size_t i : active)
+			{
+				bigger_succ[i] = biggers[i]->post(prod_states[prod_idx].bigger_sets[i], symb);
+			}
+
+			for (const State& smaller_succ : post_symb.second) {
+				if (smaller.has_final(smaller_succ)) {
+					refute(bigger_succ, prod_idx, &symb);
+					if (active.empty()) { return; }
+				}
+
+				ProdState succ = {smaller_succ, bigger_succ, prod_idx, symb};
+				VATA_STATS_INC(MACROSTATES);
+
+				bool is_subsumed = false;
+				for (size_t anti_idx : processed)
+				{ // trying to find a smaller state in processed
+					if (subsumes(prod_states[anti_idx], succ)) {
+						is_subsumed = true;
+						break;
+					}
+				}
+
+				if (is_subsumed) {
+					VATA_STATS_INC(PRUNED);
+					continue;
+				}
+
+				prod_states.push_back(std::move(succ));
+				size_t succ_idx = prod_states.size() - 1;
+
+				// prune data structures and insert succ inside
+				for (std::list<size_t>* ds : {&processed, &worklist}) {
+					auto it = ds->begin();
+					while (it != ds->end()) {
+						if (subsumes(prod_states[succ_idx], prod_states[*it])) {
+							it = ds->erase(it);
+							VATA_STATS_INC(PRUNED);
+						} else {
+							++it;
+						}
+					}
+
+					ds->push_back(succ_idx);
+				}
+
+				VATA_STATS_MAX(PEAK_WORKLIST, worklist.size());
+			}
+		}
+	}
+} // is_incl_many_antichains }}}
+
 } // namespace
 
 
@@ -192,6 +392,7 @@ bool Vata2::Nfa::is_incl(
 	Word*              cex,
 	const StringDict&  params)
 { // {{{
+	VATA_STATS_TIMER(INCLUSION);
 
 	// setting the default algorithm
 	decltype(is_incl_naive)* algo = is_incl_naive;
@@ -212,3 +413,36 @@ bool Vata2::Nfa::is_incl(
 
 	return algo(smaller, bigger, alphabet, cex, params);
 } // is_incl }}}
+
+
+void Vata2::Nfa::is_incl_many(
+	const Nfa&                      smaller,
+	const std::vector<const Nfa*>&  biggers,
+	const Alphabet&                 alphabet,
+	std::vector<bool>*              results,
+	std::vector<Word>*              cexes,
+	const StringDict&               params)
+{ // {{{
+	assert(nullptr != results);
+
+	decltype(is_incl_many_naive)* algo = is_incl_many_naive;
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("naive" == str_algo) { }
+	else if ("antichains" == str_algo) {
+		algo = is_incl_many_antichains;
+	} else {
+		throw std::runtime_error(std::to_string(__func__) +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+
+	results->assign(biggers.size(), true);
+	if (nullptr != cexes) { cexes->assign(biggers.size(), Word()); }
+
+	algo(smaller, biggers, alphabet, results, cexes, params);
+} // is_incl_many }}}
@@ -0,0 +1,380 @@
+/* nfa-lang-empty.cc -- NFA language emptiness and shortest words
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <unordered_set>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using std::tie;
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace { // anonymous namespace
+
+/// a node of a breadth-first search
+struct SearchNode
+{ // {{{
+	State state;
+	/// index of the node @p state was reached from (its own index for roots)
+	size_t pred;
+	/// the symbol on the transition between @p pred and @p state
+	Symbol symb;
+	/// the distance from a root
+	size_t dist;
+}; // SearchNode }}}
+
+
+/**
+ * The tree of a breadth-first search.  Nodes are stored in the order of
+ * discovery, so the vector of nodes serves as the BFS queue, too.
+ */
+struct SearchTree
+{ // {{{
+	std::vector<SearchNode> nodes;
+	std::unordered_map<State, size_t> index;
+
+	SearchTree() : nodes(), index() { }
+
+	/// adds a node reached from @p pred; returns @p false if seen before
+	bool add(State state, size_t pred, Symbol symb)
+	{ // {{{
+		bool inserted;
+		tie(std::ignore, inserted) = this->index.insert({state, this->nodes.size()});
+		if (inserted)
+		{
+			this->nodes.push_back({state, pred, symb, this->nodes[pred].dist + 1});
+		}
+
+		return inserted;
+	} // add }}}
+
+	/// adds a root of the search
+	void add_root(State state)
+	{ // {{{
+		bool inserted;
+		tie(std::ignore, inserted) = this->index.insert({state, this->nodes.size()});
+		if (inserted)
+		{
+			this->nodes.push_back({state, this->nodes.size(), 0, 0});
+		}
+	} // add_root }}}
+
+	/**
+	 * Obtains states and symbols on the branch from the node @p idx to the root
+	 * (in this order)
+	 */
+	void get_branch(size_t idx, Path* path, Word* word) const
+	{ // {{{
+		path->push_back(this->nodes[idx].state);
+		while (this->nodes[idx].pred != idx)
+		{
+			word->push_back(this->nodes[idx].symb);
+			idx = this->nodes[idx].pred;
+			path->push_back(this->nodes[idx].state);
+		}
+	} // get_branch }}}
+}; // SearchTree }}}
+
+
+/// the reversed transition relation (maps targets to (symbol, source) pairs)
+using ReverseMap = std::unordered_map<State, std::vector<std::pair<Symbol, State>>>;
+
+ReverseMap get_reverse_map(const Nfa& aut)
+{ // {{{
+	ReverseMap result;
+	for (const Trans& trans : aut)
+	{
+		result[trans.tgt].push_back({trans.symb, trans.src});
+	}
+
+	return result;
+} // get_reverse_map }}}
+
+
+/// checks emptiness by a BFS from initial states (gives a shortest witness)
+bool is_lang_empty_bfs(const Nfa& aut, Path* path, Word* word)
+{ // {{{
+	SearchTree tree;
+	size_t found = std::numeric_limits<size_t>::max();
+	for (State state : aut.initialstates)
+	{
+		tree.add_root(state);
+		if (aut.has_final(state))
+		{
+			found = tree.index[state];
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < tree.nodes.size() &&
+		std::numeric_limits<size_t>::max() == found; ++i)
+	{
+		State state = tree.nodes[i].state;
+		for (const auto& symb_stateset : aut[state])
+		{
+			for (State tgt : symb_stateset.second)
+			{
+				if (tree.add(tgt, i, symb_stateset.first) && aut.has_final(tgt))
+				{ // final states are checked at discovery
+					found = tree.nodes.size() - 1;
+					break;
+				}
+			}
+
+			if (std::numeric_limits<size_t>::max() != found) { break; }
+		}
+	}
+
+	if (std::numeric_limits<size_t>::max() == found) { return true; }
+
+	tree.get_branch(found, path, word);
+	std::reverse(path->begin(), path->end());
+	std::reverse(word->begin(), word->end());
+	return false;
+} // is_lang_empty_bfs }}}
+
+
+/**
+ * Checks emptiness by a BFS from initial states and a backward BFS from final
+ * states, expanding always the smaller frontier level by level.  The first
+ * level in which the searches meet contains a shortest witness.
+ */
+bool is_lang_empty_bidirectional(const Nfa& aut, Path* path, Word* word)
+{ // {{{
+	for (State state : aut.initialstates)
+	{
+		if (aut.has_final(state))
+		{
+			path->push_back(state);
+			return false;
+		}
+	}
+
+	ReverseMap rev_map = get_reverse_map(aut);
+	SearchTree fwd;
+	SearchTree bwd;
+	for (State state : aut.initialstates) { fwd.add_root(state); }
+	for (State state : aut.finalstates) { bwd.add_root(state); }
+
+	// beginnings of the currently processed levels
+	size_t fwd_begin = 0;
+	size_t bwd_begin = 0;
+
+	const size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+	size_t best_len = NOT_FOUND;
+	size_t best_fwd = 0;
+	size_t best_bwd = 0;
+
+	while (fwd_begin < fwd.nodes.size() && bwd_begin < bwd.nodes.size())
+	{
+		bool forward =
+			(fwd.nodes.size() - fwd_begin) <= (bwd.nodes.size() - bwd_begin);
+		SearchTree& tree = forward? fwd : bwd;
+		const SearchTree& other = forward? bwd : fwd;
+		size_t& begin = forward? fwd_begin : bwd_begin;
+		size_t end = tree.nodes.size();
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			auto visit = [&](Symbol symb, State succ) {
+				if (!tree.add(succ, i, symb)) { return; }
+				auto it = other.index.find(succ);
+				if (other.index.end() == it) { return; }
+
+				size_t len = tree.nodes.back().dist + other.nodes[it->second].dist;
+				if (len < best_len)
+				{
+					best_len = len;
+					best_fwd = forward? tree.nodes.size() - 1 : it->second;
+					best_bwd = forward? it->second : tree.nodes.size() - 1;
+				}
+			};
+
+			State state = tree.nodes[i].state;
+			if (forward)
+			{
+				for (const auto& symb_stateset : aut[state])
+				{
+					for (State tgt : symb_stateset.second) { visit(symb_stateset.first, tgt); }
+				}
+			}
+			else
+			{
+				auto it = rev_map.find(state);
+				if (rev_map.end() == it) { continue; }
+				for (const auto& symb_src : it->second) { visit(symb_src.first, symb_src.second); }
+			}
+		}
+
+		begin = end;
+		if (NOT_FOUND != best_len)
+		{
+			fwd.get_branch(best_fwd, path, word);
+			std::reverse(path->begin(), path->end());
+			std::reverse(word->begin(), word->end());
+
+			// the backward branch goes in the right direction; skip the meeting state
+			Path bwd_path;
+			bwd.get_branch(best_bwd, &bwd_path, word);
+			path->insert(path->end(), bwd_path.begin() + 1, bwd_path.end());
+			return false;
+		}
+	}
+
+	return true;
+} // is_lang_empty_bidirectional }}}
+
+
+/// selects the emptiness check according to @p params
+decltype(is_lang_empty_bfs)* get_lang_empty_algo(
+	const char*        func_name,
+	const StringDict&  params)
+{ // {{{
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(std::to_string(func_name) +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("bfs" == str_algo) { return is_lang_empty_bfs; }
+	else if ("bidirectional" == str_algo) { return is_lang_empty_bidirectional; }
+	else {
+		throw std::runtime_error(std::to_string(func_name) +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+} // get_lang_empty_algo }}}
+
+} // namespace
+
+
+bool Vata2::Nfa::is_lang_empty(
+	const Nfa&         aut,
+	Path*              cex,
+	const StringDict&  params)
+{ // {{{
+	auto algo = get_lang_empty_algo(__func__, params);
+
+	Path path;
+	Word word;
+	bool result = algo(aut, &path, &word);
+	if (!result && nullptr != cex) { *cex = std::move(path); }
+
+	return result;
+} // is_lang_empty }}}
+
+
+bool Vata2::Nfa::is_lang_empty_cex(
+	const Nfa&         aut,
+	Word*              cex,
+	const StringDict&  params)
+{ // {{{
+	assert(nullptr != cex);
+
+	auto algo = get_lang_empty_algo(__func__, params);
+
+	Path path;
+	Word word;
+	bool result = algo(aut, &path, &word);
+	if (!result) { *cex = std::move(word); }
+
+	return result;
+} // is_lang_empty_cex }}}
+
+
+std::vector<Word> Vata2::Nfa::get_shortest_words(const Nfa& aut, size_t k)
+{ // {{{
+	std::vector<Word> result;
+	if (0 == k) { return result; }
+
+	// only states from which a final state is reachable are kept in macrostates
+	// so that every explored prefix can be extended to a word in the language
+	ReverseMap rev_map = get_reverse_map(aut);
+	std::unordered_set<State> useful(aut.finalstates.begin(), aut.finalstates.end());
+	std::vector<State> stack(aut.finalstates.begin(), aut.finalstates.end());
+	while (!stack.empty())
+	{
+		State state = stack.back();
+		stack.pop_back();
+		auto it = rev_map.find(state);
+		if (rev_map.end() == it) { continue; }
+
+		for (const auto& symb_src : it->second)
+		{
+			if (useful.insert(symb_src.second).second) { stack.push_back(symb_src.second); }
+		}
+	}
+
+	StateSet init;
+	for (State state : aut.initialstates)
+	{
+		if (haskey(useful, state)) { init.insert(state); }
+	}
+
+	if (init.empty()) { return result; }
+
+	// prefixes are stored as (index of the prefix without the last symbol,
+	// the last symbol); the node at 0 is the empty word
+	std::vector<std::pair<size_t, Symbol>> prefixes = {{0, 0}};
+	std::list<std::pair<size_t, StateSet>> worklist = {{0, std::move(init)}};
+
+	while (!worklist.empty())
+	{
+		size_t node = worklist.front().first;
+		StateSet macrostate = std::move(worklist.front().second);
+		worklist.pop_front();
+
+		if (!are_disjoint(macrostate, aut.finalstates))
+		{
+			Word word;
+			for (size_t i = node; 0 != i; i = prefixes[i].first)
+			{
+				word.push_back(prefixes[i].second);
+			}
+
+			std::reverse(word.begin(), word.end());
+			result.push_back(std::move(word));
+			if (result.size() == k) { break; }
+		}
+
+		// successors are enqueued in the order of symbols to obtain shortlex order
+		std::map<Symbol, StateSet> post;
+		for (State state : macrostate)
+		{
+			for (const auto& symb_stateset : aut[state])
+			{
+				for (State tgt : symb_stateset.second)
+				{
+					if (haskey(useful, tgt)) { post[symb_stateset.first].insert(tgt); }
+				}
+			}
+		}
+
+		for (auto& symb_stateset : post)
+		{
+			prefixes.push_back({node, symb_stateset.first});
+			worklist.push_back({prefixes.size() - 1, std::move(symb_stateset.second)});
+		}
+	}
+
+	return result;
+} // get_shortest_words }}}
@@ -0,0 +1,469 @@
+/* nfa-matcher.cc -- matching byte strings against NFAs via lazy DFAs
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <list>
+#include <sstream>
+
+// VATA headers
+#include <vata2/nfa-matcher.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+const LazyDfaMatcher::DfaState LazyDfaMatcher::UNKNOWN;
+const size_t LazyDfaMatcher::DEFAULT_MAX_STATES;
+const size_t DiffMatcher::DEFAULT_MAX_STATES;
+const ProfilingMatcher::TransId ProfilingMatcher::NO_TRANS;
+
+namespace { // anonymous namespace
+
+/**
+ * Determinizes a component of a product on demand.  With prefix acceptance,
+ * all accepting macrostates are merged into the absorbing state ACCEPTED.
+ */
+struct ComponentDfa
+{ // {{{
+	/// the absorbing accepting state (used only with prefix acceptance)
+	static const size_t ACCEPTED = 0;
+
+	const Nfa& aut;
+	bool prefix_acceptance;
+	SubsetMap subset_map;
+	/// macrostates of states (pointing to keys of subset_map)
+	std::vector<const StateSet*> macrostates;
+	std::vector<bool> accepting;
+	/// computed successors; the successor of s over byte b is at s * 256 + b
+	std::vector<size_t> succs;
+
+	ComponentDfa(const Nfa& aut, bool prefix_acceptance) :
+		aut(aut), prefix_acceptance(prefix_acceptance), subset_map(),
+		macrostates(), accepting(), succs()
+	{
+		if (prefix_acceptance) { this->add_state(nullptr, true); }
+	}
+
+	ComponentDfa(const ComponentDfa&) = delete;
+	ComponentDfa& operator=(const ComponentDfa&) = delete;
+
+	size_t add_state(const StateSet* macrostate, bool is_accepting)
+	{ // {{{
+		this->macrostates.push_back(macrostate);
+		this->accepting.push_back(is_accepting);
+		this->succs.resize(this->succs.size() + 256, LazyDfaMatcher::UNKNOWN);
+		return this->macrostates.size() - 1;
+	} // add_state }}}
+
+	size_t get_state(const StateSet& macrostate)
+	{ // {{{
+		bool is_accepting = !are_disjoint(macrostate, this->aut.finalstates);
+		if (this->prefix_acceptance && is_accepting) { return ACCEPTED; }
+
+		auto it_bool_pair = this->subset_map.insert(
+			{macrostate, this->macrostates.size()});
+		if (!it_bool_pair.second) { return it_bool_pair.first->second; }
+
+		return this->add_state(&it_bool_pair.first->first, is_accepting);
+	} // get_state }}}
+
+	size_t get_succ(size_t state, uint8_t byte)
+	{ // {{{
+		size_t& succ = this->succs[state * 256 + byte];
+		if (LazyDfaMatcher::UNKNOWN != succ) { return succ; }
+
+		size_t result = ACCEPTED;
+		if (nullptr != this->macrostates[state])
+		{ // not the absorbing state
+			result = this->get_state(this->aut.post(*this->macrostates[state], byte));
+		}
+
+		// get_state() might have reallocated succs
+		this->succs[state * 256 + byte] = result;
+		return result;
+	} // get_succ }}}
+}; // ComponentDfa }}}
+
+const size_t ComponentDfa::ACCEPTED;
+
+} // namespace
+
+
+LazyDfaMatcher::LazyDfaMatcher(
+	const Nfa&  aut,
+	size_t      max_states) :
+	aut(aut),
+	subset_map(),
+	macrostates(),
+	table(),
+	flags(),
+	max_states(std::max<size_t>(max_states, 2)),
+	flushes(0)
+{ // {{{
+	this->get_state(aut.initialstates);
+} // LazyDfaMatcher() }}}
+
+
+LazyDfaMatcher::DfaState LazyDfaMatcher::get_state(const StateSet& macrostate)
+{ // {{{
+	auto it_bool_pair = this->subset_map.insert(
+		{macrostate, this->macrostates.size()});
+	if (!it_bool_pair.second) { return it_bool_pair.first->second; }
+
+	assert(this->macrostates.size() < UNKNOWN);
+	this->macrostates.push_back(&it_bool_pair.first->first);
+	this->table.resize(this->table.size() + 256, UNKNOWN);
+
+	uint8_t state_flags = 0;
+	if (!are_disjoint(macrostate, this->aut.finalstates))
+	{
+		state_flags |= FLAG_ACCEPTING;
+	}
+	if (macrostate.empty()) { state_flags |= FLAG_SINK; }
+	this->flags.push_back(state_flags);
+
+	return this->macrostates.size() - 1;
+} // get_state }}}
+
+
+void LazyDfaMatcher::flush()
+{ // {{{
+	this->macrostates.clear();
+	this->table.clear();
+	this->flags.clear();
+	this->subset_map.clear();
+	++this->flushes;
+
+	this->get_state(this->aut.initialstates);
+} // flush }}}
+
+
+LazyDfaMatcher::DfaState LazyDfaMatcher::compute_succ(
+	DfaState  state,
+	uint8_t   byte)
+{ // {{{
+	StateSet post = this->aut.post(*this->macrostates[state], byte);
+
+	if (this->macrostates.size() >= this->max_states &&
+		!haskey(this->subset_map, post))
+	{ // the table is full, start from scratch
+		this->flush();
+		return this->get_state(post);
+	}
+
+	DfaState succ = this->get_state(post);
+	this->table[state * 256 + byte] = succ;
+	return succ;
+} // compute_succ }}}
+
+
+bool LazyDfaMatcher::is_in_lang(const uint8_t* data, size_t len)
+{ // {{{
+	assert(nullptr != data || 0 == len);
+
+	DfaState state = this->initial();
+	for (const uint8_t* end = data + len; data != end; ++data)
+	{
+		state = this->step(state, *data);
+		if (this->is_sink(state)) { return false; }
+	}
+
+	return this->is_accepting(state);
+} // is_in_lang }}}
+
+
+bool LazyDfaMatcher::is_prfx_in_lang(const uint8_t* data, size_t len)
+{ // {{{
+	assert(nullptr != data || 0 == len);
+
+	DfaState state = this->initial();
+	for (const uint8_t* end = data + len; data != end; ++data)
+	{
+		if (this->is_accepting(state)) { return true; }
+		state = this->step(state, *data);
+		if (this->is_sink(state)) { return false; }
+	}
+
+	return this->is_accepting(state);
+} // is_prfx_in_lang }}}
+
+
+DiffMatcher::DiffMatcher(
+	const Nfa&  aut1,
+	const Nfa&  aut2,
+	bool        prefix_acceptance,
+	size_t      max_states) :
+	table(),
+	flags()
+{ // {{{
+	ComponentDfa dfa1(aut1, prefix_acceptance);
+	ComponentDfa dfa2(aut2, prefix_acceptance);
+
+	std::unordered_map<std::pair<size_t, size_t>, DfaState> prod_map;
+	std::vector<std::pair<size_t, size_t>> prod_states;
+
+	auto get_prod_state = [&](size_t state1, size_t state2) -> DfaState {
+		auto it_bool_pair = prod_map.insert(
+			{{state1, state2}, static_cast<DfaState>(prod_states.size())});
+		if (!it_bool_pair.second) { return it_bool_pair.first->second; }
+
+		if (prod_states.size() >= max_states) {
+			throw std::runtime_error("the product of automata has more than " +
+				std::to_string(max_states) + " states");
+		}
+
+		prod_states.push_back({state1, state2});
+		this->flags.push_back((dfa1.accepting[state1]? IN_FIRST_ONLY : 0) |
+			(dfa2.accepting[state2]? IN_SECOND_ONLY : 0));
+		return prod_states.size() - 1;
+	};
+
+	get_prod_state(dfa1.get_state(aut1.initialstates),
+		dfa2.get_state(aut2.initialstates));
+
+	// states are numbered in the BFS order, so the table can be filled in order
+	for (DfaState state = 0; state < prod_states.size(); ++state)
+	{
+		for (size_t byte = 0; byte < 256; ++byte)
+		{
+			size_t succ1 = dfa1.get_succ(prod_states[state].first, byte);
+			size_t succ2 = dfa2.get_succ(prod_states[state].second, byte);
+			this->table.push_back(get_prod_state(succ1, succ2));
+		}
+	}
+
+	// compute the verdicts reachable from every state (as bit masks of
+	// verdicts) using backward propagation
+	std::vector<std::vector<DfaState>> preds(prod_states.size());
+	for (size_t i = 0; i < this->table.size(); ++i)
+	{
+		preds[this->table[i]].push_back(i / 256);
+	}
+
+	std::vector<uint8_t> reachable(prod_states.size());
+	std::list<DfaState> worklist;
+	for (DfaState state = 0; state < prod_states.size(); ++state)
+	{
+		reachable[state] = 1 << this->get_verdict(state);
+		worklist.push_back(state);
+	}
+
+	while (!worklist.empty())
+	{
+		DfaState state = worklist.front();
+		worklist.pop_front();
+
+		for (DfaState pred : preds[state])
+		{
+			if ((reachable[pred] | reachable[state]) != reachable[pred])
+			{
+				reachable[pred] |= reachable[state];
+				worklist.push_back(pred);
+			}
+		}
+	}
+
+	for (DfaState state = 0; state < prod_states.size(); ++state)
+	{ // settled states reach a single verdict
+		if (reachable[state] == (1 << this->get_verdict(state)))
+		{
+			this->flags[state] |= FLAG_SETTLED;
+		}
+	}
+} // DiffMatcher() }}}
+
+
+DiffMatcher::Verdict DiffMatcher::match(const uint8_t* data, size_t len) const
+{ // {{{
+	assert(nullptr != data || 0 == len);
+
+	DfaState state = this->initial();
+	for (const uint8_t* end = data + len; data != end; ++data)
+	{
+		if (this->is_settled(state)) { break; }
+		state = this->step(state, *data);
+	}
+
+	return this->get_verdict(state);
+} // match }}}
+
+
+void ProfilingMatcher::Counters::merge(const Counters& rhs)
+{ // {{{
+	assert(this->trans_hits.size() == rhs.trans_hits.size());
+	assert(this->end_hits.size() == rhs.end_hits.size());
+
+	for (size_t i = 0; i < rhs.trans_hits.size(); ++i)
+	{
+		this->trans_hits[i] += rhs.trans_hits[i];
+	}
+
+	for (size_t i = 0; i < rhs.end_hits.size(); ++i)
+	{
+		this->end_hits[i] += rhs.end_hits[i];
+	}
+
+	this->blocked += rhs.blocked;
+} // merge }}}
+
+
+ProfilingMatcher::ProfilingMatcher(const Nfa& aut) :
+	states(),
+	table(),
+	trans_src(),
+	trans_symb(),
+	trans_tgt()
+{ // {{{
+	if (!is_deterministic(aut))
+	{
+		throw std::runtime_error(std::to_string(__func__) +
+			": the automaton is not deterministic");
+	}
+
+	std::unordered_map<State, DfaState> state_map;
+	auto get_state = [&](State state) -> DfaState {
+		auto it_bool_pair = state_map.insert(
+			{state, static_cast<DfaState>(this->states.size())});
+		if (it_bool_pair.second)
+		{
+			this->states.push_back(state);
+			this->table.resize(this->table.size() + 256, NO_TRANS);
+		}
+
+		return it_bool_pair.first->second;
+	};
+
+	get_state(*aut.initialstates.begin());
+
+	// states are numbered in the BFS order
+	for (DfaState state = 0; state < this->states.size(); ++state)
+	{
+		for (const auto& symb_state_set : aut[this->states[state]])
+		{
+			if (symb_state_set.first > 255)
+			{
+				throw std::runtime_error(std::to_string(__func__) +
+					": symbol " + std::to_string(symb_state_set.first) +
+					" is not a byte");
+			}
+
+			assert(symb_state_set.second.size() == 1);
+			DfaState tgt = get_state(*symb_state_set.second.begin());
+
+			this->table[state * 256 + symb_state_set.first] =
+				static_cast<TransId>(this->trans_tgt.size());
+			this->trans_src.push_back(state);
+			this->trans_symb.push_back(static_cast<uint8_t>(symb_state_set.first));
+			this->trans_tgt.push_back(tgt);
+		}
+	}
+} // ProfilingMatcher() }}}
+
+
+ProfilingMatcher::Counters ProfilingMatcher::new_counters() const
+{ // {{{
+	Counters result;
+	result.trans_hits.resize(this->num_trans(), 0);
+	result.end_hits.resize(this->num_states(), 0);
+	return result;
+} // new_counters }}}
+
+
+void ProfilingMatcher::profile(
+	const uint8_t*  data,
+	size_t          len,
+	Counters*       counters) const
+{ // {{{
+	assert(nullptr != data || 0 == len);
+	assert(nullptr != counters);
+	assert(counters->trans_hits.size() == this->num_trans());
+
+	const TransId* table_data = this->table.data();
+	const DfaState* tgt_data = this->trans_tgt.data();
+	uint64_t* hits = counters->trans_hits.data();
+
+	DfaState state = 0;
+	for (const uint8_t* end = data + len; data != end; ++data)
+	{
+		TransId trans = table_data[state * 256 + *data];
+		if (NO_TRANS == trans)
+		{
+			++counters->blocked;
+			return;
+		}
+
+		++hits[trans];
+		state = tgt_data[trans];
+	}
+
+	++counters->end_hits[state];
+} // profile }}}
+
+
+namespace { // anonymous namespace
+
+/// converts a probability into a string that can be read back precisely
+std::string prob_to_string(double prob)
+{ // {{{
+	std::ostringstream stream;
+	stream.precision(std::numeric_limits<double>::max_digits10);
+	stream << prob;
+	return stream.str();
+} // prob_to_string }}}
+
+} // namespace
+
+
+Vata2::Parser::ParsedSection ProfilingMatcher::serialize_prob(
+	const Counters& counters) const
+{ // {{{
+	assert(counters.trans_hits.size() == this->num_trans());
+	assert(counters.end_hits.size() == this->num_states());
+
+	// all visits of states
+	std::vector<uint64_t> visits(counters.end_hits);
+	for (TransId trans = 0; trans < this->num_trans(); ++trans)
+	{
+		visits[this->trans_src[trans]] += counters.trans_hits[trans];
+	}
+
+	Vata2::Parser::ParsedSection parsec;
+	parsec.type = "DPA";
+	parsec.dict["Initial"] = {std::to_string(this->states[0]) + ":1.0"};
+
+	std::vector<std::string>& finals = parsec.dict["Final"];
+	for (DfaState state = 0; state < this->num_states(); ++state)
+	{
+		if (0 == counters.end_hits[state]) { continue; }
+
+		double prob = static_cast<double>(counters.end_hits[state]) / visits[state];
+		finals.push_back(std::to_string(this->states[state]) + ":" +
+			prob_to_string(prob));
+	}
+
+	for (TransId trans = 0; trans < this->num_trans(); ++trans)
+	{
+		if (0 == counters.trans_hits[trans]) { continue; }
+
+		DfaState src = this->trans_src[trans];
+		double prob = static_cast<double>(counters.trans_hits[trans]) / visits[src];
+		parsec.body.push_back({
+			std::to_string(this->states[src]),
+			std::to_string(static_cast<Symbol>(this->trans_symb[trans])) + ":" + prob_to_string(prob),
+			std::to_string(this->states[this->trans_tgt[trans]])});
+	}
+
+	return parsec;
+} // serialize_prob }}}
@@ -0,0 +1,308 @@
+/* nfa-parallel.cc -- parallel construction of NFAs from .vtf
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <exception>
+#include <thread>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+
+using Vata2::Parser::TokenLine;
+using Vata2::Parser::VtfScanner;
+
+
+namespace
+{
+
+/// a name in a chunk, given by the index of the chunk and its local ID there
+using NameRef = std::pair<uint32_t, uint32_t>;
+
+
+/// names interned in a chunk, numbered in the order of their first occurrence
+struct LocalNames
+{ // {{{
+	std::unordered_map<std::string, uint32_t> ids = {};
+	/// names by their IDs (pointing to keys of ids)
+	std::vector<const std::string*> names = {};
+
+	uint32_t intern(const std::string& name)
+	{ // {{{
+		auto it_insert_pair = this->ids.insert({name, this->names.size()});
+		if (it_insert_pair.second)
+		{
+			this->names.push_back(&it_insert_pair.first->first);
+		}
+
+		return it_insert_pair.first->second;
+	} // intern }}}
+}; // LocalNames }}}
+
+
+/// a chunk of the body and the results of its processing
+struct Chunk
+{ // {{{
+	const char* data = nullptr;
+	size_t size = 0;
+
+	LocalNames states = {};
+	LocalNames symbols = {};
+	/// initial and final states (local IDs)
+	std::vector<uint32_t> initial = {};
+	std::vector<uint32_t> final = {};
+	/// transitions as triples of local IDs of the source, symbol, and target
+	std::vector<uint32_t> trans = {};
+
+	/// local IDs of states in every shard
+	std::vector<std::vector<uint32_t>> shards = {};
+	/// the first occurrences of states among all chunks
+	std::vector<NameRef> first = {};
+	/// the resulting states and symbols
+	std::vector<State> global_states = {};
+	std::vector<Symbol> global_symbols = {};
+
+	/// an exception thrown while scanning the chunk
+	std::exception_ptr error = nullptr;
+}; // Chunk }}}
+
+
+/// hashing of strings given by pointers
+struct StringPtrHash
+{ // {{{
+	size_t operator()(const std::string* str) const
+	{
+		return std::hash<std::string>()(*str);
+	}
+}; // StringPtrHash }}}
+
+struct StringPtrEqual
+{ // {{{
+	bool operator()(const std::string* lhs, const std::string* rhs) const
+	{
+		return *lhs == *rhs;
+	}
+}; // StringPtrEqual }}}
+
+
+/// runs @p func(0), ..., @p func(@p n - 1) on @p n threads
+template <class Func>
+void run_parallel(size_t n, Func func)
+{ // {{{
+	if (1 == n)
+	{
+		func(0);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < n; ++i) { workers.emplace_back(func, i); }
+	for (std::thread& worker : workers) { worker.join(); }
+} // run_parallel }}}
+
+
+/// tokenizes @p chunk and interns names of its states and symbols
+void scan_chunk(Chunk* chunk, size_t num_shards)
+{ // {{{
+	assert(nullptr != chunk);
+
+	try
+	{
+		VtfScanner scanner(chunk->data, chunk->size);
+		scanner.start_body();
+
+		TokenLine line;
+		std::string key;
+		std::string name;
+		bool is_key;
+		while (scanner.next_line(&line, &is_key))
+		{
+			if (is_key)
+			{
+				line[0].assign_to(&key);
+				std::vector<uint32_t>* states = nullptr;
+				if ("Initial" == key) { states = &chunk->initial; }
+				else if ("Final" == key) { states = &chunk->final; }
+				else { continue; }
+
+				for (size_t i = 1; i < line.size(); ++i)
+				{
+					line[i].assign_to(&name);
+					states->push_back(chunk->states.intern(name));
+				}
+
+				continue;
+			}
+
+			if (line.size() != 3)
+			{
+				Vata2::Parser::BodyLine body_line;
+				for (const auto& token : line) { body_line.push_back(token.to_string()); }
+
+				if (line.size() == 2)
+				{
+					throw std::runtime_error("Epsilon transitions not supported: " +
+						std::to_string(body_line));
+				}
+				else
+				{
+					throw std::runtime_error("Invalid transition: " +
+						std::to_string(body_line));
+				}
+			}
+
+			line[0].assign_to(&name);
+			chunk->trans.push_back(chunk->states.intern(name));
+			line[1].assign_to(&name);
+			chunk->trans.push_back(chunk->symbols.intern(name));
+			line[2].assign_to(&name);
+			chunk->trans.push_back(chunk->states.intern(name));
+		}
+	}
+	catch (...)
+	{
+		chunk->error = std::current_exception();
+		return;
+	}
+
+	chunk->shards.resize(num_shards);
+	std::hash<std::string> hasher;
+	for (uint32_t i = 0; i < chunk->states.names.size(); ++i)
+	{
+		chunk->shards[hasher(*chunk->states.names[i]) % num_shards].push_back(i);
+	}
+
+	chunk->first.resize(chunk->states.names.size());
+	chunk->global_states.resize(chunk->states.names.size());
+} // scan_chunk }}}
+
+
+/// finds first occurrences of states of the shard @p shard among all chunks
+void merge_shard(std::vector<Chunk>* chunks, size_t shard)
+{ // {{{
+	assert(nullptr != chunks);
+
+	std::unordered_map<const std::string*, NameRef, StringPtrHash, StringPtrEqual>
+		firsts;
+	for (uint32_t i = 0; i < chunks->size(); ++i)
+	{
+		Chunk& chunk = (*chunks)[i];
+		for (uint32_t id : chunk.shards[shard])
+		{
+			auto it_insert_pair = firsts.insert({chunk.states.names[id], {i, id}});
+			chunk.first[id] = it_insert_pair.first->second;
+		}
+	}
+} // merge_shard }}}
+
+} // anonymous namespace
+
+
+void Vata2::Nfa::construct_parallel(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	StringToStateMap*           state_map,
+	size_t                      threads)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != scanner);
+	assert(nullptr != alphabet);
+
+	std::string type;
+	if (!scanner->next_section(&type) || type != Vata2::Nfa::TYPE_NFA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Nfa::TYPE_NFA + "\"");
+	}
+
+	if (0 == threads) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+
+	std::vector<Chunk> chunks;
+	for (const auto& data_size : scanner->split_section(threads))
+	{
+		chunks.emplace_back();
+		chunks.back().data = data_size.first;
+		chunks.back().size = data_size.second;
+	}
+
+	if (chunks.empty()) { return; }
+	threads = std::min(threads, chunks.size());
+
+	// tokenize chunks and intern names locally
+	run_parallel(chunks.size(), [&chunks, threads](size_t i) {
+		scan_chunk(&chunks[i], threads);
+	});
+
+	// the first error in the input is reported
+	for (const Chunk& chunk : chunks)
+	{
+		if (nullptr != chunk.error) { std::rethrow_exception(chunk.error); }
+	}
+
+	// find first occurrences of states (sharded by names)
+	run_parallel(threads, [&chunks](size_t shard) { merge_shard(&chunks, shard); });
+
+	// number first occurrences of states and translate symbols (the alphabet is
+	// not thread-safe)
+	State cnt_state = 0;
+	for (uint32_t i = 0; i < chunks.size(); ++i)
+	{
+		Chunk& chunk = chunks[i];
+		for (uint32_t id = 0; id < chunk.first.size(); ++id)
+		{
+			if (NameRef(i, id) != chunk.first[id]) { continue; }
+
+			chunk.global_states[id] = cnt_state++;
+			if (nullptr != state_map)
+			{
+				state_map->insert({*chunk.states.names[id], chunk.global_states[id]});
+			}
+		}
+
+		for (const std::string* symb : chunk.symbols.names)
+		{
+			chunk.global_symbols.push_back(alphabet->translate_symb(*symb));
+		}
+	}
+
+	// resolve other occurrences of states
+	run_parallel(chunks.size(), [&chunks](size_t i) {
+		Chunk& chunk = chunks[i];
+		for (uint32_t id = 0; id < chunk.first.size(); ++id)
+		{
+			// names are unique within a chunk, so other occurrences are elsewhere
+			const NameRef& first = chunk.first[id];
+			if (first.first != i)
+			{
+				chunk.global_states[id] = chunks[first.first].global_states[first.second];
+			}
+		}
+	});
+
+	// the automaton is a single hash table, so it is filled sequentially
+	for (const Chunk& chunk : chunks)
+	{
+		for (uint32_t id : chunk.initial) { aut->add_initial(chunk.global_states[id]); }
+		for (uint32_t id : chunk.final) { aut->add_final(chunk.global_states[id]); }
+		for (size_t j = 0; j < chunk.trans.size(); j += 3)
+		{
+			aut->add_trans(chunk.global_states[chunk.trans[j]],
+				chunk.global_symbols[chunk.trans[j + 1]],
+				chunk.global_states[chunk.trans[j + 2]]);
+		}
+	}
+} // construct_parallel }}}
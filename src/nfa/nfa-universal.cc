@@ -17,6 +17,7 @@
 
 // VATA headers
 #include <vata2/nfa.hh>
+#include <vata2/stats.hh>
 
 using namespace Vata2::Nfa;
 using namespace Vata2::util;
@@ -56,6 +57,7 @@ bool is_universal_antichains(
 	using ProcessedType = std::list<StateSet>;
 
 	auto subsumes = [](const StateSet& lhs, const StateSet& rhs) {
+		VATA_STATS_INC(SUBSUMPTION_CHECKS);
 		if (lhs.size() > rhs.size()) { // bigger set cannot be subset
 			return false;
 		}
@@ -76,7 +78,10 @@ bool is_universal_antichains(
 	// initialize
 	WorklistType worklist = { aut.initialstates };
 	ProcessedType processed = { aut.initialstates };
-	std::list<Symbol> alph_symbols = alphabet.get_symbols();
+	std::vector<Symbol> alph_symbols;
+	alphabet.for_each_symbol([&alph_symbols](Symbol symb) {
+		alph_symbols.push_back(symb);
+	});
 
 	// 'paths[s] == t' denotes that state 's' was accessed from state 't',
 	// 'paths[s] == s' means that 's' is an initial state
@@ -97,6 +102,7 @@ bool is_universal_antichains(
 		// process it
 		for (Symbol symb : alph_symbols) {
 			StateSet succ = aut.post(state, symb);
+			VATA_STATS_INC(MACROSTATES);
 			if (are_disjoint(succ, aut.finalstates)) {
 				if (nullptr != cex) {
 					cex->clear();
@@ -123,7 +129,10 @@ bool is_universal_antichains(
 				}
 			}
 
-			if (is_subsumed) { continue; }
+			if (is_subsumed) {
+				VATA_STATS_INC(PRUNED);
+				continue;
+			}
 
 			// prune data structures and insert succ inside
 			for (std::list<StateSet>* ds : {&processed, &worklist}) {
@@ -133,6 +142,7 @@ bool is_universal_antichains(
 						auto to_remove = it;
 						++it;
 						ds->erase(to_remove);
+						VATA_STATS_INC(PRUNED);
 					} else {
 						++it;
 					}
@@ -142,6 +152,8 @@ bool is_universal_antichains(
 				ds->push_back(succ);
 			}
 
+			VATA_STATS_MAX(PEAK_WORKLIST, worklist.size());
+
 			// also set that succ was accessed from state
 			paths[succ] = {state, symb};
 		}
@@ -160,6 +172,7 @@ bool Vata2::Nfa::is_universal(
 	Word*              cex,
 	const StringDict&  params)
 { // {{{
+	VATA_STATS_TIMER(UNIVERSALITY);
 
 	// setting the default algorithm
 	decltype(is_universal_naive)* algo = is_universal_naive;
@@ -0,0 +1,248 @@
+/* nfa-write.cc -- fast writing of NFAs in the .vtf format
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <exception>
+#include <thread>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+
+
+namespace
+{
+
+/// the number of transitions in a block of states formatted at once
+const size_t BLOCK_TRANS = 1 << 16;
+
+/// the size of the output buffer that is flushed into the stream
+const size_t FLUSH_SIZE = 1 << 20;
+
+
+/// a state with outgoing transitions
+struct Row
+{ // {{{
+	State state;
+	const PostSymb* post;
+	size_t num_trans;
+}; // Row }}}
+
+
+/// formats names of states and symbols into buffers
+class NameFormatter
+{ // {{{
+private:
+
+	const SymbolToStringMap* symbol_map;
+	const StateToStringMap* state_map;
+
+	/// appends @p prefix followed by decimal digits of @p num
+	static void append_number(std::string* buf, char prefix, uintptr_t num)
+	{ // {{{
+		char digits[24];
+		char* end = digits + sizeof(digits);
+		char* begin = end;
+		do
+		{
+			*--begin = '0' + num % 10;
+			num /= 10;
+		} while (0 != num);
+
+		*--begin = prefix;
+		buf->append(begin, end);
+	} // append_number }}}
+
+public:
+
+	NameFormatter(
+		const SymbolToStringMap*  symbol_map,
+		const StateToStringMap*   state_map) :
+		symbol_map(symbol_map),
+		state_map(state_map)
+	{ }
+
+	void append_state(std::string* buf, State state) const
+	{ // {{{
+		if (nullptr == this->state_map)
+		{
+			append_number(buf, 'q', state);
+			return;
+		}
+
+		auto it = this->state_map->find(state);
+		if (this->state_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate state " + std::to_string(state));
+		}
+
+		buf->append(it->second);
+	} // append_state }}}
+
+	void append_symbol(std::string* buf, Symbol symb) const
+	{ // {{{
+		if (nullptr == this->symbol_map)
+		{
+			append_number(buf, 'a', symb);
+			return;
+		}
+
+		auto it = this->symbol_map->find(symb);
+		if (this->symbol_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate symbol " + std::to_string(symb));
+		}
+
+		buf->append(it->second);
+	} // append_symbol }}}
+}; // NameFormatter }}}
+
+
+/// appends transitions of states [@p begin, @p end) to @p buf
+void format_rows(
+	const NameFormatter&  names,
+	const Row*            begin,
+	const Row*            end,
+	std::string*          buf)
+{ // {{{
+	assert(nullptr != buf);
+
+	// the prefixes "src symb " are formatted once for all targets
+	std::string prefix;
+	for (const Row* row = begin; row != end; ++row)
+	{
+		for (const auto& symb_tgts : *row->post)
+		{
+			prefix.clear();
+			names.append_state(&prefix, row->state);
+			prefix += ' ';
+			names.append_symbol(&prefix, symb_tgts.first);
+			prefix += ' ';
+
+			for (State tgt : symb_tgts.second)
+			{
+				buf->append(prefix);
+				names.append_state(buf, tgt);
+				*buf += '\n';
+			}
+		}
+	}
+} // format_rows }}}
+
+} // anonymous namespace
+
+
+void Vata2::Nfa::write_vtf(
+	std::ostream&             os,
+	const Nfa&                aut,
+	const SymbolToStringMap*  symbol_map,
+	const StateToStringMap*   state_map,
+	size_t                    threads)
+{ // {{{
+	NameFormatter names(symbol_map, state_map);
+
+	// the same order of keys as in ParsedSection::dict
+	std::string buf = "@" + Vata2::Nfa::TYPE_NFA + "\n%Final";
+	for (State state : aut.finalstates)
+	{
+		buf += ' ';
+		names.append_state(&buf, state);
+	}
+	buf += "\n%Initial";
+	for (State state : aut.initialstates)
+	{
+		buf += ' ';
+		names.append_state(&buf, state);
+	}
+	buf += "\n# Body:\n";
+
+	// states are written in the order of iteration over the automaton
+	std::vector<Row> rows;
+	for (const auto& trans : aut)
+	{
+		if (rows.empty() || rows.back().state != trans.src)
+		{
+			rows.push_back({trans.src, &aut[trans.src], 0});
+		}
+
+		++rows.back().num_trans;
+	}
+
+	// split states into blocks with at least BLOCK_TRANS transitions
+	std::vector<size_t> blocks = {0};
+	size_t block_trans = 0;
+	for (size_t i = 0; i < rows.size(); ++i)
+	{
+		block_trans += rows[i].num_trans;
+		if (block_trans >= BLOCK_TRANS || i + 1 == rows.size())
+		{
+			blocks.push_back(i + 1);
+			block_trans = 0;
+		}
+	}
+
+	if (threads <= 1 || blocks.size() <= 2)
+	{
+		for (size_t i = 0; i + 1 < blocks.size(); ++i)
+		{
+			format_rows(names, &rows[0] + blocks[i], &rows[0] + blocks[i + 1], &buf);
+			if (buf.size() >= FLUSH_SIZE)
+			{
+				os.write(buf.data(), buf.size());
+				buf.clear();
+			}
+		}
+
+		os.write(buf.data(), buf.size());
+		return;
+	}
+
+	os.write(buf.data(), buf.size());
+
+	// rounds of blocks formatted in parallel, each into its own buffer
+	size_t num_blocks = blocks.size() - 1;
+	std::vector<std::string> bufs(threads);
+	std::vector<std::exception_ptr> errors(threads);
+	for (size_t round = 0; round < num_blocks; round += threads)
+	{
+		size_t round_blocks = std::min(threads, num_blocks - round);
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < round_blocks; ++i)
+		{
+			workers.emplace_back([&, i]() {
+				bufs[i].clear();
+				try
+				{
+					format_rows(names, &rows[0] + blocks[round + i],
+						&rows[0] + blocks[round + i + 1], &bufs[i]);
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			});
+		}
+
+		for (std::thread& worker : workers) { worker.join(); }
+
+		for (size_t i = 0; i < round_blocks; ++i)
+		{
+			if (nullptr != errors[i]) { std::rethrow_exception(errors[i]); }
+			os.write(bufs[i].data(), bufs[i].size());
+		}
+	}
+} // write_vtf }}}
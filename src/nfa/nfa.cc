@@ -16,11 +16,14 @@
  */
 
 #include <algorithm>
+#include <iterator>
 #include <list>
+#include <thread>
 #include <unordered_set>
 
 // VATA headers
 #include <vata2/nfa.hh>
+#include <vata2/stats.hh>
 #include <vata2/util.hh>
 #include <vata2/vm-dispatch.hh>
 
@@ -78,65 +81,78 @@ std::list<Symbol> OnTheFlyAlphabet::get_complement(
 	return result;
 } // OnTheFlyAlphabet::get_complement }}}
 
-std::list<Symbol> EnumAlphabet::get_symbols() const
+namespace
+{
+
+/// symbols 0, ..., @p dense_size - 1 of a dense alphabet
+std::list<Symbol> get_dense_symbols(size_t dense_size)
 { // {{{
 	std::list<Symbol> result;
-	for (const auto& str_sym_pair : this->symbol_map)
+	for (Symbol symb = 0; symb < dense_size; ++symb)
 	{
-		result.push_back(str_sym_pair.second);
+		result.push_back(symb);
 	}
 
 	return result;
-} // EnumAlphabet::get_symbols }}}
+} // get_dense_symbols }}}
 
-std::list<Symbol> EnumAlphabet::get_complement(
-	const std::set<Symbol>& syms) const
+/// complement of @p syms wrt a dense alphabet (computed using a bitset)
+std::list<Symbol> get_dense_complement(
+	size_t                   dense_size,
+	const std::set<Symbol>&  syms)
 { // {{{
-	std::list<Symbol> result;
-
-	// TODO: could be optimized
-	std::set<Symbol> symbols_alphabet;
-	for (const auto& str_sym_pair : this->symbol_map)
+	std::vector<bool> present(dense_size, false);
+	for (Symbol symb : syms)
 	{
-		symbols_alphabet.insert(str_sym_pair.second);
+		if (symb < dense_size) { present[symb] = true; }
 	}
 
-	std::set_difference(
-		symbols_alphabet.begin(), symbols_alphabet.end(),
-		syms.begin(), syms.end(),
-		std::inserter(result, result.end()));
-
-	return result;
-} // EnumAlphabet::get_complement }}}
-
-
-std::list<Symbol> CharAlphabet::get_symbols() const
-{ // {{{
 	std::list<Symbol> result;
-	for (size_t i = 0; i < 256; ++i)
+	for (Symbol symb = 0; symb < dense_size; ++symb)
 	{
-		result.push_back(i);
+		if (!present[symb]) { result.push_back(symb); }
 	}
 
 	return result;
-} // CharAlphabet::get_symbols }}}
+} // get_dense_complement }}}
 
-std::list<Symbol> CharAlphabet::get_complement(
+} // anonymous namespace
+
+std::list<Symbol> PooledAlphabet::get_symbols() const
+{ // {{{
+	return std::list<Symbol>(this->symbols.begin(), this->symbols.end());
+} // PooledAlphabet::get_symbols }}}
+
+std::list<Symbol> PooledAlphabet::get_complement(
 	const std::set<Symbol>& syms) const
 { // {{{
 	std::list<Symbol> result;
+	std::set_difference(this->symbols.begin(), this->symbols.end(),
+		syms.begin(), syms.end(), std::back_inserter(result));
+	return result;
+} // PooledAlphabet::get_complement }}}
 
-	std::list<Symbol> symb_list = this->get_symbols();
+std::list<Symbol> EnumAlphabet::get_symbols() const
+{ // {{{
+	return get_dense_symbols(this->get_dense_size());
+} // EnumAlphabet::get_symbols }}}
 
-	// TODO: could be optimized
-	std::set<Symbol> symbols_alphabet(symb_list.begin(), symb_list.end());
+std::list<Symbol> EnumAlphabet::get_complement(
+	const std::set<Symbol>& syms) const
+{ // {{{
+	return get_dense_complement(this->get_dense_size(), syms);
+} // EnumAlphabet::get_complement }}}
 
-	std::set_difference(
-		symbols_alphabet.begin(), symbols_alphabet.end(),
-		syms.begin(), syms.end(),
-		std::inserter(result, result.end()));
 
-	return result;
+std::list<Symbol> CharAlphabet::get_symbols() const
+{ // {{{
+	return get_dense_symbols(this->get_dense_size());
+} // CharAlphabet::get_symbols }}}
+
+std::list<Symbol> CharAlphabet::get_complement(
+	const std::set<Symbol>& syms) const
+{ // {{{
+	return get_dense_complement(this->get_dense_size(), syms);
 } // CharAlphabet::get_complement }}}
 
 
@@ -149,7 +165,7 @@ void Nfa::add_trans(const Trans& trans)
 		auto jt = post.find(trans.symb);
 		if (jt != post.end())
 		{
-			jt->second.insert(trans.tgt);
+			if (!jt->second.insert(trans.tgt).second) { return; }
 		}
 		else
 		{
@@ -161,8 +177,58 @@ void Nfa::add_trans(const Trans& trans)
 		this->transitions.insert(
 			{trans.src, PostSymb({{trans.symb, StateSet({trans.tgt})}})});
 	}
+
+	this->trans_hash ^= std::hash<Trans>{}(trans);
 } // add_trans }}}
 
+void Nfa::remove_trans(const Trans& trans)
+{ // {{{
+	auto it = this->transitions.find(trans.src);
+	if (it == this->transitions.end()) { return; }
+
+	PostSymb& post = it->second;
+	auto jt = post.find(trans.symb);
+	if (jt == post.end()) { return; }
+
+	if (0 == jt->second.erase(trans.tgt)) { return; }
+	this->trans_hash ^= std::hash<Trans>{}(trans);
+
+	// empty containers need to be removed, the iterator relies on that
+	if (jt->second.empty())
+	{
+		post.erase(jt);
+		if (post.empty()) { this->transitions.erase(it); }
+	}
+} // remove_trans }}}
+
+size_t Nfa::hash() const
+{ // {{{
+	size_t accum = hash_range(this->initialstates.begin(), this->initialstates.end());
+	accum = hash_combine(accum,
+		hash_range(this->finalstates.begin(), this->finalstates.end()));
+	accum = hash_combine(accum, this->trans_hash);
+	return accum;
+} // hash }}}
+
+bool Vata2::Nfa::operator==(const Nfa& lhs, const Nfa& rhs)
+{ // {{{
+	if (lhs.hash() != rhs.hash()) { return false; }
+
+	if (lhs.initialstates != rhs.initialstates ||
+		lhs.finalstates != rhs.finalstates ||
+		lhs.trans_size() != rhs.trans_size())
+	{
+		return false;
+	}
+
+	for (const Trans& trans : lhs)
+	{
+		if (!rhs.has_trans(trans)) { return false; }
+	}
+
+	return true;
+} // operator== }}}
+
 bool Nfa::has_trans(const Trans& trans) const
 { // {{{
 	auto it = this->transitions.find(trans.src);
@@ -284,6 +350,8 @@ StateSet Nfa::post(
 	const StateSet&  macrostate,
 	Symbol           sym) const
 { // {{{
+	VATA_STATS_INC(POST_CALLS);
+
 	StateSet result;
 	for (State state : macrostate)
 	{
@@ -304,7 +372,8 @@ StateSet Nfa::post(
 
 std::ostream& Vata2::Nfa::operator<<(std::ostream& os, const Nfa& nfa)
 { // {{{
-	return os << std::to_string(serialize(nfa));
+	write_vtf(os, nfa);
+	return os;
 } // Nfa::operator<<(ostream) }}}
 
 
@@ -416,6 +485,8 @@ void Vata2::Nfa::intersection(
 	const Nfa&   rhs,
 	ProductMap*  prod_map)
 { // {{{
+	VATA_STATS_TIMER(INTERSECTION);
+
 	bool remove_prod_map = false;
 	if (nullptr == prod_map)
 	{
@@ -474,6 +545,8 @@ void Vata2::Nfa::intersection(
 								++cnt_state;
 
 								worklist.push_back({lhs_tr.tgt, rhs_tr.tgt, tgt_state});
+								VATA_STATS_INC(MACROSTATES);
+								VATA_STATS_MAX(PEAK_WORKLIST, worklist.size());
 							}
 							else
 							{
@@ -488,6 +561,9 @@ void Vata2::Nfa::intersection(
 		}
 	}
 
+	VATA_STATS_MAX(PEAK_MAP_SIZE, prod_map->size());
+	VATA_STATS_MAX(PEAK_MAP_LOAD, static_cast<uint64_t>(1000 * prod_map->load_factor()));
+
 	if (remove_prod_map)
 	{
 		delete prod_map;
@@ -495,85 +571,6 @@ void Vata2::Nfa::intersection(
 } // intersection }}}
 
 
-bool Vata2::Nfa::is_lang_empty(const Nfa& aut, Path* cex)
-{ // {{{
-	std::list<State> worklist(
-		aut.initialstates.begin(), aut.initialstates.end());
-	std::unordered_set<State> processed(
-		aut.initialstates.begin(), aut.initialstates.end());
-
-	// 'paths[s] == t' denotes that state 's' was accessed from state 't',
-	// 'paths[s] == s' means that 's' is an initial state
-	std::map<State, State> paths;
-	for (State s : worklist)
-	{	// initialize
-		paths[s] = s;
-	}
-
-	while (!worklist.empty())
-	{
-		State state = worklist.front();
-		worklist.pop_front();
-
-		if (haskey(aut.finalstates, state))
-		{
-			// TODO process the CEX
-			if (nullptr != cex)
-			{
-				cex->clear();
-				cex->push_back(state);
-				while (paths[state] != state)
-				{
-					state = paths[state];
-					cex->push_back(state);
-				}
-
-				std::reverse(cex->begin(), cex->end());
-			}
-
-			return false;
-		}
-
-		for (const auto& symb_stateset : aut[state])
-		{
-			const StateSet& stateset = symb_stateset.second;
-			for (const auto& tgt_state : stateset)
-			{
-				bool inserted;
-				tie(std::ignore, inserted) = processed.insert(tgt_state);
-				if (inserted)
-				{
-					worklist.push_back(tgt_state);
-					// also set that tgt_state was accessed from state
-					paths[tgt_state] = state;
-				}
-				else
-				{
-					// the invariant
-					assert(haskey(paths, tgt_state));
-				}
-			}
-		}
-	}
-
-	return true;
-} // is_lang_empty }}}
-
-
-bool Vata2::Nfa::is_lang_empty_cex(const Nfa& aut, Word* cex)
-{ // {{{
-	assert(nullptr != cex);
-
-	Path path = { };
-	bool result = is_lang_empty(aut, &path);
-	if (result) { return true; }
-	bool consistent;
-	tie(*cex, consistent) = get_word_for_path(aut, path);
-	assert(consistent);
-
-	return false;
-} // is_lang_empty_cex }}}
-
 std::unordered_set<State> Vata2::Nfa::get_fwd_reach_states(const Nfa& aut)
 {
 	std::list<State> worklist(
@@ -612,6 +609,7 @@ void Vata2::Nfa::determinize(
 	State*      last_state_num)
 { // {{{
 	assert(nullptr != result);
+	VATA_STATS_TIMER(DETERMINIZE);
 
 	bool delete_map = false;
 	if (nullptr == subset_map)
@@ -627,6 +625,7 @@ void Vata2::Nfa::determinize(
 	result->initialstates = {cnt_state};
 	worklist.push_back({&it_bool_pair.first->first, cnt_state});
 	++cnt_state;
+	VATA_STATS_INC(MACROSTATES);
 
 	while (!worklist.empty())
 	{
@@ -666,6 +665,8 @@ void Vata2::Nfa::determinize(
 			{ // if not processed yet, add to the queue
 				worklist.push_back({&it_bool_pair.first->first, cnt_state});
 				++cnt_state;
+				VATA_STATS_INC(MACROSTATES);
+				VATA_STATS_MAX(PEAK_WORKLIST, worklist.size());
 			}
 
 			State post_state = it_bool_pair.first->second;
@@ -673,6 +674,9 @@ void Vata2::Nfa::determinize(
 		}
 	}
 
+	VATA_STATS_MAX(PEAK_MAP_SIZE, subset_map->size());
+	VATA_STATS_MAX(PEAK_MAP_LOAD, static_cast<uint64_t>(1000 * subset_map->load_factor()));
+
 	if (delete_map)
 	{
 		delete subset_map;
@@ -699,6 +703,10 @@ void Vata2::Nfa::make_complete(
 	worklist.push_back(sink_state);
 	processed.insert(sink_state);
 
+	// symbols of dense alphabets used by a state are kept in a bitset
+	const size_t dense_size = alphabet.get_dense_size();
+	std::vector<bool> used_dense(dense_size, false);
+
 	while (!worklist.empty())
 	{
 		State state = *worklist.begin();
@@ -707,7 +715,11 @@ void Vata2::Nfa::make_complete(
 		std::set<Symbol> used_symbols;
 		for (const auto& symb_stateset : (*aut)[state])
 		{
-			used_symbols.insert(symb_stateset.first);
+			if (0 == dense_size) { used_symbols.insert(symb_stateset.first); }
+			else if (symb_stateset.first < dense_size)
+			{
+				used_dense[symb_stateset.first] = true;
+			}
 
 			const StateSet& stateset = symb_stateset.second;
 			for (const auto& tgt_state : stateset)
@@ -718,6 +730,17 @@ void Vata2::Nfa::make_complete(
 			}
 		}
 
+		if (0 != dense_size)
+		{
+			for (Symbol symb = 0; symb < dense_size; ++symb)
+			{
+				if (!used_dense[symb]) { aut->add_trans(state, symb, sink_state); }
+				used_dense[symb] = false;
+			}
+
+			continue;
+		}
+
 		auto unused_symbols = alphabet.get_complement(used_symbols);
 		for (Symbol symb : unused_symbols)
 		{
@@ -923,6 +946,8 @@ void Vata2::Nfa::minimize(
 { // {{{
 	assert(nullptr != result);
 
+	VATA_STATS_TIMER(MINIMIZE);
+
 	DEBUG_PRINT("ignoring parameters of minimization and using default");
 	assert(&params);
 
@@ -937,47 +962,23 @@ void Vata2::Nfa::minimize(
 } // minimize }}}
 
 
-void Vata2::Nfa::construct(
+namespace
+{
+
+/// loads the body of @p parsec into @p aut, translating states by @p get_state
+template <class GetState>
+void construct_body(
 	Nfa*                                 aut,
 	const Vata2::Parser::ParsedSection&  parsec,
 	Alphabet*                            alphabet,
-	StringToStateMap*                    state_map)
+	GetState                             get_state)
 { // {{{
-	assert(nullptr != aut);
-	assert(nullptr != alphabet);
-
-	if (parsec.type != Vata2::Nfa::TYPE_NFA) {
-		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
-			Vata2::Nfa::TYPE_NFA + "\"");
-	}
-
-	bool remove_state_map = false;
-	if (nullptr == state_map) {
-		state_map = new StringToStateMap();
-		remove_state_map = true;
-	}
-
-	State cnt_state = 0;
-
-	// a lambda for translating state names to identifiers
-	auto get_state_name = [state_map, &cnt_state](const std::string& str) {
-		auto it_insert_pair = state_map->insert({str, cnt_state});
-		if (it_insert_pair.second) { return cnt_state++; }
-		else { return it_insert_pair.first->second; }
-	};
-
-	// a lambda for cleanup
-	auto clean_up = [&]() {
-		if (remove_state_map) { delete state_map; }
-	};
-
-
 	auto it = parsec.dict.find("Initial");
 	if (parsec.dict.end() != it)
 	{
 		for (const auto& str : it->second)
 		{
-			State state = get_state_name(str);
+			State state = get_state(str);
 			aut->initialstates.insert(state);
 		}
 	}
@@ -988,7 +989,7 @@ void Vata2::Nfa::construct(
 	{
 		for (const auto& str : it->second)
 		{
-			State state = get_state_name(str);
+			State state = get_state(str);
 			aut->finalstates.insert(state);
 		}
 	}
@@ -997,9 +998,6 @@ void Vata2::Nfa::construct(
 	{
 		if (body_line.size() != 3)
 		{
-			// clean up
-			clean_up();
-
 			if (body_line.size() == 2)
 			{
 				throw std::runtime_error("Epsilon transitions not supported: " +
@@ -1012,18 +1010,186 @@ void Vata2::Nfa::construct(
 			}
 		}
 
-		State src_state = get_state_name(body_line[0]);
+		State src_state = get_state(body_line[0]);
 		Symbol symbol = alphabet->translate_symb(body_line[1]);
-		State tgt_state = get_state_name(body_line[2]);
+		State tgt_state = get_state(body_line[2]);
+
+		aut->add_trans(src_state, symbol, tgt_state);
+	}
+} // construct_body(ParsedSection) }}}
+
+
+/// loads the body of the current section of @p scanner into @p aut,
+/// translating states by @p get_state
+template <class GetState>
+void construct_body(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	GetState                    get_state)
+{ // {{{
+	// buffers for tokens are reused so that no allocation is needed for most lines
+	Vata2::Parser::TokenLine line;
+	std::string key;
+	std::string src;
+	std::string symb;
+	std::string tgt;
+	bool is_key;
+	while (scanner->next_line(&line, &is_key))
+	{
+		if (is_key)
+		{
+			line[0].assign_to(&key);
+			StateSet* states = nullptr;
+			if ("Initial" == key) { states = &aut->initialstates; }
+			else if ("Final" == key) { states = &aut->finalstates; }
+			else { continue; }
+
+			for (size_t i = 1; i < line.size(); ++i)
+			{
+				line[i].assign_to(&src);
+				states->insert(get_state(src));
+			}
+
+			continue;
+		}
+
+		if (line.size() != 3)
+		{
+			Vata2::Parser::BodyLine body_line;
+			for (const auto& token : line) { body_line.push_back(token.to_string()); }
+
+			if (line.size() == 2)
+			{
+				throw std::runtime_error("Epsilon transitions not supported: " +
+					std::to_string(body_line));
+			}
+			else
+			{
+				throw std::runtime_error("Invalid transition: " +
+					std::to_string(body_line));
+			}
+		}
+
+		line[0].assign_to(&src);
+		line[1].assign_to(&symb);
+		line[2].assign_to(&tgt);
+
+		State src_state = get_state(src);
+		Symbol symbol = alphabet->translate_symb(symb);
+		State tgt_state = get_state(tgt);
 
 		aut->add_trans(src_state, symbol, tgt_state);
 	}
+} // construct_body(VtfScanner) }}}
+
+} // anonymous namespace
 
-	// do the dishes and take out garbage
-	clean_up();
+
+void Vata2::Nfa::construct(
+	Nfa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != alphabet);
+
+	if (parsec.type != Vata2::Nfa::TYPE_NFA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Nfa::TYPE_NFA + "\"");
+	}
+
+	StringToStateMap local_state_map;
+	if (nullptr == state_map) { state_map = &local_state_map; }
+
+	State cnt_state = 0;
+
+	// a lambda for translating state names to identifiers
+	auto get_state_name = [state_map, &cnt_state](const std::string& str) {
+		auto it_insert_pair = state_map->insert({str, cnt_state});
+		if (it_insert_pair.second) { return cnt_state++; }
+		else { return it_insert_pair.first->second; }
+	};
+
+	construct_body(aut, parsec, alphabet, get_state_name);
 } // construct }}}
 
 
+void Vata2::Nfa::construct(
+	Nfa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	Vata2::util::StringPool*             state_pool)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != alphabet);
+	assert(nullptr != state_pool);
+
+	if (parsec.type != Vata2::Nfa::TYPE_NFA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Nfa::TYPE_NFA + "\"");
+	}
+
+	construct_body(aut, parsec, alphabet, [state_pool](const std::string& str) {
+		return static_cast<State>(state_pool->intern(str));
+	});
+} // construct(StringPool) }}}
+
+
+void Vata2::Nfa::construct(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	StringToStateMap*           state_map)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != scanner);
+	assert(nullptr != alphabet);
+
+	std::string type;
+	if (!scanner->next_section(&type) || type != Vata2::Nfa::TYPE_NFA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Nfa::TYPE_NFA + "\"");
+	}
+
+	StringToStateMap local_state_map;
+	if (nullptr == state_map) { state_map = &local_state_map; }
+
+	State cnt_state = 0;
+	auto get_state_name = [state_map, &cnt_state](const std::string& str) {
+		auto it_insert_pair = state_map->insert({str, cnt_state});
+		if (it_insert_pair.second) { return cnt_state++; }
+		else { return it_insert_pair.first->second; }
+	};
+
+	construct_body(aut, scanner, alphabet, get_state_name);
+} // construct(VtfScanner) }}}
+
+
+void Vata2::Nfa::construct(
+	Nfa*                        aut,
+	Vata2::Parser::VtfScanner*  scanner,
+	Alphabet*                   alphabet,
+	Vata2::util::StringPool*    state_pool)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != scanner);
+	assert(nullptr != alphabet);
+	assert(nullptr != state_pool);
+
+	std::string type;
+	if (!scanner->next_section(&type) || type != Vata2::Nfa::TYPE_NFA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Nfa::TYPE_NFA + "\"");
+	}
+
+	construct_body(aut, scanner, alphabet, [state_pool](const std::string& str) {
+		return static_cast<State>(state_pool->intern(str));
+	});
+} // construct(VtfScanner, StringPool) }}}
+
+
 void Vata2::Nfa::construct(
 	Nfa*                                 aut,
 	const Vata2::Parser::ParsedSection&  parsec,
@@ -1071,6 +1237,97 @@ bool Vata2::Nfa::is_in_lang(const Nfa& aut, const Word& word)
 } // is_in_lang }}}
 
 
+namespace {
+/**
+ * Checks words at positions @p order[begin], ..., @p order[end - 1] where
+ * @p order sorts @p words lexicographically
+ */
+void is_in_lang_range(
+	const Nfa&                  aut,
+	const std::vector<Word>&    words,
+	const std::vector<size_t>&  order,
+	size_t                      begin,
+	size_t                      end,
+	std::vector<char>*          results)
+{ // {{{
+	// macrostates[i] is reached after reading the first i symbols of the
+	// previous word (the computation stops at the first empty macrostate)
+	std::vector<StateSet> macrostates = {aut.initialstates};
+	const Word* prev = nullptr;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const Word& word = words[order[i]];
+
+		size_t common = 0;
+		if (nullptr != prev)
+		{
+			size_t max_common = std::min(word.size(), macrostates.size() - 1);
+			while (common < max_common && (*prev)[common] == word[common]) { ++common; }
+		}
+
+		macrostates.resize(common + 1);
+		while (macrostates.size() <= word.size() && !macrostates.back().empty())
+		{
+			macrostates.push_back(
+				aut.post(macrostates.back(), word[macrostates.size() - 1]));
+		}
+
+		(*results)[order[i]] = (macrostates.size() == word.size() + 1) &&
+			!are_disjoint(macrostates.back(), aut.finalstates);
+		prev = &word;
+	}
+} // is_in_lang_range }}}
+}
+
+
+std::vector<bool> Vata2::Nfa::is_in_lang_many(
+	const Nfa&                aut,
+	const std::vector<Word>&  words,
+	const StringDict&         params)
+{ // {{{
+	size_t threads = 1;
+	if (haskey(params, "threads"))
+	{
+		threads = std::stoul(params.at("threads"));
+		if (0 == threads) {
+			throw std::runtime_error(std::to_string(__func__) +
+				" requires a positive number of threads; received: " +
+				std::to_string(params));
+		}
+	}
+
+	std::vector<size_t> order(words.size());
+	for (size_t i = 0; i < order.size(); ++i) { order[i] = i; }
+	std::sort(order.begin(), order.end(), [&words](size_t lhs, size_t rhs) {
+		return words[lhs] < words[rhs];
+	});
+
+	// std::vector<bool> cannot be written concurrently
+	std::vector<char> results(words.size(), false);
+	threads = std::min(threads, std::max<size_t>(words.size(), 1));
+	if (1 == threads)
+	{
+		is_in_lang_range(aut, words, order, 0, words.size(), &results);
+	}
+	else
+	{ // every thread gets a contiguous chunk of sorted words
+		std::vector<std::thread> workers;
+		size_t chunk = (words.size() + threads - 1) / threads;
+		for (size_t begin = 0; begin < words.size(); begin += chunk)
+		{
+			size_t end = std::min(begin + chunk, words.size());
+			workers.emplace_back(is_in_lang_range, std::cref(aut), std::cref(words),
+				std::cref(order), begin, end, &results);
+		}
+
+		for (std::thread& worker : workers) { worker.join(); }
+	}
+
+	return std::vector<bool>(results.begin(), results.end());
+} // is_in_lang_many }}}
+
+
 bool Vata2::Nfa::is_prfx_in_lang(const Nfa& aut, const Word& word)
 { // {{{
 	StateSet cur = aut.initialstates;
@@ -1102,8 +1359,14 @@ bool Vata2::Nfa::is_deterministic(const Nfa& aut)
 
 bool Vata2::Nfa::is_complete(const Nfa& aut, const Alphabet& alphabet)
 { // {{{
-	std::list<Symbol> symbs_ls = alphabet.get_symbols();
-	std::unordered_set<Symbol> symbs(symbs_ls.cbegin(), symbs_ls.cend());
+	// symbols of dense alphabets are not collected
+	const size_t dense_size = alphabet.get_dense_size();
+	std::unordered_set<Symbol> symbs;
+	if (0 == dense_size)
+	{
+		alphabet.for_each_symbol([&symbs](Symbol symb) { symbs.insert(symb); });
+	}
+	const size_t num_symbs = (0 == dense_size)? symbs.size() : dense_size;
 
 	// TODO: make a general function for traversal over reachable states that can
 	// be shared by other functions?
@@ -1121,7 +1384,8 @@ bool Vata2::Nfa::is_complete(const Nfa& aut, const Alphabet& alphabet)
 		for (const auto& symb_stateset : aut[state])
 		{
 			++n;
-			if (!haskey(symbs, symb_stateset.first))
+			if ((0 == dense_size)? !haskey(symbs, symb_stateset.first) :
+				symb_stateset.first >= dense_size)
 			{
 				throw std::runtime_error(std::to_string(__func__) +
 					": encountered a symbol that is not in the provided alphabet");
@@ -1136,7 +1400,7 @@ bool Vata2::Nfa::is_complete(const Nfa& aut, const Alphabet& alphabet)
 			}
 		}
 
-		if (symbs.size() != n) { return false; }
+		if (num_symbs != n) { return false; }
 	}
 
 	return true;
@@ -1153,7 +1417,7 @@ bool Vata2::Nfa::accepts_epsilon(const Nfa& aut)
 
 std::ostream& std::operator<<(std::ostream& os, const Vata2::Nfa::NfaWrapper& nfa_wrap)
 { // {{{
-	os << "{NFA wrapper|NFA: " << nfa_wrap.nfa << "|alphabet: " << nfa_wrap.alphabet <<
-		"|state_dict: " << std::to_string(nfa_wrap.state_dict) << "}";
+	os << "{NFA wrapper|NFA: " << nfa_wrap.nfa << "|alphabet: " << nfa_wrap.alphabet.get() <<
+		"|state_dict: " << std::to_string(*nfa_wrap.state_dict) << "}";
 	return os;
 } // operator<<(NfaWrapper) }}}
@@ -31,13 +31,35 @@ TEST_CASE("Vata2::VM::find_dispatcher(\"NFA\")")
 		parsec.type = Vata2::Nfa::TYPE_NFA;
 
 		VMValue res = find_dispatcher(Vata2::Nfa::TYPE_NFA)("construct",
-			{{Vata2::TYPE_PARSEC, &parsec}});
+			{VMValue::borrow(Vata2::TYPE_PARSEC, &parsec)});
 		REQUIRE(Vata2::Nfa::TYPE_NFA == res.type);
 		const Nfa* aut = static_cast<const Nfa*>(res.get_ptr());
 		REQUIRE(aut->trans_empty());
 		REQUIRE(aut->initialstates.empty());
 		REQUIRE(aut->finalstates.empty());
-		delete aut;
+	}
+
+	SECTION("construct with EnumAlphabet")
+	{
+		Vata2::Parser::ParsedSection parsec;
+		parsec.type = Vata2::Nfa::TYPE_NFA;
+		parsec.dict["EnumAlphabet"] = {"a", "b", "c"};
+		parsec.dict["Initial"] = {"q"};
+		parsec.body.push_back({"q", "c", "q"});
+
+		VMValue res = find_dispatcher(Vata2::Nfa::TYPE_NFA)("construct",
+			{VMValue::borrow(Vata2::TYPE_PARSEC, &parsec)});
+		REQUIRE(Vata2::Nfa::TYPE_NFA == res.type);
+		const NfaWrapper* wrap = static_cast<const NfaWrapper*>(res.get_ptr());
+		REQUIRE(wrap->alphabet->get_dense_size() == 3);
+		REQUIRE(wrap->nfa.has_trans(0, 2, 0));
+		REQUIRE(is_complete(wrap->nfa, *wrap->alphabet) == false);
+
+		// symbols not in the alphabet are rejected
+		parsec.body.push_back({"q", "d", "q"});
+		CHECK_THROWS_WITH(find_dispatcher(Vata2::Nfa::TYPE_NFA)("construct",
+			{VMValue::borrow(Vata2::TYPE_PARSEC, &parsec)}), Catch::Contains("unknown symbol"));
+
 	}
 
 	SECTION("no parameters")
@@ -50,7 +72,7 @@ TEST_CASE("Vata2::VM::find_dispatcher(\"NFA\")")
 	{
 		std::string str = "arg1";
 		VMValue res = find_dispatcher(Vata2::Nfa::TYPE_NFA)("barrel-roll",
-			{{Vata2::TYPE_STR, &str}});
+			{VMValue::borrow(Vata2::TYPE_STR, &str)});
 		REQUIRE(Vata2::TYPE_NOT_A_VALUE == res.type);
 	}
 
@@ -2,9 +2,15 @@
 
 #include "../3rdparty/catch.hpp"
 
+#include <cstring>
+#include <sstream>
 #include <unordered_set>
 
 #include <vata2/nfa.hh>
+#include <vata2/nfa-binary.hh>
+#include <vata2/nfa-cache.hh>
+#include <vata2/nfa-generator.hh>
+#include <vata2/nfa-matcher.hh>
 using namespace Vata2::Nfa;
 using namespace Vata2::util;
 using namespace Vata2::Parser;
@@ -83,6 +89,71 @@ TEST_CASE("Vata2::Nfa::Nfa::add_trans()/has_trans()")
 		REQUIRE(!a.has_trans(1, 'b', 2));
 		REQUIRE(!a.has_trans(2, 'a', 1));
 	}
+
+	SECTION("If I remove a transition, only it is removed")
+	{
+		a.add_trans(1, 'a', 1);
+		a.add_trans(1, 'a', 2);
+		a.remove_trans(1, 'a', 1);
+		a.remove_trans(1, 'b', 2);
+
+		REQUIRE(!a.has_trans(1, 'a', 1));
+		REQUIRE(a.has_trans(1, 'a', 2));
+
+		a.remove_trans(1, 'a', 2);
+		REQUIRE(a.trans_empty());
+		REQUIRE(a.begin() == a.end());
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::Nfa::hash()/operator==")
+{ // {{{
+	Nfa a;
+	Nfa b;
+
+	SECTION("Empty automata are equal")
+	{
+		REQUIRE(a.hash() == b.hash());
+		REQUIRE(a == b);
+	}
+
+	SECTION("The hash does not depend on the order of adding transitions")
+	{
+		a.add_trans(1, 'a', 2);
+		a.add_trans(2, 'b', 3);
+		a.add_trans(1, 'a', 3);
+
+		b.add_trans(1, 'a', 3);
+		b.add_trans(2, 'b', 3);
+		b.add_trans(1, 'a', 2);
+		b.add_trans(1, 'a', 2);
+
+		REQUIRE(a.hash() == b.hash());
+		REQUIRE(a == b);
+
+		b.add_trans(3, 'c', 1);
+		REQUIRE(a != b);
+
+		b.remove_trans(3, 'c', 1);
+		b.remove_trans(3, 'c', 2);
+		REQUIRE(a.hash() == b.hash());
+		REQUIRE(a == b);
+	}
+
+	SECTION("Initial and final states are taken into account")
+	{
+		FILL_WITH_AUT_A(a);
+		FILL_WITH_AUT_A(b);
+		REQUIRE(a == b);
+
+		b.finalstates.insert(1);
+		REQUIRE(a.hash() != b.hash());
+		REQUIRE(a != b);
+
+		b.finalstates.erase(1);
+		b.initialstates.erase(1);
+		REQUIRE(a != b);
+	}
 } // }}}
 
 TEST_CASE("Vata2::Nfa::Nfa iteration")
@@ -472,6 +543,51 @@ TEST_CASE("Vata2::Nfa::is_lang_empty()")
 		REQUIRE(cex[1] == 4);
 		REQUIRE(cex[2] == 8);
 	}
+
+	SECTION("The counterexample is a shortest path")
+	{
+		aut.initialstates = {1};
+		aut.finalstates = {9};
+		aut.add_trans(1, 'a', 2);
+		aut.add_trans(2, 'a', 3);
+		aut.add_trans(3, 'a', 4);
+		aut.add_trans(4, 'a', 9);
+		aut.add_trans(1, 'b', 5);
+		aut.add_trans(5, 'b', 9);
+
+		for (const char* algo : {"bfs", "bidirectional"})
+		{
+			cex.clear();
+			bool is_empty = is_lang_empty(aut, &cex, {{"algo", algo}});
+			REQUIRE(!is_empty);
+			REQUIRE(cex == Path({1, 5, 9}));
+		}
+	}
+
+	SECTION("Bidirectional search")
+	{
+		FILL_WITH_AUT_A(aut);
+
+		Path bfs_cex;
+		REQUIRE(!is_lang_empty(aut, &bfs_cex, {{"algo", "bfs"}}));
+		REQUIRE(!is_lang_empty(aut, &cex, {{"algo", "bidirectional"}}));
+		REQUIRE(cex.size() == bfs_cex.size());
+
+		auto word_bool_pair = get_word_for_path(aut, cex);
+		REQUIRE(word_bool_pair.second);
+		REQUIRE(is_in_lang(aut, word_bool_pair.first));
+
+		aut.finalstates = {13};
+		REQUIRE(is_lang_empty(aut, &cex, {{"algo", "bidirectional"}}));
+	}
+
+	SECTION("wrong parameters")
+	{
+		CHECK_THROWS_WITH(is_lang_empty(aut, &cex, {}),
+			Catch::Contains("requires setting the \"algo\" key"));
+		CHECK_THROWS_WITH(is_lang_empty(aut, &cex, {{"algo", "foo"}}),
+			Catch::Contains("received an unknown value"));
+	}
 } // }}}
 
 TEST_CASE("Vata2::Nfa::get_word_for_path()")
@@ -579,6 +695,70 @@ TEST_CASE("Vata2::Nfa::is_lang_empty_cex()")
 }
 
 
+TEST_CASE("Vata2::Nfa::get_shortest_words()")
+{ // {{{
+	Nfa aut;
+
+	SECTION("empty language")
+	{
+		aut.initialstates = {1};
+		aut.add_trans(1, 'a', 2);
+
+		REQUIRE(get_shortest_words(aut, 5).empty());
+	}
+
+	SECTION("finite language")
+	{
+		aut.initialstates = {1, 2};
+		aut.finalstates = {3};
+		aut.add_trans(1, 'b', 3);
+		aut.add_trans(2, 'b', 3);
+		aut.add_trans(1, 'a', 4);
+		aut.add_trans(4, 'a', 3);
+		aut.add_trans(2, 'c', 5);
+
+		std::vector<Word> words = get_shortest_words(aut, 10);
+		REQUIRE(words == std::vector<Word>({{'b'}, {'a', 'a'}}));
+
+		words = get_shortest_words(aut, 1);
+		REQUIRE(words == std::vector<Word>({{'b'}}));
+
+		REQUIRE(get_shortest_words(aut, 0).empty());
+	}
+
+	SECTION("infinite language")
+	{
+		aut.initialstates = {1};
+		aut.finalstates = {1};
+		aut.add_trans(1, 'b', 1);
+		aut.add_trans(1, 'a', 2);
+		aut.add_trans(2, 'a', 1);
+
+		std::vector<Word> words = get_shortest_words(aut, 5);
+		REQUIRE(words == std::vector<Word>({
+			{}, {'b'}, {'a', 'a'}, {'b', 'b'}, {'a', 'a', 'b'}}));
+	}
+
+	SECTION("words are distinct and accepted")
+	{
+		FILL_WITH_AUT_A(aut);
+
+		std::vector<Word> words = get_shortest_words(aut, 20);
+		REQUIRE(words.size() == 20);
+		REQUIRE(std::set<Word>(words.begin(), words.end()).size() == 20);
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			REQUIRE(is_in_lang(aut, words[i]));
+			if (0 != i) { REQUIRE(words[i-1].size() <= words[i].size()); }
+		}
+
+		Word cex;
+		REQUIRE(!is_lang_empty_cex(aut, &cex));
+		REQUIRE(words[0].size() == cex.size());
+	}
+} // }}}
+
+
 TEST_CASE("Vata2::Nfa::determinize()")
 {
 	Nfa aut;
@@ -618,6 +798,97 @@ TEST_CASE("Vata2::Nfa::determinize()")
 	}
 } // }}}
 
+TEST_CASE("Vata2::Nfa::determinize_incr()")
+{ // {{{
+	Nfa aut;
+	DetResult det;
+	DetDelta delta;
+	CharAlphabet alph;
+
+	auto trans_of = [](const Nfa& nfa) {
+		std::unordered_set<Trans> result;
+		for (const Trans& trans : nfa) { result.insert(trans); }
+		return result;
+	};
+
+	auto is_equiv = [&alph](const Nfa& lhs, const Nfa& rhs) {
+		return is_incl(lhs, rhs, alph) && is_incl(rhs, lhs, alph);
+	};
+
+	FILL_WITH_AUT_A(aut);
+	determinize_incr_init(&det, aut);
+	Nfa old_result = det.result;
+	State old_last = det.last_state_num;
+
+	SECTION("no change")
+	{
+		determinize_incr(&det, aut, { }, { }, &delta);
+
+		REQUIRE(delta.empty());
+		REQUIRE(trans_of(det.result) == trans_of(old_result));
+	}
+
+	SECTION("added transitions")
+	{
+		std::vector<Trans> added = {{9, 'b', 5}, {3, 'c', 11}};
+		for (const Trans& trans : added) { aut.add_trans(trans); }
+		determinize_incr(&det, aut, added, { }, &delta);
+
+		REQUIRE(!delta.empty());
+		REQUIRE(is_deterministic(det.result));
+		REQUIRE(is_equiv(det.result, aut));
+		REQUIRE(is_equiv(det.result, determinize(aut)));
+
+		apply_delta(&old_result, delta);
+		REQUIRE(trans_of(old_result) == trans_of(det.result));
+		REQUIRE(old_result.finalstates == det.result.finalstates);
+
+		for (State st : delta.added_states) { REQUIRE(st > old_last); }
+	}
+
+	SECTION("removed transitions")
+	{
+		std::vector<Trans> removed = {{7, 'a', 5}, {1, 'a', 10}};
+		for (const Trans& trans : removed) { aut.remove_trans(trans); }
+		determinize_incr(&det, aut, { }, removed, &delta);
+
+		REQUIRE(is_lang_empty(det.result));
+		REQUIRE(is_lang_empty(aut));
+		REQUIRE(!delta.removed_states.empty());
+
+		apply_delta(&old_result, delta);
+		REQUIRE(trans_of(old_result) == trans_of(det.result));
+		REQUIRE(old_result.finalstates == det.result.finalstates);
+		for (const auto& macro_state_pair : det.subset_map)
+		{
+			REQUIRE(!haskey(delta.removed_states, macro_state_pair.second));
+		}
+	}
+
+	SECTION("several updates in a row")
+	{
+		std::vector<std::pair<std::vector<Trans>, std::vector<Trans>>> updates = {
+			{{{9, 'b', 5}}, { }},
+			{{{5, 'b', 1}}, {{7, 'a', 5}}},
+			{{ }, {{9, 'b', 5}}},
+			{{{7, 'a', 5}}, {{5, 'b', 1}}},
+		};
+
+		for (const auto& upd : updates)
+		{
+			for (const Trans& trans : upd.first) { aut.add_trans(trans); }
+			for (const Trans& trans : upd.second) { aut.remove_trans(trans); }
+			determinize_incr(&det, aut, upd.first, upd.second, &delta);
+			apply_delta(&old_result, delta);
+
+			REQUIRE(is_deterministic(det.result));
+			REQUIRE(is_equiv(det.result, determinize(aut)));
+			REQUIRE(trans_of(old_result) == trans_of(det.result));
+			REQUIRE(old_result.finalstates == det.result.finalstates);
+		}
+	}
+} // }}}
+
 TEST_CASE("Vata2::Nfa::construct() correct calls")
 { // {{{
 	Nfa aut;
@@ -741,6 +1012,191 @@ TEST_CASE("Vata2::Nfa::construct() invalid calls")
 	}
 } // }}}
 
+TEST_CASE("Vata2::Nfa::construct() from a VtfScanner")
+{ // {{{
+	Nfa aut;
+	StringToSymbolMap symbol_map;
+	OnTheFlyAlphabet alphabet(&symbol_map);
+
+	SECTION("the same automaton as from a ParsedSection")
+	{
+		std::string file =
+			"@NFA\n"
+			"%Initial q1 \"q 2\"\n"
+			"%Final q3\n"
+			"%Name test # a comment\n"
+			"q1 a \"q 2\"\n"
+			"\"q 2\" b q3   # another comment\n"
+			"q3 \"a\" q1\n"
+			"@NFA\n"
+			"%Initial p\n"
+			"p a p\n";
+
+		Vata2::Parser::VtfScanner scanner(file.data(), file.size());
+		StringToStateMap state_map;
+		construct(&aut, &scanner, &alphabet, &state_map);
+
+		StringToSymbolMap expected_symbol_map;
+		OnTheFlyAlphabet expected_alphabet(&expected_symbol_map);
+		StringToStateMap expected_state_map;
+		Nfa expected = construct(Vata2::Parser::parse_vtf_section(file),
+			&expected_alphabet, &expected_state_map);
+
+		REQUIRE(expected == aut);
+		REQUIRE(expected_state_map == state_map);
+		REQUIRE(expected_symbol_map == symbol_map);
+
+		// the second section
+		Nfa aut2;
+		construct(&aut2, &scanner, &alphabet);
+		REQUIRE(aut2.initialstates.size() == 1);
+		REQUIRE(aut2.has_trans(0, alphabet.translate_symb("a"), 0));
+	}
+
+	SECTION("reading from a stream")
+	{
+		std::istringstream stream(
+			"@NFA\n"
+			"%Initial q1\n"
+			"q1 a q2\n"
+			"%Final q2\n"
+			"q2 b q1\n");
+
+		Vata2::Parser::VtfScanner scanner(stream);
+		StringToStateMap state_map;
+		construct(&aut, &scanner, &alphabet, &state_map);
+
+		REQUIRE(aut.initialstates == StateSet{state_map.at("q1")});
+		REQUIRE(aut.finalstates == StateSet{state_map.at("q2")});
+		REQUIRE(aut.has_trans(state_map.at("q1"), alphabet.translate_symb("a"),
+			state_map.at("q2")));
+		REQUIRE(aut.has_trans(state_map.at("q2"), alphabet.translate_symb("b"),
+			state_map.at("q1")));
+		REQUIRE(aut.trans_size() == 2);
+	}
+
+	SECTION("states and symbols interned in string pools")
+	{
+		std::string file =
+			"@NFA\n"
+			"%Initial q1 \"q 2\"\n"
+			"%Final q3\n"
+			"q1 a \"q 2\"\n"
+			"\"q 2\" b q3\n"
+			"q3 a q1\n";
+
+		Vata2::Parser::VtfScanner scanner(file.data(), file.size());
+		auto symbol_pool = std::make_shared<Vata2::util::StringPool>();
+		PooledAlphabet pooled_alphabet(symbol_pool);
+		Vata2::util::StringPool state_pool;
+		construct(&aut, &scanner, &pooled_alphabet, &state_pool);
+
+		// the same numbering as with maps
+		StringToStateMap state_map;
+		Nfa expected = construct(Vata2::Parser::parse_vtf_section(file),
+			&alphabet, &state_map);
+		REQUIRE(expected == aut);
+		REQUIRE(state_pool.size() == 3);
+		for (const auto& name_state : state_map)
+		{
+			REQUIRE(state_pool.find(name_state.first) == name_state.second);
+		}
+		REQUIRE(pooled_alphabet.get_symb_name(aut[0].begin()->first) == "a");
+
+		// the same pool of symbols and a ParsedSection
+		Nfa aut2;
+		Vata2::util::StringPool state_pool2;
+		PooledAlphabet pooled_alphabet2(symbol_pool);
+		construct(&aut2, Vata2::Parser::parse_vtf_section("@NFA\np c p\np b p\n"),
+			&pooled_alphabet2, &state_pool2);
+		REQUIRE(aut2.has_trans(0, symbol_pool->find("b"), 0));
+		REQUIRE(symbol_pool->find("c") == 2);
+		REQUIRE(pooled_alphabet2.get_symbols().size() == 2);
+		REQUIRE(pooled_alphabet2.get_complement({0, 2}) == std::list<Symbol>{1});
+	}
+
+	SECTION("invalid sections")
+	{
+		std::vector<std::pair<std::string, std::string>> files_errors = {
+			{"@FA\nq1 a q2\n", "expecting type"},
+			{"@NFA\nq1 a q2\nq1 q2\n", "Epsilon transition"},
+			{"", "expecting type"},
+		};
+
+		for (const auto& file_error : files_errors)
+		{
+			const std::string& file = file_error.first;
+			Vata2::Parser::VtfScanner scanner(file.data(), file.size());
+			CHECK_THROWS_WITH(construct(&aut, &scanner, &alphabet),
+				Catch::Contains(file_error.second));
+		}
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::construct_parallel()")
+{ // {{{
+	// a generated body with names of states shared among chunks
+	std::string file = "@NFA\n%Initial s0 \"s 1\"\n";
+	for (size_t i = 0; i < 2000; ++i)
+	{
+		file += "s" + std::to_string(i % 317) + " a" + std::to_string(i % 7) +
+			" s" + std::to_string((i * 31) % 541) + "   # comment\n";
+		if (0 == i % 400) { file += "\n%Final s" + std::to_string(i) + "\n"; }
+	}
+	file += "\"s 1\" \"a 0\" s0\n@NFA\n%Initial p\np a p\n";
+
+	StringToSymbolMap expected_symbol_map;
+	OnTheFlyAlphabet expected_alphabet(&expected_symbol_map);
+	StringToStateMap expected_state_map;
+	Nfa expected;
+	Vata2::Parser::VtfScanner expected_scanner(file.data(), file.size());
+	construct(&expected, &expected_scanner, &expected_alphabet, &expected_state_map);
+
+	for (size_t threads : {1, 2, 3, 8, 64})
+	{
+		Nfa aut;
+		StringToSymbolMap symbol_map;
+		OnTheFlyAlphabet alphabet(&symbol_map);
+		StringToStateMap state_map;
+		Vata2::Parser::VtfScanner scanner(file.data(), file.size());
+		construct_parallel(&aut, &scanner, &alphabet, &state_map, threads);
+
+		REQUIRE(expected == aut);
+		REQUIRE(expected_state_map == state_map);
+		REQUIRE(expected_symbol_map == symbol_map);
+
+		// the scanner continues with the next section
+		Nfa aut2;
+		construct_parallel(&aut2, &scanner, &alphabet, nullptr, threads);
+		REQUIRE(aut2.initialstates == StateSet{0});
+		REQUIRE(aut2.has_trans(0, alphabet.translate_symb("a"), 0));
+	}
+
+	SECTION("empty body")
+	{
+		std::string empty = "@NFA\n";
+		Nfa aut;
+		StringToSymbolMap symbol_map;
+		OnTheFlyAlphabet alphabet(&symbol_map);
+		Vata2::Parser::VtfScanner scanner(empty.data(), empty.size());
+		construct_parallel(&aut, &scanner, &alphabet, nullptr, 4);
+		REQUIRE(aut.initialstates.empty());
+		REQUIRE(aut.trans_empty());
+	}
+
+	SECTION("invalid input")
+	{
+		std::string invalid = file;
+		invalid.insert(invalid.find("\ns5 ") + 1, "q1 q2\n");
+		Nfa aut;
+		StringToSymbolMap symbol_map;
+		OnTheFlyAlphabet alphabet(&symbol_map);
+		Vata2::Parser::VtfScanner scanner(invalid.data(), invalid.size());
+		CHECK_THROWS_WITH(construct_parallel(&aut, &scanner, &alphabet, nullptr, 4),
+			Catch::Contains("Epsilon transition"));
+	}
+} // }}}
+
 TEST_CASE("Vata2::Nfa::serialize() and operator<<()")
 { // {{{
 	Nfa aut;
@@ -835,6 +1291,127 @@ TEST_CASE("Vata2::Nfa::serialize() and operator<<()")
 	}
 } // }}}
 
+TEST_CASE("Vata2::Nfa::write_vtf()")
+{ // {{{
+	Nfa aut;
+
+	auto serialize_str = [&aut](
+		const SymbolToStringMap*  symbol_map,
+		const StateToStringMap*   state_map) {
+		std::ostringstream os;
+		os << serialize(aut, symbol_map, state_map);
+		return os.str();
+	};
+
+	auto write_str = [&aut](
+		const SymbolToStringMap*  symbol_map,
+		const StateToStringMap*   state_map,
+		size_t                    threads) {
+		std::ostringstream os;
+		write_vtf(os, aut, symbol_map, state_map, threads);
+		return os.str();
+	};
+
+	SECTION("empty automaton")
+	{
+		REQUIRE(serialize_str(nullptr, nullptr) == write_str(nullptr, nullptr, 1));
+		REQUIRE("@NFA\n%Final\n%Initial\n# Body:\n" == write_str(nullptr, nullptr, 4));
+	}
+
+	SECTION("small automaton with names")
+	{
+		aut.add_initial(0);
+		aut.add_initial(12);
+		aut.add_final(3);
+		aut.add_trans(0, 0, 12);
+		aut.add_trans(0, 1, 3);
+		aut.add_trans(12, 1, 3);
+		aut.add_trans(3, 0, 0);
+
+		StateToStringMap state_map = {{0, "s"}, {3, "t"}, {12, "\"u v\""}};
+		SymbolToStringMap symbol_map = {{0, "x"}, {1, "y"}};
+
+		REQUIRE(serialize_str(nullptr, nullptr) == write_str(nullptr, nullptr, 1));
+		REQUIRE(serialize_str(&symbol_map, &state_map) ==
+			write_str(&symbol_map, &state_map, 1));
+
+		state_map.erase(12);
+		CHECK_THROWS_WITH(write_str(&symbol_map, &state_map, 1),
+			Catch::Contains("cannot translate state 12"));
+		symbol_map.erase(1);
+		state_map[12] = "u";
+		CHECK_THROWS_WITH(write_str(&symbol_map, &state_map, 1),
+			Catch::Contains("cannot translate symbol 1"));
+	}
+
+	SECTION("large automaton formatted in parallel")
+	{
+		aut.add_initial(1);
+		aut.add_final(99999);
+		for (State i = 0; i < 100000; ++i)
+		{
+			aut.add_trans(i, i % 3, (i * 7) % 100000);
+			aut.add_trans(i, i % 5, (i + 1) % 100000);
+		}
+
+		std::string expected = serialize_str(nullptr, nullptr);
+		REQUIRE(expected == write_str(nullptr, nullptr, 1));
+		REQUIRE(expected == write_str(nullptr, nullptr, 3));
+
+		std::ostringstream os;
+		os << aut;
+		REQUIRE(expected == os.str());
+
+		StateToStringMap state_map = {{0, "s"}};
+		CHECK_THROWS_WITH(write_str(nullptr, &state_map, 4),
+			Catch::Contains("cannot translate state"));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::Alphabet enumeration of symbols")
+{ // {{{
+	SECTION("dense alphabets")
+	{
+		EnumAlphabet enum_alph = {"a", "b", "c"};
+		REQUIRE(enum_alph.get_dense_size() == 3);
+		REQUIRE(enum_alph["c"] == 2);
+		REQUIRE(enum_alph.get_symbols() == std::list<Symbol>({0, 1, 2}));
+		REQUIRE(enum_alph.get_complement({1, 7}) == std::list<Symbol>({0, 2}));
+
+		std::vector<Symbol> symbols;
+		enum_alph.for_each_symbol([&symbols](Symbol symb) { symbols.push_back(symb); });
+		REQUIRE(symbols == std::vector<Symbol>({0, 1, 2}));
+
+		CharAlphabet char_alph;
+		REQUIRE(char_alph.get_dense_size() == 256);
+		REQUIRE(char_alph.get_complement({}).size() == 256);
+		REQUIRE(char_alph.get_complement({'a'}).size() == 255);
+
+		// only the symbols translated by a pooled alphabet are its symbols
+		auto pool = std::make_shared<Vata2::util::StringPool>();
+		pool->intern("w");
+		PooledAlphabet pooled_alph(pool);
+		pooled_alph.translate_symb("x");
+		pooled_alph.translate_symb("y");
+		REQUIRE(pooled_alph.get_dense_size() == 0);
+		REQUIRE(pooled_alph.get_symbols() == std::list<Symbol>({1, 2}));
+		REQUIRE(pooled_alph.get_complement({0, 1}) == std::list<Symbol>({2}));
+	}
+
+	SECTION("a sparse alphabet")
+	{
+		StringToSymbolMap ssmap;
+		OnTheFlyAlphabet alph(&ssmap, 10);
+		alph.translate_symb("a");
+		alph.translate_symb("b");
+		REQUIRE(alph.get_dense_size() == 0);
+
+		std::set<Symbol> symbols;
+		alph.for_each_symbol([&symbols](Symbol symb) { symbols.insert(symb); });
+		REQUIRE(symbols == std::set<Symbol>({10, 11}));
+	}
+} // }}}
+
 TEST_CASE("Vata2::Nfa::make_complete()")
 { // {{{
 	Nfa aut;
@@ -1421,6 +1998,121 @@ TEST_CASE("Vata2::Nfa::is_incl()")
 	}
 } // }}}
 
+TEST_CASE("Vata2::Nfa::is_incl_many()")
+{ // {{{
+	Nfa smaller;
+	std::vector<Nfa> biggers(4);
+	std::vector<bool> results;
+	std::vector<Word> cexes;
+	StringDict params;
+
+	const std::unordered_set<std::string> ALGORITHMS = {
+		"naive",
+		"antichains",
+	};
+
+	EnumAlphabet alph = {"a", "b"};
+
+	// (a+b)*
+	smaller.initialstates = {1};
+	smaller.finalstates = {1};
+	smaller.add_trans(1, alph["a"], 1);
+	smaller.add_trans(1, alph["b"], 1);
+
+	// (a+b)*
+	biggers[0].initialstates = {101};
+	biggers[0].finalstates = {101};
+	biggers[0].add_trans(101, alph["a"], 101);
+	biggers[0].add_trans(101, alph["b"], 101);
+
+	// a* + b*
+	biggers[1].initialstates = {101, 102};
+	biggers[1].finalstates = {101, 102};
+	biggers[1].add_trans(101, alph["a"], 101);
+	biggers[1].add_trans(102, alph["b"], 102);
+
+	// {}
+	biggers[2].initialstates = {101};
+
+	// eps + (a+b) + (a+b)(a+b)(a* + b*)
+	biggers[3].initialstates = {101};
+	biggers[3].finalstates = {101, 102, 103, 104, 105};
+	biggers[3].add_trans(101, alph["a"], 102);
+	biggers[3].add_trans(101, alph["b"], 102);
+	biggers[3].add_trans(102, alph["a"], 103);
+	biggers[3].add_trans(102, alph["b"], 103);
+	biggers[3].add_trans(103, alph["a"], 104);
+	biggers[3].add_trans(104, alph["a"], 104);
+	biggers[3].add_trans(103, alph["b"], 105);
+	biggers[3].add_trans(105, alph["b"], 105);
+
+	std::vector<const Nfa*> bigger_ptrs;
+	for (const Nfa& bigger : biggers) { bigger_ptrs.push_back(&bigger); }
+
+	SECTION("no bigger automata")
+	{
+		for (const auto& algo : ALGORITHMS) {
+			params["algo"] = algo;
+			is_incl_many(smaller, { }, alph, &results, &cexes, params);
+
+			REQUIRE(results.empty());
+			REQUIRE(cexes.empty());
+		}
+	}
+
+	SECTION("results correspond to is_incl()")
+	{
+		for (const auto& algo : ALGORITHMS) {
+			params["algo"] = algo;
+			is_incl_many(smaller, bigger_ptrs, alph, &results, &cexes, params);
+
+			REQUIRE(results == std::vector<bool>({true, false, false, false}));
+			REQUIRE(cexes[0].empty());
+			REQUIRE(cexes[2] == Word{});
+			REQUIRE((
+				cexes[1] == Word{alph["a"], alph["b"]} ||
+				cexes[1] == Word{alph["b"], alph["a"]}));
+			REQUIRE(cexes[3].size() == 4);
+			REQUIRE(cexes[3][2] != cexes[3][3]);
+
+			for (size_t i = 0; i < biggers.size(); ++i)
+			{
+				REQUIRE(results[i] == is_incl(smaller, biggers[i], alph, params));
+				if (!results[i])
+				{
+					REQUIRE(is_in_lang(smaller, cexes[i]));
+					REQUIRE(!is_in_lang(biggers[i], cexes[i]));
+				}
+			}
+		}
+	}
+
+	SECTION("results without counterexamples")
+	{
+		smaller.initialstates = {1, 2};
+		smaller.finalstates = {1, 2};
+		smaller.remove_trans(1, alph["b"], 1);
+		smaller.add_trans(2, alph["b"], 2);
+
+		for (const auto& algo : ALGORITHMS) {
+			params["algo"] = algo;
+			results = is_incl_many(smaller, bigger_ptrs, alph, params);
+
+			REQUIRE(results == std::vector<bool>({true, true, false, true}));
+		}
+	}
+
+	SECTION("wrong parameters")
+	{
+		CHECK_THROWS_WITH(is_incl_many(smaller, bigger_ptrs, alph, params),
+			Catch::Contains("requires setting the \"algo\" key"));
+
+		params["algo"] = "foo";
+		CHECK_THROWS_WITH(is_incl_many(smaller, bigger_ptrs, alph, params),
+			Catch::Contains("received an unknown value"));
+	}
+} // }}}
+
 TEST_CASE("Vata2::Nfa::revert()")
 { // {{{
 	Nfa aut;
@@ -1645,6 +2337,219 @@ TEST_CASE("Vata2::Nfa::is_complete()")
 	}
 } // }}}
 
+TEST_CASE("Vata2::Nfa::is_in_lang_many()")
+{ // {{{
+	Nfa aut;
+	FILL_WITH_AUT_B(aut);
+
+	std::vector<Word> words = {
+		{'b', 'a'},
+		{ },
+		{'c', 'b', 'a'},
+		{'c', 'b', 'a', 'a'},
+		{'c', 'b', 'a', 'a'},
+		{'a', 'a'},
+		{'c', 'b', 'b', 'a', 'c', 'b'},
+		{'c', 'b'},
+		{'c'},
+		{'d', 'a'},
+	};
+
+	std::vector<bool> expected;
+	for (const Word& word : words) { expected.push_back(is_in_lang(aut, word)); }
+
+	SECTION("empty list of words")
+	{
+		REQUIRE(is_in_lang_many(aut, { }).empty());
+	}
+
+	SECTION("single thread")
+	{
+		REQUIRE(is_in_lang_many(aut, words) == expected);
+	}
+
+	SECTION("more threads")
+	{
+		for (const char* threads : {"2", "3", "64"})
+		{
+			REQUIRE(is_in_lang_many(aut, words, {{"threads", threads}}) == expected);
+		}
+	}
+
+	SECTION("wrong parameters")
+	{
+		CHECK_THROWS_WITH(is_in_lang_many(aut, words, {{"threads", "0"}}),
+			Catch::Contains("positive number of threads"));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::LazyDfaMatcher")
+{ // {{{
+	Nfa aut;
+
+	auto to_bytes = [](const Word& word) {
+		return std::vector<uint8_t>(word.begin(), word.end());
+	};
+
+	std::vector<Word> words = {
+		{ },
+		{'a'},
+		{'a', 'a'},
+		{'b', 'a'},
+		{'c', 'b', 'a'},
+		{'c', 'b', 'a', 'a'},
+		{'c', 'b', 'b', 'a', 'c', 'b'},
+		{'a', 'b', 'a', 'a', 'c', 'a'},
+		{'c', 'c', 'c', 'b', 'a'},
+		{'z'},
+	};
+
+	SECTION("empty automaton")
+	{
+		LazyDfaMatcher matcher(aut);
+		for (const Word& word : words)
+		{
+			std::vector<uint8_t> bytes = to_bytes(word);
+			REQUIRE(!matcher.is_in_lang(bytes.data(), bytes.size()));
+			REQUIRE(!matcher.is_prfx_in_lang(bytes.data(), bytes.size()));
+		}
+	}
+
+	SECTION("results agree with is_in_lang() and is_prfx_in_lang()")
+	{
+		FILL_WITH_AUT_B(aut);
+		LazyDfaMatcher matcher(aut);
+
+		for (size_t round = 0; round < 2; ++round)
+		{ // the second round uses the already built table
+			for (const Word& word : words)
+			{
+				std::vector<uint8_t> bytes = to_bytes(word);
+				REQUIRE(matcher.is_in_lang(bytes.data(), bytes.size()) ==
+					is_in_lang(aut, word));
+				REQUIRE(matcher.is_prfx_in_lang(bytes.data(), bytes.size()) ==
+					is_prfx_in_lang(aut, word));
+			}
+		}
+
+		REQUIRE(matcher.num_flushes() == 0);
+		REQUIRE(matcher.get_macrostate(matcher.initial()) == aut.initialstates);
+	}
+
+	SECTION("small tables are flushed")
+	{
+		FILL_WITH_AUT_A(aut);
+		LazyDfaMatcher matcher(aut, 2);
+
+		for (const Word& word : words)
+		{
+			std::vector<uint8_t> bytes = to_bytes(word);
+			REQUIRE(matcher.is_in_lang(bytes.data(), bytes.size()) ==
+				is_in_lang(aut, word));
+			REQUIRE(matcher.num_states() <= 2);
+		}
+
+		REQUIRE(matcher.num_flushes() > 0);
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::DiffMatcher")
+{ // {{{
+	Nfa aut1;
+	Nfa aut2;
+
+	// all words of length at most 4 over {a, b, c, z}
+	std::vector<Word> words = {{ }};
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		if (words[i].size() == 4) { continue; }
+		for (Symbol symb : {'a', 'b', 'c', 'z'})
+		{
+			Word word = words[i];
+			word.push_back(symb);
+			words.push_back(word);
+		}
+	}
+
+	auto check = [&](bool prefix_acceptance) {
+		DiffMatcher matcher(aut1, aut2, prefix_acceptance);
+		for (const Word& word : words)
+		{
+			std::vector<uint8_t> bytes(word.begin(), word.end());
+			bool in1 = prefix_acceptance? is_prfx_in_lang(aut1, word) : is_in_lang(aut1, word);
+			bool in2 = prefix_acceptance? is_prfx_in_lang(aut2, word) : is_in_lang(aut2, word);
+
+			DiffMatcher::Verdict verdict = matcher.match(bytes.data(), bytes.size());
+			REQUIRE((0 != (verdict & DiffMatcher::IN_FIRST_ONLY)) == in1);
+			REQUIRE((0 != (verdict & DiffMatcher::IN_SECOND_ONLY)) == in2);
+		}
+
+		return matcher.num_states();
+	};
+
+	SECTION("empty automata")
+	{
+		REQUIRE(check(false) == 1);
+		REQUIRE(check(true) == 1);
+
+		DiffMatcher matcher(aut1, aut2);
+		REQUIRE(matcher.is_settled(matcher.initial()));
+		REQUIRE(matcher.get_verdict(matcher.initial()) == DiffMatcher::IN_NONE);
+	}
+
+	SECTION("different automata")
+	{
+		FILL_WITH_AUT_A(aut1);
+		FILL_WITH_AUT_B(aut2);
+
+		check(false);
+		check(true);
+	}
+
+	SECTION("the same automaton")
+	{
+		FILL_WITH_AUT_B(aut1);
+		FILL_WITH_AUT_B(aut2);
+
+		check(false);
+		check(true);
+	}
+
+	SECTION("settled states")
+	{
+		// aut1 accepts a(a+b+c+z)*, aut2 accepts a
+		aut1.initialstates = {1};
+		aut1.finalstates = {2};
+		aut1.add_trans(1, 'a', 2);
+		for (Symbol symb : {'a', 'b', 'c', 'z'}) { aut1.add_trans(2, symb, 2); }
+
+		aut2.initialstates = {1};
+		aut2.finalstates = {2};
+		aut2.add_trans(1, 'a', 2);
+
+		check(false);
+
+		DiffMatcher matcher(aut1, aut2, true);
+		REQUIRE(!matcher.is_settled(matcher.initial()));
+		DiffMatcher::DfaState state = matcher.step(matcher.initial(), 'a');
+		REQUIRE(matcher.is_settled(state));
+		REQUIRE(matcher.get_verdict(state) == DiffMatcher::IN_BOTH);
+
+		state = matcher.step(matcher.initial(), 'b');
+		REQUIRE(matcher.is_settled(state));
+		REQUIRE(matcher.get_verdict(state) == DiffMatcher::IN_NONE);
+	}
+
+	SECTION("too big product")
+	{
+		FILL_WITH_AUT_A(aut1);
+		FILL_WITH_AUT_B(aut2);
+
+		CHECK_THROWS_WITH(DiffMatcher(aut1, aut2, false, 2),
+			Catch::Contains("has more than 2 states"));
+	}
+} // }}}
+
 TEST_CASE("Vata2::Nfa::is_prfx_in_lang()")
 { // {{{
 	Nfa aut;
@@ -1702,3 +2607,382 @@ TEST_CASE("Vata2::Nfa::is_prfx_in_lang()")
 		REQUIRE(!is_prfx_in_lang(aut, w));
 	}
 } // }}}
+
+TEST_CASE("Vata2::Nfa::OpCache")
+{ // {{{
+	OpCache& cache = OpCache::global();
+	cache.clear();
+
+	Nfa aut;
+	FILL_WITH_AUT_A(aut);
+	CharAlphabet alph;
+
+	SECTION("disabled cache stores nothing")
+	{
+		cache.set_capacity(0);
+		REQUIRE(!cache.enabled());
+
+		Nfa det = determinize_cached(aut);
+		REQUIRE(det == determinize(aut));
+		REQUIRE(cache.size() == 0);
+		REQUIRE(cache.get_hits() == 0);
+	}
+
+	SECTION("repeated calls are served from the cache")
+	{
+		cache.set_capacity(10);
+
+		Word cex;
+		bool univ = is_universal_cached(aut, alph, &cex, {{"algo", "naive"}});
+		REQUIRE(!univ);
+		REQUIRE(cache.get_misses() == 1);
+
+		Nfa copy = aut;
+		Word cex2;
+		REQUIRE(!is_universal_cached(copy, alph, &cex2, {{"algo", "naive"}}));
+		REQUIRE(cex2 == cex);
+		REQUIRE(cache.get_hits() == 1);
+
+		// different parameters or automata are different entries
+		REQUIRE(!is_universal_cached(aut, alph, nullptr, {{"algo", "antichains"}}));
+		copy.add_trans(1, 'z', 1);
+		REQUIRE(!is_universal_cached(copy, alph, nullptr, {{"algo", "naive"}}));
+		REQUIRE(cache.get_hits() == 1);
+		REQUIRE(cache.size() == 3);
+
+		Nfa bigger;
+		FILL_WITH_AUT_B(bigger);
+		bool incl = is_incl(aut, bigger, alph);
+		REQUIRE(is_incl_cached(aut, bigger, alph) == incl);
+		REQUIRE(is_incl_cached(bigger, aut, alph) == is_incl(bigger, aut, alph));
+		REQUIRE(is_incl_cached(aut, bigger, alph) == incl);
+		REQUIRE(cache.get_hits() == 2);
+	}
+
+	SECTION("the least recently used entry is evicted")
+	{
+		cache.set_capacity(2);
+
+		Nfa other;
+		FILL_WITH_AUT_B(other);
+
+		Nfa det_aut = determinize_cached(aut);
+		Nfa det_other = determinize_cached(other);
+		REQUIRE(determinize_cached(aut) == det_aut);   // hit, aut is now the newest
+		REQUIRE(cache.get_hits() == 1);
+
+		Nfa min_aut = minimize_cached(aut);          // evicts other
+		REQUIRE(min_aut == minimize(aut));
+		REQUIRE(cache.size() == 2);
+
+		REQUIRE(determinize_cached(aut) == det_aut);
+		REQUIRE(cache.get_hits() == 2);
+		REQUIRE(determinize_cached(other) == det_other);
+		REQUIRE(cache.get_hits() == 2);
+
+		cache.set_capacity(1);
+		REQUIRE(cache.size() == 1);
+	}
+
+	cache.set_capacity(0);
+	cache.clear();
+} // }}}
+
+TEST_CASE("Vata2::Nfa::ProfilingMatcher")
+{ // {{{
+	Nfa aut;
+	aut.initialstates = {10};
+	aut.finalstates = {10};
+	aut.add_trans(10, 'a', 20);
+	aut.add_trans(10, 'b', 10);
+	aut.add_trans(20, 'b', 10);
+	aut.add_trans(30, 'a', 10);   // unreachable
+
+	auto to_bytes = [](const std::string& str) {
+		return reinterpret_cast<const uint8_t*>(str.data());
+	};
+
+	SECTION("profiling and merging counters")
+	{
+		ProfilingMatcher matcher(aut);
+		REQUIRE(matcher.num_states() == 2);
+		REQUIRE(matcher.num_trans() == 3);
+
+		ProfilingMatcher::Counters counters1 = matcher.new_counters();
+		ProfilingMatcher::Counters counters2 = matcher.new_counters();
+		for (const std::string str : {"ab", "b"})
+		{
+			matcher.profile(to_bytes(str), str.size(), &counters1);
+		}
+		for (const std::string str : {"aa", ""})
+		{
+			matcher.profile(to_bytes(str), str.size(), &counters2);
+		}
+
+		REQUIRE(counters2.blocked == 1);
+		counters1.merge(counters2);
+		REQUIRE(counters1.blocked == 1);
+
+		Vata2::Parser::ParsedSection parsec = matcher.serialize_prob(counters1);
+		REQUIRE(parsec.type == "DPA");
+		REQUIRE(parsec["Initial"] == std::vector<std::string>{"10:1.0"});
+		REQUIRE(parsec["Final"] == std::vector<std::string>{"10:0.5"});
+		REQUIRE(parsec.body.size() == 3);
+
+		std::set<std::vector<std::string>> body(parsec.body.begin(), parsec.body.end());
+		REQUIRE(haskey(body, std::vector<std::string>{"20", "98:1", "10"}));
+
+		double sum = 0.5;
+		for (const auto& line : parsec.body)
+		{
+			if (line[0] != "10") { continue; }
+			sum += std::stod(line[1].substr(line[1].find(':') + 1));
+		}
+		REQUIRE(sum == Approx(1.0));
+	}
+
+	SECTION("nondeterministic automaton")
+	{
+		aut.add_trans(10, 'a', 10);
+		CHECK_THROWS_WITH(ProfilingMatcher(aut),
+			Catch::Contains("not deterministic"));
+	}
+
+	SECTION("symbol out of range")
+	{
+		aut.add_trans(20, 300, 20);
+		CHECK_THROWS_WITH(ProfilingMatcher(aut),
+			Catch::Contains("is not a byte"));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::save_binary() and load_binary()")
+{ // {{{
+	Nfa aut;
+	aut.add_initial(7);
+	aut.add_initial(1000);
+	aut.add_final(3);
+	aut.add_trans(7, 'a', 3);
+	aut.add_trans(7, 'a', 1000);
+	aut.add_trans(7, 'b', 7);
+	aut.add_trans(1000, 'c', 3);
+	aut.add_trans(3, 'a', 3);
+
+	SECTION("round trip through a stream")
+	{
+		StateToStringMap state_names = {{7, "q"}, {3, "r"}, {42, "unused"}};
+		SymbolToStringMap symbol_names = {{'a', "alpha"}, {'c', "gamma"}};
+
+		std::ostringstream os;
+		save_binary(aut, os, &state_names, &symbol_names);
+		REQUIRE(os.str().size() % 8 == 0);
+
+		std::istringstream is(os.str());
+		StateToStringMap loaded_state_names;
+		SymbolToStringMap loaded_symbol_names;
+		Nfa loaded = load_binary(is, &loaded_state_names, &loaded_symbol_names);
+
+		REQUIRE(loaded == aut);
+		REQUIRE(loaded.hash() == aut.hash());
+		REQUIRE(loaded_state_names == StateToStringMap({{7, "q"}, {3, "r"}}));
+		REQUIRE(loaded_symbol_names == symbol_names);
+	}
+
+	SECTION("empty automaton")
+	{
+		std::ostringstream os;
+		save_binary(Nfa(), os);
+		std::istringstream is(os.str());
+		Nfa loaded = load_binary(is);
+		REQUIRE(loaded.initialstates.empty());
+		REQUIRE(loaded.trans_empty());
+	}
+
+	SECTION("queries on BinaryNfa")
+	{
+		std::ostringstream os;
+		save_binary(aut, os);
+
+		// the view requires data aligned to 8 bytes
+		std::vector<uint64_t> buf((os.str().size() + 7) / 8);
+		std::memcpy(buf.data(), os.str().data(), os.str().size());
+		BinaryNfa bin(reinterpret_cast<const char*>(buf.data()), os.str().size());
+
+		REQUIRE(bin.num_states() == 3);
+		REQUIRE(bin.num_trans() == 5);
+		REQUIRE(bin.has_initial(7));
+		REQUIRE(!bin.has_initial(3));
+		REQUIRE(!bin.has_initial(8));
+		REQUIRE(bin.has_final(3));
+		REQUIRE(bin.get_initial() == StateSet({7, 1000}));
+		REQUIRE(bin.get_final() == StateSet({3}));
+		REQUIRE(bin.post(7, 'a') == StateSet({3, 1000}));
+		REQUIRE(bin.post(7, 'b') == StateSet({7}));
+		REQUIRE(bin.post(7, 'c').empty());
+		REQUIRE(bin.post(8, 'a').empty());
+		REQUIRE(bin.post(StateSet({3, 7, 1000}), 'a') == aut.post({3, 7, 1000}, 'a'));
+		REQUIRE(bin.post(StateSet({3, 7, 1000}), 'c') == StateSet({3}));
+	}
+
+	SECTION("corrupted input")
+	{
+		std::ostringstream os;
+		save_binary(aut, os);
+		std::string data = os.str();
+
+		std::istringstream is_truncated(data.substr(0, data.size() - 8));
+		CHECK_THROWS_WITH(load_binary(is_truncated), Catch::Contains("truncated"));
+
+		std::istringstream is_text("@NFA\n%Initial q\n");
+		CHECK_THROWS_WITH(load_binary(is_text), Catch::Contains("not a binary"));
+
+		// a target out of range (targets are followed only by the two offsets of
+		// empty tables of names)
+		std::string bad_target = data;
+		uint32_t target = 42;
+		std::memcpy(&bad_target[bad_target.size() - 3 * sizeof(uint64_t)], &target,
+			sizeof(target));
+		std::istringstream is_bad(bad_target);
+		CHECK_THROWS_WITH(load_binary(is_bad), Catch::Contains("corrupted"));
+
+		// the counts (after the header) claim many transitions that are missing
+		std::string huge = data.substr(0, sizeof(Vata2::Binary::Header) + 8 * sizeof(uint64_t));
+		uint64_t cnt_trans = static_cast<uint64_t>(1) << 40;
+		std::memcpy(&huge[sizeof(Vata2::Binary::Header) + 3 * sizeof(uint64_t)],
+			&cnt_trans, sizeof(cnt_trans));
+		std::istringstream is_huge(huge);
+		CHECK_THROWS_WITH(load_binary(is_huge), Catch::Contains("truncated"));
+
+		// the indices of the initial states 7 and 1000 (after the three states)
+		// swapped
+		std::string unsorted = data;
+		size_t initial_pos = sizeof(Vata2::Binary::Header) + 11 * sizeof(uint64_t);
+		std::swap(unsorted[initial_pos], unsorted[initial_pos + sizeof(uint32_t)]);
+		std::istringstream is_unsorted(unsorted);
+		CHECK_THROWS_WITH(load_binary(is_unsorted), Catch::Contains("not sorted"));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::random_tabakov_vardi() and random_dfa()")
+{ // {{{
+	SECTION("densities of transitions and final states")
+	{
+		Nfa aut = random_tabakov_vardi(20, 3, 1.5, 0.25, 42);
+		REQUIRE(aut.initialstates == StateSet({0}));
+		REQUIRE(aut.finalstates.size() == 5);
+
+		std::map<Symbol, size_t> trans_per_symbol;
+		for (const Trans& trans : aut)
+		{
+			REQUIRE(trans.src < 20);
+			REQUIRE(trans.tgt < 20);
+			++trans_per_symbol[trans.symb];
+		}
+		REQUIRE(trans_per_symbol == std::map<Symbol, size_t>({{0, 30}, {1, 30}, {2, 30}}));
+	}
+
+	SECTION("the seed determines the automaton")
+	{
+		REQUIRE(random_tabakov_vardi(50, 2, 2, 0.5, 1) ==
+			random_tabakov_vardi(50, 2, 2, 0.5, 1));
+		REQUIRE(random_tabakov_vardi(50, 2, 2, 0.5, 1) !=
+			random_tabakov_vardi(50, 2, 2, 0.5, 2));
+	}
+
+	SECTION("extreme densities")
+	{
+		Nfa full = random_tabakov_vardi(5, 1, 5, 1, 7);
+		REQUIRE(full.finalstates.size() == 5);
+		for (State st = 0; st < 5; ++st)
+		{
+			REQUIRE(full.post({st}, 0) == StateSet({0, 1, 2, 3, 4}));
+		}
+
+		Nfa empty = random_tabakov_vardi(5, 1, 0, 0, 7);
+		REQUIRE(empty.trans_empty());
+		REQUIRE(empty.finalstates.empty());
+
+		CHECK_THROWS_WITH(random_tabakov_vardi(5, 1, 6, 0.5, 7),
+			Catch::Contains("too high"));
+		CHECK_THROWS_WITH(random_tabakov_vardi(5, 1, 1, -0.5, 7),
+			Catch::Contains("invalid density"));
+		CHECK_THROWS_WITH(random_tabakov_vardi(0, 1, 1, 0.5, 7),
+			Catch::Contains("no states"));
+	}
+
+	SECTION("random DFAs are complete and deterministic")
+	{
+		Nfa aut = random_dfa(30, 4, 0.5, 3);
+		EnumAlphabet alph({"0", "1", "2", "3"});
+		REQUIRE(is_deterministic(aut));
+		REQUIRE(is_complete(aut, alph));
+		REQUIRE(aut.finalstates.size() == 15);
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::nth_symbol_from_end()")
+{ // {{{
+	Nfa aut = nth_symbol_from_end(3);
+	REQUIRE(is_in_lang(aut, {0, 1, 1}));
+	REQUIRE(is_in_lang(aut, {1, 1, 0, 0, 0}));
+	REQUIRE(!is_in_lang(aut, {0, 1, 1, 1}));
+	REQUIRE(!is_in_lang(aut, {0, 1}));
+
+	for (size_t n = 1; n <= 6; ++n)
+	{
+		SubsetMap subset_map;
+		determinize(nth_symbol_from_end(n), &subset_map);
+		REQUIRE(subset_map.size() == (1u << n));
+	}
+
+	CHECK_THROWS_WITH(nth_symbol_from_end(0), Catch::Contains("positive"));
+} // }}}
+
+TEST_CASE("Vata2::Nfa::regex_to_nfa()")
+{ // {{{
+	StringToSymbolMap symbol_map;
+	OnTheFlyAlphabet alph(&symbol_map);
+
+	auto word = [&alph](const std::string& str) -> Word {
+		Word result;
+		for (char ch : str) { result.push_back(alph.translate_symb(std::string(1, ch))); }
+		return result;
+	};
+
+	SECTION("operators")
+	{
+		Nfa aut = regex_to_nfa("a(b|c)*d+e?", &alph);
+		REQUIRE(is_in_lang(aut, word("ad")));
+		REQUIRE(is_in_lang(aut, word("abcbddde")));
+		REQUIRE(!is_in_lang(aut, word("a")));
+		REQUIRE(!is_in_lang(aut, word("abe")));
+		REQUIRE(!is_in_lang(aut, word("adee")));
+
+		// one state per occurrence of a symbol and an initial one
+		StateSet states = aut.initialstates;
+		for (const Trans& trans : aut) { states.insert(trans.tgt); }
+		REQUIRE(states.size() == 6);
+	}
+
+	SECTION("empty words and escapes")
+	{
+		Nfa aut = regex_to_nfa("(|a\\*)(\\(|)", &alph);
+		REQUIRE(is_in_lang(aut, {}));
+		REQUIRE(is_in_lang(aut, word("a*")));
+		REQUIRE(is_in_lang(aut, word("a*(")));
+		REQUIRE(is_in_lang(aut, word("(")));
+		REQUIRE(!is_in_lang(aut, word("a")));
+
+		Nfa empty_word = regex_to_nfa("", &alph);
+		REQUIRE(is_in_lang(empty_word, {}));
+		REQUIRE(empty_word.trans_empty());
+	}
+
+	SECTION("malformed expressions")
+	{
+		CHECK_THROWS_WITH(regex_to_nfa("(ab", &alph), Catch::Contains("missing ')'"));
+		CHECK_THROWS_WITH(regex_to_nfa("ab)", &alph), Catch::Contains("unmatched ')'"));
+		CHECK_THROWS_WITH(regex_to_nfa("*a", &alph), Catch::Contains("unexpected '*'"));
+		CHECK_THROWS_WITH(regex_to_nfa("a\\", &alph), Catch::Contains("escaped"));
+	}
+} // }}}
@@ -0,0 +1,494 @@
+/* parser-mmap.cc -- scanning VTF line by line from memory or streams
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// POSIX headers
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// VATA headers
+#include <vata2/parser.hh>
+
+using Vata2::Parser::MappedFile;
+using Vata2::Parser::ParsedSection;
+using Vata2::Parser::TokenLine;
+using Vata2::Parser::TokenView;
+using Vata2::Parser::VtfScanner;
+
+
+namespace
+{
+
+/// classes of characters for the scanner
+enum CharClass : uint8_t
+{
+	CC_STRING = 0,  ///< a character of an unquoted string
+	CC_SPACE,       ///< a whitespace (as in std::isspace() in the "C" locale)
+	CC_SPECIAL      ///< a character with a special meaning in some context
+};
+
+/// the table of classes of characters
+struct CharClassTable
+{ // {{{
+	CharClass table[256];
+
+	CharClassTable() : table()
+	{
+		for (size_t i = 0; i < 256; ++i) { this->table[i] = CC_STRING; }
+		for (unsigned char ch : {' ', '\t', '\n', '\v', '\f', '\r'})
+		{
+			this->table[ch] = CC_SPACE;
+		}
+		for (unsigned char ch : {'"', '(', ')', '#', '%', '@', '\\'})
+		{
+			this->table[ch] = CC_SPECIAL;
+		}
+	}
+
+	CharClass operator[](char ch) const
+	{
+		return this->table[static_cast<unsigned char>(ch)];
+	}
+}; // CharClassTable }}}
+
+const CharClassTable char_class;
+
+
+/// Determines whether the character is a character of a @TYPE (see
+/// is_string_char() in parser.cc)
+bool is_type_char(char ch)
+{ // {{{
+	return CC_STRING == char_class[ch] ||
+		(CC_SPACE == char_class[ch] && ' ' != ch && '\t' != ch);
+} // is_type_char }}}
+
+
+/// skips whitespaces from @p pos (at most to @p end)
+const char* skip_spaces(const char* pos, const char* end)
+{ // {{{
+	while (pos != end && CC_SPACE == char_class[*pos]) { ++pos; }
+	return pos;
+} // skip_spaces }}}
+
+
+/// finds the end of the line starting at @p pos (the newline or @p end)
+const char* find_eol(const char* pos, const char* end)
+{ // {{{
+	// memchr() is vectorized in common C libraries
+	const void* eol = std::memchr(pos, '\n', end - pos);
+	return (nullptr == eol)? end : static_cast<const char*>(eol);
+} // find_eol }}}
+
+
+/**
+ * @brief  Splits the line [@p begin, @p end) into tokens
+ *
+ * Follows get_token_from_line() and tokenize_line() in parser.cc.
+ */
+void tokenize_line(const char* begin, const char* end, TokenLine* line)
+{ // {{{
+	assert(nullptr != line);
+
+	line->clear();
+	const char* pos = begin;
+	while (true)
+	{
+		pos = skip_spaces(pos, end);
+		if (pos == end || '#' == *pos) { return; }
+
+		TokenView token = {pos, 0, false, false};
+		if ('(' == *pos || ')' == *pos)
+		{
+			token.len = 1;
+			++pos;
+		}
+		else if ('"' == *pos)
+		{
+			token.quoted = true;
+			token.data = ++pos;
+			bool pending_escape = false;
+			while (pos != end && '"' != *pos)
+			{
+				if ('\\' == *pos)
+				{
+					token.escaped = true;
+					if (++pos == end)
+					{
+						pending_escape = true;
+						break;
+					}
+				}
+
+				++pos;
+			}
+
+			token.len = pos - token.data;
+			if (pos == end)
+			{ // a pending backslash is dropped
+				if (pending_escape) { --token.len; }
+				throw std::runtime_error("missing ending quotes: " + token.to_string());
+			}
+
+			++pos;   // the closing quotes
+			if (pos != end && CC_SPACE != char_class[*pos] && '#' != *pos &&
+				')' != *pos)
+			{
+				throw std::runtime_error("misplaced quotes: \"" + token.to_string() +
+					"_\"_" + std::string(pos, end));
+			}
+		}
+		else
+		{ // an unquoted string; its first character may be '@' or '%'
+			++pos;
+			while (pos != end && CC_STRING == char_class[*pos]) { ++pos; }
+
+			// handle special characters that do not end the string
+			while (pos != end && '\\' == *pos)
+			{
+				++pos;
+				while (pos != end && CC_STRING == char_class[*pos]) { ++pos; }
+			}
+
+			token.len = pos - token.data;
+			if (pos != end && ('@' == *pos || '%' == *pos))
+			{
+				throw std::runtime_error(std::to_string("misplaced character \'") +
+					*pos + "\' in string \"" + std::string(token.data, pos + 1) +
+					std::string(pos + 1, end) + "\"");
+			}
+			else if (pos != end && '"' == *pos)
+			{
+				throw std::runtime_error("misplaced quotes: " + token.to_string() +
+					"_\"_" + std::string(pos + 1, end));
+			}
+			else if (!line->empty())
+			{
+				if ('@' == *token.data)
+				{
+					throw std::runtime_error("invalid position of @TYPE: " +
+						std::string(begin, end));
+				}
+				else if ('%' == *token.data)
+				{
+					throw std::runtime_error("invalid position of %KEY: " +
+						std::string(begin, end));
+				}
+			}
+		}
+
+		line->push_back(token);
+	}
+} // tokenize_line }}}
+
+} // anonymous namespace
+
+
+MappedFile::MappedFile(const std::string& filename) :
+	addr(nullptr),
+	length(0)
+{ // {{{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (-1 == fd)
+	{
+		throw std::runtime_error("cannot open file " + filename + ": " +
+			std::strerror(errno));
+	}
+
+	struct stat st;
+	if (-1 == fstat(fd, &st))
+	{
+		int err = errno;
+		close(fd);
+		throw std::runtime_error("cannot stat file " + filename + ": " +
+			std::strerror(err));
+	}
+
+	this->length = st.st_size;
+	if (0 != this->length)
+	{ // mmap() refuses empty mappings
+		void* mapping = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED == mapping)
+		{
+			int err = errno;
+			close(fd);
+			throw std::runtime_error("cannot map file " + filename + ": " +
+				std::strerror(err));
+		}
+
+		madvise(mapping, this->length, MADV_SEQUENTIAL);
+		this->addr = static_cast<const char*>(mapping);
+	}
+
+	close(fd);
+} // MappedFile() }}}
+
+
+MappedFile::~MappedFile()
+{ // {{{
+	if (nullptr != this->addr)
+	{
+		munmap(const_cast<char*>(this->addr), this->length);
+	}
+} // ~MappedFile() }}}
+
+
+void TokenView::assign_to(std::string* str) const
+{ // {{{
+	assert(nullptr != str);
+
+	if (!this->escaped)
+	{
+		str->assign(this->data, this->len);
+		return;
+	}
+
+	// only escaped quotes are unescaped; other escape sequences are kept
+	str->clear();
+	for (size_t i = 0; i < this->len; ++i)
+	{
+		if ('\\' == this->data[i] && i + 1 < this->len)
+		{
+			++i;
+			if ('"' != this->data[i]) { *str += '\\'; }
+		}
+
+		*str += this->data[i];
+	}
+} // assign_to }}}
+
+
+bool VtfScanner::fetch_line()
+{ // {{{
+	if (nullptr == this->input)
+	{
+		this->pos = skip_spaces(this->pos, this->end);
+		if (this->pos == this->end) { return false; }
+
+		this->line_begin = this->pos;
+		this->line_end = find_eol(this->pos, this->end);
+		this->pos = (this->line_end == this->end)? this->line_end : this->line_end + 1;
+		this->has_line = true;
+		return true;
+	}
+
+	while (std::getline(*this->input, this->line_buf))
+	{
+		const char* buf_end = this->line_buf.data() + this->line_buf.size();
+		const char* first = skip_spaces(this->line_buf.data(), buf_end);
+		if (first == buf_end) { continue; }
+
+		this->line_begin = first;
+		this->line_end = buf_end;
+		this->has_line = true;
+		return true;
+	}
+
+	return false;
+} // fetch_line }}}
+
+
+bool VtfScanner::next_section(std::string* type)
+{ // {{{
+	assert(nullptr != type);
+
+	TokenLine line;
+	bool is_key;
+	while (this->in_section && this->next_line(&line, &is_key))
+	{ }
+
+	while (this->has_line || this->fetch_line())
+	{
+		this->has_line = false;
+		if ('#' == *this->line_begin) { continue; }
+
+		std::string line_str(this->line_begin, this->line_end);
+		if ('@' != *this->line_begin)
+		{
+			throw std::runtime_error("expecting automaton type (@TYPE), got \"" +
+				line_str + "\" instead");
+		}
+
+		const char* it = this->line_begin + 1;
+		while (it != this->line_end && is_type_char(*it)) { ++it; }
+		if (it == this->line_begin + 1)
+		{
+			throw std::runtime_error("expecting automaton type (@TYPE), got \"" +
+				line_str + "\" instead");
+		}
+
+		type->assign(this->line_begin + 1, it);
+
+		it = skip_spaces(it, this->line_end);
+		if (it != this->line_end && '#' != *it)
+		{
+			throw std::runtime_error("invalid trailing characters \"" +
+				std::string(it, this->line_end) + "\" on the line \"" + line_str + "\"");
+		}
+
+		this->in_section = true;
+		return true;
+	}
+
+	return false;
+} // next_section }}}
+
+
+bool VtfScanner::next_line(TokenLine* line, bool* is_key)
+{ // {{{
+	assert(nullptr != line);
+	assert(nullptr != is_key);
+
+	while (this->in_section)
+	{
+		if ((!this->has_line && !this->fetch_line()) || '@' == *this->line_begin)
+		{ // end of the section (the line with the next @TYPE is kept)
+			this->in_section = false;
+			break;
+		}
+
+		this->has_line = false;
+		tokenize_line(this->line_begin, this->line_end, line);
+		if (line->empty()) { continue; }
+
+		TokenView& first = line->front();
+		*is_key = (!first.quoted && '%' == *first.data);
+		if (*is_key)
+		{
+			++first.data;
+			--first.len;
+			if (0 == first.len)
+			{
+				throw std::runtime_error("%KEY name missing: " +
+					std::string(this->line_begin, this->line_end));
+			}
+		}
+
+		return true;
+	}
+
+	return false;
+} // next_line }}}
+
+
+bool VtfScanner::read_section(ParsedSection* parsec, bool keepQuotes)
+{ // {{{
+	assert(nullptr != parsec);
+
+	*parsec = ParsedSection();
+	if (!this->next_section(&parsec->type)) { return false; }
+
+	TokenLine line;
+	bool is_key;
+	while (this->next_line(&line, &is_key))
+	{
+		if (is_key)
+		{
+			std::vector<std::string>& val_list = parsec->dict[line[0].to_string()];
+			for (size_t i = 1; i < line.size(); ++i)
+			{
+				val_list.push_back(line[i].to_string());
+			}
+		}
+		else
+		{
+			Vata2::Parser::BodyLine body_line;
+			for (const TokenView& token : line)
+			{
+				if (keepQuotes && token.quoted)
+				{
+					body_line.push_back("\"" + token.to_string() + "\"");
+				}
+				else
+				{
+					body_line.push_back(token.to_string());
+				}
+			}
+
+			parsec->body.push_back(std::move(body_line));
+		}
+	}
+
+	return true;
+} // read_section }}}
+
+
+std::vector<std::pair<const char*, size_t>> VtfScanner::split_section(
+	size_t num_chunks)
+{ // {{{
+	if (nullptr != this->input)
+	{
+		throw std::runtime_error(std::to_string(__func__) +
+			": not available for streams");
+	}
+
+	assert(0 < num_chunks);
+
+	std::vector<std::pair<const char*, size_t>> chunks;
+	if (!this->in_section) { return chunks; }
+
+	// the section ends at the first line starting with '@'; '@' is rare in
+	// bodies, so only its occurrences are checked
+	const char* section_end = this->end;
+	const char* at = this->pos;
+	while (at != this->end)
+	{
+		const void* found = std::memchr(at, '@', this->end - at);
+		if (nullptr == found) { break; }
+
+		at = static_cast<const char*>(found);
+		const char* line_begin = at;
+		while (line_begin != this->pos && '\n' != line_begin[-1] &&
+			CC_SPACE == char_class[line_begin[-1]])
+		{
+			--line_begin;
+		}
+
+		if (line_begin == this->pos || '\n' == line_begin[-1])
+		{
+			section_end = line_begin;
+			break;
+		}
+
+		++at;
+	}
+
+	size_t chunk_size = (section_end - this->pos) / num_chunks + 1;
+	const char* chunk_begin = this->pos;
+	while (chunk_begin != section_end)
+	{
+		const char* chunk_end = chunk_begin + std::min<size_t>(chunk_size,
+			section_end - chunk_begin);
+		if (chunk_end != section_end)
+		{ // chunks end after a newline
+			chunk_end = find_eol(chunk_end, section_end);
+			if (chunk_end != section_end) { ++chunk_end; }
+		}
+
+		chunks.push_back({chunk_begin, chunk_end - chunk_begin});
+		chunk_begin = chunk_end;
+	}
+
+	this->pos = section_end;
+	this->has_line = false;
+	this->in_section = false;
+	return chunks;
+} // split_section }}}
@@ -213,7 +213,7 @@ Parsed Vata2::Parser::parse_vtf(
 { // {{{
 	Parsed result;
 
-	while (input)
+	while (input.good())
 	{
 		ParsedSection parsec = parse_vtf_section(input, keepQuotes);
 		if (!parsec.empty())
@@ -0,0 +1,283 @@
+/* stats.cc -- statistics of operations
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+// VATA headers
+#include <vata2/stats.hh>
+
+using namespace Vata2::Stats;
+
+
+namespace
+{
+
+/// statistics of all threads
+struct Registry
+{ // {{{
+	std::mutex mtx = {};
+	/// statistics of running threads
+	std::set<ThreadStats*> live = {};
+	/// aggregated statistics of finished threads
+	Stats finished = {};
+}; // Registry }}}
+
+Registry& get_registry()
+{ // {{{
+	// never destroyed, so that threads can finish after static destructors
+	static Registry* registry = new Registry();
+	return *registry;
+} // get_registry }}}
+
+} // namespace
+
+
+bool Vata2::Stats::enabled()
+{ // {{{
+#ifdef VATA_STATS
+	return true;
+#else
+	return false;
+#endif
+} // enabled }}}
+
+
+const char* Vata2::Stats::to_string(Counter counter)
+{ // {{{
+	switch (counter)
+	{
+		case Counter::MACROSTATES: return "macrostates";
+		case Counter::SUBSUMPTION_CHECKS: return "subsumption checks";
+		case Counter::PRUNED: return "pruned";
+		case Counter::POST_CALLS: return "post calls";
+		case Counter::PEAK_WORKLIST: return "peak worklist";
+		case Counter::PEAK_MAP_SIZE: return "peak map size";
+		case Counter::PEAK_MAP_LOAD: return "peak map load";
+		default: throw std::runtime_error(std::string(__func__) + ": invalid counter");
+	}
+} // to_string(Counter) }}}
+
+
+const char* Vata2::Stats::to_string(Phase phase)
+{ // {{{
+	switch (phase)
+	{
+		case Phase::DETERMINIZE: return "determinize";
+		case Phase::COMPLEMENT: return "complement";
+		case Phase::MINIMIZE: return "minimize";
+		case Phase::INTERSECTION: return "intersection";
+		case Phase::INCLUSION: return "inclusion";
+		case Phase::UNIVERSALITY: return "universality";
+		default: throw std::runtime_error(std::string(__func__) + ": invalid phase");
+	}
+} // to_string(Phase) }}}
+
+
+void Stats::merge(const Stats& rhs)
+{ // {{{
+	for (size_t i = 0; i < NUM_COUNTERS; ++i)
+	{
+		if (is_peak(static_cast<Counter>(i)))
+		{
+			this->counters[i] = std::max(this->counters[i], rhs.counters[i]);
+		}
+		else
+		{
+			this->counters[i] += rhs.counters[i];
+		}
+	}
+
+	for (size_t i = 0; i < NUM_PHASES; ++i)
+	{
+		this->runs[i] += rhs.runs[i];
+		this->times[i] += rhs.times[i];
+	}
+} // merge }}}
+
+
+std::ostream& Vata2::Stats::operator<<(std::ostream& os, const Stats& stats)
+{ // {{{
+	if (!enabled())
+	{
+		return os << "statistics are disabled (compile with VATA_STATS)\n";
+	}
+
+	for (size_t i = 0; i < NUM_COUNTERS; ++i)
+	{
+		if (0 == stats.counters[i]) { continue; }
+
+		Counter counter = static_cast<Counter>(i);
+		os << to_string(counter) << ": ";
+		if (Counter::PEAK_MAP_LOAD == counter)
+		{
+			os << static_cast<double>(stats.counters[i]) / 1000;
+		}
+		else
+		{
+			os << stats.counters[i];
+		}
+		os << "\n";
+	}
+
+	for (size_t i = 0; i < NUM_PHASES; ++i)
+	{
+		if (0 == stats.runs[i]) { continue; }
+
+		os << "time of " << to_string(static_cast<Phase>(i)) << ": " <<
+			stats.times[i] << " s (" << stats.runs[i] << " runs)\n";
+	}
+
+	return os;
+} // operator<<(Stats) }}}
+
+
+ThreadStats::ThreadStats() :
+	counters(),
+	runs(),
+	nanos()
+{ // {{{
+	this->clear();
+
+	Registry& registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mtx);
+	registry.live.insert(this);
+} // ThreadStats() }}}
+
+
+ThreadStats::~ThreadStats()
+{ // {{{
+	Registry& registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mtx);
+	registry.finished.merge(this->snapshot());
+	registry.live.erase(this);
+} // ~ThreadStats() }}}
+
+
+Stats ThreadStats::snapshot() const
+{ // {{{
+	Stats result;
+	for (size_t i = 0; i < NUM_COUNTERS; ++i)
+	{
+		result.counters[i] = this->counters[i].load(std::memory_order_relaxed);
+	}
+
+	for (size_t i = 0; i < NUM_PHASES; ++i)
+	{
+		result.runs[i] = this->runs[i].load(std::memory_order_relaxed);
+		result.times[i] = static_cast<double>(
+			this->nanos[i].load(std::memory_order_relaxed)) / 1e9;
+	}
+
+	return result;
+} // snapshot }}}
+
+
+void ThreadStats::clear()
+{ // {{{
+	for (auto& cnt : this->counters) { cnt.store(0, std::memory_order_relaxed); }
+	for (auto& cnt : this->runs) { cnt.store(0, std::memory_order_relaxed); }
+	for (auto& cnt : this->nanos) { cnt.store(0, std::memory_order_relaxed); }
+} // clear }}}
+
+
+ThreadStats& Vata2::Stats::get_local()
+{ // {{{
+	thread_local ThreadStats local;
+	return local;
+} // get_local }}}
+
+
+Stats Vata2::Stats::get_thread()
+{ // {{{
+	return get_local().snapshot();
+} // get_thread }}}
+
+
+Stats Vata2::Stats::get_total()
+{ // {{{
+	Registry& registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mtx);
+	Stats result = registry.finished;
+	for (const ThreadStats* thread_stats : registry.live)
+	{
+		result.merge(thread_stats->snapshot());
+	}
+
+	return result;
+} // get_total }}}
+
+
+void Vata2::Stats::reset()
+{ // {{{
+	Registry& registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mtx);
+	registry.finished = Stats();
+	for (ThreadStats* thread_stats : registry.live) { thread_stats->clear(); }
+} // reset }}}
+
+
+Collector::Collector(Stats* result) :
+	result(result),
+	start(get_thread())
+{ // {{{
+	assert(nullptr != result);
+
+	// peaks are measured from zero and restored afterwards
+	ThreadStats& local = get_local();
+	for (size_t i = 0; i < NUM_COUNTERS; ++i)
+	{
+		if (is_peak(static_cast<Counter>(i)))
+		{
+			local.counters[i].store(0, std::memory_order_relaxed);
+		}
+	}
+} // Collector() }}}
+
+
+Collector::~Collector()
+{ // {{{
+	ThreadStats& local = get_local();
+	Stats end = local.snapshot();
+
+	Stats diff;
+	for (size_t i = 0; i < NUM_COUNTERS; ++i)
+	{
+		if (is_peak(static_cast<Counter>(i)))
+		{
+			diff.counters[i] = end.counters[i];
+			local.counters[i].store(std::max(this->start.counters[i], end.counters[i]),
+				std::memory_order_relaxed);
+		}
+		else
+		{
+			diff.counters[i] = end.counters[i] - this->start.counters[i];
+		}
+	}
+
+	for (size_t i = 0; i < NUM_PHASES; ++i)
+	{
+		diff.runs[i] = end.runs[i] - this->start.runs[i];
+		diff.times[i] = end.times[i] - this->start.times[i];
+	}
+
+	this->result->merge(diff);
+} // ~Collector() }}}
@@ -16,16 +16,6 @@ namespace
 	{ // {{{
 		DEBUG_VM_HIGH_PRINT("calling function \"" + func_name + "\" for " + Vata2::TYPE_STR);
 
-		if ("delete" == func_name) {
-			assert(func_args.size() == 1);
-			const VMValue& arg1 = func_args[0];
-			assert(Vata2::TYPE_STR == arg1.type || Vata2::TYPE_TOKEN == arg1.type);
-			const std::string* str = static_cast<const std::string*>(arg1.get_ptr());
-			assert(nullptr != str);
-			delete str;
-			return VMValue(Vata2::TYPE_VOID, nullptr);
-		}
-
 		// we use throw to return result from test_and_call
 		try {
 
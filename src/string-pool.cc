@@ -0,0 +1,170 @@
+/* string-pool.cc -- interning of names of states and symbols
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cstring>
+#include <stdexcept>
+
+// VATA headers
+#include <vata2/string-pool.hh>
+
+using Vata2::util::StringPool;
+
+const StringPool::Id StringPool::NOT_FOUND;
+
+
+namespace
+{
+
+/// the initial number of slots of the hash table
+const size_t INITIAL_SLOTS = 16;
+
+/// the FNV-1a hash of a string
+uint32_t hash_string(const char* str, size_t len)
+{ // {{{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i)
+	{
+		hash ^= static_cast<unsigned char>(str[i]);
+		hash *= 16777619u;
+	}
+
+	return hash;
+} // hash_string }}}
+
+} // anonymous namespace
+
+
+StringPool::StringPool() :
+	mutex(),
+	chars(),
+	offsets({0}),
+	hashes(),
+	slots(INITIAL_SLOTS, NOT_FOUND)
+{ }
+
+
+size_t StringPool::find_slot(const char* str, size_t len, uint32_t hash) const
+{ // {{{
+	size_t mask = this->slots.size() - 1;
+	for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+	{
+		Id id = this->slots[slot];
+		if (NOT_FOUND == id) { return slot; }
+
+		if (this->hashes[id] == hash &&
+			this->offsets[id + 1] - this->offsets[id] == len &&
+			0 == std::memcmp(this->chars.data() + this->offsets[id], str, len))
+		{
+			return slot;
+		}
+	}
+} // find_slot }}}
+
+
+void StringPool::grow()
+{ // {{{
+	std::vector<Id> new_slots(2 * this->slots.size(), NOT_FOUND);
+	size_t mask = new_slots.size() - 1;
+	for (Id id = 0; id < this->hashes.size(); ++id)
+	{
+		size_t slot = this->hashes[id] & mask;
+		while (NOT_FOUND != new_slots[slot]) { slot = (slot + 1) & mask; }
+		new_slots[slot] = id;
+	}
+
+	this->slots.swap(new_slots);
+} // grow }}}
+
+
+StringPool::Id StringPool::intern(const char* str, size_t len)
+{ // {{{
+	uint32_t hash = hash_string(str, len);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	size_t slot = this->find_slot(str, len, hash);
+	if (NOT_FOUND != this->slots[slot]) { return this->slots[slot]; }
+
+	if (this->hashes.size() >= NOT_FOUND - 1)
+	{
+		throw std::length_error(std::string(__func__) + ": too many strings");
+	}
+
+	Id id = this->hashes.size();
+	this->chars.insert(this->chars.end(), str, str + len);
+	this->offsets.push_back(this->chars.size());
+	this->hashes.push_back(hash);
+	this->slots[slot] = id;
+
+	// the load factor is kept at most 1/2
+	if (2 * this->hashes.size() > this->slots.size()) { this->grow(); }
+
+	return id;
+} // intern }}}
+
+
+StringPool::Id StringPool::find(const char* str, size_t len) const
+{ // {{{
+	uint32_t hash = hash_string(str, len);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->slots[this->find_slot(str, len, hash)];
+} // find }}}
+
+
+std::string StringPool::get(Id id) const
+{ // {{{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (id >= this->hashes.size())
+	{
+		throw std::out_of_range(std::string(__func__) + ": invalid ID " +
+			std::to_string(id));
+	}
+
+	return std::string(this->chars.data() + this->offsets[id],
+		this->offsets[id + 1] - this->offsets[id]);
+} // get }}}
+
+
+size_t StringPool::size() const
+{ // {{{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->hashes.size();
+} // size }}}
+
+
+size_t StringPool::memory_usage() const
+{ // {{{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return sizeof(*this) +
+		this->chars.capacity() * sizeof(char) +
+		this->offsets.capacity() * sizeof(size_t) +
+		this->hashes.capacity() * sizeof(uint32_t) +
+		this->slots.capacity() * sizeof(Id);
+} // memory_usage }}}
+
+
+std::string std::to_string(const Vata2::util::StringPool& pool)
+{ // {{{
+	std::string result = "{";
+	for (StringPool::Id id = 0; id < pool.size(); ++id)
+	{
+		if (0 != id) { result += ", "; }
+		result += pool.get(id) + " -> " + std::to_string(id);
+	}
+
+	return result + "}";
+} // to_string(StringPool) }}}
@@ -0,0 +1,126 @@
+/* tests-code.cc -- tests of compilation of VATA@CODE
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <sstream>
+
+#include <vata2/code.hh>
+
+using namespace Vata2::Code;
+using Vata2::Parser::ParsedSection;
+
+
+namespace
+{
+
+/// compiles @p sec and prints the instructions
+std::string compile_to_string(const ParsedSection& sec)
+{
+	std::ostringstream os;
+	os << compile(sec);
+	return os.str();
+}
+
+} /* anonymous namespace */
+
+
+TEST_CASE("Vata2::Code::compile() correct code")
+{ // {{{
+	ParsedSection sec;
+	sec.type = "CODE";
+
+	SECTION("empty program")
+	{
+		Program prog = compile(sec);
+		REQUIRE(prog.instrs.empty());
+		REQUIRE(prog.max_args == 0);
+	}
+
+	SECTION("Hello World")
+	{
+		sec.body.push_back({"(", "print", "\"Hello World!\"", ")"});
+		REQUIRE(compile_to_string(sec) ==
+			"PUSH_STR \"Hello World!\"\n"
+			"CALL print _\n"
+			"DISCARD\n");
+	}
+
+	SECTION("assignments and nested calls")
+	{
+		sec.body.push_back({"a1", "=", "(", "load_file", "\"a.vtf\"", ")"});
+		sec.body.push_back({"a2", "=", "(", "union", "a1", "(", "return", "a1", ")", ")"});
+		sec.body.push_back({"(", "print", "(", "is_incl", "a1", "a2", ")", ")"});
+
+		Program prog = compile(sec);
+		REQUIRE(compile_to_string(sec) ==
+			"PUSH_STR \"a.vtf\"\n"
+			"CALL load_file _\n"
+			"STORE a1\n"
+			"CALL return a1\n"
+			"CALL union a1 _\n"
+			"STORE a2\n"
+			"CALL is_incl a1 a2\n"
+			"CALL print _\n"
+			"DISCARD\n");
+
+		// names are interned
+		REQUIRE(prog.vars == std::vector<std::string>({"a1", "a2"}));
+		REQUIRE(prog.funcs.size() == 5);
+		REQUIRE(prog.calls.size() == 5);
+		REQUIRE(prog.max_args == 2);
+	}
+} // }}}
+
+TEST_CASE("Vata2::Code::compile() invalid code")
+{ // {{{
+	ParsedSection sec;
+	sec.type = "CODE";
+
+	SECTION("errors are reported where the interpreter reports them")
+	{
+		sec.body.push_back({"(", "print", "\"a\"", ")"});
+		sec.body.push_back({"(", "foo", "(", "return", "\"b\"", ")"});
+
+		REQUIRE(compile_to_string(sec) ==
+			"PUSH_STR \"a\"\n"
+			"CALL print _\n"
+			"DISCARD\n"
+			"PUSH_STR \"b\"\n"
+			"CALL return _\n"
+			"ERROR dangling code or invalid token: foo (expecting '=')\n");
+	}
+
+	SECTION("invalid calls")
+	{
+		std::vector<std::pair<Vata2::Parser::BodyLine, std::string>> lines = {
+			{{"(", ")"}, "ERROR \"()\" is not a valid function call\n"},
+			{{"(", "(", "return", "\"a\"", ")", ")"},
+				"ERROR \"((return \"a\"))\" is not a valid function call\n"},
+			{{"(", "load_file", ")"}, "ERROR \"(load_file)\" is not a valid function call\n"},
+			{{"(", "return", "\"a\"", ")", ")"}, "ERROR mismatched parenthesis\n"},
+			{{"x", "y"}, "ERROR dangling code in a CODE section: [x, y]\n"},
+		};
+
+		for (const auto& line_error : lines)
+		{
+			sec.body = {line_error.first};
+			std::string code = compile_to_string(sec);
+			REQUIRE(code.substr(code.rfind("ERROR")) == line_error.second);
+		}
+	}
+} // }}}
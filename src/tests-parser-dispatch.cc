@@ -40,12 +40,11 @@ TEST_CASE("Vata2::VM::find_dispatcher(\"Parsec\")")
 				{ },
 			};
 
-		VMValue res = find_dispatcher(Vata2::TYPE_PARSEC)("copy", {{Vata2::TYPE_PARSEC, &parsec}});
+		VMValue res = find_dispatcher(Vata2::TYPE_PARSEC)("copy", {VMValue::borrow(Vata2::TYPE_PARSEC, &parsec)});
 		REQUIRE(Vata2::TYPE_PARSEC == res.type);
 		const ParsedSection* parsec_copy =
 			static_cast<const ParsedSection*>(res.get_ptr());
 		REQUIRE((*parsec_copy == parsec));
-		delete parsec_copy;
 	}
 
 	SECTION("copy 2")
@@ -63,13 +62,12 @@ TEST_CASE("Vata2::VM::find_dispatcher(\"Parsec\")")
 				{ },
 			};
 
-		VMValue res = find_dispatcher(Vata2::TYPE_PARSEC)("copy", {{Vata2::TYPE_PARSEC, &parsec}});
+		VMValue res = find_dispatcher(Vata2::TYPE_PARSEC)("copy", {VMValue::borrow(Vata2::TYPE_PARSEC, &parsec)});
 		parsec.body.pop_back();   // remove an element from body
 		REQUIRE(Vata2::TYPE_PARSEC == res.type);
 		const ParsedSection* parsec_copy =
 			static_cast<const ParsedSection*>(res.get_ptr());
 		REQUIRE((*parsec_copy != parsec));
-		delete parsec_copy;
 	}
 
 	SECTION("invalid function")
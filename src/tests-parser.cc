@@ -17,9 +17,14 @@
 
 #include "../3rdparty/catch.hpp"
 
+#include <memory>
+
 #include <vata2/parser.hh>
 #include <vata2/util.hh>
 
+// POSIX headers
+#include <unistd.h>
+
 using namespace Vata2::Parser;
 using namespace Vata2::util;
 
@@ -614,3 +619,210 @@ TEST_CASE("Vata2::Parser::ParsedSection::operator<<(ostream&)")
 	}
 
 } // }}}
+
+TEST_CASE("Vata2::Parser::VtfScanner")
+{ // {{{
+	// the scanner needs to agree with parse_vtf() on valid and invalid inputs
+	const std::vector<std::string> inputs = {
+		"",
+		"   \n\n# only a comment\n",
+		"@Type\n",
+		"@Type",
+		"@Type1\n%key1\n@Type2\n%key2\n",
+		"@Type\n%key1     value1.1  value1.2 value1.3\t\t\tvalue1.4\n%key2\n",
+		"     \n\n\t\n# a comment\n    #another comment\n#\n     @Ty#pe      \n"
+			"# some commment\n%key1 value1#comment#comment2\n"
+			"   %key2 value2.1 # value2.2     \n\t\na\n   b0 b1 #b2",
+		"@Type\n%key1 \"value 1\"\n%key2 \"value2.1\" value2 2 \"value 2 3\"\n"
+			"%key3 \"val#1\"    # test\na \"\"\n%key4 \"val 1   \" \n%key5\n"
+			"b0 \"b 1\" c d\n\"%key6\"\n%key7\n"
+			"c 0 \"\\\"he's so cool,\\\" he said \\/\" c d\n\"a\"\n\"\"\n'\nq a q'",
+		"@Type\n%key1     \"value@1\"  \"value@2\"#new\n"
+			"%key2     \"value%1\"  (\"value%2\")\n",
+		"@Type\n%key1 (a b)\na (b   c  d)(e\n",
+		"@Type\na\\b c\\\\ \"d\\\\\" \"e\\\\\\\"f\"\n",
+		"@Type\r\nq1 a q2\r\n%Final q2\r\n",
+		"@A\n%Initial q\nq a q\n@B\nx y z\n\n@C\n",
+		// invalid inputs
+		"@\nType%key1\n%key2\n",
+		"@Type another\n",
+		"%key1\n%key2\n",
+		"@Type\n%key1 \"value\n",
+		"@Type\n%key1 \"\n",
+		"@Type\n%key1 \"val\"ue\n",
+		"@Type\n%key1 val\"ue\n",
+		"@Type\n%key1 val@ue\n",
+		"@Type\n%key1 val%ue\n",
+		"@Type\n%key1 %value\n",
+		"@Type\n%key1 @value\n",
+		"@Type\n% value\n",
+		"@Type\na b \"c\\",
+		"@Type\na b \"c\\\\",
+	};
+
+	for (const std::string& input : inputs)
+	{
+		CAPTURE(input);
+
+		Parsed expected;
+		std::string expected_error;
+		try
+		{
+			expected = parse_vtf(input, true);
+		}
+		catch (const std::exception& ex)
+		{
+			expected_error = ex.what();
+		}
+
+		auto scan_all = [&expected, &expected_error](VtfScanner* scanner) {
+			Parsed result;
+			std::string error;
+			try
+			{
+				ParsedSection parsec;
+				while (scanner->read_section(&parsec, true)) { result.push_back(parsec); }
+			}
+			catch (const std::exception& ex)
+			{
+				error = ex.what();
+			}
+
+			REQUIRE(expected_error == error);
+			REQUIRE(expected == result);
+		};
+
+		VtfScanner buffer_scanner(input.data(), input.size());
+		scan_all(&buffer_scanner);
+
+		std::istringstream stream(input);
+		VtfScanner stream_scanner(stream);
+		scan_all(&stream_scanner);
+	}
+
+	SECTION("lines of a section one by one")
+	{
+		std::string input =
+			"@Type\n"
+			"%key1 value1 \"value 2\"\n"
+			"a \"b\\\"c\" (d)\n"
+			"@Type2\n";
+
+		for (bool from_stream : {false, true})
+		{
+			std::istringstream stream(input);
+			std::unique_ptr<VtfScanner> scanner(from_stream? new VtfScanner(stream) :
+				new VtfScanner(input.data(), input.size()));
+			std::string type;
+			REQUIRE(scanner->next_section(&type));
+			REQUIRE("Type" == type);
+
+			TokenLine line;
+			bool is_key;
+			REQUIRE(scanner->next_line(&line, &is_key));
+			REQUIRE(is_key);
+			REQUIRE(line.size() == 3);
+			REQUIRE("key1" == line[0].to_string());
+			REQUIRE(line[2].quoted);
+			REQUIRE("value 2" == line[2].to_string());
+			if (!from_stream)
+			{ // tokens point into the input
+				REQUIRE(input.data() + 7 == line[0].data);
+			}
+
+			REQUIRE(scanner->next_line(&line, &is_key));
+			REQUIRE(!is_key);
+			REQUIRE(line.size() == 5);
+			REQUIRE("b\"c" == line[1].to_string());
+			REQUIRE("(" == line[2].to_string());
+
+			REQUIRE(!scanner->next_line(&line, &is_key));
+			REQUIRE(scanner->next_section(&type));
+			REQUIRE("Type2" == type);
+			REQUIRE(!scanner->next_line(&line, &is_key));
+			REQUIRE(!scanner->next_section(&type));
+		}
+	}
+
+	SECTION("splitting a section into chunks")
+	{
+		std::string input =
+			"@Type\n"
+			"a b c\n"
+			"d \"@e\" f\n"
+			"  g @h i\n"
+			"j k l\n"
+			"  @Type2\n"
+			"m n o\n";
+
+		VtfScanner scanner(input.data(), input.size());
+		std::string type;
+		REQUIRE(scanner.next_section(&type));
+
+		auto chunks = scanner.split_section(3);
+		REQUIRE(chunks.size() <= 3);
+		std::string joined;
+		for (const auto& chunk : chunks)
+		{ // chunks consist of whole lines
+			REQUIRE('\n' == chunk.first[chunk.second - 1]);
+			joined += std::string(chunk.first, chunk.second);
+		}
+		REQUIRE("a b c\nd \"@e\" f\n  g @h i\nj k l\n" == joined);
+
+		// chunks are scanned as bodies
+		VtfScanner chunk_scanner(chunks[0].first, chunks[0].second);
+		chunk_scanner.start_body();
+		TokenLine line;
+		bool is_key;
+		REQUIRE(chunk_scanner.next_line(&line, &is_key));
+		REQUIRE("a" == line[0].to_string());
+
+		// the scanner is moved past the section
+		REQUIRE(scanner.next_section(&type));
+		REQUIRE("Type2" == type);
+
+		std::istringstream stream(input);
+		VtfScanner stream_scanner(stream);
+		REQUIRE(stream_scanner.next_section(&type));
+		CHECK_THROWS_WITH(stream_scanner.split_section(2),
+			Catch::Contains("not available for streams"));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Parser::MappedFile")
+{ // {{{
+	SECTION("mapping a file")
+	{
+		std::string content = "@NFA\n%Initial q\nq a q\n";
+		char filename[] = "/tmp/vata2-test-XXXXXX";
+		int fd = mkstemp(filename);
+		REQUIRE(-1 != fd);
+		REQUIRE(write(fd, content.data(), content.size()) ==
+			static_cast<ssize_t>(content.size()));
+		close(fd);
+
+		{
+			MappedFile file(filename);
+			REQUIRE(content.size() == file.size());
+			REQUIRE(content == std::string(file.data(), file.size()));
+		}
+
+		// an empty file
+		REQUIRE(0 == truncate(filename, 0));
+		{
+			MappedFile file(filename);
+			REQUIRE(0 == file.size());
+			VtfScanner scanner(file.data(), file.size());
+			std::string type;
+			REQUIRE(!scanner.next_section(&type));
+		}
+
+		unlink(filename);
+	}
+
+	SECTION("nonexistent file")
+	{
+		CHECK_THROWS_WITH(MappedFile("/nonexistent/file.vtf"),
+			Catch::Contains("cannot open file"));
+	}
+} // }}}
@@ -0,0 +1,123 @@
+/* tests-stats.cc -- tests of statistics of operations
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <sstream>
+#include <thread>
+
+#include <vata2/nfa.hh>
+#include <vata2/stats.hh>
+
+using namespace Vata2::Stats;
+
+
+TEST_CASE("Vata2::Stats aggregation")
+{ // {{{
+	reset();
+
+	SECTION("sums and peaks of threads")
+	{
+		add(Counter::POST_CALLS, 3);
+		update_max(Counter::PEAK_WORKLIST, 10);
+
+		uint64_t thread_posts = 0;
+		std::thread thread([&thread_posts]() {
+			add(Counter::POST_CALLS, 4);
+			update_max(Counter::PEAK_WORKLIST, 7);
+			update_max(Counter::PEAK_WORKLIST, 20);
+			thread_posts = get_thread()[Counter::POST_CALLS];
+		});
+		thread.join();
+
+		REQUIRE(thread_posts == 4);
+
+		REQUIRE(get_thread()[Counter::POST_CALLS] == 3);
+		Stats total = get_total();
+		REQUIRE(total[Counter::POST_CALLS] == 7);
+		REQUIRE(total[Counter::PEAK_WORKLIST] == 20);
+
+		reset();
+		REQUIRE(get_total()[Counter::POST_CALLS] == 0);
+	}
+
+	SECTION("collectors")
+	{
+		update_max(Counter::PEAK_WORKLIST, 10);
+		add(Counter::MACROSTATES, 5);
+
+		Stats stats;
+		{
+			Collector collector(&stats);
+			add(Counter::MACROSTATES, 2);
+			update_max(Counter::PEAK_WORKLIST, 3);
+			{
+				Timer timer(Phase::DETERMINIZE);
+			}
+		}
+
+		REQUIRE(stats[Counter::MACROSTATES] == 2);
+		REQUIRE(stats[Counter::PEAK_WORKLIST] == 3);
+		REQUIRE(stats.get_runs(Phase::DETERMINIZE) == 1);
+		REQUIRE(stats.get_time(Phase::DETERMINIZE) >= 0);
+
+		// the peak of the thread is kept
+		REQUIRE(get_thread()[Counter::PEAK_WORKLIST] == 10);
+		REQUIRE(get_thread()[Counter::MACROSTATES] == 7);
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Stats of operations")
+{ // {{{
+	using namespace Vata2::Nfa;
+
+	Nfa aut;
+	aut.add_initial(0);
+	aut.add_final(0);
+	aut.add_trans(0, 0, 0);
+	aut.add_trans(0, 1, 0);
+	aut.add_trans(0, 0, 1);
+	aut.add_trans(1, 1, 2);
+	EnumAlphabet alph({"a", "b"});
+
+	Stats stats;
+	{
+		Collector collector(&stats);
+		REQUIRE(is_universal(aut, alph, {{"algo", "antichains"}}));
+		determinize(aut);
+	}
+
+	std::ostringstream os;
+	os << stats;
+
+	if (!enabled())
+	{
+		REQUIRE(stats[Counter::MACROSTATES] == 0);
+		REQUIRE(os.str() == "statistics are disabled (compile with VATA_STATS)\n");
+		return;
+	}
+
+	REQUIRE(stats[Counter::MACROSTATES] > 0);
+	REQUIRE(stats[Counter::SUBSUMPTION_CHECKS] > 0);
+	REQUIRE(stats[Counter::POST_CALLS] > 0);
+	REQUIRE(stats[Counter::PEAK_MAP_SIZE] > 0);
+	REQUIRE(stats.get_runs(Phase::UNIVERSALITY) == 1);
+	REQUIRE(stats.get_runs(Phase::DETERMINIZE) == 1);
+	REQUIRE(os.str().find("subsumption checks: ") != std::string::npos);
+	REQUIRE(os.str().find("time of universality: ") != std::string::npos);
+} // }}}
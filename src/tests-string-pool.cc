@@ -0,0 +1,100 @@
+/* tests-string-pool.cc -- tests of StringPool
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <thread>
+
+#include <vata2/string-pool.hh>
+
+using Vata2::util::StringPool;
+
+
+TEST_CASE("Vata2::util::StringPool")
+{ // {{{
+	StringPool pool;
+
+	SECTION("empty pool")
+	{
+		REQUIRE(pool.size() == 0);
+		REQUIRE(pool.find("a") == StringPool::NOT_FOUND);
+		REQUIRE(std::to_string(pool) == "{}");
+		CHECK_THROWS_AS(pool.get(0), std::out_of_range);
+	}
+
+	SECTION("interning strings")
+	{
+		REQUIRE(pool.intern("q1") == 0);
+		REQUIRE(pool.intern("q2") == 1);
+		REQUIRE(pool.intern("q1") == 0);
+		REQUIRE(pool.intern("") == 2);
+		REQUIRE(pool.intern(std::string("a\0b", 3)) == 3);
+		REQUIRE(pool.intern("a") == 4);
+
+		REQUIRE(pool.size() == 5);
+		REQUIRE(pool.find("q2") == 1);
+		REQUIRE(pool.find("") == 2);
+		REQUIRE(pool.find("q3") == StringPool::NOT_FOUND);
+		REQUIRE(pool.get(0) == "q1");
+		REQUIRE(pool.get(2) == "");
+		REQUIRE(pool.get(3) == std::string("a\0b", 3));
+		REQUIRE(std::to_string(pool).substr(0, 18) == "{q1 -> 0, q2 -> 1,");
+	}
+
+	SECTION("many strings")
+	{
+		for (size_t i = 0; i < 10000; ++i)
+		{
+			REQUIRE(pool.intern("s" + std::to_string(i)) == i);
+		}
+
+		for (size_t i = 0; i < 10000; ++i)
+		{
+			REQUIRE(pool.find("s" + std::to_string(i)) == i);
+			REQUIRE(pool.get(i) == "s" + std::to_string(i));
+		}
+
+		REQUIRE(pool.size() == 10000);
+		REQUIRE(pool.memory_usage() > 10000 * 5);
+	}
+
+	SECTION("sharing a pool by several threads")
+	{
+		std::vector<std::vector<StringPool::Id>> ids(4);
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			workers.emplace_back([&pool, &ids, i]() {
+				for (size_t j = 0; j < 1000; ++j)
+				{
+					ids[i].push_back(pool.intern("s" + std::to_string((i + j) % 1000)));
+				}
+			});
+		}
+
+		for (std::thread& worker : workers) { worker.join(); }
+
+		REQUIRE(pool.size() == 1000);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			for (size_t j = 0; j < 1000; ++j)
+			{
+				REQUIRE(pool.get(ids[i][j]) == "s" + std::to_string((i + j) % 1000));
+			}
+		}
+	}
+} // }}}
@@ -0,0 +1,142 @@
+/* tests-trace.cc -- tests of traces of execution
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <vata2/trace.hh>
+#include <vata2/util.hh>
+#include <vata2/vm.hh>
+
+using namespace Vata2::Trace;
+
+
+namespace
+{
+
+/// a temporary file removed at the end of its scope
+struct TempFile
+{
+	char name[32] = "/tmp/vata2-test-XXXXXX";
+
+	TempFile()
+	{
+		int fd = mkstemp(this->name);
+		REQUIRE(-1 != fd);
+		close(fd);
+	}
+
+	~TempFile() { unlink(this->name); }
+
+	std::string read() const
+	{
+		std::ifstream is(this->name);
+		std::ostringstream buf;
+		buf << is.rdbuf();
+		return buf.str();
+	}
+};
+
+} /* anonymous namespace */
+
+
+TEST_CASE("Vata2::Trace")
+{ // {{{
+	TempFile file;
+
+	SECTION("names are not constructed without tracing")
+	{
+		REQUIRE(!enabled());
+
+		bool constructed = false;
+		{
+			VATA_TRACE_SCOPE("test", (constructed = true, "name"));
+		}
+		REQUIRE(!constructed);
+	}
+
+	SECTION("events of a scope")
+	{
+		start(file.name);
+		REQUIRE(enabled());
+		REQUIRE_THROWS_WITH(start(file.name), Catch::Contains("already started"));
+
+		{
+			VATA_TRACE_SCOPE("test", std::string("a \"quoted\"\tname"));
+		}
+		stop();
+		REQUIRE(!enabled());
+
+		std::string trace = file.read();
+		REQUIRE(trace.find("[\n{") == 0);
+		REQUIRE(trace.find("\"name\": \"a \\\"quoted\\\"\\tname\", \"cat\": \"test\", "
+			"\"ph\": \"X\", \"ts\": ") != std::string::npos);
+		REQUIRE(trace.find("\"tid\": ") != std::string::npos);
+		REQUIRE(trace.substr(trace.size() - 4) == "}\n]\n");
+	}
+
+	SECTION("calls of the VM")
+	{
+		Vata2::VM::VirtualMachine mach;
+		Vata2::Parser::ParsedSection sec;
+		sec.type = "CODE";
+		sec.body.push_back({"(", "reset_stats", "\"x\"", ")"});
+
+		start(file.name);
+		mach.run_code(sec);
+		stop();
+
+		std::string trace = file.read();
+		size_t call_pos = trace.find("{\"name\": \"reset_stats\", \"cat\": \"call\"");
+		size_t code_pos = trace.find("{\"name\": \"@CODE\", \"cat\": \"vm\"");
+		REQUIRE(call_pos != std::string::npos);
+		REQUIRE(code_pos != std::string::npos);
+		// an event is written when it ends
+		REQUIRE(call_pos < code_pos);
+	}
+
+	SECTION("a file that cannot be opened")
+	{
+		REQUIRE_THROWS_WITH(start("/nonexistent/trace.json"),
+			Catch::Contains("cannot open"));
+		REQUIRE(!enabled());
+	}
+} // Vata2::Trace }}}
+
+
+TEST_CASE("VATA_LOG_ENABLED")
+{ // {{{
+	unsigned old_verbosity = Vata2::LOG_VERBOSITY;
+
+	Vata2::LOG_VERBOSITY = 0;
+	REQUIRE(!VATA_LOG_ENABLED(1));
+
+	Vata2::LOG_VERBOSITY = VATA_MAX_LOG_LEVEL + 1;
+#if VATA_MAX_LOG_LEVEL > 0
+	// the comparison of the unsigned verbosity with 0 would give a warning
+	REQUIRE(VATA_LOG_ENABLED(VATA_MAX_LOG_LEVEL));
+#endif
+	// levels that are not compiled in are never enabled
+	REQUIRE(!VATA_LOG_ENABLED(VATA_MAX_LOG_LEVEL + 1));
+
+	Vata2::LOG_VERBOSITY = old_verbosity;
+} // VATA_LOG_ENABLED }}}
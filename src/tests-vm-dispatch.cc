@@ -19,7 +19,7 @@ TEST_CASE("Vata2::VM::find_dispatcher()")
 	{
 		size_t n42 = 42;
 		auto f = [&n42](const VMFuncName&, const VMFuncArgs&) -> VMValue {
-			return VMValue("ANSWER", &n42); };
+			return VMValue::borrow("ANSWER", &n42); };
 
 		reg_dispatcher("FOO", f, "a foo data type");
 
@@ -34,3 +34,48 @@ TEST_CASE("Vata2::VM::find_dispatcher()")
 			Catch::Contains("already registered"));
 	}
 }
+
+TEST_CASE("Vata2::VM::VMValue lifetime")
+{
+	auto str = std::make_shared<std::string>("foo");
+	std::weak_ptr<std::string> observer = str;
+
+	SECTION("copies share the object, which is freed with the last of them")
+	{
+		VMValue val(Vata2::TYPE_STR, std::move(str));
+		{
+			VMValue copy = val;
+			REQUIRE(copy.get_ptr() == val.get_ptr());
+			val = VMValue();
+			REQUIRE(!observer.expired());
+		}
+		REQUIRE(observer.expired());
+	}
+
+	SECTION("a moved value gives up the object")
+	{
+		VMValue val(Vata2::TYPE_STR, std::move(str));
+		VMValue moved = std::move(val);
+		REQUIRE(*static_cast<const std::string*>(moved.get_ptr()) == "foo");
+		moved = VMValue();
+		REQUIRE(observer.expired());
+	}
+
+	SECTION("a borrowed value does not own the object")
+	{
+		{
+			VMValue val = VMValue::borrow(Vata2::TYPE_STR, str.get());
+			REQUIRE(val.get_ptr() == str.get());
+		}
+		REQUIRE(*str == "foo");
+	}
+}
+
+TEST_CASE("Vata2::VM::has_side_effect()")
+{
+	REQUIRE(has_side_effect("print"));
+	REQUIRE(!has_side_effect("return"));
+
+	reg_side_effect("save_to_disk");
+	REQUIRE(has_side_effect("save_to_disk"));
+}
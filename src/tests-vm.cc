@@ -2,7 +2,17 @@
 
 #include "../3rdparty/catch.hpp"
 
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <vata2/nfa-binary.hh>
 #include <vata2/vm.hh>
+#include <vata2/vm-dispatch.hh>
 
 using namespace Vata2::Parser;
 using namespace Vata2::VM;
@@ -67,6 +77,149 @@ TEST_CASE("Vata2::VM::VirtualMachine::run_code() correct calls")
 		mach.run_code(sec);
 	}
 
+	SECTION("print_stats")
+	{
+		sec.body.push_back({"(", "reset_stats", "\"\"", ")"});
+		sec.body.push_back({"(", "print_stats", "\"none\"", ")"});
+
+		// we wish to catch output
+		std::ostringstream cout_buf;
+		cout_redirect cout_guard(cout_buf.rdbuf());
+
+		mach.run_code(sec);
+		REQUIRE(cout_buf.str().find("statistics (none):\n") == 0);
+	}
+
+	SECTION("variables")
+	{
+		sec.body.push_back({"s", "=", "(", "return", "\"Hi\"", ")"});
+		sec.body.push_back({"(", "print", "s", ")"});
+		sec.body.push_back({"s", "=", "(", "return", "\" there\"", ")"});
+		sec.body.push_back({"(", "print", "s", ")"});
+		sec.body.push_back({"(", "print", "(", "return", "s", ")", ")"});
+
+		std::ostringstream cout_buf;
+		cout_redirect cout_guard(cout_buf.rdbuf());
+
+		mach.run_code(sec);
+
+		REQUIRE(cout_buf.str() == "Hi there there");
+		VMValue val_s = mach.load_from_storage("s");
+		REQUIRE(Vata2::TYPE_STR == val_s.type);
+		REQUIRE(" there" == *static_cast<const std::string*>(val_s.get_ptr()));
+
+		// a compiled program can be run repeatedly
+		Vata2::Code::Program prog = Vata2::Code::compile(sec);
+		cout_buf.str("");
+		mach.run_program(prog);
+		mach.run_program(prog);
+		REQUIRE(cout_buf.str() == "Hi there thereHi there there");
+	}
+
+	SECTION("load_file with a binary file")
+	{
+		Vata2::Nfa::Nfa aut;
+		aut.add_initial(1);
+		aut.add_trans(1, 0, 2);
+		aut.add_final(2);
+
+		char filename[] = "/tmp/vata2-test-XXXXXX";
+		int fd = mkstemp(filename);
+		REQUIRE(-1 != fd);
+		close(fd);
+		{
+			std::ofstream os(filename, std::ios::out | std::ios::binary);
+			Vata2::Nfa::save_binary(aut, os);
+		}
+
+		sec.body.push_back({"a1", "=", "(", "load_file", "\"" + std::string(filename) + "\"", ")"});
+		sec.body.push_back({"(", "print", "a1", ")"});
+
+		std::ostringstream cout_buf;
+		cout_redirect cout_guard(cout_buf.rdbuf());
+
+		mach.run_code(sec);
+		unlink(filename);
+
+		REQUIRE(cout_buf.str().find("q1 a0 q2") != std::string::npos);
+	}
+
+	SECTION("alphabets of automata do not depend on other automata")
+	{
+		std::vector<std::string> files = {
+			"@NFA\n%Initial q\n%Final q\nq a q\nq b q\n",
+			"@NFA\n%Initial p\n%Final p\np c p\n",
+		};
+
+		std::vector<std::string> filenames;
+		for (const std::string& file : files) {
+			char filename[] = "/tmp/vata2-test-XXXXXX";
+			int fd = mkstemp(filename);
+			REQUIRE(-1 != fd);
+			close(fd);
+			std::ofstream(filename) << file;
+			filenames.push_back(filename);
+		}
+
+		sec.body.push_back({"a1", "=", "(", "load_file", "\"" + filenames[0] + "\"", ")"});
+		sec.body.push_back({"(", "print", "(", "is_univ", "a1", ")", ")"});
+		sec.body.push_back({"a2", "=", "(", "load_file", "\"" + filenames[1] + "\"", ")"});
+		sec.body.push_back({"(", "print", "(", "is_univ", "a1", ")", ")"});
+		sec.body.push_back({"(", "print", "(", "is_univ", "a2", ")", ")"});
+
+		std::ostringstream cout_buf;
+		cout_redirect cout_guard(cout_buf.rdbuf());
+
+		mach.run_code(sec);
+		for (const std::string& filename : filenames) { unlink(filename.c_str()); }
+
+		REQUIRE(cout_buf.str() == "111");
+	}
+
+	SECTION("load_file with a binary file with some names")
+	{
+		// the unnamed state 2 must not be merged with the state named "q2"
+		Vata2::Nfa::Nfa aut;
+		aut.add_initial(1);
+		aut.add_trans(1, 0, 2);
+		aut.add_trans(1, 1, 1);
+		aut.add_final(2);
+		Vata2::Nfa::StateToStringMap state_names = {{1, "q2"}};
+		Vata2::Nfa::SymbolToStringMap symbol_names = {{0, "a1"}};
+
+		char filename[] = "/tmp/vata2-test-XXXXXX";
+		int fd = mkstemp(filename);
+		REQUIRE(-1 != fd);
+		close(fd);
+		{
+			std::ofstream os(filename, std::ios::out | std::ios::binary);
+			Vata2::Nfa::save_binary(aut, os, &state_names, &symbol_names);
+		}
+
+		sec.body.push_back({"a1", "=", "(", "load_file", "\"" + std::string(filename) + "\"", ")"});
+		sec.body.push_back({"(", "print", "a1", ")"});
+
+		std::ostringstream cout_buf;
+		cout_redirect cout_guard(cout_buf.rdbuf());
+
+		mach.run_code(sec);
+		unlink(filename);
+
+		std::string output = cout_buf.str();
+		REQUIRE(output.find("q2 -> 0, q2' -> 1") != std::string::npos);
+		REQUIRE(output.find("%Final q1\n") != std::string::npos);
+
+		// the unnamed symbol 1 must not be merged with the symbol named "a1"
+		std::istringstream lines(output);
+		std::set<std::string> symbols;
+		for (std::string line; std::getline(lines, line); ) {
+			if (0 == line.find("q0 ")) {
+				symbols.insert(line.substr(3, line.rfind(' ') - 3));
+			}
+		}
+		REQUIRE(symbols.size() == 2);
+	}
+
 	SECTION("aux")
 	{
 		WARN_PRINT("Insufficient testing of Vata2::VM::VirtualMachine::run_code()");
@@ -170,6 +323,22 @@ TEST_CASE("Vata2::VM::VirtualMachine::run() calls")
 		REQUIRE(val_a1.type == "NFA");
 	}
 
+	SECTION("assignments share values")
+	{
+		sec.type = "NFA";
+		sec.dict.insert({"Name", {"a1"}});
+		mach.run(sec);
+
+		ParsedSection code;
+		code.type = "CODE";
+		code.body.push_back({"a2", "=", "(", "return", "a1", ")"});
+		mach.run(code);
+
+		// the automaton is not copied
+		REQUIRE(mach.load_from_storage("a2").get_ptr() ==
+			mach.load_from_storage("a1").get_ptr());
+	}
+
 	SECTION("aux")
 	{
 		WARN_PRINT("Insufficient testing of Vata2::VM::VirtualMachine::run()");
@@ -223,3 +392,153 @@ TEST_CASE("Vata2::VM::VirtualMachine::default_dispatch() calls")
 		WARN_PRINT("Insufficient testing of Vata2::VM::VirtualMachine::run_code()");
 	}
 }
+
+TEST_CASE("Vata2::VM::VirtualMachine::run_dataflow() calls")
+{
+	// setting the environment
+	VirtualMachine mach;
+	mach.set_dataflow(4);
+	ParsedSection sec;
+	sec.type = "CODE";
+
+	std::ostringstream cout_buf;
+	cout_redirect cout_guard(cout_buf.rdbuf());
+
+	SECTION("calls with side effects in the order of the program")
+	{
+		sec.body.push_back({"s", "=", "(", "return", "\"Hi\"", ")"});
+		sec.body.push_back({"(", "print", "s", ")"});
+		sec.body.push_back({"(", "print", "(", "return", "\" there\"", ")", ")"});
+		sec.body.push_back({"(", "print", "s", ")"});
+		mach.run_code(sec);
+
+		REQUIRE(cout_buf.str() == "Hi thereHi");
+		REQUIRE(" there" != *static_cast<const std::string*>(
+			mach.load_from_storage("s").get_ptr()));
+	}
+
+	SECTION("unused values are not computed")
+	{
+		sec.body.push_back({"a", "=", "(", "invalid_func_name", "\"arg1\"", ")"});
+		sec.body.push_back({"(", "invalid_func_name", "\"arg1\"", ")"});
+		sec.body.push_back({"a", "=", "(", "return", "\"ok\"", ")"});
+		sec.body.push_back({"(", "print", "a", ")"});
+		mach.run_code(sec);
+
+		REQUIRE(cout_buf.str() == "ok");
+	}
+
+	SECTION("last values of variables are computed")
+	{
+		sec.body.push_back({"(", "print", "\"a\"", ")"});
+		sec.body.push_back({"b", "=", "(", "invalid_func_name", "\"arg1\"", ")"});
+		CHECK_THROWS_WITH(mach.run_code(sec),
+			Catch::Contains("is not a defined function"));
+		REQUIRE(cout_buf.str() == "a");
+	}
+
+	SECTION("variables assigned in several sections")
+	{
+		std::vector<ParsedSection> secs(3, sec);
+		secs[0].body.push_back({"x", "=", "(", "return", "\"a\"", ")"});
+		secs[0].body.push_back({"(", "print", "x", ")"});
+		secs[1].body.push_back({"x", "=", "(", "return", "\"b\"", ")"});
+		secs[2].body.push_back({"(", "print", "x", ")"});
+
+		for (const ParsedSection& code : secs) { mach.run_code(code); }
+		std::string dataflow_out = cout_buf.str();
+		cout_buf.str("");
+
+		VirtualMachine serial_mach;
+		for (const ParsedSection& code : secs) { serial_mach.run_code(code); }
+
+		REQUIRE(dataflow_out == "ab");
+		REQUIRE(dataflow_out == cout_buf.str());
+	}
+
+	SECTION("errors of needed values")
+	{
+		sec.body.push_back({"(", "print", "\"a\"", ")"});
+		sec.body.push_back({"b", "=", "(", "invalid_func_name", "\"arg1\"", ")"});
+		sec.body.push_back({"(", "print", "b", ")"});
+		sec.body.push_back({"(", "print", "\"c\"", ")"});
+		CHECK_THROWS_WITH(mach.run_code(sec),
+			Catch::Contains("is not a defined function"));
+		REQUIRE(cout_buf.str() == "a");
+	}
+
+	SECTION("errors of the program")
+	{
+		sec.body.push_back({"(", "print", "\"a\"", ")"});
+		sec.body.push_back({"(", "return", "\"a\"", ")", ")"});
+		sec.body.push_back({"(", "print", "\"b\"", ")"});
+		CHECK_THROWS_WITH(mach.run_code(sec),
+			Catch::Contains("mismatched parenthesis"));
+		REQUIRE(cout_buf.str() == "a");
+	}
+
+	SECTION("variables of previous sections")
+	{
+		ParsedSection aut;
+		aut.type = "NFA";
+		aut.dict.insert({"Name", {"a1"}});
+		aut.dict.insert({"Initial", {"q"}});
+		aut.dict.insert({"Final", {"q"}});
+		aut.body.push_back({"q", "a", "q"});
+
+		sec.body.push_back({"u1", "=", "(", "is_univ", "a1", ")"});
+		sec.body.push_back({"u2", "=", "(", "is_univ", "(", "return", "a1", ")", ")"});
+		sec.body.push_back({"(", "print", "u1", ")"});
+		sec.body.push_back({"(", "print", "u2", ")"});
+
+		mach.run(aut);
+		mach.run_code(sec);
+		std::string dataflow_out = cout_buf.str();
+		cout_buf.str("");
+
+		VirtualMachine serial_mach;
+		serial_mach.run(aut);
+		serial_mach.run_code(sec);
+
+		REQUIRE(dataflow_out.size() == 2);
+		REQUIRE(dataflow_out == cout_buf.str());
+	}
+
+	SECTION("independent calls run in parallel")
+	{
+		// a dispatcher whose calls wait for each other
+		struct Meeting
+		{
+			mutable std::mutex mtx = {};
+			mutable std::condition_variable cond = {};
+			mutable unsigned arrived = 0;
+		};
+
+		static bool registered = false;
+		if (!registered) {
+			reg_dispatcher("MEETING", [](const VMFuncName& name, const VMFuncArgs& args) {
+					if ("meet" != name) { return VMValue(Vata2::TYPE_NOT_A_VALUE, nullptr); }
+
+					const Meeting& meeting = *static_cast<const Meeting*>(args[0].get_ptr());
+					std::unique_lock<std::mutex> lock(meeting.mtx);
+					++meeting.arrived;
+					meeting.cond.notify_all();
+					bool met = meeting.cond.wait_for(lock, std::chrono::seconds(10),
+						[&meeting]() { return 2 <= meeting.arrived; });
+					return VMValue(Vata2::TYPE_STR,
+						std::make_shared<std::string>(met? "met" : "alone"));
+				}, "two calls meeting each other (for tests)");
+			registered = true;
+		}
+
+		Meeting meeting;
+		mach.save_to_storage("m", VMValue::borrow("MEETING", &meeting));
+		sec.body.push_back({"x1", "=", "(", "meet", "m", ")"});
+		sec.body.push_back({"x2", "=", "(", "meet", "m", ")"});
+		sec.body.push_back({"(", "print", "x1", ")"});
+		sec.body.push_back({"(", "print", "x2", ")"});
+		mach.run_code(sec);
+
+		REQUIRE(cout_buf.str() == "metmet");
+	}
+}
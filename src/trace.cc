@@ -0,0 +1,163 @@
+/* trace.cc -- traces of execution in the Chrome trace format
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include <unistd.h>
+
+// VATA headers
+#include <vata2/trace.hh>
+
+using namespace Vata2::Trace;
+
+
+std::atomic<bool> Vata2::Trace::ENABLED(false);
+
+
+namespace
+{
+
+/// the output of the trace
+struct Sink
+{ // {{{
+	std::mutex mtx = {};
+	std::ofstream os = {};
+	/// the process that started the trace
+	pid_t pid = 0;
+	/// the time of start()
+	Clock::time_point origin = {};
+	/// has an event been written (so that the next one needs a comma)?
+	bool nonempty = false;
+	/// the number of threads that have written an event
+	unsigned num_threads = 0;
+}; // Sink }}}
+
+Sink& get_sink()
+{ // {{{
+	// never destroyed, so that threads can finish after static destructors
+	static Sink* sink = new Sink();
+	return *sink;
+} // get_sink }}}
+
+
+/// writes @p str to @p os as a JSON string
+void write_json_string(std::ostream& os, const std::string& str)
+{ // {{{
+	os << "\"";
+	for (char ch : str)
+	{
+		switch (ch)
+		{
+			case '"': os << "\\\""; break;
+			case '\\': os << "\\\\"; break;
+			case '\n': os << "\\n"; break;
+			case '\t': os << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(ch) < 0x20)
+				{
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(ch));
+					os << buf;
+				}
+				else
+				{
+					os << ch;
+				}
+		}
+	}
+	os << "\"";
+} // write_json_string }}}
+
+} // namespace
+
+
+void Vata2::Trace::start(const std::string& filename)
+{ // {{{
+	Sink& sink = get_sink();
+	std::lock_guard<std::mutex> lock(sink.mtx);
+	if (ENABLED.load())
+	{
+		throw std::runtime_error(std::string(__func__) + ": tracing already started");
+	}
+
+	sink.os.open(filename);
+	if (!sink.os)
+	{
+		throw std::runtime_error(std::string(__func__) + ": cannot open \"" +
+			filename + "\"");
+	}
+
+	sink.os << "[\n";
+	sink.pid = getpid();
+	sink.origin = Clock::now();
+	sink.nonempty = false;
+	ENABLED.store(true);
+} // start }}}
+
+
+void Vata2::Trace::stop()
+{ // {{{
+	Sink& sink = get_sink();
+	std::lock_guard<std::mutex> lock(sink.mtx);
+	if (!ENABLED.load()) { return; }
+
+	ENABLED.store(false);
+	if (getpid() != sink.pid)
+	{ // a forked process does not own the file
+		return;
+	}
+
+	sink.os << "\n]\n";
+	sink.os.close();
+} // stop }}}
+
+
+void Vata2::Trace::record(
+	const char*          category,
+	const std::string&   name,
+	Clock::time_point    begin,
+	Clock::time_point    end)
+{ // {{{
+	Sink& sink = get_sink();
+	std::lock_guard<std::mutex> lock(sink.mtx);
+	if (!ENABLED.load(std::memory_order_relaxed) || getpid() != sink.pid)
+	{
+		return;
+	}
+
+	// small numbers of threads are easier to read than std::thread::id
+	thread_local unsigned tid = 0;
+	if (0 == tid) { tid = ++sink.num_threads; }
+
+	using std::chrono::duration_cast;
+	using std::chrono::microseconds;
+
+	if (sink.nonempty) { sink.os << ",\n"; }
+	sink.nonempty = true;
+
+	sink.os << "{\"name\": ";
+	write_json_string(sink.os, name);
+	sink.os << ", \"cat\": ";
+	write_json_string(sink.os, category);
+	sink.os << ", \"ph\": \"X\", \"ts\": " <<
+		duration_cast<microseconds>(begin - sink.origin).count() << ", \"dur\": " <<
+		duration_cast<microseconds>(end - begin).count() << ", \"pid\": " <<
+		sink.pid << ", \"tid\": " << tid << "}";
+} // record }}}
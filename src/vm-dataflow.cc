@@ -0,0 +1,427 @@
+/* vm-dataflow.cc -- the dataflow execution of the VATA virtual machine
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// VATA headers
+#include <vata2/trace.hh>
+#include <vata2/vm.hh>
+#include <vata2/vm-dispatch.hh>
+
+using namespace Vata2::VM;
+
+using Vata2::Code::OpCode;
+using Vata2::Code::Program;
+
+
+namespace
+{
+
+const size_t NO_NODE = static_cast<size_t>(-1);
+
+/// a node of the dataflow graph of a program
+struct Node
+{ // {{{
+	enum class Kind
+	{
+		VALUE,   ///< a string or a token (known in advance)
+		LOAD,    ///< the value of a variable before the program
+		CALL,    ///< a call (Program::calls[arg])
+		ERROR,   ///< an error with the message Program::strings[arg]
+	};
+
+	Kind kind = Kind::VALUE;
+	uint32_t arg = 0;
+	/// nodes of arguments of a call, followed by the previous node with side
+	/// effects (for nodes with side effects)
+	std::vector<size_t> inputs = {};
+	/// the number of arguments of a call in inputs
+	size_t num_args = 0;
+	/// nodes having this node among inputs (if they are needed)
+	std::vector<size_t> users = {};
+
+	/// the node has side effects (it is always evaluated)
+	bool sink = false;
+	/// the value is the last value of a variable (so it is kept till the end)
+	bool stored = false;
+	/// the node is evaluated (it is a sink or an input of a needed node)
+	bool needed = false;
+
+	// the state of the evaluation (guarded by the mutex of the scheduler)
+
+	/// the number of inputs not evaluated yet
+	size_t pending = 0;
+	/// the number of users not evaluated yet (the value is freed at 0)
+	size_t pending_users = 0;
+	bool finished = false;
+
+	VMValue value = {};
+	/// the error of the evaluation (or of an input)
+	std::exception_ptr error = nullptr;
+}; // Node }}}
+
+
+/// the dataflow graph of a program
+struct Graph
+{ // {{{
+	std::vector<Node> nodes = {};
+	/// the nodes with side effects in the order of the program
+	std::vector<size_t> sinks = {};
+	/// the nodes of the last values of variables (or NO_NODE)
+	std::vector<size_t> var_nodes = {};
+}; // Graph }}}
+
+
+/// builds the dataflow graph of @p prog by simulating its stack
+Graph build_graph(const Program& prog)
+{ // {{{
+	Graph graph;
+	std::vector<Node>& nodes = graph.nodes;
+	graph.var_nodes.assign(prog.vars.size(), NO_NODE);
+
+	auto add_node = [&nodes](Node::Kind kind, uint32_t arg) -> size_t {
+		nodes.emplace_back();
+		nodes.back().kind = kind;
+		nodes.back().arg = arg;
+		return nodes.size() - 1;
+	};
+
+	size_t last_sink = NO_NODE;
+	auto add_sink = [&](size_t node) {
+		if (NO_NODE != last_sink) { nodes[node].inputs.push_back(last_sink); }
+		nodes[node].sink = true;
+		graph.sinks.push_back(node);
+		last_sink = node;
+	};
+
+	std::vector<size_t> stack;
+	for (const Vata2::Code::Instr& instr : prog.instrs)
+	{
+		switch (instr.op)
+		{
+			case OpCode::PUSH_STR:
+			case OpCode::PUSH_TOKEN:
+			{
+				size_t node = add_node(Node::Kind::VALUE, instr.arg);
+				nodes[node].value = VMValue(
+					(OpCode::PUSH_STR == instr.op)? Vata2::TYPE_STR : Vata2::TYPE_TOKEN,
+					std::make_shared<std::string>(prog.strings[instr.arg]));
+				stack.push_back(node);
+				break;
+			}
+
+			case OpCode::CALL:
+			{
+				const Vata2::Code::Call& call = prog.calls[instr.arg];
+				std::vector<size_t> inputs;
+				size_t next_on_stack = stack.size() - call.num_stack;
+				for (uint32_t arg : call.args)
+				{
+					if (Vata2::Code::Call::FROM_STACK == arg)
+					{
+						inputs.push_back(stack[next_on_stack++]);
+						continue;
+					}
+
+					size_t& var_node = graph.var_nodes[arg];
+					if (NO_NODE == var_node) { var_node = add_node(Node::Kind::LOAD, arg); }
+					inputs.push_back(var_node);
+				}
+				stack.resize(stack.size() - call.num_stack);
+
+				size_t node = add_node(Node::Kind::CALL, instr.arg);
+				nodes[node].num_args = inputs.size();
+				nodes[node].inputs = std::move(inputs);
+				if (has_side_effect(prog.funcs[call.func])) { add_sink(node); }
+				stack.push_back(node);
+				break;
+			}
+
+			case OpCode::STORE:
+				graph.var_nodes[instr.arg] = stack.back();
+				stack.pop_back();
+				break;
+
+			case OpCode::DISCARD:
+				if (!nodes[stack.back()].sink)
+				{
+					DEBUG_VM_HIGH_PRINT("skipping an unused value");
+				}
+				stack.pop_back();
+				break;
+
+			case OpCode::ERROR:
+				// the rest of the program is never executed
+				add_sink(add_node(Node::Kind::ERROR, instr.arg));
+				return graph;
+		}
+	}
+
+	return graph;
+} // build_graph }}}
+
+
+/// evaluates needed nodes of a graph on a number of threads
+class Scheduler
+{ // {{{
+private:
+
+	const Program& prog;
+	Graph& graph;
+	/// evaluates LOAD nodes
+	std::function<VMValue(const std::string&)> load;
+
+	std::mutex mtx;
+	std::condition_variable cond;
+	/// nodes whose inputs are evaluated
+	std::deque<size_t> ready;
+	/// the number of needed nodes not evaluated yet
+	size_t unfinished;
+	/// a node with side effects failed, so no more nodes are started
+	bool stop;
+
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	/// computes the value of @p node (whose inputs have no errors)
+	VMValue evaluate(const Node& node) const
+	{ // {{{
+		switch (node.kind)
+		{
+			case Node::Kind::VALUE:
+				return node.value;
+
+			case Node::Kind::LOAD:
+				return this->load(this->prog.vars[node.arg]);
+
+			case Node::Kind::ERROR:
+				throw VMException(this->prog.strings[node.arg]);
+
+			case Node::Kind::CALL:
+				break;
+		}
+
+		const Vata2::Code::Call& call = this->prog.calls[node.arg];
+		const std::string& fnc_name = this->prog.funcs[call.func];
+		DEBUG_VM_HIGH_PRINT("Executing " + fnc_name);
+		VATA_TRACE_SCOPE("call", fnc_name);
+
+		VMFuncArgs args;
+		args.reserve(node.num_args);
+		for (size_t i = 0; i < node.num_args; ++i)
+		{ // finished inputs are not modified until the node finishes
+			args.push_back(this->graph.nodes[node.inputs[i]].value);
+		}
+
+		VMValue ret_val = find_dispatcher(args[0].type)(fnc_name, args);
+		if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
+			ret_val = default_dispatch(fnc_name, args);
+			if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
+				throw VMException(fnc_name + " is not a defined function");
+			}
+		}
+
+		return ret_val;
+	} // evaluate }}}
+
+	/// records the evaluation of @p id (with the lock held)
+	void finish(size_t id)
+	{ // {{{
+		Node& node = this->graph.nodes[id];
+		node.finished = true;
+		--this->unfinished;
+		if (node.sink && nullptr != node.error) { this->stop = true; }
+
+		for (size_t user : node.users)
+		{
+			if (0 == --this->graph.nodes[user].pending) { this->ready.push_back(user); }
+		}
+
+		for (size_t input : node.inputs)
+		{
+			Node& input_node = this->graph.nodes[input];
+			if (0 == --input_node.pending_users && !input_node.stored)
+			{ // nobody needs the value anymore
+				input_node.value = VMValue();
+			}
+		}
+
+		this->cond.notify_all();
+	} // finish }}}
+
+public:
+
+	Scheduler(
+		const Program&                                prog,
+		Graph&                                        graph,
+		std::function<VMValue(const std::string&)>    load) :
+		prog(prog),
+		graph(graph),
+		load(std::move(load)),
+		mtx(),
+		cond(),
+		ready(),
+		unfinished(0),
+		stop(false)
+	{ // {{{
+		std::vector<Node>& nodes = this->graph.nodes;
+
+		// nodes are numbered in the order of the program, so inputs of a node
+		// precede it, and needed nodes are found from the last ones; the last
+		// values of variables are needed, as later sections can use them
+		for (size_t sink : this->graph.sinks) { nodes[sink].needed = true; }
+		for (size_t var_node : this->graph.var_nodes)
+		{
+			if (NO_NODE != var_node && Node::Kind::LOAD != nodes[var_node].kind)
+			{
+				nodes[var_node].needed = true;
+			}
+		}
+		for (size_t id = nodes.size(); id > 0; --id)
+		{
+			Node& node = nodes[id - 1];
+			if (!node.needed) { continue; }
+
+			++this->unfinished;
+			node.pending = node.inputs.size();
+			for (size_t input : node.inputs)
+			{
+				nodes[input].needed = true;
+				nodes[input].users.push_back(id - 1);
+				++nodes[input].pending_users;
+			}
+		}
+
+		for (size_t id = 0; id < nodes.size(); ++id)
+		{ // nodes are started in the order of the program
+			if (nodes[id].needed && 0 == nodes[id].pending) { this->ready.push_back(id); }
+		}
+
+		for (size_t var_node : this->graph.var_nodes)
+		{
+			if (NO_NODE != var_node) { nodes[var_node].stored = true; }
+		}
+	} // Scheduler() }}}
+
+	/// evaluates ready nodes until all needed nodes are evaluated (or stopped)
+	void work()
+	{ // {{{
+		std::unique_lock<std::mutex> lock(this->mtx);
+		while (true)
+		{
+			this->cond.wait(lock, [this]() {
+				return this->stop || 0 == this->unfinished || !this->ready.empty(); });
+			if (this->stop || 0 == this->unfinished) { return; }
+
+			size_t id = this->ready.front();
+			this->ready.pop_front();
+			Node& node = this->graph.nodes[id];
+
+			// an error of an input is the error of the node
+			for (size_t input : node.inputs)
+			{
+				if (nullptr != this->graph.nodes[input].error)
+				{
+					node.error = this->graph.nodes[input].error;
+					break;
+				}
+			}
+
+			if (nullptr == node.error)
+			{
+				lock.unlock();
+				VMValue value;
+				std::exception_ptr error = nullptr;
+				try {
+					value = this->evaluate(node);
+				}
+				catch (...) {
+					error = std::current_exception();
+				}
+				lock.lock();
+
+				node.value = std::move(value);
+				node.error = error;
+			}
+
+			this->finish(id);
+		}
+	} // work }}}
+}; // Scheduler }}}
+
+} // anonymous namespace
+
+
+void Vata2::VM::VirtualMachine::run_dataflow(
+	const Code::Program&  prog,
+	size_t                num_threads)
+{ // {{{
+	assert(num_threads > 0);
+
+	Graph graph = build_graph(prog);
+	Scheduler scheduler(prog, graph,
+		[this](const std::string& name) { return this->get_stored(name); });
+
+	// the calling thread is one of the threads
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_threads; ++i)
+	{
+		threads.emplace_back(&Scheduler::work, &scheduler);
+	}
+	scheduler.work();
+	for (std::thread& thread : threads) { thread.join(); }
+
+	// variables get their last values (unless they failed or were not started)
+	for (size_t var = 0; var < prog.vars.size(); ++var)
+	{
+		size_t var_node = graph.var_nodes[var];
+		if (NO_NODE == var_node) { continue; }
+
+		const Node& node = graph.nodes[var_node];
+		if (Node::Kind::LOAD != node.kind && node.finished && nullptr == node.error)
+		{
+			this->save_to_storage(prog.vars[var], node.value);
+		}
+	}
+
+	// sinks are evaluated one after another, so the first failed one is the
+	// only one failed by itself (the following ones are failed or not started)
+	for (size_t sink : graph.sinks)
+	{
+		const Node& node = graph.nodes[sink];
+		if (nullptr != node.error) { std::rethrow_exception(node.error); }
+		assert(node.finished);
+	}
+
+	// otherwise, the first failed value of a variable is reported
+	size_t failed = NO_NODE;
+	for (size_t var_node : graph.var_nodes)
+	{
+		if (NO_NODE != var_node && nullptr != graph.nodes[var_node].error)
+		{
+			failed = std::min(failed, var_node);
+		}
+	}
+
+	if (NO_NODE != failed) { std::rethrow_exception(graph.nodes[failed].error); }
+} // run_dataflow(Program) }}}
@@ -1,5 +1,7 @@
 // TODO: add header
 
+#include <unordered_set>
+
 #include <vata2/vm-dispatch.hh>
 
 // Headers of user data types
@@ -36,6 +38,9 @@ using VMInitFunc = std::function<void()>;
 /// the dispatch function dictionary
 VMDispatcherDict dispatch_dict = { };
 
+/// functions with side effects (of the default dispatcher and of printing)
+std::unordered_set<std::string> side_effects = {"print", "print_stats", "reset_stats"};
+
 
 /// list of init functions --- ADD HERE FUNCTIONS TO BE RUN AT STARTUP
 const VMInitFunc INIT_FUNCTIONS[] =
@@ -88,6 +93,18 @@ void Vata2::VM::reg_dispatcher(
 } // reg_dispatcher }}}
 
 
+void Vata2::VM::reg_side_effect(const VMFuncName& func_name)
+{ // {{{
+	side_effects.insert(func_name);
+} // reg_side_effect }}}
+
+
+bool Vata2::VM::has_side_effect(const VMFuncName& func_name)
+{ // {{{
+	return side_effects.count(func_name) > 0;
+} // has_side_effect }}}
+
+
 const VMDispatcherFunc& Vata2::VM::find_dispatcher(
 	const std::string&       type_name)
 { // {{{
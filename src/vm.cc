@@ -15,6 +15,9 @@
  * GNU General Public License for more details.
  */
 
+#include <vata2/binary.hh>
+#include <vata2/stats.hh>
+#include <vata2/trace.hh>
 #include <vata2/vm.hh>
 #include <vata2/vm-dispatch.hh>
 
@@ -84,7 +87,8 @@ void Vata2::VM::VirtualMachine::run(const Vata2::Parser::ParsedSection& parsec)
 
 	// TODO: is the dispatch OK? shouldn't weget the type of the parsec first?
 
-	VMValue arg(Vata2::TYPE_PARSEC, new Parser::ParsedSection(parsec));
+	// the section outlives the construction, so it is not copied
+	VMValue arg = VMValue::borrow(Vata2::TYPE_PARSEC, &parsec);
 	VMFuncArgs args = {arg};
 	VMValue val = dispatch("construct", args);
 	if (!name.empty()) {
@@ -98,209 +102,111 @@ void Vata2::VM::VirtualMachine::run_code(
 	const Vata2::Parser::ParsedSection& parsec)
 { // {{{
 	DEBUG_VM_LOW_PRINT("VATA-CODE START");
-	for (const auto& line : parsec.body) {
-		assert(this->exec_stack.empty());
-
-		DEBUG_VM_LOW_PRINT(std::to_string(line));
-		this->execute_line(line);
-
-		if (1 == this->exec_stack.size()) { // dead return value
-			const VMValue& last_val = this->exec_stack.top();
-			if (TYPE_VOID != last_val.type) {
-				WARN_PRINT("throwing away an unused value at the stack: " +
-					std::to_string(this->exec_stack.top()));
-			}
-			this->clean_stack();
-		}
-		else if (3 == this->exec_stack.size()) {
-			// assignment
-
-			// the returned value
-			VMValue val = this->exec_stack.top();
-			this->exec_stack.pop();
-
-			// the assignment operator '='
-			VMValue asgn = this->exec_stack.top();
-			if (TYPE_TOKEN != asgn.type || "=" != *static_cast<const std::string*>(asgn.get_ptr())) {
-				call_dispatch_with_self(val, "delete");
-				throw VMException("dangling code or invalid token: " + std::to_string(asgn) +
-					" (expecting '=')");
-			}
-			this->exec_stack.pop();
-			call_dispatch_with_self(asgn, "delete");
-
-			// the target variable
-			VMValue var_name = this->exec_stack.top();
-			if (TYPE_TOKEN != var_name.type) {
-				call_dispatch_with_self(val, "delete");
-				throw VMException("dangling code or invalid token: " + std::to_string(asgn) +
-					" (expecting '=')");
-			}
-			this->exec_stack.pop();
-			assert(this->exec_stack.empty());
-			std::string var_name_str = *static_cast<const std::string*>(var_name.get_ptr());
-			call_dispatch_with_self(var_name, "delete");
-
-			// TODO: check var_name_str is a good variable name
-			this->save_to_storage(var_name_str, val);
-		}
-		else {
-			assert(this->exec_stack.size() > 1);
-			std::string dangling = std::to_string(this->exec_stack);
-			this->clean_stack();
-			throw VMException("dangling code in a CODE section: " + dangling);
-		}
-
+	VATA_TRACE_SCOPE("vm", "@" + parsec.type);
+	Code::Program prog = Code::compile(parsec);
+	DEBUG_VM_LOW_PRINT_LN("compiled code:\n" << prog);
+	if (0 == this->dataflow_threads) {
+		this->run_program(prog);
+	} else {
+		this->run_dataflow(prog, this->dataflow_threads);
 	}
-
 	DEBUG_VM_LOW_PRINT("VATA-CODE END");
-	DEBUG_VM_LOW_PRINT("Stack: " + std::to_string(this->exec_stack));
 } // run_code(ParsedSection) }}}
 
 
-void Vata2::VM::VirtualMachine::execute_line(
-	const Vata2::Parser::BodyLine& line)
+void Vata2::VM::VirtualMachine::run_program(const Code::Program& prog)
 { // {{{
-	for (const std::string& tok : line) {
-		this->process_token(tok);
-	}
-} // execute_line(BodyLine) }}}
-
-
-void Vata2::VM::VirtualMachine::process_token(
-	const std::string& tok)
-{ // {{{
-	if (")" != tok) { // nothing special
-		DEBUG_VM_LOW_PRINT("allocating memory for token " + tok);
-		if (('\"' == tok[0]) && ('\"' == tok[tok.length()-1])) { // for strings
-			std::string* str = new std::string(tok, 1, tok.length()-2);
-			VMValue val(TYPE_STR, str);
-			this->push_to_stack(val);
-		} else { // for tokens
-			std::string* str = new std::string(tok);
-			VMValue val(TYPE_TOKEN, str);
-			this->push_to_stack(val);
-		}
-	} else { // closing parenthesis - execute action
-		assert(")" == tok);
-
-		std::vector<VMValue> exec_vec;
-		bool closed = false;
-		while (!this->exec_stack.empty()) {
-			const VMValue& st_top = this->exec_stack.top();
-			DEBUG_VM_LOW_PRINT("top of stack type: " + st_top.type);
-			if (TYPE_TOKEN == st_top.type) {
-				assert(nullptr != st_top.get_ptr());
-				const std::string& val = *static_cast<const std::string*>(st_top.get_ptr());
-				DEBUG_VM_LOW_PRINT("top of stack token value: " + val);
-				if ("(" == val) {
-					closed = true;
-					call_dispatch_with_self(st_top, "delete");
-					this->exec_stack.pop();   // NEEDS TO BE AFTER THE CALL!!
-					break;
+	using Code::OpCode;
+
+	// values computed by the program (strings and results of calls)
+	std::vector<VMValue> stack;
+	// arguments of calls (allocated only once)
+	VMFuncArgs args;
+	args.reserve(prog.max_args);
+	// dispatchers of calls for the type of the first argument in the last call
+	std::vector<std::pair<std::string, const VMDispatcherFunc*>> dispatchers(
+		prog.calls.size(), {std::string(), nullptr});
+	// values of variables in the memory (found at the first access)
+	std::vector<const VMValue*> vars(prog.vars.size(), nullptr);
+
+	// the values left at the stack after an exception are freed with it
+	for (const Code::Instr& instr : prog.instrs) {
+		switch (instr.op) {
+			case OpCode::PUSH_STR:
+				stack.push_back(VMValue(TYPE_STR,
+					std::make_shared<std::string>(prog.strings[instr.arg])));
+				break;
+
+			case OpCode::PUSH_TOKEN:
+				stack.push_back(VMValue(TYPE_TOKEN,
+					std::make_shared<std::string>(prog.strings[instr.arg])));
+				break;
+
+			case OpCode::CALL: {
+				const Code::Call& call = prog.calls[instr.arg];
+				const std::string& fnc_name = prog.funcs[call.func];
+				DEBUG_VM_HIGH_PRINT("Executing " + fnc_name);
+				VATA_TRACE_SCOPE("call", fnc_name);
+
+				// constructing the arguments
+				const size_t first_on_stack = stack.size() - call.num_stack;
+				size_t next_on_stack = first_on_stack;
+				args.clear();
+				for (uint32_t arg : call.args) {
+					if (Code::Call::FROM_STACK == arg) { // the stack gives it up below
+						args.push_back(std::move(stack[next_on_stack++]));
+						continue;
+					}
+
+					if (nullptr == vars[arg]) { vars[arg] = &this->get_stored(prog.vars[arg]); }
+					args.push_back(*vars[arg]);
 				}
-				else { /* do nothing */ }
-			}
-			else { /* do nothing */ }
 
-			exec_vec.insert(exec_vec.begin(), st_top);
-			this->exec_stack.pop();
-		}
+				// the dispatcher is given by the type of the first argument
+				auto& type_dispatcher = dispatchers[instr.arg];
+				if (nullptr == type_dispatcher.second || type_dispatcher.first != args[0].type) {
+					type_dispatcher = {args[0].type, &find_dispatcher(args[0].type)};
+				}
 
-		auto clean_exec_vec = [&exec_vec]()
-			{
-				// deallocate elements in exec_vec
-				for (const auto& val : exec_vec) {
-					DEBUG_VM_LOW_PRINT("exec_vec: deleting " + std::to_string(val));
-					call_dispatch_with_self(val, "delete");
+				VMValue ret_val = (*type_dispatcher.second)(fnc_name, args);
+				if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
+					ret_val = default_dispatch(fnc_name, args);
+					if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
+						throw VMException(fnc_name + " is not a defined function");
+					}
 				}
-			};
 
-		// below here, we should have a try block, catch exceptions, and deallocate
-		// the memory taken by the content of the execution stack
-		try {
-			if (!closed) {
-				throw VMException("mismatched parenthesis");
+				// the arguments from the stack are replaced by the result (the
+				// arguments are freed unless they are referred to elsewhere)
+				stack.resize(first_on_stack);
+				args.clear();
+				stack.push_back(std::move(ret_val));
+				break;
 			}
 
-			this->exec_cmd(exec_vec);
-		}
-		catch (const VMException& ex) {
-			DEBUG_VM_HIGH_PRINT("VM: caught the following VMException: " +
-				std::to_string(ex.what()));
-			// clean exec_vec and the whole stack
-			DEBUG_VM_LOW_PRINT("VM: cleaning the execution vector and execution stack");
-			clean_exec_vec();
-			DEBUG_VM_LOW_PRINT("VM: execution vector clean");
-			this->clean_stack();
-			DEBUG_VM_LOW_PRINT("VM: execution stack clean");
-			throw;
-		}
-		catch (...) {
-			assert(false);
-		}
-
-		clean_exec_vec();
-	}
-} // process_token(string) }}}
-
-
-void Vata2::VM::VirtualMachine::exec_cmd(
-	const std::vector<VMValue>& exec_vec)
-{ // {{{
-	DEBUG_VM_HIGH_PRINT("Executing " + std::to_string(exec_vec));
-
-	if (exec_vec.empty()) {
-		throw VMException("\"()\" is not a valid function call");
-	}
-
-	// getting the function name
-	const VMValue& fnc_val = exec_vec[0];
-	if (TYPE_TOKEN != fnc_val.type) {
-		std::string err_string = "(" + std::to_string(fnc_val);
-		for (size_t i = 1; i < exec_vec.size(); ++i) {
-			err_string += ", " + std::to_string(exec_vec[i]);
-		}
-		err_string += ")";
-
-		throw VMException("\"" + err_string + "\" is not a valid function call");
-	}
-
-	// assert(TYPE_TOKEN == fnc_val.type);
-	assert(nullptr != fnc_val.get_ptr());
-	const std::string& fnc_name = *static_cast<const std::string*>(fnc_val.get_ptr());
-
-	if (exec_vec.size() <= 1) {
-		throw VMException("\"(" + fnc_name + ")\" is not a valid function call");
-	}
-
-	// constructing the arguments
-	std::vector<VMValue> args;
-	for (auto it = exec_vec.begin() + 1; it != exec_vec.end(); ++it) {
-		if (TYPE_TOKEN == it->type) {
-			const std::string& var_name = *static_cast<const std::string*>(it->get_ptr());
-			VMValue val = load_from_storage(var_name);
-			args.push_back(val);
-		} else {
-			args.push_back(*it);
-		}
-	}
+			case OpCode::STORE: {
+				const std::string& var_name = prog.vars[instr.arg];
+				this->save_to_storage(var_name, std::move(stack.back()));
+				stack.pop_back();
+				vars[instr.arg] = &this->get_stored(var_name);
+				break;
+			}
 
-	// getting the object type (type of the first argument of the function) and
-	// removing it from the arguments
-	VMValue arg1_val = args[0];
-	const std::string& arg1_type = arg1_val.type;
+			case OpCode::DISCARD: { // dead return value
+				const VMValue& last_val = stack.back();
+				if (TYPE_VOID != last_val.type) {
+					WARN_PRINT("throwing away an unused value at the stack: " +
+						std::to_string(last_val));
+				}
+				stack.pop_back();
+				break;
+			}
 
-	VMValue ret_val = find_dispatcher(arg1_type)(fnc_name, args);
-	if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
-		ret_val = default_dispatch(fnc_name, args);
-		if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
-			throw VMException(fnc_name + " is not a defined function");
+			case OpCode::ERROR:
+				throw VMException(prog.strings[instr.arg]);
 		}
 	}
-
-	this->push_to_stack(ret_val);
-} // exec_cmd(std::vector) }}}
+} // run_program(Program) }}}
 
 
 Vata2::VM::VMValue Vata2::VM::default_dispatch(
@@ -315,12 +221,8 @@ Vata2::VM::VMValue Vata2::VM::default_dispatch(
 				std::to_string(func_args.size()) + " provided)");
 		}
 
-		VMValue ret_val = call_dispatch_with_self(func_args[0], "copy");
-		if (Vata2::TYPE_NOT_A_VALUE == ret_val.type) {
-			throw VMException("The type \"" + func_args[0].type +
-				"\" does not implement the \"copy\" operation");
-		}
-		return ret_val;
+		// values are immutable, so the result shares the object of the argument
+		return func_args[0];
 	}
 
 	if ("load_file" == func_name) {
@@ -337,11 +239,29 @@ Vata2::VM::VMValue Vata2::VM::default_dispatch(
 
 		const std::string& filename = *(static_cast<const std::string*>(func_args[0].get_ptr()));
 		DEBUG_VM_HIGH_PRINT("loading file " + filename);
-		std::fstream fs(filename, std::ios::in);
+		std::fstream fs(filename, std::ios::in | std::ios::binary);
 		if (!fs) {
 			throw VMException("could not open file \"" + filename + "\"");
 		}
 
+		// binary files are loaded by the dispatcher of their type
+		Binary::Header header;
+		fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (Binary::has_magic(header.magic, fs.gcount())) {
+			std::string type = Binary::read_header(
+				reinterpret_cast<const char*>(&header), fs.gcount());
+			DEBUG_VM_HIGH_PRINT("loading a binary file with " + type + " from " + filename);
+			VMValue res = Vata2::VM::find_dispatcher(type)("load_binary", func_args);
+			if (Vata2::TYPE_NOT_A_VALUE == res.type) {
+				throw VMException("the type \"" + type +
+					"\" does not implement the \"load_binary\" operation");
+			}
+			return res;
+		}
+
+		fs.clear();
+		fs.seekg(0);
+
 		// TODO: handle keepQuotes?
 		Parser::Parsed prs = Parser::parse_vtf(fs);
 		if (prs.size() != 1) {
@@ -349,30 +269,41 @@ Vata2::VM::VMValue Vata2::VM::default_dispatch(
 				" sections; only 1 section per loaded file is supported in load_file calls");
 		}
 
-		// Parser::ParsedSection* sec = new Parser::ParsedSection(std::move(prs[0]));
 		// TODO: handle more sections
-		Parser::ParsedSection* sec = new Parser::ParsedSection(std::move(prs[0]));
+		const Parser::ParsedSection& sec = prs[0];
 		assert(prs.size() == 1);
-		DEBUG_VM_HIGH_PRINT("loaded a section of the type \"" + sec->type +
+		DEBUG_VM_HIGH_PRINT("loaded a section of the type \"" + sec.type +
 			"\" from file " + filename);
-		VMValue sec_val(TYPE_PARSEC, sec);
+		VMValue sec_val = VMValue::borrow(TYPE_PARSEC, &sec);
 		VMFuncArgs args = {sec_val};
-		VMDispatcherFunc dispatch = Vata2::VM::find_dispatcher(sec->type);
+		VMDispatcherFunc dispatch = Vata2::VM::find_dispatcher(sec.type);
 		VMValue res = dispatch("construct", args);
 
 		return res;
 	}
 
+	// statistics of operations (aggregated over all threads); the argument is
+	// a title of the printed statistics
+	if ("print_stats" == func_name || "reset_stats" == func_name) {
+		if (func_args.size() != 1 || func_args[0].type != TYPE_STR) {
+			throw VMException("\"" + func_name + "\" requires 1 argument of the type \"" +
+				std::string(TYPE_STR) + "\"");
+		}
+
+		if ("reset_stats" == func_name) {
+			Stats::reset();
+		} else {
+			const std::string& title = *(static_cast<const std::string*>(func_args[0].get_ptr()));
+			std::cout << "statistics (" << title << "):\n" << Stats::get_total();
+		}
+
+		return VMValue(TYPE_VOID, nullptr);
+	}
+
 	return VMValue(Vata2::TYPE_NOT_A_VALUE, nullptr);
 } // default_dispatch() }}}
 
 
-void Vata2::VM::VirtualMachine::push_to_stack(VMValue val)
-{ // {{{
-	DEBUG_VM_LOW_PRINT("VM: pushing " + std::to_string(val) + " on the stack");
-	this->exec_stack.push(val);
-} // push_to_stack() }}}
-
 void Vata2::VM::VirtualMachine::save_to_storage(
 	const std::string&  name,
 	VMValue             val)
@@ -382,11 +313,17 @@ void Vata2::VM::VirtualMachine::save_to_storage(
 	if (this->mem.end() != iter) { // name already used
 		WARN_PRINT("rewriting stored value of " + name + ": " + std::to_string(val));
 	}
-	this->mem[name] = val;
+	this->mem[name] = std::move(val);
 } // save_to_storage()
 
 Vata2::VM::VMValue Vata2::VM::VirtualMachine::load_from_storage(
 	const std::string& name) const
+{ // {{{
+	return this->get_stored(name);
+} // load_from_storage() }}}
+
+const Vata2::VM::VMValue& Vata2::VM::VirtualMachine::get_stored(
+	const std::string& name) const
 { // {{{
 	DEBUG_VM_LOW_PRINT("retrieving object \"" + name + "\" from the memory");
 	auto it = this->mem.find(name);
@@ -395,16 +332,4 @@ Vata2::VM::VMValue Vata2::VM::VirtualMachine::load_from_storage(
 	}
 
 	return it->second;
-} // load_from_storage() }}}
-
-
-void Vata2::VM::VirtualMachine::clean_stack()
-{ // {{{
-	while (!this->exec_stack.empty()) {
-		const auto& val = this->exec_stack.top();
-		DEBUG_VM_LOW_PRINT("VM: cleaning " + std::to_string(val) + " from the stack");
-		call_dispatch_with_self(val, "delete");
-		this->exec_stack.pop();   // NEEDS TO BE AFTER THE CALL!!
-	}
-} // clean_stack() }}}
-
+} // get_stored() }}}
@@ -12,15 +12,10 @@ namespace
 {
 	VMValue void_dispatch(
 		const VMFuncName&  func_name,
-		const VMFuncArgs&  func_args)
+		const VMFuncArgs&  /* func_args */)
 	{
 		DEBUG_PRINT("calling function \"" + func_name + "\" for " + Vata2::TYPE_VOID);
 
-		if ("delete" == func_name) {
-			assert(func_args.size() == 1);
-			return VMValue(Vata2::TYPE_VOID, nullptr);
-		}
-
 		return VMValue(Vata2::TYPE_NOT_A_VALUE, nullptr);
 	}
 }